@@ -20,7 +20,9 @@
 #define _XTAL_FREQ   20000000UL           // cristal 20 MHz
 #define FCY          (_XTAL_FREQ/4UL)     // 5 MHz
 #include <xc.h>
+#include <stdint.h>
 #include <libpic30.h>
+#include "pwm_dutyset.h"
 
 /* =======  PWM 10 kHz – 70 %  ======= */
 #define PWM_HZ       10000UL              // 10 kHz
@@ -39,6 +41,23 @@
 #define BLINK_TRIS   TRISDbits.TRISD1
 #define BLINK_LAT    LATDbits.LATD1
 
+/* Costo medido del commit atómico (TMR2 libre a TCY) */
+static volatile uint16_t g_commit_tcy     = 0;
+static volatile uint16_t g_commit_tcy_max = 0;
+
+/* ----------  Duty de las tres fases en un solo límite de periodo  ---------- */
+static void setAllDuties(uint16_t pdc1, uint16_t pdc2, uint16_t pdc3)
+{
+    const uint16_t pdc[3] = { pdc1, pdc2, pdc3 };
+
+    uint16_t t0 = TMR2;
+    pwm_duty_commit(pdc);             // UDIS = 1, PDC1..3, UDIS = 0
+    uint16_t dt = TMR2 - t0;
+
+    g_commit_tcy = dt;
+    if (dt > g_commit_tcy_max) g_commit_tcy_max = dt;
+}
+
 /* ----------  Timer 1: parpadeo  ---------- */
 void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
 {
@@ -97,18 +116,17 @@ static void initAllPWMs70(void)
     /* 5) Sin dead-time */
     DTCON1 = 0;
 
-    /* 6) Duty cycle fijo 70% */
-    PDC1 = PDC2 = PDC3 = PDC_70;
+    /* 6) Carga en el límite de periodo (IUE = 0) y duty fijo 70 %,
+          los tres canales juntos */
+    pwm_dutyset_init();
+    setAllDuties(PDC_70, PDC_70, PDC_70);
 
     /* 7) Activa control PWM sobre pines Low-side */
     OVDCONbits.POVD1L = 1;
     OVDCONbits.POVD2L = 1;
     OVDCONbits.POVD3L = 1;
 
-    /* 8) Actualización inmediata del duty-cycle */
-    PWMCON2bits.IUE = 1;
-
-    /* 9) Enciende módulo PWM */
+    /* 8) Enciende módulo PWM */
     PTCONbits.PTEN  = 1;
 }
 
@@ -116,14 +134,19 @@ int main(void)
 {
     __builtin_disable_interrupts();
 
+    T2CON = 0; PR2 = 0xFFFF;          // Timer 2 libre a TCY: mide el commit
+    T2CONbits.TON = 1;
+
     initBlink_T1();       // Timer 1  → LED 10 Hz (prioridad 5)
     initAllPWMs70();      // PWM1/2/3 al 70 %
 
-    /* Timer 2 reservado: prioridad menor (3) si lo habilitas
-       IPC1bits.T2IP = 3; */
-
     __builtin_enable_interrupts();
 
-    while (1) { /* loop vacío */ }
+    while (1) {
+        /* Re-commit periódico del mismo juego: sólo para medir g_commit_tcy
+           (o poner un breakpoint y usar el cronómetro del simulador) */
+        setAllDuties(PDC_70, PDC_70, PDC_70);
+        __delay_ms(10);
+    }
     return 0;
 }
@@ -22,6 +22,7 @@
 #define STEP_MS         10UL        // resolución 10 ms
 #include <xc.h>
 #include <libpic30.h>
+#include "../0160_dspic30f_soft_timers/timer_wheel.h"
 
 
 /* === LED blink en RD1 === */
@@ -86,18 +87,21 @@ static void initPWM1L(void)
     PTCONbits.PTEN  = 1;            // arranca PWM
 }
 
-/* ========== Timer1: actualiza duty cada 10 ms ========== */
-#define T1_PRESC 64
-#define T1_PR    ((FCY / T1_PRESC / 1000) * STEP_MS - 1) // ~780
+/* ========== Timer1: tick de 1 ms para timer_wheel.h ==========
+ * Rampa y blink son temporizadores por software sobre este único tick;
+ * Timer2/3 quedan libres (disparo del ADC, captura).                 */
+#define TICK_MS  1UL
+#define T1_PRESC 8
+#define T1_PR    ((FCY / T1_PRESC / 1000) * TICK_MS - 1) // 624
 
 static void initTimer1(void)
 {
     T1CON = 0;
     PR1   = T1_PR;
-    T1CONbits.TCKPS = 0b10;          // 1:64
+    T1CONbits.TCKPS = 0b01;          // 1:8
     IFS0bits.T1IF   = 0;
     IEC0bits.T1IE   = 1;
-    IPC0bits.T1IP   = 4;
+    IPC0bits.T1IP   = TW_IPL;
     T1CONbits.TON   = 1;
 }
 
@@ -105,36 +109,40 @@ static void initTimer1(void)
 void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
 {
     IFS0bits.T1IF = 0;
+    tw_tick();                            // corre los callbacks vencidos
+}
+
+/* ======== Rampa: actualiza duty cada 10 ms ======== */
+static tw_timer_t ramp_tmr;
+
+static void ramp_step(void *arg)
+{
+    (void)arg;
     duty += dir * duty_step;
     if (duty >= duty_max) { duty = duty_max; dir = -1; }
     else if (duty == 0)   { dir = +1; }
     PDC1 = duty;                          // *** actualiza PWM1L/RE0 ***
 }
 
-/* ======== Timer2: blink LED cada 100 ms ======== */
+/* ======== Blink LED cada 100 ms ======== */
 #define BLINK_MS 100UL
-#define T2_PRESC 64
-#define T2_PR    ((FCY / T2_PRESC / 1000) * BLINK_MS - 1) // ~7812
+static tw_timer_t blink_tmr;
+
+static void blink_toggle(void *arg)
+{
+    (void)arg;
+    BLINK_LAT ^= 1;
+}
 
-static void initTimer2(void)
+static void initSoftTimers(void)
 {
     // LED en RD1
     BLINK_TRIS = 0;
     BLINK_LAT  = 0;
 
-    T2CON = 0;
-    PR2   = T2_PR;
-    T2CONbits.TCKPS = 0b10;          // 1:64
-    IFS0bits.T2IF = 0;
-    IEC0bits.T2IE = 1;
-    IPC1bits.T2IP = 3;
-    T2CONbits.TON = 1;
-}
-
-void __attribute__((interrupt, auto_psv)) _T2Interrupt(void)
-{
-    IFS0bits.T2IF = 0;
-    BLINK_LAT ^= 1;
+    tw_init();
+    tw_start(&ramp_tmr,  STEP_MS / TICK_MS,  STEP_MS / TICK_MS,  ramp_step,    NULL);
+    tw_start(&blink_tmr, BLINK_MS / TICK_MS, BLINK_MS / TICK_MS, blink_toggle, NULL);
 }
 
 /* ===================== MAIN ===================== */
@@ -142,8 +150,8 @@ int main(void)
 {
     __builtin_disable_interrupts();
     initPWM1L();
+    initSoftTimers();
     initTimer1();
-    initTimer2();
     __builtin_enable_interrupts();
 
     while (1) { /* todo por ISRs */ }
@@ -0,0 +1,216 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  medio puente (PWM1H/PWM1L) complementario con tiempo
+ *         muerto verificado al compilar y compensación por polaridad
+ *
+ *  – PWM1 centrado a 20 kHz, PMOD1 = 0: PWM1H (RE1) y PWM1L (RE0)
+ *    complementarios con PWM_DT_NS de tiempo muerto (pwm_deadtime.h).
+ *  – Carga RL entre la salida del medio puente y el punto medio del
+ *    bus (divisor capacitivo). Referencia senoidal de DRIVE_FREQ_HZ
+ *    con amplitud fijada por el potenciómetro de AN1.
+ *  – El special event en el valle (SEVTCMP = 0) dispara el ADC: CH1
+ *    muestrea la corriente (AN0, sensor bipolar con offset a media
+ *    escala, > 0 saliendo de la rama) en el centro del pulso de
+ *    PWM1H, donde vale su media del periodo, y CH0 el potenciómetro.
+ *  – _ADCInterrupt calcula el duty y, si g_dtc_on, le suma la
+ *    corrección de tiempo muerto según el signo de la corriente
+ *    medida. Con g_dtc_on = 0 se ve la distorsión típica: corriente
+ *    plana en los cruces por cero y amplitud menor a duty bajo.
+ *    Con amplitud por debajo de Td/T la corrección se apaga
+ *    (pwm_dtc_modulation): ahí compensar empeora la forma de onda.
+ *  – host/deadtime_sim.c simula este mismo lazo y mide el error de
+ *    tensión y la distorsión antes y después de compensar.
+ *  – g_isr_tcy / g_isr_tcy_max: costo de la ISR medido con TMR1.
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN    // PWM en alta impedancia tras reset
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_ON
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+/* PWM centrado: periodo = 2·(PTPER + 1)·TCY, PDC de 0 a 2·(PTPER + 1) */
+#define PWM_FREQ_HZ     20000UL
+#define PTPER_VAL       ((FCY / (2UL * PWM_FREQ_HZ)) - 1)  // 736
+#define PDC_HALF        (PTPER_VAL + 1)
+#define PDC_MAX         (2U * PDC_HALF)
+
+/* Tiempo muerto: verificado contra el periodo en pwm_deadtime.h */
+#define PWM_DT_NS          1000
+#define PWM_DT_PERIOD_TCY  (2UL * PDC_HALF)
+
+/* Compensación: banda lineal de ±2^9 LSB Q15 (≈ 1.6 % del fondo) */
+#define DTC_BAND_SHIFT  9U
+
+/* Referencia senoidal: Δθ por periodo = f · 65536 / f_pwm */
+#define DRIVE_FREQ_HZ   50UL
+#define THETA_STEP      ((uint16_t)((DRIVE_FREQ_HZ * 65536UL) / PWM_FREQ_HZ))
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "pwm_deadtime.h"
+#include "../0050_dspic30f_dsp_core/q15_math.h"
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static pwm_dtc_t         g_dtc;
+static volatile uint16_t g_dtc_on      = 1;  // 0 → sin compensar (comparar)
+static volatile q15_t    g_i_offset    = 0;
+static volatile q15_t    g_i           = 0;  // última corriente, Q15
+static volatile uint16_t g_pdc         = PDC_HALF;
+static uint16_t          g_theta       = 0;
+static volatile uint16_t g_isr_tcy     = 0;
+static volatile uint16_t g_isr_tcy_max = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timer1_init_stamp(void);
+static void pwm_init_half_bridge(void);
+static void adc_init_pwm_trigger(void);
+static void calibrate_offset(void);
+
+/* ——————————————————— TIMER1: sello de ciclos ——————————— */
+static void timer1_init_stamp(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0;       // 1:1 → un tick por TCY
+    T1CONbits.TON   = 1;
+}
+
+/* ——————————————————— PWM1: medio puente complementario ——————— */
+static void pwm_init_half_bridge(void)
+{
+    PTCONbits.PTEN   = 0;
+    PTCONbits.PTCKPS = 0;      // 1:1 (lo supone PWM_DT_COMP_CENTER)
+    PTCONbits.PTMOD  = 0b10;   // up/down, centrado
+    PTPER = PTPER_VAL;
+
+    PWMCON1 = 0;
+    pwm_complementary_init(0x1U);   // PWM1H/PWM1L + DTCON1
+
+    OVDCON = 0x0000;           // ambas salidas forzadas a inactivo
+    PDC1   = PDC_HALF;         // 50 % → tensión media cero
+
+    SEVTCMP = 0;               // special event en el valle
+    PWMCON2 = 0;
+    PWMCON2bits.SEVOPS = 0;    // todos los periodos
+    PWMCON2bits.IUE    = 0;    // PDC1 entra en el valle
+
+    pwm_dtc_init(&g_dtc, PWM_DT_COMP_CENTER, DTC_BAND_SHIFT, PDC_MAX);
+
+    PTCONbits.PTEN = 1;
+}
+
+/* ——————————————————— ADC: CH0 = AN1 (pot), CH1 = AN0 (i) ———— */
+static void adc_init_pwm_trigger(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFGbits.PCFG0 = 0;
+    ADPCFGbits.PCFG1 = 0;
+
+    ADCON1 = 0;
+    ADCON1bits.FORM   = 0b11;  // fraccional con signo → Q15
+    ADCON1bits.SSRC   = 0b011; // special event del PWM
+    ADCON1bits.SIMSAM = 1;
+    ADCON1bits.ASAM   = 1;
+
+    ADCON2 = 0;
+    ADCON2bits.CHPS = 0b01;    // CH0 y CH1
+    ADCON2bits.SMPI = 1;       // IRQ tras las dos conversiones
+
+    ADCON3bits.ADCS = 9;       // TAD ≈ 170 ns
+    ADCON3bits.SAMC = 2;
+
+    ADCHS = 0;
+    ADCHSbits.CH123SA = 0;     // CH1 = AN0
+    ADCHSbits.CH0SA   = 1;     // CH0 = AN1
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 6;
+    IEC0bits.ADIE = 0;         // se habilita tras calibrar
+
+    ADCON1bits.ADON = 1;
+}
+
+/* ——————————————————— OFFSET DEL SENSOR CON EL PUENTE APAGADO ——— */
+static void calibrate_offset(void)
+{
+    int32_t s = 0;
+    for (uint16_t n = 0; n < 64; n++) {
+        IFS0bits.ADIF = 0;
+        while (!IFS0bits.ADIF);
+        s += (q15_t)ADCBUF1;
+    }
+    g_i_offset = (q15_t)(s >> 6);
+
+    IFS0bits.ADIF = 0;
+    IEC0bits.ADIE = 1;
+}
+
+/* ——————————————————— ADC INTERRUPT: un periodo ——————————————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    uint16_t t0 = TMR1;
+    IFS0bits.ADIF = 0;
+
+    q15_t amp = (q15_t)ADCBUF0;                     // pot, −1…1
+    if (amp < 0) amp = 0;
+    q15_t i   = q15_sat((q31_t)(q15_t)ADCBUF1 - g_i_offset);
+    g_i = i;
+
+    /* v = amp · sin θ, base Vdc/2 → PDC = half · (1 + v) */
+    g_theta += THETA_STEP;
+    q15_t    v   = q15_mul(amp, q15_sin(g_theta));
+    uint16_t pdc = (uint16_t)(PDC_HALF + (((q31_t)v * PDC_HALF) >> Q15_SHIFT));
+
+    if (g_dtc_on) {
+        pwm_dtc_modulation(&g_dtc, amp);            // sin corrección en la zona muerta
+        pdc = pwm_dtc_apply(&g_dtc, pdc, i);
+    }
+    PDC1  = pdc;
+    g_pdc = pdc;
+
+    uint16_t dt = TMR1 - t0;
+    g_isr_tcy = dt;
+    if (dt > g_isr_tcy_max) g_isr_tcy_max = dt;
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    TRISEbits.TRISE0 = 0;      // PWM1L
+    TRISEbits.TRISE1 = 0;      // PWM1H
+
+    timer1_init_stamp();
+    pwm_init_half_bridge();
+    adc_init_pwm_trigger();
+    calibrate_offset();        // salidas todavía forzadas a bajo
+
+    OVDCONbits.POVD1H = 1;     // el PWM toma los dos pines
+    OVDCONbits.POVD1L = 1;
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        /* todo el control corre en _ADCInterrupt */
+    }
+    return 0;
+}
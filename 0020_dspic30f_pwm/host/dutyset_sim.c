@@ -0,0 +1,292 @@
+/*************************************************************
+ *  dutyset_sim – commit de PDC1…PDC3 de pwm_dutyset.h contra la
+ *  base de tiempo del PWM, simulado en PC a resolución de TCY
+ *
+ *  cc -O2 -Wall -I.. -o dutyset_sim dutyset_sim.c
+ *  (con -DPWM_COMMIT_GUARD=n se prueba otra guarda)
+ *
+ *  Se incluye el mismo pwm_dutyset.h que el firmware. PTMR, PTPER,
+ *  PTCONbits, PWMCON2bits y PDC1…PDC3 son funciones que avanzan el
+ *  reloj simulado lo que cuestan la instrucción que toca el registro
+ *  y las que la rodean; los costos C_* son estimados del código con
+ *  XC16 -O1 (pwm_duty_commit inline, pdc en W0). Se modela:
+ *    – base de tiempo con prescaler 1:1. PTMOD 0: 0…PTPER, carga al
+ *      volver a 0. PTMOD 2: sube 0…PTPER y baja PTPER…0, periodo
+ *      2·(PTPER + 1), PTMR<15> = 1 bajando, carga en el valle.
+ *      PTMOD 3: además carga al empezar a bajar (pico)
+ *    – búferes PDCx con IUE = 0: pasan juntos a los registros
+ *      activos en cada límite de carga, salvo con UDIS = 1
+ *  Casos (PASS/FAIL; el código de salida es el número de fallas):
+ *    1 pwm_ticks_to_load – en cada valor de PTMR de los tres modos
+ *                          nunca da más cuentas que las que faltan
+ *                          de verdad, y a lo sumo 2 menos
+ *    2 commit            – desde cada fase de un periodo: ningún
+ *                          límite cae con UDIS = 1, el juego entra
+ *                          completo en el primer límite después del
+ *                          retorno y el costo PTMR → BCLR no pasa
+ *                          de PWM_COMMIT_GUARD
+ *    3 sin UDIS          – tres MOV seguidos a PDC1…PDC3: cuántas
+ *                          fases por periodo dejan un juego mezclado
+ *************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+
+#define PTPER_VAL       736U               // 20 kHz up/down a 29.48 MHz
+
+/* Costos (TCY), estimados de XC16 -O1 */
+#define C_PTEN          2U                 // BTSS PTCON,#15 + BRA
+#define C_PTMR          1U                 // MOV PTMR,W1  (la muestra)
+#define C_PTPER         1U                 // MOV PTPER,W2
+#define C_LOOP_EXIT     2U                 // CP + BRA no tomado
+#define C_LOOP_BACK     3U                 // CP + BRA tomado
+#define C_BSET          1U
+#define C_PDC           2U                 // MOV [W0+k],W1 + MOV W1,PDCx
+#define C_BCLR          1U
+/* Resto de pwm_ticks_to_load() tras leer PTPER: AND 0x7FFF, PTMOD
+   de PTCON, cadena de comparaciones del switch, BTSC y la resta */
+static const uint16_t C_TTL[4] = { 9U, 9U, 13U, 14U };
+
+/* ——————————————————— REGISTROS SIMULADOS ——————————————————— */
+typedef struct { unsigned PTMOD, PTEN; } ptcon_t;
+typedef struct { unsigned UDIS, IUE; } pwmcon2_t;
+
+enum { A_NONE, A_PTEN, A_PTMR, A_PTPER, A_PTMOD, A_UDIS, A_PDC };
+
+static uint64_t  g_t;                      // TCY
+static uint32_t  g_ph;                     // fase dentro del periodo
+static uint32_t  g_sample_ph;              // fase de la última lectura de PTMR
+static int       g_last = A_NONE;          // último acceso (para los costos)
+static ptcon_t   g_ptcon;
+static pwmcon2_t g_pwmcon2;
+static uint16_t  g_pdc_buf[3], g_pdc_act[3];
+static uint32_t  g_loads, g_blocked, g_split;
+static uint64_t  g_load_t;
+static uint16_t  g_new_tag;                // tag del juego que se está escribiendo
+
+static uint32_t period_len(void)
+{
+    return (g_ptcon.PTMOD >= 2U) ? 2U * (PTPER_VAL + 1U) : PTPER_VAL + 1U;
+}
+
+static int is_load_point(uint32_t ph)
+{
+    if (ph == 0) return 1;
+    return g_ptcon.PTMOD == 3U && ph == PTPER_VAL + 1U;
+}
+
+static uint16_t ptmr_value(uint32_t ph)
+{
+    if (g_ptcon.PTMOD < 2U || ph <= PTPER_VAL) return (uint16_t)ph;
+    return (uint16_t)(0x8000U | (2U * PTPER_VAL + 1U - ph));
+}
+
+/* Cuentas hasta el próximo límite de carga desde la fase ph */
+static uint32_t true_ticks(uint32_t ph)
+{
+    uint32_t n = 1;
+    while (!is_load_point((ph + n) % period_len())) n++;
+    return n;
+}
+
+static void advance(uint32_t n)
+{
+    while (n--) {
+        g_t++;
+        g_ph = (g_ph + 1U) % period_len();
+        if (!g_ptcon.PTEN || !is_load_point(g_ph)) continue;
+        if (g_pwmcon2.UDIS) { g_blocked++; continue; }
+        int nnew = 0;
+        for (int i = 0; i < 3; i++) {
+            if (g_pdc_act[i] != g_pdc_buf[i]) g_load_t = g_t;
+            g_pdc_act[i] = g_pdc_buf[i];
+            nnew += (g_pdc_buf[i] >> 12) == g_new_tag;
+        }
+        if (nnew != 0 && nnew != 3) g_split++;
+        g_loads++;
+    }
+}
+
+static uint16_t sim_ptmr(void)
+{
+    advance((g_last == A_PTMOD ? C_LOOP_BACK : 0U) + C_PTMR);
+    g_last = A_PTMR;
+    g_sample_ph = g_ph;
+    return ptmr_value(g_ph);
+}
+
+static uint16_t sim_ptper(void)
+{
+    advance(C_PTPER);
+    g_last = A_PTPER;
+    return PTPER_VAL;
+}
+
+static ptcon_t *sim_ptcon(void)
+{
+    if (g_last == A_PTPER) { advance(C_TTL[g_ptcon.PTMOD]); g_last = A_PTMOD; }
+    else                   { advance(C_PTEN);               g_last = A_PTEN;  }
+    return &g_ptcon;
+}
+
+/* El valor se escribe al final del ciclo: advance() antes de volver */
+static pwmcon2_t *sim_pwmcon2(void)
+{
+    if      (g_last == A_PTMOD) advance(C_LOOP_EXIT + C_BSET);
+    else if (g_last == A_PDC)   advance(C_BCLR);
+    else                        advance(C_BSET);
+    g_last = A_UDIS;
+    return &g_pwmcon2;
+}
+
+static uint16_t *sim_pdc(int i)
+{
+    advance(C_PDC);
+    g_last = A_PDC;
+    return &g_pdc_buf[i];
+}
+
+#define PWM_DUTYSET_HOST
+#define PTMR            sim_ptmr()
+#define PTPER           sim_ptper()
+#define PTCONbits       (*sim_ptcon())
+#define PWMCON2bits     (*sim_pwmcon2())
+#define PDC1            (*sim_pdc(0))
+#define PDC2            (*sim_pdc(1))
+#define PDC3            (*sim_pdc(2))
+#include "pwm_dutyset.h"
+
+/* ——————————————————— BANCO ——————————————————— */
+static int g_fail = 0;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+/* Estado de partida: juego viejo (tag 1) cargado, UDIS = 0 */
+static void reset(unsigned mode, uint32_t ph)
+{
+    g_ptcon.PTMOD = mode;
+    g_ptcon.PTEN  = 1;
+    g_pwmcon2.UDIS = 0;
+    g_pwmcon2.IUE  = 0;
+    g_ph = ph;
+    g_last = A_NONE;
+    for (int i = 0; i < 3; i++) g_pdc_buf[i] = g_pdc_act[i] = (uint16_t)(0x1000U | i);
+    g_new_tag = 2;
+    g_loads = g_blocked = g_split = 0;
+}
+
+static int new_set_loaded(void)
+{
+    for (int i = 0; i < 3; i++)
+        if (g_pdc_act[i] != (uint16_t)(0x2000U | i)) return 0;
+    return 1;
+}
+
+int main(void)
+{
+    static const unsigned modes[3] = { 0U, 2U, 3U };
+    char what[96];
+
+    printf("PTPER = %u, PWM_COMMIT_GUARD = %u\n", PTPER_VAL, (unsigned)PWM_COMMIT_GUARD);
+
+    printf("\n1 pwm_ticks_to_load contra la base de tiempo\n");
+    for (int m = 0; m < 3; m++) {
+        reset(modes[m], 0);
+        uint32_t len = period_len(), over = 0;
+        int dmin = 99, dmax = -99;
+        for (uint32_t ph = 0; ph < len; ph++) {
+            g_ph = ph;
+            g_last = A_NONE;
+            uint16_t ticks = pwm_ticks_to_load();
+            int d = (int)true_ticks(g_sample_ph) - (int)ticks;
+            if (d < 0) over++;
+            if (d < dmin) dmin = d;
+            if (d > dmax) dmax = d;
+        }
+        printf("  PTMOD %u: reales − calculadas = %d…%d\n", modes[m], dmin, dmax);
+        snprintf(what, sizeof what, "PTMOD %u: nunca mas que las reales, a lo sumo 2 menos",
+                 modes[m]);
+        check(what, over == 0 && dmin >= 0 && dmax <= 2);
+    }
+
+    printf("\n2 pwm_duty_commit desde cada fase del periodo\n");
+    for (int m = 0; m < 3; m++) {
+        reset(modes[m], 0);
+        uint32_t len = period_len();
+        uint32_t blocked = 0, split = 0, late = 0, waits = 0;
+        uint32_t c_min = UINT32_MAX, c_max = 0, w_max = 0, lat_max = 0;
+        uint64_t c_sum = 0;
+        for (uint32_t ph = 0; ph < len; ph++) {
+            reset(modes[m], ph);
+            const uint16_t pdc[3] = { 0x2000U, 0x2001U, 0x2002U };
+            uint64_t t_call = g_t;
+            pwm_duty_commit(pdc);
+            uint64_t t_ret = g_t;
+            uint32_t next = true_ticks(g_ph);
+            /* desde la última muestra de PTMR hasta soltar UDIS */
+            uint32_t win = (uint32_t)((g_ph + len - g_sample_ph) % len) + C_PTMR;
+            advance(next);
+
+            uint32_t cost = (uint32_t)(t_ret - t_call);
+            if (cost > C_PTEN + C_PTMR + C_PTPER + C_TTL[modes[m]] + C_LOOP_EXIT +
+                       C_BSET + 3U * C_PDC + C_BCLR) waits++;
+            if (cost < c_min) c_min = cost;
+            if (cost > c_max) c_max = cost;
+            c_sum += cost;
+            if (win > w_max) w_max = win;
+            if (g_load_t - t_call > lat_max) lat_max = (uint32_t)(g_load_t - t_call);
+            blocked += g_blocked;
+            split   += g_split;
+            if (!new_set_loaded() || g_load_t != t_ret + next) late++;
+        }
+        printf("  PTMOD %u: costo %u/%.1f/%u TCY (min/media/max), %u de %u fases esperan,\n"
+               "           PTMR → BCLR %u TCY, llamada → carga <= %u TCY\n",
+               modes[m], (unsigned)c_min, (double)c_sum / len, (unsigned)c_max,
+               (unsigned)waits, (unsigned)len, (unsigned)w_max, (unsigned)lat_max);
+        snprintf(what, sizeof what, "PTMOD %u: ningun limite con UDIS = 1 (%u)",
+                 modes[m], (unsigned)blocked);
+        check(what, blocked == 0);
+        snprintf(what, sizeof what, "PTMOD %u: juego completo en el primer limite tras el retorno",
+                 modes[m]);
+        check(what, split == 0 && late == 0);
+        snprintf(what, sizeof what, "PTMOD %u: PTMR -> BCLR (%u) <= PWM_COMMIT_GUARD",
+                 modes[m], (unsigned)w_max);
+        check(what, w_max <= PWM_COMMIT_GUARD);
+    }
+
+    /* Con PTEN = 0 no hay límite que esperar */
+    reset(0U, 0);
+    g_ptcon.PTEN = 0;
+    {
+        const uint16_t pdc[3] = { 0x2000U, 0x2001U, 0x2002U };
+        uint64_t t0 = g_t;
+        pwm_duty_commit(pdc);
+        uint32_t cost = (uint32_t)(g_t - t0);
+        snprintf(what, sizeof what, "PTEN = 0: sin espera (%u TCY)", (unsigned)cost);
+        check(what, cost == C_PTEN + C_BSET + 3U * C_PDC + C_BCLR);
+    }
+
+    printf("\n3 sin UDIS: PDC1, PDC2, PDC3 seguidos\n");
+    for (int m = 0; m < 3; m++) {
+        reset(modes[m], 0);
+        uint32_t len = period_len(), split = 0;
+        for (uint32_t ph = 0; ph < len; ph++) {
+            reset(modes[m], ph);
+            PDC1 = 0x2000U;
+            PDC2 = 0x2001U;
+            PDC3 = 0x2002U;
+            advance(true_ticks(g_ph));
+            split += g_split;
+        }
+        printf("  PTMOD %u: %u de %u fases dejan un periodo con juego mezclado\n",
+               modes[m], (unsigned)split, (unsigned)len);
+        snprintf(what, sizeof what, "PTMOD %u: el modelo reproduce la mezcla", modes[m]);
+        check(what, split > 0);
+    }
+
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,169 @@
+/*************************************************************
+ *  Modo complementario con tiempo muerto y compensación – header-only
+ *
+ *  Antes de incluir:
+ *      #define FCY          …          // Hz
+ *      #define PWM_DT_NS    1000       // tiempo muerto pedido, ns
+ *      #define PWM_DT_PERIOD_TCY  …    // (opcional) periodo PWM en TCY
+ *
+ *  – PWM_DT_TCY es PWM_DT_NS en TCY redondeado hacia arriba (nunca
+ *    más corto que lo pedido). El preprocesador elige el DTAPS más
+ *    chico con el que DTA (6 bits) alcanza y deja el valor final en
+ *    PWM_DT_DTCON1; PWM_DT_ACTUAL_TCY es lo que el hardware inserta.
+ *    Falla al compilar si el tiempo muerto es 0, si no cabe en
+ *    63 · 8 TCY o si pasa de 1/16 del periodo.
+ *  – pwm_complementary_init(mask) pone los pares de mask (bit 0 =
+ *    PWM1) en modo complementario (PMODx = 0, PENxH = PENxL = 1) y
+ *    carga DTCON1. No toca OVDCON ni la base de tiempo.
+ *
+ *  Compensación por polaridad de la corriente
+ *  En cada conmutación las dos llaves quedan abiertas PWM_DT_ACTUAL_TCY
+ *  y la salida la fija el diodo que conduce:
+ *      i > 0 (sale de la rama hacia la carga) → diodo inferior, la
+ *            salida queda baja: se pierde Td de pulso alto;
+ *      i < 0 → diodo superior, la salida queda alta: se gana Td.
+ *  El error medio es −sign(i) · Td/T · Vdc por periodo, independiente
+ *  del duty, así que pesa sobre todo a duty bajo y en los cruces por
+ *  cero (aplana la corriente). pwm_dtc_apply() suma sign(i)·Td al PDC,
+ *  con una rampa lineal en |i| < 2^band_shift para no conmutar la
+ *  corrección con el ruido de la medida cerca de cero, y
+ *  pwm_dtc_modulation() la apaga cuando la amplitud pedida no sale
+ *  de la zona muerta (menor que Td/T · Vdc).
+ *
+ *  Td en cuentas de PDC: en up/down (PTMOD 2/3) un LSB de PDC es un
+ *  TCY de pulso → PWM_DT_COMP_CENTER; en libre (PTMOD 0) es medio TCY
+ *  → PWM_DT_COMP_EDGE. Los retardos de encendido/apagado del driver
+ *  se suman a comp si se quieren compensar también.
+ *
+ *  El cálculo es una comparación, un MUL 16×16 y un recorte (unas 15
+ *  instrucciones por fase); pwm_dtc_modulation() suma dos
+ *  comparaciones, y un DIV sólo dentro de la rampa.
+ *  host/deadtime_sim.c usa el mismo código.
+ *
+ *  Incluir desde otra carpeta:  #include "../0020_dspic30f_pwm/pwm_deadtime.h"
+ *************************************************************/
+#ifndef PWM_DEADTIME_H
+#define PWM_DEADTIME_H
+
+#include <stdint.h>
+
+#ifndef FCY
+#error "definir FCY antes de incluir pwm_deadtime.h"
+#endif
+#ifndef PWM_DT_NS
+#error "definir PWM_DT_NS (tiempo muerto en ns) antes de incluir pwm_deadtime.h"
+#endif
+
+/* ——————————————————— TIEMPO MUERTO EN COMPILACIÓN ——————————————————— */
+#define PWM_DT_TCY      ((((FCY) / 1000UL) * (PWM_DT_NS) + 999999UL) / 1000000UL)
+
+#if PWM_DT_TCY == 0
+#error "PWM_DT_NS da 0 TCY: en complementario habría cruce directo"
+#elif PWM_DT_TCY <= 63
+#define PWM_DT_DTAPS    0               // reloj de tiempo muerto = TCY
+#define PWM_DT_DTA      (PWM_DT_TCY)
+#elif (PWM_DT_TCY + 1) / 2 <= 63
+#define PWM_DT_DTAPS    1               // 2 TCY
+#define PWM_DT_DTA      ((PWM_DT_TCY + 1) / 2)
+#elif (PWM_DT_TCY + 3) / 4 <= 63
+#define PWM_DT_DTAPS    2               // 4 TCY
+#define PWM_DT_DTA      ((PWM_DT_TCY + 3) / 4)
+#elif (PWM_DT_TCY + 7) / 8 <= 63
+#define PWM_DT_DTAPS    3               // 8 TCY
+#define PWM_DT_DTA      ((PWM_DT_TCY + 7) / 8)
+#else
+#error "PWM_DT_NS no cabe en DTCON1 (máx. 63 · 8 TCY)"
+#endif
+
+#define PWM_DT_ACTUAL_TCY   (PWM_DT_DTA << PWM_DT_DTAPS)
+#define PWM_DT_DTCON1       ((PWM_DT_DTAPS << 6) | PWM_DT_DTA)
+
+#if defined(PWM_DT_PERIOD_TCY) && (16 * PWM_DT_ACTUAL_TCY > PWM_DT_PERIOD_TCY)
+#error "tiempo muerto mayor que 1/16 del periodo PWM"
+#endif
+
+/* Td en cuentas de PDC */
+#define PWM_DT_COMP_CENTER  ((int16_t)PWM_DT_ACTUAL_TCY)         // PTMOD 2/3
+#define PWM_DT_COMP_EDGE    ((int16_t)(2 * PWM_DT_ACTUAL_TCY))   // PTMOD 0
+
+/* ——————————————————— CONFIGURACIÓN DEL MÓDULO ——————————————————— */
+#if defined(__dsPIC30F__) || defined(__XC16__)
+#include <xc.h>
+
+/* mask: bit 0 = PWM1, bit 1 = PWM2, bit 2 = PWM3 */
+static inline void pwm_complementary_init(uint16_t mask)
+{
+    mask &= 0x7U;
+    PWMCON1 = (PWMCON1 & ~(mask << 8))         // PMODx = 0 → complementario
+            | (mask << 4) | mask;               // PENxH, PENxL
+    DTCON1  = PWM_DT_DTCON1;
+}
+#endif
+
+/* ——————————————————— COMPENSACIÓN ——————————————————— */
+typedef struct {
+    int16_t  comp;          // corrección en uso, cuentas de PDC
+    int16_t  comp_full;     // corrección plena
+    uint16_t band_shift;    // rampa lineal en |i| < 2^band_shift
+    uint16_t pdc_max;       // 2·(PTPER + 1)
+    int16_t  m_dt;          // Td en amplitud Q15: comp / (pdc_max / 2)
+} pwm_dtc_t;
+
+static inline void pwm_dtc_init(pwm_dtc_t *c, int16_t comp, uint16_t band_shift,
+                                uint16_t pdc_max)
+{
+    c->comp       = comp;
+    c->comp_full  = comp;
+    c->band_shift = band_shift > 14U ? 14U : band_shift;
+    c->pdc_max    = pdc_max;
+    c->m_dt       = (int16_t)(((int32_t)comp << 16) / pdc_max);
+}
+
+/* Rampa por modulación. Con la amplitud pedida por debajo de Td la
+   salida queda dentro de la zona muerta: la corriente media no sale
+   del rizado, cambia de signo dentro del periodo y la corrección por
+   signo empeora la forma de onda en vez de levantarla. m: amplitud
+   pedida en Q15; sin corrección hasta m_dt, plena desde
+   PWM_DTC_FADE_HI/16 · m_dt. Sin llamarla la corrección queda plena.
+   Dentro de la rampa la THD de la corriente sube hasta 2 puntos
+   sobre la de sin compensar; el error de tensión no empeora. */
+#ifndef PWM_DTC_FADE_HI
+#define PWM_DTC_FADE_HI     17          // /16
+#endif
+
+static inline void pwm_dtc_modulation(pwm_dtc_t *c, int16_t m)
+{
+    int16_t lo = c->m_dt;
+    int16_t hi = (int16_t)(((int32_t)lo * PWM_DTC_FADE_HI) >> 4);
+
+    if (m < 0) m = (m == INT16_MIN) ? INT16_MAX : (int16_t)-m;
+    if      (m >= hi) c->comp = c->comp_full;
+    else if (m <= lo) c->comp = 0;
+    else c->comp = (int16_t)(((int32_t)(m - lo) * c->comp_full) / (hi - lo));
+}
+
+/* Corrección en cuentas de PDC para la corriente i (>0 sale de la rama) */
+static inline int16_t pwm_dtc_term(const pwm_dtc_t *c, int16_t i)
+{
+    int16_t band = (int16_t)(1 << c->band_shift);
+    if (i >=  band) return  c->comp;
+    if (i <= -band) return (int16_t)-c->comp;
+    return (int16_t)(((int32_t)i * c->comp) >> c->band_shift);
+}
+
+static inline uint16_t pwm_dtc_apply(const pwm_dtc_t *c, uint16_t pdc, int16_t i)
+{
+    int32_t v = (int32_t)pdc + pwm_dtc_term(c, i);
+    if (v < 0)                   v = 0;
+    if (v > (int32_t)c->pdc_max) v = c->pdc_max;
+    return (uint16_t)v;
+}
+
+/* Tres fases; i[] en las mismas unidades que la banda */
+static inline void pwm_dtc_apply3(const pwm_dtc_t *c, uint16_t pdc[3], const int16_t i[3])
+{
+    for (uint16_t k = 0; k < 3; k++)
+        pdc[k] = pwm_dtc_apply(c, pdc[k], i[k]);
+}
+
+#endif /* PWM_DEADTIME_H */
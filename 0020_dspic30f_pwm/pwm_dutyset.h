@@ -0,0 +1,95 @@
+/*************************************************************
+ *  Actualización atómica de PDC1…PDC3 (PWMCON2.UDIS) – header-only
+ *
+ *  Escribir PDC1, PDC2 y PDC3 uno tras otro deja una ventana en la
+ *  que un límite de periodo carga sólo parte del juego y las fases
+ *  quedan un periodo con duties mezclados. Con UDIS = 1 los búferes
+ *  PDCx no pasan a los registros activos: se escriben los tres y al
+ *  volver a UDIS = 0 el siguiente límite los carga juntos.
+ *
+ *  – Requiere IUE = 0 (con IUE = 1 cada escritura entra de inmediato);
+ *    pwm_dutyset_init() lo deja así.
+ *  – Punto de commit sincronizado con la base de tiempo: si al llamar
+ *    faltan menos de PWM_COMMIT_GUARD cuentas de PTMR para el límite
+ *    de carga, se espera a que pase. Así el juego siempre entra en el
+ *    primer límite posterior al retorno de pwm_duty_commit(), nunca
+ *    uno después por haber soltado UDIS justo encima del límite.
+ *    El límite es PTMR = 0 en libre y up/down (PTMOD 0, 1, 2) y
+ *    también PTMR = PTPER en doble actualización (PTMOD 3).
+ *  – Costo: 23 a 28 TCY sin espera según PTMOD (PTEN, PTMR, modo,
+ *    BSET, tres MOV, BCLR) más a lo sumo PWM_COMMIT_GUARD si cae en
+ *    la guarda. PWM_COMMIT_GUARD debe cubrir lo que va de la lectura
+ *    de PTMR al BCLR: 21 a 26 TCY estimados (host/dutyset_sim.c), de
+ *    ahí 32. Medirlo con el cronómetro del simulador de MPLAB X entre
+ *    la entrada y la salida de pwm_duty_commit(), o con un TMR libre
+ *    como en 20_all_70_pwm_main.c.
+ *  – Hacer commit desde un solo contexto (una ISR o el lazo): dos
+ *    commits anidados soltarían UDIS antes de tiempo.
+ *  – Supone prescaler 1:1 de la base de tiempo (PTCKPS = 0).
+ *
+ *  – En el PC (host/dutyset_sim.c) los registros los pone el que
+ *    incluye, con PWM_DUTYSET_HOST definido.
+ *
+ *  Uso:    uint16_t pdc[3] = { a, b, c };
+ *          pwm_duty_commit(pdc);
+ *  Incluir desde otra carpeta:  #include "../0020_dspic30f_pwm/pwm_dutyset.h"
+ *************************************************************/
+#ifndef PWM_DUTYSET_H
+#define PWM_DUTYSET_H
+
+#include <stdint.h>
+
+#if defined(__dsPIC30F__) || defined(__XC16__)
+#include <xc.h>
+#elif !defined(PWM_DUTYSET_HOST)
+#error "pwm_dutyset.h: fuera del dsPIC definir PWM_DUTYSET_HOST y PTMR, PTPER, PTCONbits, PWMCON2bits, PDC1…PDC3"
+#endif
+
+#ifndef PWM_COMMIT_GUARD
+#define PWM_COMMIT_GUARD    32U        // cuentas de PTMR (≥ costo del commit)
+#endif
+
+static inline void pwm_dutyset_init(void)
+{
+    PWMCON2bits.IUE  = 0;              // PDCx se cargan en el límite
+    PWMCON2bits.UDIS = 0;
+}
+
+/* Cuentas de PTMR que faltan para el próximo límite de carga de PDCx */
+static inline uint16_t pwm_ticks_to_load(void)
+{
+    uint16_t ptmr = PTMR;
+    uint16_t cnt  = ptmr & 0x7FFF;
+    uint16_t per  = PTPER;
+
+    switch (PTCONbits.PTMOD) {
+    case 0b10:                         // up/down: carga sólo en el valle
+        return (ptmr & 0x8000) ? cnt : (uint16_t)(2U * per - cnt);
+    case 0b11:                         // doble actualización: valle y pico
+        return (ptmr & 0x8000) ? cnt : (uint16_t)(per - cnt);
+    default:                           // libre / disparo único
+        return (uint16_t)(per - cnt);
+    }
+}
+
+static inline void pwm_duty_commit(const uint16_t pdc[3])
+{
+    if (PTCONbits.PTEN)
+        while (pwm_ticks_to_load() < PWM_COMMIT_GUARD)
+            ;                          // deja pasar el límite inminente
+
+    PWMCON2bits.UDIS = 1;
+    PDC1 = pdc[0];
+    PDC2 = pdc[1];
+    PDC3 = pdc[2];
+    PWMCON2bits.UDIS = 0;
+}
+
+/* Mismo duty en las tres fases */
+static inline void pwm_duty_commit_all(uint16_t pdc)
+{
+    const uint16_t d[3] = { pdc, pdc, pdc };
+    pwm_duty_commit(d);
+}
+
+#endif /* PWM_DUTYSET_H */
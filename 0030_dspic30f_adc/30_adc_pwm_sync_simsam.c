@@ -0,0 +1,193 @@
+/*************************************************************
+ *  dsPIC30F4011  – 20 MHz crystal  (FCY = 5 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  muestreo simultáneo AN0…AN3 sincronizado con el PWM
+ *
+ *  – El ADC se dispara con el "special event" del PWM (SSRC = 011):
+ *    una conversión por periodo, en el punto fijado por SEVTCMP.
+ *  – SIMSAM + CHPS = 1x: CH0…CH3 muestrean en el mismo instante
+ *    (CH1 = AN0, CH2 = AN1, CH3 = AN2, CH0 = AN3).
+ *  – El postscaler SEVOPS decima el disparo: la ISR corre cada
+ *    ADC_POSTSCALE periodos PWM, no cientos de veces como en el
+ *    modo libre de 20_adc_pwm_main.c.
+ *  – La ISR publica un juego coherente (4 lecturas + secuencia) por
+ *    ciclo de control; el fondo lo lee con adc_get_set().
+ *  – PWM2H (RE3) sigue a AN0, igual que en 20_adc_pwm_main.c.
+ *************************************************************/
+
+/* ——— CONFIG BITS (idénticos a los que vienes usando) ——— */
+#pragma config FPR     = HS                 // HS cristal 20 MHz
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define FCY             5000000UL          // Hz (usado por libpic30)
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+
+/* PWM: centrado (up/down) → periodo = 2·(PTPER+1)·TCY */
+#define PWM_FREQ_HZ     10000UL                              // 10 kHz
+#define PTPER_COUNTS    ((FCY / (2UL * PWM_FREQ_HZ)) - 1)    // 249
+
+/* Punto de muestreo dentro del periodo:
+   ADC_TRIG_COUNT = valor de PTMR (0…PTPER) y ADC_TRIG_DOWN = 1 si el
+   disparo debe ocurrir contando hacia abajo. PTPER en subida = centro
+   del tiempo en bajo de las salidas (shunts en la rama baja). */
+#define ADC_TRIG_COUNT  PTPER_COUNTS
+#define ADC_TRIG_DOWN   0
+
+/* Postscaler del special event: 1…16 periodos PWM por disparo */
+#define ADC_POSTSCALE   2U                 // ISR a 5 kHz
+
+/* ADC: TAD = (ADCS+1)/2 · TCY = 200 ns (mín. 154 ns) */
+#define ADCS_TAD_COUNTS 1
+#define SAMPLING_TAD    2                  // sólo aplica tras el disparo
+
+#if (ADC_POSTSCALE < 1) || (ADC_POSTSCALE > 16)
+#error "ADC_POSTSCALE debe estar entre 1 y 16"
+#endif
+#if (ADC_TRIG_COUNT > PTPER_COUNTS)
+#error "ADC_TRIG_COUNT fuera del periodo PWM"
+#endif
+
+/* ——————————————————— TIPOS ——————————————————— */
+typedef struct {
+    uint16_t an[4];            // AN0, AN1, AN2, AN3 (0…1023)
+    uint16_t seq;              // cuenta de juegos entregados
+} adc_set_t;
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static volatile adc_set_t g_adc_set;
+static volatile uint16_t  g_adc_missed = 0;  // juegos no leídos por el fondo
+static uint16_t           g_adc_seq_read = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void pwm_init_sync(void);
+static void adc_init_simsam(void);
+static uint8_t adc_get_set(adc_set_t *out);
+
+/* ——————————————————— PWM: time-base + special event ———————— */
+static void pwm_init_sync(void)
+{
+    TRISEbits.TRISE3 = 0;
+
+    PTCONbits.PTEN   = 0;
+    PTCONbits.PTCKPS = 0;          // 1:1
+    PTCONbits.PTOPS  = 0;
+    PTCONbits.PTMOD  = 0b10;       // up/down continuo (centrado)
+    PTPER = PTPER_COUNTS;
+
+    PWMCON1 = 0;
+    PWMCON1bits.PMOD2 = 1;         // canal 2 independiente
+    PWMCON1bits.PEN2H = 1;         // RE3
+    DTCON1  = 0;
+
+    /* Punto de disparo: SEVTCMP<14:0> = PTMR, SEVTCMP<15> = dirección */
+    SEVTCMP = (uint16_t)ADC_TRIG_COUNT | ((uint16_t)ADC_TRIG_DOWN << 15);
+
+    PWMCON2 = 0;
+    PWMCON2bits.SEVOPS = ADC_POSTSCALE - 1;   // 0 → 1:1 … 15 → 1:16
+    PWMCON2bits.UDIS   = 0;
+
+    OVDCON = 0;
+    OVDCONbits.POVD2H = 1;
+    PDC2 = 0;
+
+    PTCONbits.PTEN = 1;
+}
+
+/* ——————————————————— ADC: 4 canales simultáneos ———————————— */
+static void adc_init_simsam(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFG &= ~0x000F;             // AN0…AN3 analógicos
+
+    ADCON1 = 0;
+    ADCON1bits.FORM   = 0;         // entero 0…1023
+    ADCON1bits.SSRC   = 0b011;     // special event del PWM inicia conversión
+    ADCON1bits.SIMSAM = 1;         // muestreo simultáneo
+    ADCON1bits.ASAM   = 1;         // muestreando hasta el disparo
+
+    ADCON2 = 0;
+    ADCON2bits.CHPS = 0b10;        // CH0, CH1, CH2, CH3
+    ADCON2bits.SMPI = 3;           // IRQ tras 4 conversiones = 1 juego
+
+    ADCON3bits.ADCS = ADCS_TAD_COUNTS;
+    ADCON3bits.SAMC = SAMPLING_TAD;
+
+    ADCHS = 0;
+    ADCHSbits.CH123SA = 0;         // CH1 = AN0, CH2 = AN1, CH3 = AN2
+    ADCHSbits.CH0SA   = 3;         // CH0 = AN3
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 6;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+}
+
+/* ——————————————————— ADC INTERRUPT: un juego por ciclo —————————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    /* Orden del búfer con SIMSAM: CH0, CH1, CH2, CH3 */
+    g_adc_set.an[3] = ADCBUF0;     // CH0 = AN3
+    g_adc_set.an[0] = ADCBUF1;     // CH1 = AN0
+    g_adc_set.an[1] = ADCBUF2;     // CH2 = AN1
+    g_adc_set.an[2] = ADCBUF3;     // CH3 = AN2
+    g_adc_set.seq++;
+
+    /* Ej. de uso inmediato en el ciclo: PWM2H sigue a AN0 */
+    PDC2 = (uint16_t)(((uint32_t)g_adc_set.an[0] * (2UL * (PTPER_COUNTS + 1UL))) >> 10);
+
+    IFS0bits.ADIF = 0;
+}
+
+/* Copia coherente del último juego. Devuelve 1 si es nuevo. */
+static uint8_t adc_get_set(adc_set_t *out)
+{
+    IEC0bits.ADIE = 0;
+    out->an[0] = g_adc_set.an[0];
+    out->an[1] = g_adc_set.an[1];
+    out->an[2] = g_adc_set.an[2];
+    out->an[3] = g_adc_set.an[3];
+    out->seq   = g_adc_set.seq;
+    IEC0bits.ADIE = 1;
+
+    if (out->seq == g_adc_seq_read) return 0;
+    g_adc_missed += (uint16_t)(out->seq - g_adc_seq_read - 1U);
+    g_adc_seq_read = out->seq;
+    return 1;
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    pwm_init_sync();
+    adc_init_simsam();
+
+    __builtin_enable_interrupts();
+
+    adc_set_t s;
+    for (;;)
+    {
+        if (adc_get_set(&s)) {
+            /* s.an[0…3]: cuatro lecturas del mismo instante */
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  ADC en bloques ping-pong con procesamiento diferido
+ *
+ *  – Timer3 dispara el ADC a ADC_FS_HZ (SSRC = 010), AN0 en CH0.
+ *  – BUFM = 1 divide ADCBUF0…F en dos mitades de 8; SMPI = 7 pide
+ *    una interrupción por mitad. BUFS indica qué mitad está llenando
+ *    el ADC: la ISR sólo copia la otra mitad al bloque en curso y,
+ *    cuando el bloque se completa, publica su descriptor.
+ *  – El filtrado, las estadísticas y el empaquetado de telemetría
+ *    corren en el lazo principal (prioridad 0) sobre bloques
+ *    completos, así no suman latencia a otras interrupciones.
+ *  – Si el consumidor se atrasa y no queda bloque libre, el bloque
+ *    recién llenado se descarta y se cuenta en g_blk_overruns; el
+ *    número de secuencia del descriptor deja ver el hueco.
+ *  – TMR1 libre a TCY mide el costo de la ISR y del consumidor por
+ *    bloque; g_fs_max_hz estima la frecuencia de muestreo máxima
+ *    sostenible con el peor caso medido. host/pingpong_bench.c corre
+ *    la misma cola (adc_blocks.h) contra un modelo del ADC y la CPU
+ *    y acepta esos dos máximos como argumentos.
+ *  – UART2 (RF5 = U2TX) a 115200 envía un marco de estadísticas por
+ *    bloque, sin bloquear el lazo, con el sello de 32 bits del bloque
+ *    (../0140_dspic30f_timebase sobre Timer4/5, TCY).
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#define TB_T45                                     // Timer3 es del ADC
+#include "../0140_dspic30f_timebase/timebase.h"
+#define ADC_BLK_NOW()   tb_now32()
+#include "adc_blocks.h"
+
+/* Muestreo */
+#define ADC_FS_HZ       20000UL
+#define PR3_COUNTS      ((FCY / ADC_FS_HZ) - 1)    // 1473
+
+/* ADC: TAD = (ADCS+1)/2 · TCY ≈ 170 ns (mín. 154 ns) */
+#define ADCS_TAD_COUNTS 9
+
+/* UART2 */
+#define UART_BAUD       115200UL
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static volatile uint16_t g_isr_cycles_max  = 0;   // TCY
+static uint16_t          g_proc_cycles_max = 0;   // TCY por bloque
+static uint32_t          g_fs_max_hz       = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timer1_init_stamp(void);
+static void adc_init_pingpong(void);
+static void uart2_init(void);
+static void tlm_pump(void);
+
+/* ——————————————————— TIMER1: sello de ciclos ——————————— */
+static void timer1_init_stamp(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0;       // 1:1 → un tick por TCY
+    T1CONbits.TON   = 1;       // sin interrupción
+}
+
+/* ——————————————————— ADC: Timer3 + ping-pong ———————————— */
+static void adc_init_pingpong(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFGbits.PCFG0 = 0;      // AN0 analógico
+
+    ADCON1 = 0;
+    ADCON1bits.FORM = 0;       // entero 0…1023
+    ADCON1bits.SSRC = 0b010;   // fin de periodo de Timer3 → convertir
+    ADCON1bits.ASAM = 1;       // muestreando entre disparos
+
+    ADCON2 = 0;
+    ADCON2bits.BUFM = 1;       // dos mitades de 8 palabras
+    ADCON2bits.SMPI = ADC_HALF_LEN - 1;
+
+    ADCON3bits.ADCS = ADCS_TAD_COUNTS;
+    ADCHS = 0;                 // CH0 = AN0
+
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = PR3_COUNTS;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 5;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    T3CONbits.TON   = 1;
+}
+
+/* ——————————————————— UART2: 8N1, sólo TX ———————————————— */
+static void uart2_init(void)
+{
+    U2MODE = 0;
+    U2MODEbits.PDSEL = 0b00;
+    U2MODEbits.STSEL = 0;
+    U2BRG = (uint16_t)U2BRG_VAL;
+    U2STA = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+}
+
+/* ——————————————————— ADC INTERRUPT: sólo copia y publica ——————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    uint16_t t0 = TMR1;
+    IFS0bits.ADIF = 0;
+
+    /* BUFS = 1: el ADC llena 8…F, la mitad 0…7 está lista */
+    adc_block_isr_copy(ADCON2bits.BUFS ? &ADCBUF0 : &ADCBUF8);
+
+    uint16_t dt = TMR1 - t0;
+    if (dt > g_isr_cycles_max) g_isr_cycles_max = dt;
+}
+
+/* ——————————————————— TELEMETRÍA ——————————————————— */
+/* Llena la FIFO de TX sin esperar */
+static void tlm_pump(void)
+{
+    while (g_tlm_tail != g_tlm_head && !U2STAbits.UTXBF)
+        U2TXREG = g_tlm_ring[(g_tlm_tail++) & (TLM_RING_LEN - 1)];
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    timer1_init_stamp();
+    tb_init();
+    uart2_init();
+    adc_init_pingpong();
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        const adc_block_t *b = adc_block_get();
+        if (b) {
+            uint16_t t0 = TMR1;
+            block_process(b);
+            adc_block_release();
+            uint16_t dt = TMR1 - t0;
+
+            if (dt > g_proc_cycles_max) {
+                g_proc_cycles_max = dt;
+                /* Sostenible si ISR + proceso caben en el bloque:
+                   fs_max = FCY · N / (ciclos_proceso + ciclos_ISR · N/8).
+                   FCY · N en 64 bits: pasa de 32 desde N = 256. Sólo se
+                   calcula con un máximo nuevo, la división larga no pesa. */
+                uint32_t per_blk = (uint32_t)dt +
+                    (uint32_t)g_isr_cycles_max * (ADC_BLOCK_LEN / ADC_HALF_LEN);
+                g_fs_max_hz = (uint32_t)(((uint64_t)FCY * ADC_BLOCK_LEN) / per_blk);
+            }
+        }
+        tlm_pump();
+    }
+    return 0;
+}
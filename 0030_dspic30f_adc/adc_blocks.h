@@ -0,0 +1,190 @@
+/*************************************************************
+ *  Bloques ADC ping-pong – header-only
+ *  (firmware y PC: 31_adc_pingpong_blocks.c, host/pingpong_bench.c)
+ *
+ *  – adc_block_isr_copy() es todo lo que hace la ISR: copia la mitad
+ *    lista del ADCBUF al bloque en curso y, cuando se llena, publica
+ *    su descriptor con el sello ADC_BLK_NOW() de esa ISR (la última
+ *    muestra más la latencia de la ISR). Sin bloque libre el bloque se
+ *    reescribe y se cuenta en g_blk_overruns; seq deja ver el hueco.
+ *  – adc_block_get() / adc_block_release(): cola de un productor (la
+ *    ISR) y un consumidor (el lazo principal); cada índice lo escribe
+ *    un solo lado.
+ *  – block_process(): filtro, estadísticas y marco de telemetría en
+ *    g_tlm_ring. El envío por la UART queda en el programa.
+ *  Sin registros del dsPIC: el mismo código corre en PC. Quien incluye
+ *  define ADC_BLK_NOW(), un reloj libre de 32 bits (tb_now32() de
+ *  ../0140_dspic30f_timebase en el equipo).
+ *************************************************************/
+#ifndef ADC_BLOCKS_H
+#define ADC_BLOCKS_H
+
+#include <stdint.h>
+
+#ifndef ADC_BLK_NOW
+#error "definir ADC_BLK_NOW() (reloj libre de 32 bits) antes de incluir adc_blocks.h"
+#endif
+
+/* Bloques: ADC_HALF_LEN lo fija BUFM; el resto es configurable */
+#define ADC_HALF_LEN    8U
+#ifndef ADC_BLOCK_LEN
+#define ADC_BLOCK_LEN   64U                        // muestras por bloque
+#endif
+#ifndef ADC_NBLOCKS
+#define ADC_NBLOCKS     4U                         // potencia de 2
+#endif
+#ifndef TLM_RING_LEN
+#define TLM_RING_LEN    64U                        // potencia de 2
+#endif
+
+#if (ADC_BLOCK_LEN % ADC_HALF_LEN) != 0
+#error "ADC_BLOCK_LEN debe ser múltiplo de 8"
+#endif
+#if (ADC_NBLOCKS < 2) || ((ADC_NBLOCKS & (ADC_NBLOCKS - 1)) != 0)
+#error "ADC_NBLOCKS debe ser potencia de 2 y >= 2"
+#endif
+#if (TLM_RING_LEN & (TLM_RING_LEN - 1)) != 0
+#error "TLM_RING_LEN debe ser potencia de 2"
+#endif
+
+#define TLM_FRAME_LEN   18U
+
+/* ——————————————————— TIPOS ——————————————————— */
+typedef struct {
+    const uint16_t *data;      // ADC_BLOCK_LEN muestras 0…1023
+    uint16_t        seq;       // número de bloque (cuenta descartados)
+    uint16_t        overruns;  // g_blk_overruns al publicar
+    uint32_t        t;         // ADC_BLK_NOW() al completarse
+} adc_block_t;
+
+typedef struct {
+    uint16_t min, max, mean, rms;
+} blk_stats_t;
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static uint16_t          g_blk_data[ADC_NBLOCKS][ADC_BLOCK_LEN];
+static adc_block_t       g_blk_desc[ADC_NBLOCKS];
+static volatile uint16_t g_blk_head = 0;     // sólo lo escribe la ISR
+static volatile uint16_t g_blk_tail = 0;     // sólo lo escribe el consumidor
+static uint16_t          g_blk_fill = 0;     // muestras en el bloque actual
+static uint16_t          g_blk_seq  = 0;
+static volatile uint16_t g_blk_overruns = 0;
+
+static int32_t           g_filt_state = 0;        // IIR, Q16
+static uint16_t          g_filt_out   = 0;        // última salida 0…1023
+static blk_stats_t       g_stats;
+
+static uint8_t           g_tlm_ring[TLM_RING_LEN];
+static uint16_t          g_tlm_head = 0, g_tlm_tail = 0;
+static uint16_t          g_tlm_drops = 0;
+
+/* ——————————————————— PRODUCTOR (ISR) ——————————————————— */
+static inline void adc_block_isr_copy(const volatile uint16_t *src)
+{
+    uint16_t slot = g_blk_head & (ADC_NBLOCKS - 1);
+    uint16_t *dst = &g_blk_data[slot][g_blk_fill];
+
+    for (uint16_t i = 0; i < ADC_HALF_LEN; i++)
+        dst[i] = src[i];
+    g_blk_fill += ADC_HALF_LEN;
+
+    if (g_blk_fill >= ADC_BLOCK_LEN) {
+        g_blk_fill = 0;
+        g_blk_seq++;
+
+        /* Publicar sólo si queda otro bloque libre para seguir llenando */
+        if ((uint16_t)(g_blk_head - g_blk_tail) < (ADC_NBLOCKS - 1)) {
+            g_blk_desc[slot].t        = ADC_BLK_NOW();
+            g_blk_desc[slot].data     = g_blk_data[slot];
+            g_blk_desc[slot].seq      = g_blk_seq;
+            g_blk_desc[slot].overruns = g_blk_overruns;
+            g_blk_head++;
+        } else {
+            g_blk_overruns++;          // se reescribe el mismo bloque
+        }
+    }
+}
+
+/* ——————————————————— COLA DE BLOQUES (consumidor) ——————————— */
+static inline const adc_block_t *adc_block_get(void)
+{
+    if (g_blk_tail == g_blk_head) return 0;
+    return &g_blk_desc[g_blk_tail & (ADC_NBLOCKS - 1)];
+}
+
+static inline void adc_block_release(void)
+{
+    g_blk_tail++;              // el bloque vuelve a la ISR
+}
+
+/* Raíz entera por dígitos binarios */
+static inline uint16_t isqrt32(uint32_t x)
+{
+    uint32_t r = 0, bit = 1UL << 30;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) { x -= r + bit; r = (r >> 1) + bit; }
+        else              { r >>= 1; }
+        bit >>= 2;
+    }
+    return (uint16_t)r;
+}
+
+/* ——————————————————— TELEMETRÍA ——————————————————— */
+/* Marco: 0xA5 0x5A seqL seqH minL minH maxL maxH meanL meanH
+          rmsL rmsH ovr t0 t1 t2 t3 chk
+   (t = sello del bloque, byte bajo primero; chk = suma de los bytes 2…16) */
+static inline void tlm_pack_stats(uint16_t seq, const blk_stats_t *s, uint16_t ovr, uint32_t t)
+{
+    uint8_t f[TLM_FRAME_LEN];
+    uint8_t chk = 0;
+
+    f[0]  = 0xA5;            f[1]  = 0x5A;
+    f[2]  = (uint8_t)seq;    f[3]  = (uint8_t)(seq >> 8);
+    f[4]  = (uint8_t)s->min; f[5]  = (uint8_t)(s->min >> 8);
+    f[6]  = (uint8_t)s->max; f[7]  = (uint8_t)(s->max >> 8);
+    f[8]  = (uint8_t)s->mean;f[9]  = (uint8_t)(s->mean >> 8);
+    f[10] = (uint8_t)s->rms; f[11] = (uint8_t)(s->rms >> 8);
+    f[12] = (uint8_t)ovr;
+    f[13] = (uint8_t)t;      f[14] = (uint8_t)(t >> 8);
+    f[15] = (uint8_t)(t >> 16); f[16] = (uint8_t)(t >> 24);
+    for (uint16_t i = 2; i < 17; i++) chk += f[i];
+    f[17] = chk;
+
+    /* Marco completo o nada */
+    if ((uint16_t)(TLM_RING_LEN - (uint16_t)(g_tlm_head - g_tlm_tail)) < sizeof f) {
+        g_tlm_drops++;
+        return;
+    }
+    for (uint16_t i = 0; i < sizeof f; i++)
+        g_tlm_ring[(g_tlm_head++) & (TLM_RING_LEN - 1)] = f[i];
+}
+
+/* ——————————————————— PROCESAMIENTO DE UN BLOQUE ——————————— */
+static inline void block_process(const adc_block_t *b)
+{
+    uint16_t mn = 0xFFFF, mx = 0;
+    uint32_t sum = 0, sum2 = 0;
+
+    for (uint16_t i = 0; i < ADC_BLOCK_LEN; i++) {
+        uint16_t x = b->data[i];
+
+        /* Pasa-bajas IIR de un polo: y += (x − y)/8 */
+        g_filt_state += (((int32_t)x << 16) - g_filt_state) >> 3;
+
+        if (x < mn) mn = x;
+        if (x > mx) mx = x;
+        sum  += x;
+        sum2 += (uint32_t)x * x;
+    }
+
+    g_filt_out   = (uint16_t)(g_filt_state >> 16);
+    g_stats.min  = mn;
+    g_stats.max  = mx;
+    g_stats.mean = (uint16_t)(sum / ADC_BLOCK_LEN);
+    g_stats.rms  = isqrt32(sum2 / ADC_BLOCK_LEN);
+
+    tlm_pack_stats(b->seq, &g_stats, b->overruns, b->t);
+}
+
+#endif  /* ADC_BLOCKS_H */
@@ -0,0 +1,427 @@
+/*************************************************************
+ *  pingpong_bench – adc_blocks.h (31_adc_pingpong_blocks.c)
+ *  a resolución de TCY: caudal y frecuencia de muestreo máxima
+ *
+ *  cc -O2 -Wall -I.. -o pingpong_bench pingpong_bench.c -lm
+ *  ./pingpong_bench [isr_tcy proc_tcy]
+ *
+ *  dsPIC30F4011 a FCY = 29.48 MHz como en 31. Se modela:
+ *    – el ADC: Timer3 dispara cada PR3 + 1 TCY, la conversión tarda
+ *      12 TAD y BUFM = 1 alterna las mitades de ADCBUF; al llenarse
+ *      una mitad se activa ADIF y cambia BUFS. Si ADIF ya estaba
+ *      activo la mitad anterior se pierde
+ *    – la CPU: ISR del ADC a IPL5 y lazo principal (get, proceso,
+ *      release, tlm_pump) con una tarea lenta opcional que lo
+ *      detiene; la ISR copia con el BUFS que ve al leer
+ *    – UART2 a 115200: FIFO de 4 bytes; el PC decodifica los marcos
+ *    – ADC_BLK_NOW(): el tiempo simulado en TCY, como tb_now32()
+ *  Las funciones de adc_blocks.h corren tal cual; sólo su costo en
+ *  TCY sale de C_*, estimados del código con XC16 -O1. Con
+ *  argumentos se usan los g_isr_cycles_max y g_proc_cycles_max
+ *  medidos en el equipo.
+ *  Casos (PASS/FAIL; el código de salida es el número de fallas):
+ *    1 20 kHz        – 1 s: cada bloque llega una vez, en orden y con
+ *                      sus muestras; cada marco de telemetría llega
+ *                      con suma válida y estadísticas exactas, y su
+ *                      sello cae a menos de una ISR de la última
+ *                      muestra del bloque
+ *    2 máxima fs     – la mayor fs sin overruns (búsqueda en PR3),
+ *                      con el proceso de 31 y con uno 4 veces más
+ *                      caro, contra la estimación g_fs_max_hz de 31 o
+ *                      el límite de conversión del ADC (±10 %), y la fs a la que la telemetría a 115200 empieza
+ *                      a descartar marcos contra la cuenta de bytes
+ *    3 consumidor    – tarea lenta de 0.5…16 ms cada 50 ms: sin
+ *      atrasado        overrun mientras quepa en los bloques libres;
+ *                      más larga, cada bloque perdido se cuenta una
+ *                      vez, deja su hueco en seq y ningún bloque
+ *                      entregado trae muestras ajenas
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+static uint64_t g_now;                  // tiempo simulado, TCY
+#define ADC_BLK_NOW()   ((uint32_t)g_now)
+#include "adc_blocks.h"
+
+#define FCY             (7370000UL * 16UL / 4UL)    // ≈ 29.48 MHz
+#define ADCS_TAD_COUNTS 9U
+#define TAD_TCY         ((ADCS_TAD_COUNTS + 1U) / 2U)
+#define CONV_TCY        (12U * TAD_TCY)             // 10 bits + 2 TAD
+#define ADC_MIN_TCY     (CONV_TCY + 2U * TAD_TCY)   // con 2 TAD de muestreo
+#define UART_BAUD       115200UL
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+#define UART_BYTE_TCY   (160UL * (U2BRG_VAL + 1UL))
+
+/* Costos estimados en TCY (-O1) */
+#define C_ISR_IN        25U     // latencia + prólogo, sello TMR1, ADIF, BUFS
+#define C_ISR_WORD      5U      // copia por palabra (fuente volatile)
+#define C_ISR_OUT       28U     // g_blk_fill, sello, máximo, epílogo, RETFIE
+#define C_ISR_PUB       36U     // publicar el descriptor y su sello (tb_now32)
+#define C_PROC_X        32U     // IIR 32 bits, mín/máx, Σx, Σx² por muestra
+#define C_PROC_BLK      620U    // isqrt32, medias, marco y copia al anillo
+#define C_POLL          12U     // adc_block_get + release + vuelta del lazo
+#define C_PUMP          10U     // un byte de tlm_pump
+
+#define NSAMP_MAX       (1UL << 22)
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static uint32_t g_rng = 2463534242UL;
+static uint32_t rnd32(void) { g_rng ^= g_rng << 13; g_rng ^= g_rng >> 17; g_rng ^= g_rng << 5; return g_rng; }
+
+/* Costos en uso (C_* o los medidos) */
+static uint32_t g_c_isr, g_c_pub, g_c_proc;
+static uint32_t g_pr3;                  // del run() en curso
+
+/* Señal: seno + ruido, 10 bits, fija por índice de muestra */
+static uint16_t g_sig[NSAMP_MAX];
+
+typedef struct {
+    uint32_t pr3;
+    uint32_t stall_tcy, stall_every;     // tarea lenta del lazo (0 = no)
+    double   seconds;
+} cfg_t;
+
+typedef struct {
+    uint32_t halves, halves_lost;
+    uint32_t blocks, delivered, bad_data, out_of_order;
+    uint32_t gap_sum;                    // bloques faltantes según seq
+    uint32_t ovr_field_bad;              // descriptor.overruns ≠ bloques perdidos hasta ahí
+    uint32_t frames, frames_bad, tlm_bytes;
+    uint32_t stamp_bad;                  // sello fuera de [última muestra, + una ISR]
+    uint32_t stamp_lat_max;              // TCY desde la última muestra
+    uint32_t queued;                     // publicados aún sin entregar al final
+    uint32_t isr_max;
+    uint64_t busy_isr, busy_main;     // TCY en la ISR y en block_process
+} res_t;
+
+/* ——— decodificador de telemetría en el PC ——— */
+static uint8_t  g_rx[TLM_FRAME_LEN];
+static uint32_t g_rx_n;
+
+static void stats_ref(uint16_t seq, blk_stats_t *s)
+{
+    const uint32_t k0 = (uint32_t)(seq - 1U) * ADC_BLOCK_LEN;
+    uint32_t sum = 0, sum2 = 0;
+    s->min = 0xFFFF; s->max = 0;
+    for (uint32_t i = 0; i < ADC_BLOCK_LEN; i++) {
+        uint16_t x = g_sig[(k0 + i) % NSAMP_MAX];
+        if (x < s->min) s->min = x;
+        if (x > s->max) s->max = x;
+        sum += x; sum2 += (uint32_t)x * x;
+    }
+    s->mean = (uint16_t)(sum / ADC_BLOCK_LEN);
+    s->rms  = (uint16_t)floor(sqrt((double)(sum2 / ADC_BLOCK_LEN)));
+}
+
+static void host_rx(uint8_t b, res_t *r)
+{
+    r->tlm_bytes++;
+    if (g_rx_n == 0 && b != 0xA5) return;
+    if (g_rx_n == 1 && b != 0x5A) { g_rx_n = (b == 0xA5); return; }
+    g_rx[g_rx_n++] = b;
+    if (g_rx_n < TLM_FRAME_LEN) return;
+    g_rx_n = 0;
+
+    uint8_t chk = 0;
+    for (uint32_t i = 2; i < 17; i++) chk += g_rx[i];
+    blk_stats_t ref;
+    const uint16_t seq = (uint16_t)(g_rx[2] | g_rx[3] << 8);
+    stats_ref(seq, &ref);
+    r->frames++;
+
+    /* Sello: la última muestra del bloque seq termina su conversión en
+       seq·N·(PR3+1) + CONV_TCY; la ISR que lo publica corre enseguida */
+    const uint32_t t = (uint32_t)g_rx[13] | (uint32_t)g_rx[14] << 8 |
+                       (uint32_t)g_rx[15] << 16 | (uint32_t)g_rx[16] << 24;
+    const uint32_t lat = t - (uint32_t)((uint64_t)seq * ADC_BLOCK_LEN * (g_pr3 + 1U) + CONV_TCY);
+    if (lat > g_c_isr + g_c_pub) r->stamp_bad++;
+    else if (lat > r->stamp_lat_max) r->stamp_lat_max = lat;
+
+    if (chk != g_rx[17] ||
+        (uint16_t)(g_rx[4]  | g_rx[5]  << 8) != ref.min  ||
+        (uint16_t)(g_rx[6]  | g_rx[7]  << 8) != ref.max  ||
+        (uint16_t)(g_rx[8]  | g_rx[9]  << 8) != ref.mean ||
+        (uint16_t)(g_rx[10] | g_rx[11] << 8) != ref.rms)
+        r->frames_bad++;
+}
+
+static void reset_blocks(void)
+{
+    memset(g_blk_data, 0, sizeof g_blk_data);
+    memset(g_blk_desc, 0, sizeof g_blk_desc);
+    g_blk_head = g_blk_tail = 0;
+    g_blk_fill = g_blk_seq = 0;
+    g_blk_overruns = 0;
+    g_filt_state = 0;
+    g_tlm_head = g_tlm_tail = 0;
+    g_tlm_drops = 0;
+    g_rx_n = 0;
+}
+
+/* Verifica el bloque que toma el consumidor (sin costo en la CPU simulada) */
+static void consume_check(const adc_block_t *b, uint16_t *last_seq, res_t *r)
+{
+    const uint32_t k0 = (uint32_t)(b->seq - 1U) * ADC_BLOCK_LEN;
+    for (uint32_t i = 0; i < ADC_BLOCK_LEN; i++)
+        if (b->data[i] != g_sig[(k0 + i) % NSAMP_MAX]) { r->bad_data++; break; }
+    if (r->delivered && (uint16_t)(b->seq - *last_seq) == 0) r->out_of_order++;
+    else if (r->delivered) r->gap_sum += (uint16_t)(b->seq - *last_seq - 1U);
+    else                   r->gap_sum += (uint16_t)(b->seq - 1U);
+    if (b->overruns != r->gap_sum) r->ovr_field_bad++;
+    *last_seq = b->seq;
+    r->delivered++;
+}
+
+static void run(const cfg_t *c, res_t *r)
+{
+    memset(r, 0, sizeof *r);
+    reset_blocks();
+    g_pr3 = c->pr3;
+
+    enum { M_POLL, M_PROC, M_PUMP, M_STALL } mst = M_POLL;
+    uint32_t m_left = C_POLL, isr_left = 0, isr_at = 0, isr_len = 0;
+    uint16_t adcbuf[16];
+    uint8_t  adif = 0, bufs = 0, fill_half = 0;
+    uint32_t k = 0, t_conv = c->pr3 + 1U + CONV_TCY;
+    uint8_t  txq[4];
+    uint32_t tx_fifo = 0, tx_rd = 0, t_tx = 0;
+    uint64_t t_stall = c->stall_every;
+    uint8_t  stall_pend = 0;
+    uint16_t last_seq = 0;
+    const uint64_t end = (uint64_t)(c->seconds * FCY);
+
+    for (uint64_t now = 0; now < end; now++) {
+        g_now = now;
+        /* ADC: fin de conversión de la muestra k */
+        if (now == t_conv) {
+            adcbuf[fill_half * 8U + (k % 8U)] = g_sig[k % NSAMP_MAX];
+            k++;
+            t_conv += c->pr3 + 1U;
+            if (k % 8U == 0) {
+                r->halves++;
+                if (adif) r->halves_lost++;
+                adif = 1;
+                fill_half ^= 1U;
+                bufs = fill_half;                   // mitad que llena ahora
+            }
+        }
+
+        /* UART2: un byte sale del registro de desplazamiento */
+        if (tx_fifo && now >= t_tx) {
+            host_rx(txq[tx_rd++ & 3U], r);
+            if (--tx_fifo) t_tx = now + UART_BYTE_TCY;
+        }
+
+        if (c->stall_every && now == t_stall) { stall_pend = 1; t_stall += c->stall_every; }
+
+        /* ISR a IPL5 sobre el lazo principal */
+        if (!isr_left && adif) {
+            adif = 0;
+            isr_len = isr_left = g_c_isr + ((g_blk_fill + ADC_HALF_LEN >= ADC_BLOCK_LEN) ? g_c_pub : 0);
+            isr_at = isr_len - C_ISR_IN;
+        }
+        if (isr_left) {
+            r->busy_isr++;
+            if (--isr_left == isr_at)
+                adc_block_isr_copy(bufs ? &adcbuf[0] : &adcbuf[8]);
+            if (!isr_left && isr_len > r->isr_max) r->isr_max = isr_len;
+            continue;
+        }
+
+        /* Lazo principal */
+        if (mst == M_PROC) r->busy_main++;
+        if (--m_left) continue;
+        switch (mst) {
+            case M_PROC:
+                adc_block_release();
+                /* fallthrough */
+            case M_PUMP:
+            case M_STALL:
+            case M_POLL:
+                if (stall_pend) {
+                    stall_pend = 0;
+                    mst = M_STALL;
+                    m_left = c->stall_tcy;
+                    break;
+                }
+                /* tlm_pump: llena la FIFO de TX */
+                if (g_tlm_tail != g_tlm_head && tx_fifo < 4U) {
+                    txq[(tx_rd + tx_fifo) & 3U] = g_tlm_ring[(g_tlm_tail++) & (TLM_RING_LEN - 1)];
+                    if (tx_fifo++ == 0) t_tx = now + UART_BYTE_TCY;
+                    mst = M_PUMP;
+                    m_left = C_PUMP;
+                    break;
+                }
+                const adc_block_t *b = adc_block_get();
+                if (b) {
+                    consume_check(b, &last_seq, r);
+                    block_process(b);
+                    mst = M_PROC;
+                    m_left = g_c_proc;
+                } else {
+                    mst = M_POLL;
+                    m_left = C_POLL;
+                }
+                break;
+        }
+    }
+    r->blocks = g_blk_seq;
+    r->queued = (uint16_t)(g_blk_head - g_blk_tail) - (mst == M_PROC ? 1U : 0U);
+}
+
+static double fs_of(uint32_t pr3) { return (double)FCY / (pr3 + 1U); }
+
+static void print_res(const cfg_t *c, const res_t *r)
+{
+    printf("      fs %7.0f Hz: bloques %lu, entregados %lu, overruns %u, mitades perdidas %lu, "
+           "marcos %lu (descartados %u)\n"
+           "      CPU: ISR %.1f %% (peor %lu TCY), block_process %.1f %%\n",
+           fs_of(c->pr3), (unsigned long)r->blocks, (unsigned long)r->delivered, g_blk_overruns,
+           (unsigned long)r->halves_lost, (unsigned long)r->frames, g_tlm_drops,
+           100.0 * r->busy_isr / (c->seconds * FCY), (unsigned long)r->isr_max,
+           100.0 * r->busy_main / (c->seconds * FCY));
+}
+
+/* Todo bloque lleno se entregó, se descartó (overrun) o espera en la cola */
+static int accounted(const res_t *r)
+{
+    return r->blocks == r->delivered + g_blk_overruns + r->queued;
+}
+
+static int clean(const res_t *r)
+{
+    return g_blk_overruns == 0 && r->halves_lost == 0 && r->bad_data == 0 && r->out_of_order == 0 &&
+           r->gap_sum == 0;
+}
+
+/* Mayor fs (menor PR3) que cumple ok() */
+static uint32_t search_pr3(cfg_t c, int (*ok)(const res_t *), res_t *r)
+{
+    uint32_t lo = ADC_MIN_TCY - 1U, hi = (FCY / 1000UL) - 1U;    // 1 kHz siempre cumple
+    while (hi - lo > 1U) {
+        c.pr3 = (lo + hi) / 2U;
+        run(&c, r);
+        if (ok(r)) hi = c.pr3; else lo = c.pr3;
+    }
+    c.pr3 = hi;
+    run(&c, r);
+    return hi;
+}
+
+static int no_tlm_drops(const res_t *r) { return clean(r) && g_tlm_drops == 0; }
+
+int main(int argc, char **argv)
+{
+    g_c_isr  = C_ISR_IN + ADC_HALF_LEN * C_ISR_WORD + C_ISR_OUT;
+    g_c_pub  = C_ISR_PUB;
+    g_c_proc = ADC_BLOCK_LEN * C_PROC_X + C_PROC_BLK;
+    if (argc == 3) {
+        g_c_isr  = (uint32_t)strtoul(argv[1], 0, 0);
+        g_c_pub  = 0;
+        g_c_proc = (uint32_t)strtoul(argv[2], 0, 0);
+    }
+    for (uint32_t i = 0; i < NSAMP_MAX; i++) {
+        double v = 512.0 + 400.0 * sin(2.0 * M_PI * i / 97.3) + (double)(rnd32() % 41U) - 20.0;
+        g_sig[i] = (uint16_t)(v < 0 ? 0 : v > 1023 ? 1023 : v);
+    }
+    printf("pingpong_bench: FCY %.2f MHz, bloques %u × %u, ISR %lu TCY (+%lu al publicar), "
+           "proceso %lu TCY por bloque\n",
+           FCY / 1e6, ADC_NBLOCKS, ADC_BLOCK_LEN, (unsigned long)g_c_isr, (unsigned long)g_c_pub,
+           (unsigned long)g_c_proc);
+
+    cfg_t c;
+    res_t r;
+    char  what[112];
+
+    printf("\n1 20 kHz (PR3 = %lu), 1 s\n", (unsigned long)(FCY / 20000UL - 1UL));
+    c = (cfg_t){ .pr3 = FCY / 20000UL - 1UL, .seconds = 1.0 };
+    run(&c, &r);
+    print_res(&c, &r);
+    check("cada bloque una vez, en orden, con sus muestras", clean(&r) && accounted(&r));
+    check("marcos con suma válida y estadísticas exactas",
+          r.frames + 2U >= r.delivered && r.frames_bad == 0 && g_tlm_drops == 0);
+    printf("      sellos: hasta %lu TCY después de la última muestra del bloque\n",
+           (unsigned long)r.stamp_lat_max);
+    snprintf(what, sizeof what, "cada sello a ≤ una ISR (%lu TCY) de la última muestra",
+             (unsigned long)(g_c_isr + g_c_pub));
+    check(what, r.frames > 0 && r.stamp_bad == 0);
+
+    printf("\n2 máxima fs sostenida (0.2 s por punto)\n");
+    c.seconds = 0.2;
+    const uint32_t proc_base = g_c_proc;
+    for (uint32_t mult = 1; mult <= 4U; mult += 3U) {
+        g_c_proc = proc_base * mult;
+        const uint32_t pr3 = search_pr3(c, clean, &r);
+        c.pr3 = pr3;
+        printf("    proceso %s%lu TCY por bloque\n", mult == 1 ? "" : "×4 (p. ej. un FIR más), ",
+               (unsigned long)g_c_proc);
+        print_res(&c, &r);
+        /* Estimación de 31: fs_max = FCY · N / (proceso + ISR · N/8), peor ISR medido;
+           por encima de eso manda la conversión del ADC */
+        const uint32_t per_blk = g_c_proc + (g_c_isr + g_c_pub) * (ADC_BLOCK_LEN / ADC_HALF_LEN);
+        const double fs_est = (double)FCY * ADC_BLOCK_LEN / per_blk;
+        const double fs_adc = fs_of(ADC_MIN_TCY - 1U);
+        const double fs_lim = fs_est < fs_adc ? fs_est : fs_adc;
+        printf("      simulada %.0f Hz; g_fs_max_hz estimaría %.0f Hz, el ADC llega a %.0f Hz "
+               "(%+.1f %% contra el menor)\n",
+               fs_of(pr3), fs_est, fs_adc, 100.0 * (fs_of(pr3) / fs_lim - 1.0));
+        snprintf(what, sizeof what, "%s: dentro de ±10 %% de min(estimación de 31, ADC)",
+                 mult == 1 ? "proceso actual" : "proceso ×4");
+        check(what, fabs(fs_of(pr3) / fs_lim - 1.0) <= 0.10);
+    }
+    g_c_proc = proc_base;
+    c.pr3 = search_pr3(c, no_tlm_drops, &r);
+    const double fs_tlm = (double)FCY / UART_BYTE_TCY / TLM_FRAME_LEN * ADC_BLOCK_LEN;
+    printf("      telemetría: sin descartes hasta %.0f Hz (cuenta: %u B por bloque a %.0f B/s "
+           "→ %.0f Hz)\n", fs_of(c.pr3), TLM_FRAME_LEN, (double)FCY / UART_BYTE_TCY, fs_tlm);
+    check("la telemetría a 115200 limita donde dice la cuenta (±5 %)",
+          fabs(fs_of(c.pr3) / fs_tlm - 1.0) <= 0.05);
+    c.pr3 = FCY / 150000UL - 1UL;
+    run(&c, &r);
+    print_res(&c, &r);
+    snprintf(what, sizeof what, "a %.0f Hz los marcos se descartan enteros, sin bloques perdidos",
+             fs_of(c.pr3));
+    check(what, clean(&r) && g_tlm_drops > 0 && r.frames_bad == 0);
+    printf("      con el proceso dentro de la ISR, ésta duraría hasta %lu TCY (%.1f us) "
+           "en vez de %lu\n",
+           (unsigned long)(g_c_isr + g_c_pub + ADC_HALF_LEN * C_PROC_X + C_PROC_BLK),
+           (g_c_isr + g_c_pub + ADC_HALF_LEN * C_PROC_X + C_PROC_BLK) * 1e6 / FCY,
+           (unsigned long)(g_c_isr + g_c_pub));
+
+    printf("\n3 consumidor atrasado: tarea lenta cada 50 ms a 20 kHz, 1 s\n");
+    const double t_blk_ms = 1e3 * ADC_BLOCK_LEN / 20000.0;
+    const double ok_ms = (ADC_NBLOCKS - 2U) * t_blk_ms;
+    static const double stall_ms[] = { 0.5, 2.0, 4.0, 6.0, 8.0, 12.0, 16.0 };
+    int tol_ok = 1, ovr_ok = 1, seen_ovr = 0;
+    for (uint32_t i = 0; i < sizeof stall_ms / sizeof stall_ms[0]; i++) {
+        c = (cfg_t){ .pr3 = FCY / 20000UL - 1UL, .seconds = 1.0,
+                     .stall_tcy = (uint32_t)(stall_ms[i] * FCY / 1e3), .stall_every = FCY / 20UL };
+        run(&c, &r);
+        printf("      %5.1f ms: entregados %lu de %lu, overruns %u, huecos en seq %lu, "
+               "marcos %lu (malos %lu)\n",
+               stall_ms[i], (unsigned long)r.delivered, (unsigned long)r.blocks, g_blk_overruns,
+               (unsigned long)r.gap_sum, (unsigned long)r.frames, (unsigned long)r.frames_bad);
+        if (stall_ms[i] < ok_ms && g_blk_overruns) tol_ok = 0;
+        if (g_blk_overruns) seen_ovr = 1;
+        if (r.bad_data || r.out_of_order || r.ovr_field_bad || r.frames_bad || r.stamp_bad ||
+            r.halves_lost || !accounted(&r))
+            ovr_ok = 0;
+    }
+    snprintf(what, sizeof what, "sin overrun con la tarea lenta < %u bloques (%.1f ms)",
+             ADC_NBLOCKS - 2U, ok_ms);
+    check(what, tol_ok);
+    check("más larga: cada bloque perdido contado una vez, con hueco en seq", seen_ovr && ovr_ok);
+
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
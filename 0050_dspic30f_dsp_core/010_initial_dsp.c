@@ -11,8 +11,10 @@
  *  – Deterministic trigger: PWM special‑event → ADC → ISR
  *  – Explicit interrupt priorities (level 6) and context save‑restore
  *  – Helper macros for Q‑math & saturation → clearer tuning section
- *  – More robust anti‑wind‑up (clamp tracks duty range automatically)
- *  – Dead‑time ready: complementary PWM2L enabled but held low
+ *  – PID from pid_q15.h: back‑calculation anti‑wind‑up against the real
+ *    duty limits, filtered D, bumpless retuning (g_retune)
+ *  – PWM2H/PWM2L complementary with a compile‑time checked
+ *    500 ns dead‑time (../0020_dspic30f_pwm/pwm_deadtime.h)
  *
  *  Author:  <your‑name> — 2025‑05‑30
  **********************************************************************/
@@ -34,41 +36,44 @@
 /*=========================== Constants ============================*/
 #define FCY         40000000UL
 #define PWM_FREQ_HZ 10000UL
+#define PWM_DT_NS   500                /* 20 Tcy @ 40 MHz */
+#define PWM_DT_PERIOD_TCY (FCY / PWM_FREQ_HZ)
 #include <xc.h>
 #include <stdint.h>
 #include <libpic30.h>
-/*====================== Fixed‑point helpers ========================*/
-#define Q15_SHIFT   15
-#define Q15_ONE     (1 << Q15_SHIFT)
-#define SAT_Q15(x)  __builtin_saturate(x, 15)   /* needs CORCON.SATA */
-
-static inline int32_t mac_q15(int16_t a, int16_t b, int32_t acc)
-{   /* one‑cycle multiply‑accumulate */
-    return __builtin_mla(a, b, acc);
-}
-static inline int32_t mul_q15(int16_t a, int16_t b)
-{   return __builtin_mulss(a, b);  }
-
-
-/* Tunable PI gains (Q1.15) */
-static volatile int16_t Kp_q15 = 0.5  * Q15_ONE;   /* 0.50 */
-static volatile int16_t Ki_q15 = 0.10 * Q15_ONE;   /* 0.10 */
+#include "../0020_dspic30f_pwm/pwm_deadtime.h"
+#include "pid_q15.h"
+/*====================== Controller tuning ==========================*/
+/* Ts = 1/PWM_FREQ_HZ: Kp = 1.0, Ti = 10·Ts, no D, Tt = Ti */
+static const pid_gains_t k_gains = {
+    .kp = PID_GAIN(1.0), .ki = Q15(0.10), .kd = 0, .ad = 0,
+    .kt = Q15(0.10),     .b  = PID_W_ONE, .c  = 0,
+};
+
+/* Write new gains here from the debugger, then set g_retune = 1 */
+static pid_gains_t        g_gains_new;
+static volatile uint16_t g_retune = 0;
 
 /*=========================== Globals ==============================*/
-static volatile int16_t setpoint_q15  = 0.5 * Q15_ONE;  /* 0‑1 per‑unit */
-static volatile int32_t integrator_q30 = 0;             /* extended */
+static volatile q15_t    setpoint_q15  = Q15(0.5);   /* 0‑1 per‑unit       */
+static pid_q15_t         g_pid;
+static volatile uint16_t g_pid_tcy     = 0;          /* last ISR, Tcy      */
+static volatile uint16_t g_pid_tcy_max = 0;
 
 /*==================== Function prototypes =========================*/
 static void init_clock(void);
 static void init_pwm(void);
 static void init_adc(void);
 static void init_corcon(void);
+static void init_timer1(void);
 
 /*============================== MAIN ==============================*/
 int main(void)
 {
     init_clock();
     init_corcon();
+    init_timer1();
+    pid_init(&g_pid, &k_gains, 0, Q15_MAX);      /* duty 0 … 100 %     */
     init_pwm();
     init_adc();
 
@@ -85,6 +90,16 @@ static void init_corcon(void)
     CORCONbits.RAF   = 0;  /* round to nearest (optional)                            */
 }
 
+/*---------------- Timer1: free‑running Tcy counter ----------------*/
+static void init_timer1(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0;          /* 1:1 → one tick per Tcy           */
+    T1CONbits.TON   = 1;
+}
+
 /*---------------- PWM module (10 kHz centre‑aligned) --------------*/
 static void init_pwm(void)
 {
@@ -95,10 +110,11 @@ static void init_pwm(void)
     PTPER  = (FCY / PWM_FREQ_HZ) - 1;             /* period value                        */
     PDC2   = 0;                                   /* start with 0 % duty                 */
 
-    PWMCON1bits.PMOD2 = 1;                        /* independent outputs                */
-    PWMCON1bits.PEN2H = 1;                        /* PWM2H → RE3                        */
-    PWMCON1bits.PEN2L = 1;                        /* PWM2L → RE2 (complement), for future*/
-    DTCON1           = 20;                        /* ~500 ns dead‑time @ 40 MHz          */
+    pwm_complementary_init(0x2U);                 /* PWM2H (RE3) / PWM2L (RE2)           */
+                                                  /* complementary, DTCON1 dead‑time     */
+
+    SEVTCMP            = 0;                       /* ADC trigger at period start         */
+    PWMCON2bits.SEVOPS = 0;                       /* every period                        */
 
     PTCONbits.PTEN   = 1;                         /* start PWM                           */
 }
@@ -108,7 +124,8 @@ static void init_adc(void)
 {
     /* Basic 10‑bit signed fractional output (‑1 … 0.999) */
     ADCON1 = 0;
-    ADCON1bits.SSRC = 0b111;      /* auto‑convert after TAD count */
+    ADCON1bits.SSRC = 0b011;      /* PWM special event ends sampling */
+    ADCON1bits.ASAM = 1;          /* sample until the trigger        */
     ADCON1bits.FORM = 0b01;       /* signed fractional            */
 
     ADCON2 = 0;                   /* use AVdd/AVss refs, one sample/channel */
@@ -117,9 +134,8 @@ static void init_adc(void)
     ADCHS  = 0;                   /* sample AN0                        */
     ADPCFG = 0xFFFE;              /* AN0 = analog, others digital      */
 
-    /* PWM special‑event trigger → SAMP set @ centre of period */
-    ADTRIG = 0;                   /* clear all first                  */
-    ADTRIGbits.TRGSRC0 = 0b0010;  /* PWM2 special event               */
+    /* dsPIC30F has no ADTRIG/TRGSRC: the trigger point is SEVTCMP
+       (set in init_pwm) and SSRC = 011 routes it to the ADC */
 
     IFS0bits.ADIF = 0;
     IPC2bits.ADIP = 6;            /* priority level 6                 */
@@ -128,29 +144,28 @@ static void init_adc(void)
     ADCON1bits.ADON = 1;          /* enable ADC                       */
 }
 
-/*================= ADC interrupt = PI control loop ===============*/
+/*================= ADC interrupt = PID control loop ==============*/
 void __attribute__((interrupt, no_auto_psv)) _ADCInterrupt(void)
 {
+    uint16_t t0 = TMR1;
     IFS0bits.ADIF = 0;          /* clear flag early */
 
     /*---------- Read & scale feedback (10‑bit → Q1.15) ----------*/
-    int16_t feedback_q15 = (int16_t)ADCBUF0 << 5;   /* 10‑bit ↗︎ 15‑bit */
-
-    /*---------------- PI algorithm in DSP core ------------------*/
-    int16_t error_q15 = setpoint_q15 - feedback_q15;
-
-    integrator_q30 = mac_q15(error_q15, Ki_q15, integrator_q30);
+    q15_t feedback_q15 = (q15_t)ADCBUF0 << 5;     /* 10‑bit ↗︎ 15‑bit */
 
-    /* Anti‑wind‑up: clamp to ±100 % duty in Q30 space */
-    int32_t max_int = ((int32_t)Q15_ONE << Q15_SHIFT);   /* 1.0 in Q30 */
-    if (integrator_q30 >  max_int) integrator_q30 =  max_int;
-    if (integrator_q30 < -max_int) integrator_q30 = -max_int;
+    /*---------- bumpless retune: P change moves into I ----------*/
+    if (g_retune) {
+        pid_set_gains(&g_pid, &g_gains_new);
+        g_retune = 0;
+    }
 
-    int32_t acc_q30 = (mul_q15(error_q15, Kp_q15) << 1) + integrator_q30;
+    /*---------- PID; integrator tracks the saturated duty -------*/
+    q15_t duty_q15 = pid_run(&g_pid, setpoint_q15, feedback_q15, 0);
 
     /*---------- Convert to duty register units (0…2·PTPER) ------*/
-    int16_t duty_q15 = SAT_Q15(acc_q30 >> Q15_SHIFT);    /* apply saturation */
+    PDC2 = (uint16_t)(((int32_t)duty_q15 * (PTPER << 1)) >> Q15_SHIFT);
 
-    uint16_t duty_counts = (uint16_t)(((int32_t)duty_q15 * (PTPER << 1)) >> Q15_SHIFT);
-    PDC2 = duty_counts;
+    uint16_t dt = TMR1 - t0;
+    g_pid_tcy = dt;
+    if (dt > g_pid_tcy_max) g_pid_tcy_max = dt;
 }
@@ -0,0 +1,173 @@
+/**********************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz, PLL ×16  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC‑DSC 3.21+ (C30 mode)
+ *
+ *  Demo: sin/cos encoder (resolver‑style) decoding with q15_math.h
+ *        – AN0 = sin track, AN1 = cos track, both centred at AVdd/2
+ *        – ADC delivers signed fractional (Q1.15) results directly
+ *        – both tracks sampled at the same instant (SIMSAM, CH1 = AN0,
+ *          CH0 = AN1), triggered by the PWM special event and decimated
+ *          by SEVOPS to DECODE_HZ. The ISR (15-step CORDIC + RMS) is a
+ *          few hundred cycles: under 10 % CPU at 5 kHz, where a
+ *          free-running scan interrupted at ~147 kHz and never caught up
+ *        – ISR: angle = atan2(sin, cos), amplitude = |(sin, cos)|
+ *        – PWM1L duty follows the electrical angle (0…360° → 0…100 %)
+ *        – main loop: RMS of the amplitude over 256 samples and its
+ *          level in log2 units, no float anywhere
+ *
+ *  Needs q15_math.h in the same project folder.
+ **********************************************************************/
+
+/*==================== CONFIGURATION BITS ===========================*/
+#pragma config FPR     = FRC_PLL16      // 7.37 MHz × 16 → FCY ≈ 29.48 MHz
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BOREN   = PBOR_ON
+#pragma config MCLRE   = MCLR_EN
+#pragma config ICS     = ICS_PGD
+/*==================================================================*/
+
+/*=========================== Constants ============================*/
+#define FCY           (7370000UL * 16UL / 4UL)
+#define PWM_FREQ_HZ   20000UL
+#define PTPER_VAL     ((FCY / PWM_FREQ_HZ) - 1)      /* free‑running       */
+#define RMS_LOG2_N    8                              /* 256‑sample window  */
+#define DECODE_HZ     5000UL                         /* ADC pair + decode  */
+#define ADC_POSTSCALE (PWM_FREQ_HZ / DECODE_HZ)      /* PWM periods/trigger */
+
+#if (ADC_POSTSCALE < 1) || (ADC_POSTSCALE > 16) || (PWM_FREQ_HZ % DECODE_HZ)
+#error "DECODE_HZ must be PWM_FREQ_HZ / (1…16)"
+#endif
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "q15_math.h"
+
+/*=========================== Globals ==============================*/
+static volatile q15_ang  g_angle     = 0;     /* electrical angle         */
+static volatile q15_t    g_amplitude = 0;     /* |(sin, cos)|, Q15        */
+static uint32_t          g_energy_acc = 0;    /* ISR only: Σ amplitude²   */
+static volatile uint32_t g_energy    = 0;     /* latched block, Q30 >> N  */
+static volatile uint16_t g_count     = 0;
+static volatile uint8_t  g_block_ready = 0;
+
+static q15_t   g_rms_q15   = 0;               /* main‑loop results        */
+static int16_t g_level_q11 = 0;               /* log2(rms), Q4.11         */
+
+/*==================== Function prototypes =========================*/
+static void init_pwm(void);
+static void init_adc(void);
+
+/*============================== MAIN ==============================*/
+int main(void)
+{
+    __builtin_disable_interrupts();
+    init_pwm();
+    init_adc();
+    __builtin_enable_interrupts();
+
+    while (1)
+    {
+        if (g_block_ready)
+        {
+            IEC0bits.ADIE = 0;                 /* atomic 32-bit read */
+            uint32_t e = g_energy;
+            g_block_ready = 0;
+            IEC0bits.ADIE = 1;
+
+            /* mean of a² is already Q30 (shifted by N in the ISR) */
+            g_rms_q15   = q15_sqrt_q30(e);
+            g_level_q11 = q15_log2(g_rms_q15);  /* −15 … 0, e.g. −1.0 = half scale */
+        }
+    }
+}
+
+/*---------------- PWM1L on RE0, free‑running ---------------------*/
+static void init_pwm(void)
+{
+    TRISEbits.TRISE0 = 0;
+
+    PTCONbits.PTEN   = 0;
+    PTCONbits.PTCKPS = 0;                 /* 1:1                      */
+    PTCONbits.PTMOD  = 0;                 /* free‑running             */
+    PTPER = PTPER_VAL;
+
+    PWMCON1 = 0;
+    PWMCON1bits.PMOD1 = 1;                /* independent              */
+    PWMCON1bits.PEN1L = 1;                /* RE0                      */
+    DTCON1 = 0;
+    OVDCON = 0;
+    OVDCONbits.POVD1L = 1;
+
+    PDC1 = 0;
+    PWMCON2bits.IUE = 1;
+
+    /* ADC trigger at the start of the period, every ADC_POSTSCALE periods */
+    SEVTCMP = 0;
+    PWMCON2bits.SEVOPS = ADC_POSTSCALE - 1;
+    PTCONbits.PTEN  = 1;
+}
+
+/*---------------- ADC: AN0/AN1 simultaneous, signed fractional ---*/
+static void init_adc(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFGbits.PCFG0 = 0;                 /* AN0 = sin                */
+    ADPCFGbits.PCFG1 = 0;                 /* AN1 = cos                */
+
+    ADCON1 = 0;
+    ADCON1bits.FORM   = 0b11;             /* signed fractional → Q15  */
+    ADCON1bits.SSRC   = 0b011;            /* PWM special event        */
+    ADCON1bits.SIMSAM = 1;                /* CH0 and CH1 together     */
+    ADCON1bits.ASAM   = 1;                /* sampling until trigger   */
+
+    ADCON2 = 0;
+    ADCON2bits.CHPS = 0b01;               /* CH0, CH1                 */
+    ADCON2bits.SMPI = 1;                  /* IRQ after the pair       */
+
+    ADCON3bits.ADCS = 9;                  /* TAD = (ADCS+1)/2·Tcy ≈ 170 ns */
+
+    ADCHS = 0;
+    ADCHSbits.CH123SA = 0;                /* CH1 = AN0 (sin)          */
+    ADCHSbits.CH0SA   = 1;                /* CH0 = AN1 (cos)          */
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 5;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+}
+
+/*================= ADC interrupt: polar decode ===================*/
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    IFS0bits.ADIF = 0;
+
+    q15_t c = (q15_t)ADCBUF0;             /* CH0 = AN1 → cos          */
+    q15_t s = (q15_t)ADCBUF1;             /* CH1 = AN0 → sin          */
+
+    q15_t   mag;
+    q15_ang ang = q15_cordic_polar(c, s, &mag);
+
+    g_angle     = ang;
+    g_amplitude = mag;
+
+    /* duty = angle / 2π · 2(PTPER+1) */
+    PDC1 = (uint16_t)(((uint32_t)ang * (2UL * (PTPER_VAL + 1UL))) >> 16);
+
+    /* accumulate mean square: a² (Q30) / 2^N keeps the sum in 32 bits;
+       latch exactly 2^N samples so main never sees a longer window */
+    g_energy_acc += ((uint32_t)((q31_t)mag * mag)) >> RMS_LOG2_N;
+    if (++g_count >= (1U << RMS_LOG2_N)) {
+        g_energy      = g_energy_acc;
+        g_energy_acc  = 0;
+        g_count       = 0;
+        g_block_ready = 1;
+    }
+}
@@ -0,0 +1,207 @@
+/**********************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz, PLL ×16  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC‑DSC 3.21+ (C30 mode)
+ *
+ *  Demo: 20 kHz field‑oriented current control (foc_q15.h)
+ *        – PWM1/2/3 complementary, centre‑aligned, ~1 µs dead‑time
+ *          (pwm_deadtime.h), compensated from the sign of each
+ *          measured phase current before the duties are committed
+ *        – ADC started by the PWM special event at the carrier peak
+ *          (low‑side switches on → low‑side shunts valid)
+ *        – CH1/CH2/CH3 sample AN0/AN1/AN2 simultaneously, CH0 = AN3
+ *            AN0 = ia, AN1 = ib, AN2 = Vdc sense, AN3 = torque pot
+ *        – whole FOC chain runs in _ADCInterrupt, once per period
+ *        – angle: open‑loop ramp (I/f start‑up); replace g_theta_step
+ *          by an encoder/observer angle when one is available
+ *        – TMR1 free‑runs at Tcy to record the ISR cost per period
+ **********************************************************************/
+
+/*==================== CONFIGURATION BITS ===========================*/
+#pragma config FPR     = FRC_PLL16      // 7.37 MHz × 16 → FCY ≈ 29.48 MHz
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN     // PWM pins hi‑Z after reset
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BOREN   = PBOR_ON
+#pragma config MCLRE   = MCLR_EN
+#pragma config ICS     = ICS_PGD
+/*==================================================================*/
+
+/*=========================== Constants ============================*/
+#define FCY            (7370000UL * 16UL / 4UL)
+#define PWM_FREQ_HZ    20000UL
+/* centre‑aligned: period = 2·(PTPER+1)·Tcy */
+#define PTPER_VAL      ((FCY / (2UL * PWM_FREQ_HZ)) - 1)      /* 736 */
+#define PWM_DT_NS      1000                                   /* 30 Tcy */
+#define PWM_DT_PERIOD_TCY  (2UL * (PTPER_VAL + 1))
+#define DTC_BAND_SHIFT 9U                     /* linear below ±1.6 % FS */
+#define CYCLE_BUDGET   (FCY / PWM_FREQ_HZ)                    /* 1474 Tcy */
+
+/* Open‑loop electrical speed: Δθ per period = f_el · 65536 / f_pwm */
+#define OPENLOOP_HZ    20UL
+#define THETA_STEP     ((uint16_t)((OPENLOOP_HZ * 65536UL) / PWM_FREQ_HZ))
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "q15_math.h"
+#include "foc_q15.h"
+#include "../0020_dspic30f_pwm/pwm_dutyset.h"
+#include "../0020_dspic30f_pwm/pwm_deadtime.h"
+
+/*=========================== Globals ==============================*/
+static foc_t             g_foc;
+static pwm_dtc_t         g_dtc;
+static volatile uint16_t g_dtc_on        = 1;      /* 0 → raw SVM duties */
+static volatile uint16_t g_theta_step    = THETA_STEP;
+static volatile q15_t    g_ia_offset     = 0;      /* measured at start */
+static volatile q15_t    g_ib_offset     = 0;
+static volatile q15_t    g_vdc           = 0;
+static volatile uint16_t g_foc_cycles    = 0;      /* last ISR, Tcy     */
+static volatile uint16_t g_foc_cycles_max = 0;     /* worst case, Tcy   */
+static volatile uint16_t g_foc_overruns  = 0;      /* ISR > one period  */
+
+/*==================== Function prototypes =========================*/
+static void init_pwm(void);
+static void init_adc(void);
+static void init_timer1(void);
+static void calibrate_offsets(void);
+
+/*============================== MAIN ==============================*/
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    foc_init(&g_foc, PTPER_VAL, Q15(0.25), Q15(0.01));
+    init_timer1();
+    init_pwm();
+    init_adc();
+    calibrate_offsets();              /* outputs still overridden low */
+
+    OVDCON = 0x3F00;                  /* PWM takes the six pins       */
+    __builtin_enable_interrupts();
+
+    while (1)
+    {
+        /* background: anything that is not time‑critical */
+    }
+}
+
+/*---------------- Timer1: free‑running Tcy counter ----------------*/
+static void init_timer1(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0;              /* 1:1 → one tick per Tcy       */
+    T1CONbits.TON   = 1;              /* no interrupt, only a stamp   */
+}
+
+/*---------------- PWM: 3 complementary pairs, centre‑aligned -------*/
+static void init_pwm(void)
+{
+    PTCONbits.PTEN   = 0;
+    PTCONbits.PTCKPS = 0;
+    PTCONbits.PTMOD  = 0b10;          /* continuous up/down           */
+    PTPER = PTPER_VAL;
+
+    PWMCON1 = 0;
+    pwm_complementary_init(0x7U);     /* 3 complementary pairs + DTCON1 */
+    pwm_dtc_init(&g_dtc, PWM_DT_COMP_CENTER, DTC_BAND_SHIFT,
+                 2U * (PTPER_VAL + 1));
+
+    OVDCON = 0x0000;                  /* all outputs overridden …     */
+                                      /* … and driven inactive (POUT=0) */
+    PDC1 = PDC2 = PDC3 = PTPER_VAL + 1;  /* 50 % → zero voltage       */
+
+    /* special event at the carrier peak, counting up */
+    SEVTCMP = PTPER_VAL;              /* SEVTDIR (bit 15) = 0         */
+    PWMCON2 = 0;
+    PWMCON2bits.SEVOPS = 0;           /* every period                 */
+    PWMCON2bits.IUE    = 0;           /* duties latch at period start */
+
+    PTCONbits.PTEN = 1;
+}
+
+/*---------------- ADC: PWM‑triggered, 4 channels simultaneous -----*/
+static void init_adc(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFG &= ~0x000F;                /* AN0…AN3 analogue             */
+
+    ADCON1 = 0;
+    ADCON1bits.FORM   = 0b11;         /* signed fractional → Q15      */
+    ADCON1bits.SSRC   = 0b011;        /* motor‑control PWM special evt */
+    ADCON1bits.SIMSAM = 1;            /* CH0…CH3 sampled together     */
+    ADCON1bits.ASAM   = 1;            /* sample until the trigger     */
+
+    ADCON2 = 0;
+    ADCON2bits.CHPS = 0b10;           /* convert CH0, CH1, CH2, CH3   */
+    ADCON2bits.SMPI = 3;              /* IRQ after 4 conversions      */
+
+    ADCON3bits.ADCS = 9;              /* TAD = (ADCS+1)/2·Tcy ≈ 170 ns */
+    ADCON3bits.SAMC = 2;
+
+    ADCHS = 0;
+    ADCHSbits.CH123SA = 0;            /* CH1=AN0, CH2=AN1, CH3=AN2    */
+    ADCHSbits.CH0SA   = 3;            /* CH0=AN3                      */
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 6;                /* above everything else        */
+    IEC0bits.ADIE = 0;                /* enabled after calibration    */
+
+    ADCON1bits.ADON = 1;
+}
+
+/*---------------- zero‑current offsets with the bridge off --------*/
+static void calibrate_offsets(void)
+{
+    int32_t sa = 0, sb = 0;
+    for (uint16_t n = 0; n < 64; n++) {
+        IFS0bits.ADIF = 0;
+        while (!IFS0bits.ADIF);       /* one PWM‑triggered set        */
+        sa += (q15_t)ADCBUF1;
+        sb += (q15_t)ADCBUF2;
+    }
+    g_ia_offset = (q15_t)(sa >> 6);
+    g_ib_offset = (q15_t)(sb >> 6);
+
+    IFS0bits.ADIF = 0;
+    IEC0bits.ADIE = 1;
+}
+
+/*================= ADC interrupt = FOC current loop ==============*/
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    uint16_t t0 = TMR1;
+    IFS0bits.ADIF = 0;
+
+    /* buffer order for SIMSAM: CH0, CH1, CH2, CH3 */
+    q15_t iq_ref = (q15_t)ADCBUF0;                    /* AN3 pot     */
+    q15_t ia     = q15_sat((q31_t)(q15_t)ADCBUF1 - g_ia_offset);
+    q15_t ib     = q15_sat((q31_t)(q15_t)ADCBUF2 - g_ib_offset);
+    g_vdc        = (q15_t)ADCBUF3;
+
+    g_foc.iq_ref = iq_ref >> 1;                       /* ±0.5 pu     */
+    g_foc.id_ref = 0;
+    g_foc.theta += g_theta_step;
+
+    foc_step(&g_foc, ia, ib);
+
+    /* dead‑time compensation: phase current > 0 flows into the motor */
+    if (g_dtc_on) {
+        const q15_t iabc[3] = { ia, ib, q15_sat(-(q31_t)ia - ib) };
+        pwm_dtc_apply3(&g_dtc, g_foc.pdc, iabc);
+    }
+
+    /* all three phases latch at the same valley (UDIS bracket) */
+    pwm_duty_commit(g_foc.pdc);
+
+    uint16_t dt = TMR1 - t0;
+    g_foc_cycles = dt;
+    if (dt > g_foc_cycles_max) g_foc_cycles_max = dt;
+    if (dt > CYCLE_BUDGET)     g_foc_overruns++;
+}
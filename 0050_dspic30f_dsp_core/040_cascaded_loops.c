@@ -0,0 +1,304 @@
+/**********************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz, PLL ×16  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC‑DSC 3.21+ (C30 mode)
+ *
+ *  Demo: synchronous buck, cascaded current / voltage control from one
+ *        PWM‑synchronised ADC interrupt (ctl_sched.h)
+ *        – PWM1H (high side) / PWM1L (low side) complementary,
+ *          centre‑aligned 20 kHz, 250 ns dead‑time (pwm_deadtime.h)
+ *        – ADC started by the special event at the valley, i.e. in
+ *          the middle of the high‑side pulse, where the inductor
+ *          current equals its period average
+ *        – CH1/CH2/CH3 sample AN0/AN1/AN2 simultaneously, CH0 = AN3
+ *            AN0 = inductor current, AN1 = Vout, AN2 = Vin,
+ *            AN3 = output voltage setpoint (pot)
+ *          Vout and Vin use the same divider, so Vout/Vin is a duty
+ *        – every tick (20 kHz): current PI with Vout/Vin feedforward,
+ *          PDC1 written, then the slow tasks of the current slot
+ *        – slow tasks, 16‑tick frame, phases chosen by
+ *          ctl_sched_place() so no two heavy tasks share a slot:
+ *            voltage PI       ÷8   2.5 kHz  (average of 8 samples)
+ *            feedforward      ÷8   2.5 kHz  (one divide)
+ *            telemetry        ÷16  1.25 kHz
+ *            protection       ÷16  1.25 kHz
+ *            soft‑start ramp  ÷16  1.25 kHz
+ *        – g_sched.tcy_max[slot]: worst whole‑ISR time per slot
+ *          (TMR1 stamps), g_sched.overruns: ticks over budget,
+ *          g_sched_est_peak: heaviest slot by the estimates
+ **********************************************************************/
+
+/*==================== CONFIGURATION BITS ===========================*/
+#pragma config FPR     = FRC_PLL16      // 7.37 MHz × 16 → FCY ≈ 29.48 MHz
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN     // PWM pins hi‑Z after reset
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BOREN   = PBOR_ON
+#pragma config MCLRE   = MCLR_EN
+#pragma config ICS     = ICS_PGD
+/*==================================================================*/
+
+/*=========================== Constants ============================*/
+#define FCY            (7370000UL * 16UL / 4UL)
+#define PWM_FREQ_HZ    20000UL
+/* centre‑aligned: period = 2·(PTPER+1)·Tcy, PDC 0 … 2·(PTPER+1) */
+#define PTPER_VAL      ((FCY / (2UL * PWM_FREQ_HZ)) - 1)      /* 736 */
+#define PDC_FULL       (2UL * (PTPER_VAL + 1))
+#define PWM_DT_NS      250                                    /* 8 Tcy */
+#define PWM_DT_PERIOD_TCY  PDC_FULL
+#define CYCLE_BUDGET   (FCY / PWM_FREQ_HZ)                    /* 1474 Tcy */
+
+/* Rate dividers of the slow tasks (powers of two, ≤ CTL_SLOTS) */
+#define CTL_SLOTS      16
+#define VLOOP_DIV      8U
+#define FF_DIV         8U
+#define SLOW_DIV       16U
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "q15_math.h"
+#include "pid_q15.h"
+#include "ctl_sched.h"
+#include "../0020_dspic30f_pwm/pwm_deadtime.h"
+
+/* Limits, per unit of the ADC full scale */
+#define DUTY_MAX       Q15(0.95)        /* keep the bootstrap charged    */
+#define I_LIMIT        Q15(0.80)        /* current reference clamp       */
+#define VOUT_OV        Q15(0.90)        /* output over‑voltage trip      */
+#define VIN_UV         Q15(0.20)        /* input under‑voltage trip      */
+#define RAMP_STEP      Q15(0.0008)      /* setpoint slope per ramp call  */
+                                        /* 0 → 1.0 in ~1 s at 1.25 kHz   */
+
+/*====================== Controller tuning ==========================*/
+/* Starting values, tune on the board.
+   Inner loop, Ts = 50 µs: Kp = 0.5, Ti = 25·Ts, Tt = Ti */
+static const pid_gains_t k_iloop = {
+    .kp = PID_GAIN(0.5), .ki = Q15(0.02), .kd = 0, .ad = 0,
+    .kt = Q15(0.04),     .b  = PID_W_ONE, .c  = 0,
+};
+/* Outer loop, Ts = 400 µs: Kp = 2.0, Ti = 40·Ts, Tt = Ti */
+static const pid_gains_t k_vloop = {
+    .kp = PID_GAIN(2.0), .ki = Q15(0.05), .kd = 0, .ad = 0,
+    .kt = Q15(0.025),    .b  = PID_W_ONE, .c  = 0,
+};
+
+/*=========================== Types ================================*/
+typedef struct {
+    q15_t    vout, vin, il, iref, vref;
+    uint16_t seq;
+} tele_t;
+
+/*=========================== Globals ==============================*/
+static pid_q15_t         g_iloop, g_vloop;
+static ctl_sched_t       g_sched;
+static volatile uint16_t g_sched_est_peak = 0;
+
+/* written by the inner loop, read by the slow tasks */
+static int32_t           g_vo_sum = 0;     /* Vout, summed per tick   */
+static q15_t             g_vo     = 0;     /* last Vout sample        */
+static q15_t             g_vin    = 0;     /* last Vin sample         */
+static q15_t             g_il     = 0;     /* last inductor current   */
+static q15_t             g_pot    = 0;     /* setpoint pot            */
+
+/* written by the slow tasks, read by the inner loop */
+static q15_t             g_iref   = 0;     /* current reference       */
+static q15_t             g_d_ff   = 0;     /* Vref/Vin duty           */
+static q15_t             g_vref   = 0;     /* ramped voltage setpoint */
+static q15_t             g_vin_f  = 0;     /* filtered Vin            */
+static volatile uint16_t g_fault  = 0;     /* latched, 1 = OV, 2 = UV */
+
+static volatile tele_t   g_tele;
+
+/*==================== Function prototypes =========================*/
+static void init_pwm(void);
+static void init_adc(void);
+static void init_timer1(void);
+static void task_vloop(void);
+static void task_ff(void);
+static void task_tele(void);
+static void task_protect(void);
+static void task_ramp(void);
+
+/*======================== Slow task table =========================*/
+/* est_tcy: estimates from the instruction count, used only to place
+   the phases; tcy_max[] shows what the slots really cost. */
+static ctl_task_t g_tasks[] = {
+    { task_vloop,   VLOOP_DIV, 0, 200 },
+    { task_ff,      FF_DIV,    0,  80 },
+    { task_tele,    SLOW_DIV,  0,  60 },
+    { task_protect, SLOW_DIV,  0,  60 },
+    { task_ramp,    SLOW_DIV,  0,  40 },
+};
+
+/*============================== MAIN ==============================*/
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    pid_init(&g_iloop, &k_iloop, 0, DUTY_MAX);
+    pid_init(&g_vloop, &k_vloop, 0, I_LIMIT);
+    g_sched_est_peak = ctl_sched_place(&g_sched, g_tasks,
+                                       sizeof g_tasks / sizeof g_tasks[0],
+                                       CYCLE_BUDGET);
+    if (g_sched_est_peak == CTL_BAD)
+        while (1);                    /* task table error: stop here  */
+
+    init_timer1();
+    init_pwm();
+    init_adc();
+
+    OVDCON = 0x0300;                  /* PWM takes PWM1H / PWM1L      */
+    __builtin_enable_interrupts();
+
+    uint16_t seq = 0;
+    while (1)
+    {
+        /* background: g_tele is a coherent snapshot, new one when
+           seq changes (send it, log it …) */
+        if (g_tele.seq != seq) {
+            seq = g_tele.seq;
+        }
+    }
+}
+
+/*---------------- Timer1: free‑running Tcy counter ----------------*/
+static void init_timer1(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0;              /* 1:1 → one tick per Tcy       */
+    T1CONbits.TON   = 1;
+}
+
+/*---------------- PWM1: complementary pair, centre‑aligned ---------*/
+static void init_pwm(void)
+{
+    PTCONbits.PTEN   = 0;
+    PTCONbits.PTCKPS = 0;
+    PTCONbits.PTMOD  = 0b10;          /* continuous up/down           */
+    PTPER = PTPER_VAL;
+
+    PWMCON1 = 0;
+    pwm_complementary_init(0x1U);     /* PWM1H / PWM1L + DTCON1       */
+
+    OVDCON = 0x0000;                  /* outputs overridden low       */
+    PDC1   = 0;
+
+    SEVTCMP = 0;                      /* valley, centre of PWM1H pulse */
+    PWMCON2 = 0;
+    PWMCON2bits.SEVOPS = 0;           /* ADC every period             */
+
+    PTCONbits.PTEN = 1;
+}
+
+/*---------------- ADC: PWM‑triggered, 4 channels simultaneous -----*/
+static void init_adc(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFG &= ~0x000F;                /* AN0…AN3 analogue             */
+
+    ADCON1 = 0;
+    ADCON1bits.FORM   = 0b10;         /* fractional, 0 … 0xFFC0       */
+    ADCON1bits.SSRC   = 0b011;        /* motor‑control PWM special evt */
+    ADCON1bits.SIMSAM = 1;
+    ADCON1bits.ASAM   = 1;
+
+    ADCON2 = 0;
+    ADCON2bits.CHPS = 0b10;           /* CH0…CH3                      */
+    ADCON2bits.SMPI = 3;              /* IRQ after 4 conversions      */
+
+    ADCON3bits.ADCS = 9;              /* TAD ≈ 170 ns                 */
+    ADCON3bits.SAMC = 2;
+
+    ADCHS = 0;
+    ADCHSbits.CH123SA = 0;            /* CH1=AN0, CH2=AN1, CH3=AN2    */
+    ADCHSbits.CH0SA   = 3;            /* CH0=AN3                      */
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 6;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+}
+
+/*======================== Slow tasks ==============================*/
+/* Voltage PI on the average of the last VLOOP_DIV samples */
+static void task_vloop(void)
+{
+    q15_t vo = (q15_t)(g_vo_sum / (int32_t)VLOOP_DIV);
+    g_vo_sum = 0;
+    g_iref   = pid_run(&g_vloop, g_vref, vo, 0);
+}
+
+/* Duty feedforward Vref/Vin: the one divide lives here, not at 20 kHz */
+static void task_ff(void)
+{
+    g_vin_f += (g_vin - g_vin_f) >> 2;              /* 4‑tap IIR      */
+    if (g_vin_f <= g_vref)
+        g_d_ff = DUTY_MAX;
+    else
+        g_d_ff = (q15_t)Q15_DIVUD((uint32_t)g_vref << Q15_SHIFT, g_vin_f);
+}
+
+static void task_tele(void)
+{
+    g_tele.vout = g_vo;
+    g_tele.vin  = g_vin;
+    g_tele.il   = g_il;
+    g_tele.iref = g_iref;
+    g_tele.vref = g_vref;
+    g_tele.seq++;
+}
+
+/* Latched trip: both switches off, controllers reset */
+static void task_protect(void)
+{
+    if (g_fault) return;
+    if (g_vo > VOUT_OV)       g_fault = 1;
+    else if (g_vin < VIN_UV)  g_fault = 2;
+    else return;
+
+    OVDCON = 0x0000;                  /* PWM1H = PWM1L = 0            */
+    PDC1   = 0;
+    pid_reset(&g_iloop);
+    pid_reset(&g_vloop);
+    g_iref = 0;
+    g_vref = 0;
+}
+
+/* Soft start: g_vref follows the pot at RAMP_STEP per call */
+static void task_ramp(void)
+{
+    q15_t tgt = g_fault ? 0 : g_pot;
+    if (tgt > g_vref + RAMP_STEP)       g_vref += RAMP_STEP;
+    else if (tgt < g_vref - RAMP_STEP)  g_vref -= RAMP_STEP;
+    else                                g_vref  = tgt;
+}
+
+/*============ ADC interrupt = inner loop + scheduled slots ========*/
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    uint16_t t0 = TMR1;
+    IFS0bits.ADIF = 0;
+
+    /* buffer order for SIMSAM: CH0, CH1, CH2, CH3; 0xFFC0 → Q15 */
+    g_pot = (q15_t)(ADCBUF0 >> 1);
+    g_il  = (q15_t)(ADCBUF1 >> 1);
+    g_vo  = (q15_t)(ADCBUF2 >> 1);
+    g_vin = (q15_t)(ADCBUF3 >> 1);
+    g_vo_sum += g_vo;
+
+    /* inner loop first: its latency does not depend on the slot */
+    if (!g_fault) {
+        q15_t d = pid_run(&g_iloop, g_iref, g_il, g_d_ff);
+        PDC1 = (uint16_t)(((uint32_t)d * PDC_FULL) >> Q15_SHIFT);
+    }
+
+    ctl_sched_run(&g_sched);
+    ctl_sched_end(&g_sched, TMR1 - t0);
+}
@@ -0,0 +1,284 @@
+/**********************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz, PLL ×16  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC‑DSC 3.21+ (C30 mode)
+ *
+ *  Demo: grid frequency and harmonic detection on the ADC stream
+ *        (tone_q15.h), results over UART2 instead of raw samples
+ *        – Timer3 starts the ADC, CSCNA scans AN0 and AN1, one IRQ
+ *          per pair: FS_HZ per channel (3200 Hz ≈ 64 samples per
+ *          50 Hz cycle). Inputs biased at mid‑scale, signed
+ *          fractional → Q15.
+ *            AN0 = grid voltage → sliding DFT, N = 64, bin 1 (50 Hz):
+ *                  amplitude, phase and frequency (tone_freq)
+ *            AN1 = line current → Goertzel, N = 256 (80 ms), bins at
+ *                  k_harm[] × 50 Hz: harmonic content
+ *        – the ISR only pushes the two samples; when a Goertzel block
+ *          ends it copies the voltage bin and the current bins, so
+ *          both reports refer to the same sample instant (phases
+ *          directly comparable) and the background never reads the
+ *          32‑bit engine state while it moves, and stamps them with
+ *          the 64‑bit timebase
+ *          (../0140_dspic30f_timebase, Timer4/5: Timer3 is the ADC's)
+ *        – frequency only from consecutive blocks; a skipped block
+ *          (background too slow) is counted in g_late
+ *        – the background turns them into magnitude / phase and sends
+ *          two ADC_PACK_TONE frames (../0060_uart/adc_pack.h) per
+ *          block, ≈ 640 B/s against 12.8 kB/s of raw 10‑bit samples
+ *          that 115200 bps could not carry
+ *        – host/tone_bench.c: accuracy and cost of the same engines;
+ *          ../0060_uart/host/adc_unpack.c prints the frames
+ *        – g_tone_tcy / g_tone_tcy_max: per‑sample ISR cost (TMR1)
+ **********************************************************************/
+
+/*==================== CONFIGURATION BITS ===========================*/
+#pragma config FPR     = FRC_PLL16      // 7.37 MHz × 16 → FCY ≈ 29.48 MHz
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BOREN   = PBOR_ON
+#pragma config MCLRE   = MCLR_EN
+#pragma config ICS     = ICS_PGD
+/*==================================================================*/
+
+/*=========================== Constants ============================*/
+#define FCY            (7370000UL * 16UL / 4UL)
+
+/* Sampling: 2 channels per Timer3 period */
+#define ADC_NCH        2UL
+#define FS_HZ          3200UL                                 /* per channel */
+#define PR3_COUNTS     ((FCY / (FS_HZ * ADC_NCH)) - 1)        /* 4605 */
+#define FS_REAL        ((double)FCY / (ADC_NCH * (PR3_COUNTS + 1)))   /* 3200.17 */
+#define FS_CHZ         ((uint32_t)(FS_REAL * 100.0 + 0.5))    /* fs, 0.01 Hz */
+
+#define GRID_HZ        50.0
+#define SD_LOG2N       6                /* 64‑sample window, bin 1 = fs/64 */
+#define GZ_LOG2N       8                /* 256‑sample Goertzel blocks      */
+
+/* UART2 */
+#define UART_BAUD      115200UL
+#define U2BRG_VAL      (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+#define TX_RING_LEN    128U             /* power of 2                      */
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "q15_math.h"
+#include "tone_q15.h"
+#include "../0060_uart/adc_pack.h"
+#define TB_T45                          /* Timer3 triggers the ADC         */
+#include "../0140_dspic30f_timebase/timebase.h"
+
+#define NHARM          6
+#if NHARM > ADC_PACK_TONE_MAX || NHARM > TONE_MAX_BINS
+#error "NHARM does not fit one TONE frame"
+#endif
+
+/* Harmonics of GRID_HZ watched on the current (steps folded at
+   compile time, no float at run time) */
+#define HARM(h)        { h, TONE_W((h) * GRID_HZ, FS_REAL) }
+static const struct { uint8_t h; q15_ang w; } k_harm[NHARM] = {
+    HARM(1), HARM(3), HARM(5), HARM(7), HARM(9), HARM(11),
+};
+
+/*=========================== Globals ==============================*/
+static q15_t             g_vhist[1 << SD_LOG2N];
+static tone_sdft_t       g_vsd;                 /* AN0, voltage          */
+static tone_gz_t         g_igz;                 /* AN1, current          */
+
+/* written by the ISR at the end of a Goertzel block */
+typedef struct { q31_t re, im; } gz_snap_t;
+static tone_sdft_bin_t   g_vsnap;
+static gz_snap_t         g_isnap[NHARM];
+static uint32_t          g_snap_t;              /* timebase, last sample */
+static volatile uint16_t g_snap_seq = 0;
+
+static volatile uint16_t g_tone_tcy     = 0;    /* last ISR, Tcy        */
+static volatile uint16_t g_tone_tcy_max = 0;
+static uint16_t          g_late = 0;            /* blocks never reported */
+
+static uint8_t           g_tx_ring[TX_RING_LEN];
+static uint16_t          g_tx_head = 0, g_tx_tail = 0;
+static uint16_t          g_tx_drops = 0;
+
+/*==================== Function prototypes =========================*/
+static void init_timer1(void);
+static void init_adc(void);
+static void init_uart2(void);
+static void tx_frame(const uint8_t *f, uint8_t len);
+static void tx_pump(void);
+static uint16_t report(void);
+
+/*============================== MAIN ==============================*/
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    tone_sdft_init(&g_vsd, g_vhist, SD_LOG2N);
+    tone_sdft_add(&g_vsd, 1);                   /* fs/64 ≈ 50 Hz        */
+    tone_gz_init(&g_igz, GZ_LOG2N);
+    for (uint8_t i = 0; i < NHARM; i++)
+        tone_gz_add(&g_igz, k_harm[i].w);
+
+    init_timer1();
+    tb_init();
+    init_uart2();
+    init_adc();
+
+    __builtin_enable_interrupts();
+
+    uint16_t seq = 0;
+    while (1)
+    {
+        if (g_snap_seq != seq)
+            seq = report();
+        tx_pump();
+    }
+}
+
+/*---------------- Timer1: free‑running Tcy counter ----------------*/
+static void init_timer1(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0;
+    T1CONbits.TON   = 1;
+}
+
+/*---------------- ADC: Timer3, scan AN0/AN1 -----------------------*/
+static void init_adc(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFG &= ~0x0003;                /* AN0, AN1 analogue            */
+    ADCSSL = 0x0003;
+
+    ADCON1 = 0;
+    ADCON1bits.FORM = 0b11;           /* signed fractional → Q15      */
+    ADCON1bits.SSRC = 0b010;          /* Timer3 compare               */
+    ADCON1bits.ASAM = 1;
+
+    ADCON2 = 0;
+    ADCON2bits.CSCNA = 1;
+    ADCON2bits.SMPI  = ADC_NCH - 1;   /* one IRQ per AN0/AN1 pair     */
+
+    ADCON3bits.ADCS = 9;              /* TAD ≈ 170 ns                 */
+    ADCHS = 0;
+
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = PR3_COUNTS;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 5;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    T3CONbits.TON   = 1;
+}
+
+/*---------------- UART2: 8N1, TX only -----------------------------*/
+static void init_uart2(void)
+{
+    U2MODE = 0;
+    U2BRG  = (uint16_t)U2BRG_VAL;
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+}
+
+/*================= ADC interrupt: one sample per engine ===========*/
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    uint16_t t0 = TMR1;
+    IFS0bits.ADIF = 0;
+
+    tone_sdft_push(&g_vsd, (q15_t)ADCBUF0);
+    if (tone_gz_push(&g_igz, (q15_t)ADCBUF1)) {
+        g_vsnap  = g_vsd.b[0];                  /* same sample instant  */
+        for (uint8_t i = 0; i < NHARM; i++) {
+            g_isnap[i].re = g_igz.b[i].re;
+            g_isnap[i].im = g_igz.b[i].im;
+        }
+        g_snap_t = tb_now32();
+        g_snap_seq++;
+    }
+
+    uint16_t dt = TMR1 - t0;
+    g_tone_tcy = dt;
+    if (dt > g_tone_tcy_max) g_tone_tcy_max = dt;
+}
+
+/*================= Background: polar conversion + frames ==========*/
+/* Returns the block number it reported */
+static uint16_t report(void)
+{
+    static q15_ang  ph_last;
+    static uint16_t seq_last;
+    static uint8_t  have_last = 0, fseq = 0;
+    uint8_t         frame[ADC_PACK_FRAME_MAX];
+    adc_tone_t      t[NHARM];
+    tone_res_t      r;
+    tone_sdft_bin_t v;
+    gz_snap_t       cur[NHARM];
+    uint32_t        ts;
+    uint16_t        sq, f0_chz = 0;
+
+    __builtin_disable_interrupts();             /* one block, whole     */
+    v  = g_vsnap;
+    for (uint8_t i = 0; i < NHARM; i++) cur[i] = g_isnap[i];
+    ts = g_snap_t;
+    sq = g_snap_seq;
+    __builtin_enable_interrupts();
+
+    /* voltage: fundamental + frequency from the phase advance over
+       one block (valid within ±fs/512 ≈ ±6 Hz of the bin). ph_last
+       is only one block back if no block was skipped. */
+    tone_sdft_result(&v, SD_LOG2N, &r);
+    if (have_last) g_late += (uint16_t)(sq - seq_last - 1U);
+    if (have_last && (uint16_t)(sq - seq_last) == 1U && tone_sdft_ready(&g_vsd)) {
+        uint32_t w0 = tone_freq(ph_last, r.phase, 1U << GZ_LOG2N, v.w);
+        f0_chz = (uint16_t)(((uint64_t)w0 * FS_CHZ) >> 32);
+    }
+    ph_last   = r.phase;
+    seq_last  = sq;
+    have_last = 1;
+    t[0].id    = 1;
+    t[0].mag   = (uint16_t)r.mag;
+    t[0].phase = r.phase;
+    adc_pack_tone(frame, t, 1, f0_chz, 0, fseq);
+    tx_frame(frame, adc_pack_stamp(frame, ts));
+
+    /* current: harmonics of the same block (same scaling as
+       tone_gz_result) */
+    for (uint8_t i = 0; i < NHARM; i++) {
+        tone_polar(cur[i].re, cur[i].im, GZ_LOG2N - 1, &r);
+        t[i].id    = k_harm[i].h;
+        t[i].mag   = (uint16_t)r.mag;
+        t[i].phase = r.phase;
+    }
+    adc_pack_tone(frame, t, NHARM, f0_chz, 1, fseq);
+    tx_frame(frame, adc_pack_stamp(frame, ts));
+    fseq++;
+    return sq;
+}
+
+/*================= UART2: whole frames or nothing =================*/
+static void tx_frame(const uint8_t *f, uint8_t len)
+{
+    if ((uint16_t)(TX_RING_LEN - (g_tx_head - g_tx_tail)) < len) {
+        g_tx_drops++;
+        return;
+    }
+    for (uint8_t i = 0; i < len; i++)
+        g_tx_ring[(g_tx_head++) & (TX_RING_LEN - 1)] = f[i];
+}
+
+static void tx_pump(void)
+{
+    while (g_tx_tail != g_tx_head && !U2STAbits.UTXBF)
+        U2TXREG = g_tx_ring[(g_tx_tail++) & (TX_RING_LEN - 1)];
+}
@@ -0,0 +1,159 @@
+/**********************************************************************
+ *  dsPIC30F4011  – Multi-rate control scheduler (header-only)
+ *  Toolchain     – XC-DSC 3.21+ (C30 mode)
+ *
+ *  Cascaded loops from one PWM-synchronised interrupt. The ISR runs the
+ *  inner loop every period (one "tick") and then calls ctl_sched_run(),
+ *  which runs the slow tasks that own the current slot:
+ *
+ *     tick   0   1   2   3   4   5   6   7   8   9  …  15   0 …
+ *     inner  ■   ■   ■   ■   ■   ■   ■   ■   ■   ■  …  ■    ■
+ *     div 8  A               .               A              A
+ *     div 8      B               .               B
+ *     div 16         C
+ *
+ *  A task with divider div runs at f_tick/div, in the slots where
+ *  (slot mod div) == phase. div is a power of two ≤ CTL_SLOTS, so the
+ *  slot counter wraps cleanly and every task keeps a fixed period.
+ *
+ *  ctl_sched_place() picks the phases: largest estimated cost first,
+ *  each task goes to the phase whose slots are least loaded so far.
+ *  Tasks that would all fire in slot 0 with phase = 0 end up spread
+ *  over the frame, and the worst-case ISR time stays close to
+ *  inner + the single largest slow task instead of inner + all of them.
+ *
+ *  Per-slot accounting: ctl_sched_end() takes the Tcy spent in the
+ *  whole ISR (inner loop included) and keeps the last and the worst
+ *  value for the slot that just ran, plus an overrun count against the
+ *  tick budget. Compare tcy_max[] with est[] to correct the estimates.
+ *
+ *  Tasks run inside the ISR, at its priority: keep them short and
+ *  bounded; divides, limits, filters and telemetry snapshots are good
+ *  candidates, anything with a loop of unknown length is not.
+ *
+ *  See 040_cascaded_loops.c.
+ **********************************************************************/
+#ifndef CTL_SCHED_H
+#define CTL_SCHED_H
+
+#include <stdint.h>
+
+#ifndef CTL_SLOTS
+#define CTL_SLOTS       16              /* frame length, ticks           */
+#endif
+#if CTL_SLOTS < 2 || CTL_SLOTS > 64 || (CTL_SLOTS & (CTL_SLOTS - 1))
+#error "CTL_SLOTS must be a power of two, 2…64"
+#endif
+
+#define CTL_MAX_TASKS   16              /* one bit each in the slot mask */
+#define CTL_BAD         0xFFFFu         /* ctl_sched_place(): bad table  */
+
+typedef struct {
+    void   (*fn)(void);
+    uint8_t  div;       /* runs every div ticks: 1, 2, 4 … CTL_SLOTS    */
+    uint8_t  phase;     /* slot within div, written by ctl_sched_place  */
+    uint16_t est_tcy;   /* estimated cost, Tcy, for placement           */
+} ctl_task_t;
+
+typedef struct {
+    ctl_task_t *task;
+    uint8_t  n;
+    uint8_t  slot;                      /* slot of the current tick     */
+    uint16_t budget;                    /* Tcy per tick                 */
+    uint16_t mask[CTL_SLOTS];           /* tasks due in each slot       */
+    uint16_t est[CTL_SLOTS];            /* placed estimate, slow tasks  */
+    uint16_t tcy[CTL_SLOTS];            /* last ISR time per slot       */
+    uint16_t tcy_max[CTL_SLOTS];        /* worst ISR time per slot      */
+    uint16_t overruns;                  /* ticks longer than budget     */
+    volatile uint8_t clear;             /* set → stats cleared next tick */
+} ctl_sched_t;
+
+/* Assigns the phases and builds the slot masks. Returns the largest
+   per-slot estimate (slow tasks only), or CTL_BAD for an invalid
+   table. Call before the interrupt is enabled. */
+static inline uint16_t ctl_sched_place(ctl_sched_t *s, ctl_task_t *task,
+                                       uint8_t n, uint16_t budget)
+{
+    uint16_t done = 0, peak = 0;
+
+    if (n > CTL_MAX_TASKS) return CTL_BAD;
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t d = task[i].div;
+        if (d == 0 || d > CTL_SLOTS || (d & (d - 1)) || !task[i].fn)
+            return CTL_BAD;
+    }
+
+    s->task   = task;
+    s->n      = n;
+    s->slot   = 0;
+    s->budget = budget;
+    for (uint8_t k = 0; k < CTL_SLOTS; k++) {
+        s->mask[k] = 0;
+        s->est[k]  = 0;
+        s->tcy[k]  = 0;
+        s->tcy_max[k] = 0;
+    }
+    s->overruns = 0;
+    s->clear    = 0;
+
+    for (uint8_t m = 0; m < n; m++) {
+        /* costliest task not placed yet */
+        uint8_t i = 0xFF;
+        for (uint8_t j = 0; j < n; j++)
+            if (!(done & (1u << j)) && (i == 0xFF || task[j].est_tcy > task[i].est_tcy))
+                i = j;
+        done |= 1u << i;
+
+        /* phase whose slots carry the least load */
+        uint8_t  d = task[i].div, best = 0;
+        uint16_t best_load = 0xFFFF;
+        for (uint8_t p = 0; p < d; p++) {
+            uint16_t load = 0;
+            for (uint8_t k = p; k < CTL_SLOTS; k += d)
+                if (s->est[k] > load) load = s->est[k];
+            if (load < best_load) { best_load = load; best = p; }
+        }
+        task[i].phase = best;
+        for (uint8_t k = best; k < CTL_SLOTS; k += d) {
+            s->mask[k] |= 1u << i;
+            s->est[k]  += task[i].est_tcy;
+            if (s->est[k] > peak) peak = s->est[k];
+        }
+    }
+    return peak;
+}
+
+/* Runs the tasks due in this tick, in table order */
+static inline void ctl_sched_run(ctl_sched_t *s)
+{
+    uint16_t m = s->mask[s->slot];
+    for (uint8_t i = 0; m; i++, m >>= 1)
+        if (m & 1u) s->task[i].fn();
+}
+
+/* Closes the tick: tcy = whole ISR time, Tcy. Advances the slot. */
+static inline void ctl_sched_end(ctl_sched_t *s, uint16_t tcy)
+{
+    uint8_t k = s->slot;
+
+    if (s->clear) {
+        for (uint8_t j = 0; j < CTL_SLOTS; j++) s->tcy_max[j] = 0;
+        s->overruns = 0;
+        s->clear    = 0;
+    }
+    s->tcy[k] = tcy;
+    if (tcy > s->tcy_max[k]) s->tcy_max[k] = tcy;
+    if (tcy > s->budget)     s->overruns++;
+    s->slot = (uint8_t)((k + 1) & (CTL_SLOTS - 1));
+}
+
+/* Worst ISR time over the whole frame */
+static inline uint16_t ctl_sched_worst(const ctl_sched_t *s)
+{
+    uint16_t w = 0;
+    for (uint8_t k = 0; k < CTL_SLOTS; k++)
+        if (s->tcy_max[k] > w) w = s->tcy_max[k];
+    return w;
+}
+
+#endif /* CTL_SCHED_H */
@@ -0,0 +1,232 @@
+/**********************************************************************
+ *  dsPIC30F4011  – In-place complex FFT, Q15, 64…256 points (header-only)
+ *  Toolchain     – XC-DSC 3.21+ (C30 mode)
+ *
+ *  Decimation in time on an array of fft_cplx_t: bit-reversed input,
+ *  natural-order output. Radix-4 passes (3 complex multiplies per 4
+ *  points instead of 4 for two radix-2 stages), plus one twiddle-free
+ *  radix-2 pass first when log2(N) is odd:
+ *
+ *     N = 64    4·4·4          N = 128   2·4·4·4     N = 256   4·4·4·4
+ *
+ *  The radix-4 butterfly is the product of two radix-2 stages, so it
+ *  takes plain bit-reversed input (not base-4 digit reversal) and N
+ *  need not be a power of four.
+ *
+ *  Addressing: fft_rev() is one read of an 8-bit reversal table and a
+ *  shift. An ADC ISR can store sample n straight at
+ *  x[fft_rev(n, log2n)] and call fft_q15_run() without a reorder pass;
+ *  fft_q15() reorders in place first for data in natural order.
+ *
+ *  Twiddles: q15_sin_qtab (q15_math.h) is the quarter wave of a
+ *  512-point circle, so every twiddle of N ≤ 256 is an exact table
+ *  entry (no interpolation, no second table). They are looked up once
+ *  per butterfly column and reused across all groups of a pass.
+ *
+ *  Scaling: block floating point. Before each pass the largest |re|,
+ *  |im| in the array picks the smallest right shift (0…3 radix-4, 0…1
+ *  radix-2) that keeps that pass from overflowing. The shifts add up
+ *  in the returned exponent e:
+ *
+ *     DFT{x}[k] = X[k] · 2^e
+ *
+ *  A full-scale input ends near e = log2(N), like fixed 1/N scaling;
+ *  a small input keeps its bits instead of being shifted into the
+ *  rounding noise. Products and sums are 32-bit with FFT_GUARD extra
+ *  bits (what the 40-bit accumulator keeps on the DSP engine) and are
+ *  rounded once per output; the shift bound keeps every radix-4
+ *  output inside Q15.
+ *
+ *  fft_hann() gives the window from the same table, fft_q15_mag() the
+ *  bin magnitudes. host/fft_bench.c measures the SNR against a double
+ *  DFT and the host time; ../0060_uart/024_adc_uart_spectrum.c streams
+ *  the spectra and measures the Tcy per transform on the target.
+ *
+ *  Needs q15_math.h.
+ **********************************************************************/
+#ifndef FFT_Q15_H
+#define FFT_Q15_H
+
+#include <stdint.h>
+#include "q15_math.h"
+
+#define FFT_LOG2N_MIN   6
+#define FFT_LOG2N_MAX   8
+#define FFT_BAD         0xFFu           /* fft_q15_run(): bad log2n      */
+#define FFT_GUARD       2               /* fraction bits kept in a pass  */
+
+typedef struct {
+    q15_t re, im;
+} fft_cplx_t;
+
+/* Bit reversal of 0…255 */
+static const uint8_t fft_rev8[256] = {
+    0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0,
+    0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8, 0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8,
+    0x04, 0x84, 0x44, 0xC4, 0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
+    0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC, 0x3C, 0xBC, 0x7C, 0xFC,
+    0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2, 0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2,
+    0x0A, 0x8A, 0x4A, 0xCA, 0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+    0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6, 0x36, 0xB6, 0x76, 0xF6,
+    0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE, 0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE,
+    0x01, 0x81, 0x41, 0xC1, 0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+    0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9, 0x39, 0xB9, 0x79, 0xF9,
+    0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5, 0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5,
+    0x0D, 0x8D, 0x4D, 0xCD, 0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+    0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3, 0x33, 0xB3, 0x73, 0xF3,
+    0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB, 0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB,
+    0x07, 0x87, 0x47, 0xC7, 0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
+    0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF,
+};
+
+/* Bit-reversed index of i (0 ≤ i < 2^log2n, log2n ≤ 8) */
+static inline uint16_t fft_rev(uint16_t i, uint8_t log2n)
+{   return (uint16_t)(fft_rev8[i] >> (8 - log2n));   }
+
+/* cos and sin of 2π·i/512, exact table entries */
+static inline void fft_tw(uint16_t i, q15_t *c, q15_t *s)
+{
+    uint16_t r = i & 127u;
+    q15_t    a = q15_sin_qtab[r], b = q15_sin_qtab[128 - r];
+
+    switch ((i >> 7) & 3u) {
+    case 0:  *c =  b; *s =  a; break;
+    case 1:  *c = -a; *s =  b; break;
+    case 2:  *c = -b; *s = -a; break;
+    default: *c =  a; *s = -b; break;
+    }
+}
+
+/* Periodic Hann window, sample i of 2^log2n: (1 − cos(2π·i/N)) / 2 */
+static inline q15_t fft_hann(uint16_t i, uint8_t log2n)
+{
+    q15_t c, s;
+    fft_tw((uint16_t)(i << (9 - log2n)), &c, &s);
+    return (q15_t)((32768L - c) >> 1);
+}
+
+/* Largest |re| or |im| in the array */
+static inline uint16_t fft_peak(const fft_cplx_t *x, uint16_t n)
+{
+    uint16_t m = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t a = (uint16_t)x[i].re, b = (uint16_t)x[i].im;
+        if (x[i].re < 0) a = (uint16_t)(0u - a);
+        if (x[i].im < 0) b = (uint16_t)(0u - b);
+        if (a > m) m = a;
+        if (b > m) m = b;
+    }
+    return m;
+}
+
+/* p · (c − j·s) in Q15 with FFT_GUARD extra fraction bits, truncated */
+static inline void fft_cmul(const fft_cplx_t *p, q15_t c, q15_t s,
+                            int32_t *re, int32_t *im)
+{
+    *re = ((int32_t)p->re * c + (int32_t)p->im * s) >> (15 - FFT_GUARD);
+    *im = ((int32_t)p->im * c - (int32_t)p->re * s) >> (15 - FFT_GUARD);
+}
+
+/* In-place permutation to bit-reversed order */
+static inline void fft_bitrev(fft_cplx_t *x, uint8_t log2n)
+{
+    uint16_t n = 1u << log2n;
+    for (uint16_t i = 1; i < n - 1; i++) {
+        uint16_t j = fft_rev(i, log2n);
+        if (j > i) { fft_cplx_t t = x[i]; x[i] = x[j]; x[j] = t; }
+    }
+}
+
+/* Transform of bit-reversed x, result in natural order.
+   Returns the block exponent e (DFT = x · 2^e) or FFT_BAD. */
+static inline uint8_t fft_q15_run(fft_cplx_t *x, uint8_t log2n)
+{
+    uint16_t n, h = 1, m;
+    uint8_t  e = 0, s;
+    int32_t  rnd;
+
+    if (log2n < FFT_LOG2N_MIN || log2n > FFT_LOG2N_MAX) return FFT_BAD;
+    n = 1u << log2n;
+    m = fft_peak(x, n);
+
+    if (log2n & 1u) {
+        /* radix-2, twiddle 1: |out| ≤ 2·m; only 32767 − (−32768)
+           can round up past Q15 here, hence the saturation */
+        s   = (m > 16383u);
+        rnd = s;
+        for (uint16_t i = 0; i < n; i += 2) {
+            int32_t ar = x[i].re, ai = x[i].im;
+            int32_t br = x[i + 1].re, bi = x[i + 1].im;
+            x[i].re     = q15_sat((ar + br + rnd) >> s);
+            x[i].im     = q15_sat((ai + bi + rnd) >> s);
+            x[i + 1].re = q15_sat((ar - br + rnd) >> s);
+            x[i + 1].im = q15_sat((ai - bi + rnd) >> s);
+        }
+        e += s;
+        h  = 2;
+        m  = fft_peak(x, n);
+    }
+
+    for (; h < n; h <<= 2) {
+        /* radix-4 over spans h and 2h: |out| ≤ (1 + 3·√2)·m + 3 */
+        s   = (m <= 6240u) ? 0 : (m <= 12480u) ? 1 : (m <= 24960u) ? 2 : 3;
+        rnd = 1L << (s + FFT_GUARD - 1);
+        uint16_t step = 128u / h;               /* W_4h in 512ths of a turn */
+
+        for (uint16_t j = 0; j < h; j++) {
+            q15_t c1, s1, c2, s2, c3, s3;
+            fft_tw((uint16_t)(j * step),      &c1, &s1);
+            fft_tw((uint16_t)(2 * j * step),  &c2, &s2);
+            fft_tw((uint16_t)(3 * j * step),  &c3, &s3);
+
+            for (uint16_t g = j; g < n; g += 4 * h) {
+                fft_cplx_t *p0 = x + g, *p1 = p0 + h, *p2 = p1 + h, *p3 = p2 + h;
+                int32_t br, bi, cr, ci, dr, di;
+
+                fft_cmul(p1, c2, s2, &br, &bi);     /* b·W^2j */
+                fft_cmul(p2, c1, s1, &cr, &ci);     /* c·W^j  */
+                fft_cmul(p3, c3, s3, &dr, &di);     /* d·W^3j */
+
+                int32_t ar = (int32_t)p0->re << FFT_GUARD;
+                int32_t ai = (int32_t)p0->im << FFT_GUARD;
+                int32_t t0r = ar + br, t0i = ai + bi;
+                int32_t t1r = ar - br, t1i = ai - bi;
+                int32_t t2r = cr + dr,     t2i = ci + di;
+                int32_t t3r = cr - dr,     t3i = ci - di;
+
+                p0->re = (q15_t)((t0r + t2r + rnd) >> (s + FFT_GUARD));
+                p0->im = (q15_t)((t0i + t2i + rnd) >> (s + FFT_GUARD));
+                p2->re = (q15_t)((t0r - t2r + rnd) >> (s + FFT_GUARD));
+                p2->im = (q15_t)((t0i - t2i + rnd) >> (s + FFT_GUARD));
+                p1->re = (q15_t)((t1r + t3i + rnd) >> (s + FFT_GUARD));  /* t1 − j·t3 */
+                p1->im = (q15_t)((t1i - t3r + rnd) >> (s + FFT_GUARD));
+                p3->re = (q15_t)((t1r - t3i + rnd) >> (s + FFT_GUARD));  /* t1 + j·t3 */
+                p3->im = (q15_t)((t1i + t3r + rnd) >> (s + FFT_GUARD));
+            }
+        }
+        e += s;
+        if ((h << 2) < n) m = fft_peak(x, n);
+    }
+    return e;
+}
+
+/* Transform of x in natural order */
+static inline uint8_t fft_q15(fft_cplx_t *x, uint8_t log2n)
+{
+    if (log2n < FFT_LOG2N_MIN || log2n > FFT_LOG2N_MAX) return FFT_BAD;
+    fft_bitrev(x, log2n);
+    return fft_q15_run(x, log2n);
+}
+
+/* |X[k]| for k = 0…nbins−1, floor, same exponent as the transform
+   (up to √2 · 32768, so uint16) */
+static inline void fft_q15_mag(const fft_cplx_t *x, uint16_t *mag, uint16_t nbins)
+{
+    for (uint16_t k = 0; k < nbins; k++) {
+        uint32_t p = (uint32_t)((int32_t)x[k].re * x[k].re)
+                   + (uint32_t)((int32_t)x[k].im * x[k].im);
+        mag[k] = q15_isqrt32(p);
+    }
+}
+
+#endif /* FFT_Q15_H */
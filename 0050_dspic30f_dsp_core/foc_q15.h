@@ -0,0 +1,178 @@
+/**********************************************************************
+ *  dsPIC30F4011  – Field‑oriented control pipeline in Q15 (header‑only)
+ *  Toolchain     – XC‑DSC 3.21+ (C30 mode)
+ *
+ *  One call per PWM period, from the PWM‑synchronised ADC interrupt:
+ *
+ *     ia, ib ─► Clarke ─► Park ─► PI(d), PI(q) ─► inv. Park ─► SVM ─► PDC1..3
+ *                          ▲                        ▲
+ *                          └──── sin/cos(θ) ────────┘
+ *
+ *  Per‑unit conventions (all Q15):
+ *    currents  – 1.0 = full ADC scale of the current sense
+ *    voltages  – 1.0 = Vdc; the linear SVM range is |v| ≤ 1/√3 (0.577)
+ *    angle     – q15_ang, full electrical turn = 65536
+ *
+ *  SVM is done with min/max zero‑sequence injection, which yields the
+ *  same duties as conventional sector‑based SVPWM without a sector table.
+ *
+ *  Cycle budget at FCY = 29.48 MHz: 1474 Tcy per period at 20 kHz,
+ *  2948 Tcy at 10 kHz. foc_step() has no loops except the sqrt in the
+ *  voltage limiter; time it on target with the TMR1 stamps in
+ *  030_foc_pipeline.c (g_foc_cycles_max).
+ *
+ *  Needs q15_math.h.
+ **********************************************************************/
+#ifndef FOC_Q15_H
+#define FOC_Q15_H
+
+#include <stdint.h>
+#include "q15_math.h"
+
+#define FOC_INV_SQRT3   ((q15_t)18919)      /* 1/√3  */
+#define FOC_SQRT3_2     ((q15_t)28378)      /* √3/2  */
+#define FOC_VMAX_LINEAR ((q15_t)18918)      /* 1/√3 − 1 LSB, SVM hexagon circle */
+
+/*====================== PI controller ============================*/
+typedef struct {
+    q15_t kp;           /* proportional gain, Q15                     */
+    q15_t ki;           /* integral gain per sample, Q15              */
+    q15_t out_max;      /* output limits, Q15                         */
+    q15_t out_min;
+    q31_t integ;        /* integrator state, Q30                      */
+} foc_pi_t;
+
+static inline q15_t foc_pi_run(foc_pi_t *pi, q15_t err)
+{
+    q31_t imax = (q31_t)pi->out_max << Q15_SHIFT;
+    q31_t imin = (q31_t)pi->out_min << Q15_SHIFT;
+
+    pi->integ += (q31_t)pi->ki * err;               /* MAC, Q30          */
+    if (pi->integ > imax) pi->integ = imax;         /* clamp to the real */
+    if (pi->integ < imin) pi->integ = imin;         /* output limits     */
+
+    q31_t out = ((q31_t)pi->kp * err + pi->integ) >> Q15_SHIFT;
+    if (out > pi->out_max) out = pi->out_max;
+    if (out < pi->out_min) out = pi->out_min;
+    return (q15_t)out;
+}
+
+static inline void foc_pi_reset(foc_pi_t *pi)
+{   pi->integ = 0;   }
+
+/*====================== Transforms ===============================*/
+/* Clarke (two sensors, ia + ib + ic = 0):
+   α = ia,  β = (ia + 2·ib)/√3 */
+static inline void foc_clarke(q15_t ia, q15_t ib, q15_t *alpha, q15_t *beta)
+{
+    *alpha = ia;
+    *beta  = q15_sat(((q31_t)FOC_INV_SQRT3 * ((q31_t)ia + 2L * ib)) >> Q15_SHIFT);
+}
+
+/* Park: d =  α·cos + β·sin,  q = −α·sin + β·cos */
+static inline void foc_park(q15_t alpha, q15_t beta, q15_t s, q15_t c,
+                            q15_t *d, q15_t *q)
+{
+    *d = q15_sat(((q31_t)alpha * c + (q31_t)beta * s) >> Q15_SHIFT);
+    *q = q15_sat(((q31_t)beta * c - (q31_t)alpha * s) >> Q15_SHIFT);
+}
+
+/* Inverse Park: α = d·cos − q·sin,  β = d·sin + q·cos */
+static inline void foc_ipark(q15_t d, q15_t q, q15_t s, q15_t c,
+                             q15_t *alpha, q15_t *beta)
+{
+    *alpha = q15_sat(((q31_t)d * c - (q31_t)q * s) >> Q15_SHIFT);
+    *beta  = q15_sat(((q31_t)d * s + (q31_t)q * c) >> Q15_SHIFT);
+}
+
+/* Circular voltage limit, d axis has priority:
+   |vd| ≤ vmax,  |vq| ≤ sqrt(vmax² − vd²) */
+static inline void foc_vlimit(q15_t *vd, q15_t *vq, q15_t vmax)
+{
+    if (*vd >  vmax) *vd =  vmax;
+    if (*vd < -vmax) *vd = -vmax;
+
+    uint32_t room = (uint32_t)((q31_t)vmax * vmax) - (uint32_t)((q31_t)*vd * *vd);
+    q15_t    vq_max = q15_sqrt_q30(room);
+    if (*vq >  vq_max) *vq =  vq_max;
+    if (*vq < -vq_max) *vq = -vq_max;
+}
+
+/*====================== Space‑vector modulation ==================*/
+/* α/β voltage (base Vdc) → three duty registers.
+   half = PTPER + 1: in centre‑aligned mode PDCx spans 0 … 2·half. */
+static inline void foc_svm(q15_t valpha, q15_t vbeta, uint16_t half,
+                           uint16_t pdc[3])
+{
+    q31_t bh = ((q31_t)FOC_SQRT3_2 * vbeta) >> Q15_SHIFT;
+    q31_t v[3];
+    v[0] = valpha;
+    v[1] = -(valpha >> 1) + bh;
+    v[2] = -(valpha >> 1) - bh;
+
+    /* zero‑sequence injection: centre the three phases in the carrier */
+    q31_t vmax = v[0], vmin = v[0];
+    for (uint16_t k = 1; k < 3; k++) {
+        if (v[k] > vmax) vmax = v[k];
+        if (v[k] < vmin) vmin = v[k];
+    }
+    q31_t voff = (vmax + vmin) >> 1;
+
+    for (uint16_t k = 0; k < 3; k++) {
+        /* duty = 0.5 + v   (v base Vdc) → counts = half + v·2·half */
+        q31_t cnt = (q31_t)half + ((((v[k] - voff) * (q31_t)half)) >> (Q15_SHIFT - 1));
+        if (cnt < 0)                  cnt = 0;
+        if (cnt > 2L * (q31_t)half)   cnt = 2L * (q31_t)half;
+        pdc[k] = (uint16_t)cnt;
+    }
+}
+
+/*====================== Complete pipeline ========================*/
+typedef struct {
+    /* inputs */
+    q15_t    id_ref, iq_ref;
+    q15_ang  theta;
+    /* controllers */
+    foc_pi_t pi_d, pi_q;
+    /* observables (last period) */
+    q15_t    i_alpha, i_beta, id, iq;
+    q15_t    vd, vq, v_alpha, v_beta;
+    uint16_t pdc[3];
+    /* PWM scaling */
+    uint16_t half;          /* PTPER + 1 */
+} foc_t;
+
+static inline void foc_init(foc_t *f, uint16_t ptper, q15_t kp, q15_t ki)
+{
+    f->id_ref = f->iq_ref = 0;
+    f->theta  = 0;
+    f->pi_d.kp = f->pi_q.kp = kp;
+    f->pi_d.ki = f->pi_q.ki = ki;
+    f->pi_d.out_max = f->pi_q.out_max =  FOC_VMAX_LINEAR;
+    f->pi_d.out_min = f->pi_q.out_min = -FOC_VMAX_LINEAR;
+    foc_pi_reset(&f->pi_d);
+    foc_pi_reset(&f->pi_q);
+    f->half = ptper + 1;
+    f->pdc[0] = f->pdc[1] = f->pdc[2] = f->half;    /* 50 % = zero volts */
+}
+
+/* One control period: currents in, duties out (f->pdc). */
+static inline void foc_step(foc_t *f, q15_t ia, q15_t ib)
+{
+    q15_t s = q15_sin(f->theta);
+    q15_t c = q15_cos(f->theta);
+
+    foc_clarke(ia, ib, &f->i_alpha, &f->i_beta);
+    foc_park(f->i_alpha, f->i_beta, s, c, &f->id, &f->iq);
+
+    q15_t vd = foc_pi_run(&f->pi_d, q15_sat((q31_t)f->id_ref - f->id));
+    q15_t vq = foc_pi_run(&f->pi_q, q15_sat((q31_t)f->iq_ref - f->iq));
+    foc_vlimit(&vd, &vq, FOC_VMAX_LINEAR);
+    f->vd = vd;
+    f->vq = vq;
+
+    foc_ipark(vd, vq, s, c, &f->v_alpha, &f->v_beta);
+    foc_svm(f->v_alpha, f->v_beta, f->half, f->pdc);
+}
+
+#endif /* FOC_Q15_H */
@@ -0,0 +1,290 @@
+/**********************************************************************
+ *  fft_bench – fft_q15.h against double precision on the PC
+ *  cc -O2 -I.. -o fft_bench fft_bench.c -lm
+ *
+ *  Input as on the target (../../0060_uart/024_adc_uart_spectrum.c):
+ *  10-bit signed fractional ADC in Q15 (LSB = 64), Hann window from
+ *  fft_hann(), samples stored bit-reversed with fft_rev(). Each case
+ *  prints its figures and PASS/FAIL; the exit code is the number of
+ *  failures.
+ *
+ *    1 accuracy – N = 64, 128, 256; two tones at 0, −20, −40 dBFS and
+ *                 full-scale noise. SNR of the transform against a
+ *                 double DFT of the same Q15 samples, and the loss it
+ *                 adds to the ADC's own SNR (both against the DFT of
+ *                 the unquantised signal)
+ *    2 range    – full-scale complex inputs (±32768 DC, Nyquist, tones,
+ *                 random and mixed squares) that hit every scaling
+ *                 bound: no wrap-around, error in output LSBs
+ *    3 bitrev   – fft_rev() against the 16-step reverse_bits_16() of
+ *                 021_adc_uart_sent.c, every index, and the time of each
+ *    4 cost     – host µs per transform, complex multiplies against
+ *                 a radix-2 FFT of the same size (target Tcy is
+ *                 measured there as g_fft_tcy); fft_q15() against
+ *                 fft_q15_run() on reordered input
+ **********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "fft_q15.h"
+
+#define NMAX    (1 << FFT_LOG2N_MAX)
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %-52s %s\n", what, ok ? "PASS" : "FAIL");
+    if (!ok) g_fail++;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double db(double p)             { return 10.0 * log10(p); }
+
+/* 10-bit signed fractional ADC → Q15 */
+static q15_t adc(double v)
+{
+    long q = lround(v * 512.0);
+    if (q >  511) q =  511;
+    if (q < -512) q = -512;
+    return (q15_t)(q * 64);
+}
+
+/* Plain DFT in double, natural order */
+static void dft(const double *xr, int n, double *yr, double *yi)
+{
+    for (int k = 0; k < n; k++) {
+        double sr = 0, si = 0;
+        for (int i = 0; i < n; i++) {
+            double a = -2.0 * M_PI * (double)((long)k * i % n) / n;
+            sr += xr[i] * cos(a);
+            si += xr[i] * sin(a);
+        }
+        yr[k] = sr;
+        yi[k] = si;
+    }
+}
+
+/* ——————————————————— 1: accuracy ——————————————————— */
+typedef struct { const char *name; double amp; int noise; } sig_t;
+
+static void case_accuracy(void)
+{
+    static const sig_t k_sig[] = {
+        { "two tones    0 dBFS", 1.00, 0 },
+        { "two tones  -20 dBFS", 0.10, 0 },
+        { "two tones  -40 dBFS", 0.01, 0 },
+        { "noise        0 dBFS", 1.00, 1 },
+    };
+    enum { TRIALS = 20 };
+    static fft_cplx_t x[NMAX];
+    static double ideal[NMAX], quant[NMAX];
+    static double ir[NMAX], ii[NMAX], qr[NMAX], qi[NMAX], fr[NMAX], fi[NMAX];
+    double worst_margin = 1e9, worst_loss = 0;
+
+    printf("1 accuracy (SNR over all bins, mean of %d blocks)\n", TRIALS);
+    printf("    %-20s %4s  %3s  %9s  %9s  %7s\n", "signal", "N", "e", "fft/dbl", "adc", "loss");
+    for (uint8_t l2 = FFT_LOG2N_MIN; l2 <= FFT_LOG2N_MAX; l2++) {
+        int n = 1 << l2;
+        for (unsigned s = 0; s < sizeof k_sig / sizeof k_sig[0]; s++) {
+            double pf = 0, ef = 0, pa = 0, ea = 0, et = 0;
+            int emax = 0;
+            for (int t = 0; t < TRIALS; t++) {
+                /* two off-grid tones (0.9 and 0.1 of the amplitude) or noise */
+                double f1 = (5.0 + 40.0 * rand() / RAND_MAX) / n;
+                double f2 = (0.25 + 0.2 * rand() / RAND_MAX);
+                double p1 = 2 * M_PI * rand() / RAND_MAX, p2 = 2 * M_PI * rand() / RAND_MAX;
+                for (int i = 0; i < n; i++) {
+                    double v = k_sig[s].noise
+                             ? k_sig[s].amp * (2.0 * rand() / RAND_MAX - 1.0)
+                             : k_sig[s].amp * (0.9 * sin(2 * M_PI * f1 * i + p1)
+                                             + 0.1 * sin(2 * M_PI * f2 * i + p2));
+                    if (v >  0.998) v =  0.998;
+                    if (v < -0.998) v = -0.998;
+                    q15_t w = fft_hann((uint16_t)i, l2);
+                    q15_t q = q15_mul(adc(v), w);
+                    ideal[i] = v * 32768.0 * w / 32768.0;
+                    quant[i] = q;
+                    uint16_t r = fft_rev((uint16_t)i, l2);
+                    x[r].re = q;
+                    x[r].im = 0;
+                }
+                uint8_t e = fft_q15_run(x, l2);
+                if (e > emax) emax = e;
+                for (int k = 0; k < n; k++) {
+                    fr[k] = ldexp(x[k].re, e);
+                    fi[k] = ldexp(x[k].im, e);
+                }
+                dft(ideal, n, ir, ii);
+                dft(quant, n, qr, qi);
+                for (int k = 0; k < n; k++) {
+                    double p = ir[k] * ir[k] + ii[k] * ii[k];
+                    pf += qr[k] * qr[k] + qi[k] * qi[k];
+                    ef += (fr[k] - qr[k]) * (fr[k] - qr[k]) + (fi[k] - qi[k]) * (fi[k] - qi[k]);
+                    pa += p;
+                    ea += (qr[k] - ir[k]) * (qr[k] - ir[k]) + (qi[k] - ii[k]) * (qi[k] - ii[k]);
+                    et += (fr[k] - ir[k]) * (fr[k] - ir[k]) + (fi[k] - ii[k]) * (fi[k] - ii[k]);
+                }
+            }
+            double s_fft = db(pf / ef), s_adc = db(pa / ea), loss = s_adc - db(pa / et);
+            printf("    %-20s %4d  %3d  %6.1f dB  %6.1f dB  %4.2f dB\n",
+                   k_sig[s].name, n, emax, s_fft, s_adc, loss);
+            if (s_fft - s_adc < worst_margin) worst_margin = s_fft - s_adc;
+            if (loss > worst_loss) worst_loss = loss;
+        }
+    }
+    char line[80];
+    snprintf(line, sizeof line, "transform noise ≥ 6 dB under ADC (worst %.1f dB)", worst_margin);
+    check(line, worst_margin >= 6.0);
+    snprintf(line, sizeof line, "loss on 10-bit input ≤ 1 dB (worst %.2f dB)", worst_loss);
+    check(line, worst_loss <= 1.0);
+}
+
+/* ——————————————————— 2: range ——————————————————— */
+static void case_range(void)
+{
+    static fft_cplx_t x[NMAX];
+    static double xr[NMAX], xi[NMAX];
+    double worst = 0;
+
+    printf("2 range (max |error| in LSB of the scaled output)\n");
+    for (uint8_t l2 = FFT_LOG2N_MIN; l2 <= FFT_LOG2N_MAX; l2++) {
+        int n = 1 << l2;
+        double wn = 0;
+        for (int c = 0; c < 6; c++) {
+            for (int i = 0; i < n; i++) {
+                double a = 2 * M_PI * (c == 2 ? 1 : n / 2 - 3) * i / n;
+                switch (c) {
+                case 0:  xr[i] = -32768; xi[i] = -32768;                   break;
+                case 1:  xr[i] = (i & 1) ? -32768 : 32767; xi[i] = -xr[i]; break;
+                case 2:
+                case 3:  xr[i] = round(32767 * cos(a)); xi[i] = round(32767 * sin(a)); break;
+                case 4:  xr[i] = (rand() & 1) ? 32767 : -32768;
+                         xi[i] = (rand() & 1) ? 32767 : -32768;            break;
+                default: xr[i] = ((i * 37) % n < n / 2) ? 32767 : -32768;
+                         xi[i] = ((i * 11) % n < n / 2) ? -32768 : 32767;  break;
+                }
+                uint16_t r = fft_rev((uint16_t)i, l2);
+                x[r].re = (q15_t)xr[i];
+                x[r].im = (q15_t)xi[i];
+            }
+            uint8_t e = fft_q15_run(x, l2);
+            for (int k = 0; k < n; k++) {
+                double sr = 0, si = 0;
+                for (int i = 0; i < n; i++) {
+                    double a = -2.0 * M_PI * (double)((long)k * i % n) / n;
+                    sr += xr[i] * cos(a) - xi[i] * sin(a);
+                    si += xr[i] * sin(a) + xi[i] * cos(a);
+                }
+                double d = hypot(x[k].re - ldexp(sr, -e), x[k].im - ldexp(si, -e));
+                if (d > wn) wn = d;
+            }
+        }
+        printf("    N = %3d  %.2f LSB\n", n, wn);
+        if (wn > worst) worst = wn;
+    }
+    check("no wrap-around, error ≤ 2 LSB", worst <= 2.0);
+}
+
+/* ——————————————————— 3: bit reversal ——————————————————— */
+/* as in 021_adc_uart_sent.c */
+static inline uint16_t reverse_bits_16(uint16_t num)
+{
+    uint16_t rev = 0;
+    for (uint8_t i = 0; i < 16; ++i) {
+        rev <<= 1;
+        rev |= (num & 1);
+        num >>= 1;
+    }
+    return rev;
+}
+
+static void case_bitrev(void)
+{
+    enum { REPS = 200000 };
+    int bad = 0;
+    volatile uint16_t sink = 0;
+
+    printf("3 bitrev\n");
+    for (uint8_t l2 = FFT_LOG2N_MIN; l2 <= FFT_LOG2N_MAX; l2++)
+        for (uint16_t i = 0; i < (1u << l2); i++)
+            if (fft_rev(i, l2) != (reverse_bits_16(i) >> (16 - l2))) bad++;
+
+    double t0 = now_s();
+    for (int r = 0; r < REPS; r++)
+        for (uint16_t i = 0; i < NMAX; i++) sink += reverse_bits_16((uint16_t)(i ^ r)) >> 8;
+    double t1 = now_s();
+    for (int r = 0; r < REPS; r++)
+        for (uint16_t i = 0; i < NMAX; i++) sink += fft_rev((uint16_t)((i ^ r) & 0xFF), 8);
+    double t2 = now_s();
+    (void)sink;
+
+    printf("    loop: %.2f ns per index, table: %.2f ns per index\n",
+           (t1 - t0) / REPS / NMAX * 1e9, (t2 - t1) / REPS / NMAX * 1e9);
+    check("fft_rev() == reverse_bits_16() >> (16 − log2n)", bad == 0);
+}
+
+/* ——————————————————— 4: cost ——————————————————— */
+static void case_cost(void)
+{
+    enum { REPS = 20000 };
+    static fft_cplx_t x[NMAX], src[NMAX];
+    volatile int sink = 0;
+
+    printf("4 cost (host; target Tcy from g_fft_tcy)\n");
+    for (int i = 0; i < NMAX; i++) {
+        src[i].re = (q15_t)(rand() - RAND_MAX / 2);
+        src[i].im = 0;
+    }
+    for (uint8_t l2 = FFT_LOG2N_MIN; l2 <= FFT_LOG2N_MAX; l2++) {
+        int n = 1 << l2, r4 = l2 / 2, r2 = l2 & 1;
+        double t0 = now_s();
+        for (int r = 0; r < REPS; r++) {
+            for (int i = 0; i < n; i++) x[i] = src[i];
+            sink += fft_q15_run(x, l2);
+        }
+        double t1 = now_s();
+        for (int r = 0; r < REPS; r++) {
+            for (int i = 0; i < n; i++) x[i] = src[i];
+        }
+        double t2 = now_s();
+        double us = ((t1 - t0) - (t2 - t1)) / REPS * 1e6;
+        /* radix-4: 3 per butterfly of 4, n/4 butterflies per pass */
+        int cm4 = 3 * (n / 4) * r4, cm2 = (n / 2) * l2;
+        printf("    N = %3d  %2d×4%s  %6.2f µs  %4d cmul (radix-2: %4d)\n",
+               n, r4, r2 ? " + 2" : "    ", us, cm4, cm2);
+    }
+    (void)sink;
+
+    /* natural-order entry point = reorder + run; sizes outside 64…256 refused */
+    static fft_cplx_t y[NMAX];
+    int same = 1;
+    for (uint8_t l2 = FFT_LOG2N_MIN; l2 <= FFT_LOG2N_MAX; l2++) {
+        int n = 1 << l2;
+        for (int i = 0; i < n; i++) { x[i] = src[i]; y[fft_rev((uint16_t)i, l2)] = src[i]; }
+        same &= fft_q15(x, l2) == fft_q15_run(y, l2);
+        for (int i = 0; i < n; i++) same &= x[i].re == y[i].re && x[i].im == y[i].im;
+    }
+    check("fft_q15() == fft_rev() order + fft_q15_run()", same);
+    check("log2n 5 and 9 return FFT_BAD",
+          fft_q15(x, 5) == FFT_BAD && fft_q15_run(x, 9) == FFT_BAD);
+}
+
+int main(void)
+{
+    srand(1);
+    case_accuracy();
+    case_range();
+    case_bitrev();
+    case_cost();
+    printf("%d failure(s)\n", g_fail);
+    return g_fail;
+}
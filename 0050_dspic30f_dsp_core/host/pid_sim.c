@@ -0,0 +1,320 @@
+/**********************************************************************
+ *  pid_sim – pid_q15.h against plant models on the PC
+ *  cc -O2 -I.. -o pid_sim pid_sim.c -lm
+ *
+ *  Every case runs the real header at Ts = 50 µs (20 kHz) on a plant
+ *  integrated in double precision, with a 10-bit ADC on the
+ *  measurement. Each case prints its figures and PASS/FAIL; the exit
+ *  code is the number of failures.
+ *
+ *    1 windup      – output limited to [0, 0.6]: the clamp-to-±1.0 PI
+ *                    of 010_initial_dsp.c against back-calculation
+ *    2 pid         – 2nd-order plant, PID with filtered D, setpoint
+ *                    weighting and feedforward; actuator noise with
+ *                    and without the derivative filter
+ *    3 gain step   – Kp doubled on a ramp: pid_set_gains() against
+ *                    overwriting the gains
+ *    4 manual→auto – pid_track() against a cold switch-over
+ *    5 reference   – fixed point against the same law in double
+ *                    precision on a random sequence
+ **********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#define PID_GAIN_SHIFT  7               /* gains up to 128: unfiltered D fits */
+#include "pid_q15.h"
+
+#define TS          50e-6
+#define Q(x)        ((x) / 32768.0)
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %-48s %s\n", what, ok ? "PASS" : "FAIL");
+    if (!ok) g_fail++;
+}
+
+/* ——————————————————— design helper ——————————————————— */
+static pid_gains_t gains(double kp, double ti, double td, double n, double tt,
+                         double b, double c)
+{
+    pid_gains_t g;
+    double tf = (td > 0 && n > 0) ? td / n : 0;          /* n = 0: no filter */
+    if (kp >= (1 << PID_GAIN_SHIFT) || (td > 0 && kp * td / (tf + TS) >= (1 << PID_GAIN_SHIFT))) {
+        fprintf(stderr, "gain out of range for PID_GAIN_SHIFT %d\n", PID_GAIN_SHIFT);
+        exit(99);
+    }
+    g.kp = PID_GAIN(kp);
+    g.ki = ti > 0 ? Q15(kp * TS / ti) : 0;
+    g.kd = td > 0 ? PID_GAIN(kp * td / (tf + TS)) : 0;
+    g.ad = td > 0 ? Q15(tf / (tf + TS)) : 0;
+    g.kt = tt > 0 ? Q15(TS / tt) : 0;
+    g.b  = (int16_t)lround(b * PID_W_ONE);
+    g.c  = (int16_t)lround(c * PID_W_ONE);
+    return g;
+}
+
+/* ——————————————————— plants ——————————————————— */
+typedef struct { double x1, x2, k, t1, t2; } plant_t;   /* k/((t1 s+1)(t2 s+1)) */
+
+static double plant_step(plant_t *p, double u)
+{
+    const int sub = 10;                       /* Euler sub-steps */
+    double h = TS / sub;
+    for (int i = 0; i < sub; i++) {
+        p->x1 += (p->k * u - p->x1) / p->t1 * h;
+        if (p->t2 > 0) p->x2 += (p->x1 - p->x2) / p->t2 * h;
+        else           p->x2  = p->x1;
+    }
+    return p->x2;
+}
+
+/* 10-bit ADC, Q15 out, optional ±noise LSB */
+static q15_t adc(double y, int noise)
+{
+    long q = lround(y * 512.0);
+    if (noise) q += (rand() % (2 * noise + 1)) - noise;
+    if (q >  511) q =  511;
+    if (q < -512) q = -512;
+    return (q15_t)(q * 64);
+}
+
+typedef struct { double overshoot, settle, iae, du_rms; } resp_t;
+
+static void metrics(resp_t *m, const double *y, const double *u, int n, double r, int t0)
+{
+    double peak = -1e9, iae = 0, du2 = 0;
+    int last_out = t0;
+    for (int k = t0; k < n; k++) {
+        if (y[k] > peak) peak = y[k];
+        iae += fabs(r - y[k]) * TS;
+        if (fabs(y[k] - r) > 0.02 * fabs(r)) last_out = k;
+        if (k > t0) du2 += (u[k] - u[k - 1]) * (u[k] - u[k - 1]);
+    }
+    m->overshoot = r != 0 ? 100.0 * (peak - r) / r : 0;
+    if (m->overshoot < 0) m->overshoot = 0;
+    m->settle = (last_out - t0) * TS * 1e3;
+    m->iae    = iae * 1e3;
+    m->du_rms = sqrt(du2 / (n - t0));
+}
+
+/* ——————————————————— 1: windup ——————————————————— */
+/* 010_initial_dsp.c before this module: integrator clamped to ±1.0
+   whatever the real output limit is */
+typedef struct { q15_t kp, ki; q31_t integ; q15_t out_min, out_max; } legacy_pi_t;
+
+static q15_t legacy_pi(legacy_pi_t *p, q15_t r, q15_t y)
+{
+    q15_t e = q15_sat((q31_t)r - y);
+    p->integ += (q31_t)e * p->ki;
+    if (p->integ >  (1L << 30)) p->integ =  (1L << 30);
+    if (p->integ < -(1L << 30)) p->integ = -(1L << 30);
+    q31_t acc = (((q31_t)e * p->kp) << 1) + p->integ;
+    q31_t v = acc >> Q15_SHIFT;
+    return v > p->out_max ? p->out_max : v < p->out_min ? p->out_min : (q15_t)v;
+}
+
+static void case_windup(void)
+{
+    enum { N = 4000 };                 /* 200 ms */
+    static double y0[N], u0[N], y1[N], u1[N];
+    const double r = 0.55;
+    plant_t pa = { 0, 0, 1.0, 20e-3, 0 }, pb = pa;
+
+    /* Kp = 4, Ti = τ: without limits a clean 5 ms first-order response.
+       The legacy law doubles kp and cannot go past 1.0: Kp = 2 there. */
+    legacy_pi_t lp = { Q15_MAX, 0, 0, 0, Q15(0.6) };
+    lp.ki = Q15(4.0 * TS / 20e-3);
+    pid_q15_t pid;
+    pid_gains_t g = gains(4.0, 20e-3, 0, 0, 20e-3, 1, 0);
+    pid_init(&pid, &g, 0, Q15(0.6));
+
+    double ya = 0, yb = 0;
+    for (int k = 0; k < N; k++) {
+        q15_t rq = Q15(r);
+        u0[k] = Q(legacy_pi(&lp, rq, adc(ya, 0)));
+        u1[k] = Q(pid_run(&pid, rq, adc(yb, 0), 0));
+        y0[k] = ya = plant_step(&pa, u0[k]);
+        y1[k] = yb = plant_step(&pb, u1[k]);
+    }
+    resp_t m0, m1;
+    metrics(&m0, y0, u0, N, r, 0);
+    metrics(&m1, y1, u1, N, r, 0);
+    printf("1 windup: 1st order 20 ms, Kp 4 (legacy 2), Ti 20 ms, u in [0, 0.6], r = %.2f\n", r);
+    printf("    legacy PI  overshoot %5.1f %%  settle %6.2f ms  IAE %.3f\n", m0.overshoot, m0.settle, m0.iae);
+    printf("    pid_q15    overshoot %5.1f %%  settle %6.2f ms  IAE %.3f\n", m1.overshoot, m1.settle, m1.iae);
+    check("back-calculation overshoot < 1 %", m1.overshoot < 1.0);
+    check("back-calculation settles faster than legacy", m1.settle < m0.settle);
+}
+
+/* ——————————————————— 2: PID on a 2nd-order plant ——————————————— */
+#define PID_STEP    0.1
+
+static resp_t run_pid(pid_gains_t g, int use_ff, int noise, double *u_peak)
+{
+    enum { N = 2000 };                 /* 100 ms, step at 10 ms */
+    static double y[N], u[N];
+    plant_t pl = { 0, 0, 1.0, 10e-3, 2e-3 };
+    pid_q15_t p;
+    pid_init(&p, &g, Q15(-1.0), Q15_MAX);
+    srand(7);
+
+    double yy = 0;
+    *u_peak = 0;
+    for (int k = 0; k < N; k++) {
+        q15_t rq = Q15(k < 200 ? 0 : PID_STEP);
+        u[k] = Q(pid_run(&p, rq, adc(yy, noise), use_ff ? rq : 0));   /* DC gain 1 */
+        if (fabs(u[k]) > *u_peak) *u_peak = fabs(u[k]);
+        y[k] = yy = plant_step(&pl, u[k]);
+    }
+    resp_t m;
+    metrics(&m, y, u, N, PID_STEP, 200);
+    return m;
+}
+
+static void case_pid(void)
+{
+    /* Kp = 6, Ti = 6 ms, Td = 1 ms, N = 10, Tt = √(Ti·Td) */
+    const double kp = 6, ti = 6e-3, td = 1e-3, tt = 2.45e-3;
+    double pa, pb, pc, pd, pe;
+    resp_t a = run_pid(gains(kp, ti, td, 10, tt, 1.0, 1.0), 0, 0, &pa);
+    resp_t b = run_pid(gains(kp, ti, td, 10, tt, 0.5, 0.0), 0, 0, &pb);
+    resp_t c = run_pid(gains(kp, ti, td, 10, tt, 0.5, 0.0), 1, 0, &pc);
+    resp_t d = run_pid(gains(kp, ti, td, 10, tt, 0.5, 0.0), 1, 2, &pd);
+    resp_t e = run_pid(gains(kp, ti, td,  0, tt, 0.5, 0.0), 1, 2, &pe);
+
+    printf("2 pid: 1/((10 ms s+1)(2 ms s+1)), Kp %.0f, Ti %.0f ms, Td %.0f ms, step %.1f\n",
+           kp, ti * 1e3, td * 1e3, PID_STEP);
+    printf("    b=1 c=1        overshoot %5.1f %%  settle %6.2f ms  IAE %.3f  |u| peak %.2f\n", a.overshoot, a.settle, a.iae, pa);
+    printf("    b=0.5 c=0      overshoot %5.1f %%  settle %6.2f ms  IAE %.3f  |u| peak %.2f\n", b.overshoot, b.settle, b.iae, pb);
+    printf("    + feedforward  overshoot %5.1f %%  settle %6.2f ms  IAE %.3f  |u| peak %.2f\n", c.overshoot, c.settle, c.iae, pc);
+    printf("    ±2 LSB noise, N = 10      Δu rms %.4f  settle %6.2f ms\n", d.du_rms, d.settle);
+    printf("    ±2 LSB noise, unfiltered  Δu rms %.4f  settle %6.2f ms\n", e.du_rms, e.settle);
+    check("setpoint weighting lowers overshoot and kick", b.overshoot < a.overshoot && pb < pa);
+    check("feedforward lowers IAE", c.iae < b.iae);
+    check("derivative filter halves actuator noise", d.du_rms < 0.5 * e.du_rms);
+    check("noisy loop still settles (2 %) within 40 ms", d.settle < 40.0);
+}
+
+/* ——————————————————— 3: bumpless gain change ——————————————— */
+static double gain_step(int bumpless)
+{
+    pid_q15_t p;
+    pid_gains_t g1 = gains(1, 10e-3, 0, 0, 10e-3, 1, 0);
+    pid_gains_t g2 = gains(2, 10e-3, 0, 0, 10e-3, 1, 0);
+    plant_t pl = { 0, 0, 1.0, 5e-3, 0 };
+    pid_init(&p, &g1, Q15(-1.0), Q15_MAX);
+
+    double y = 0, u_prev = 0, jump = 0;
+    for (int k = 0; k < 2000; k++) {
+        double r = 0.3 * k / 2000.0;                 /* ramp: error ≠ 0 */
+        if (k == 1000) {
+            if (bumpless) pid_set_gains(&p, &g2);
+            else          p.g = g2;
+        }
+        double u = Q(pid_run(&p, Q15(r), adc(y, 0), 0));
+        if (k == 1000) jump = fabs(u - u_prev);
+        u_prev = u;
+        y = plant_step(&pl, u);
+    }
+    return jump;
+}
+
+static void case_gain_step(void)
+{
+    double j0 = gain_step(0), j1 = gain_step(1);
+    printf("3 gain step: Kp 1 → 2 on a ramp\n");
+    printf("    overwrite gains   |Δu| = %.4f\n", j0);
+    printf("    pid_set_gains()   |Δu| = %.4f\n", j1);
+    check("bumpless |Δu| below 10 % of the overwrite", j1 < 0.1 * j0);
+}
+
+/* ——————————————————— 4: manual → auto ——————————————————— */
+static double manual_auto(int track)
+{
+    pid_q15_t p;
+    pid_gains_t g = gains(2, 8e-3, 0.5e-3, 8, 4e-3, 1, 0);
+    plant_t pl = { 0, 0, 1.0, 5e-3, 1e-3 };
+    pid_init(&p, &g, Q15(-1.0), Q15_MAX);
+
+    double y = 0, u = 0, u_prev = 0, jump = 0;
+    for (int k = 0; k < 1000; k++) {
+        q15_t rq = Q15(0.2), yq = adc(y, 0);
+        if (k < 500) {
+            u = 0.45;                                  /* operator output */
+            if (track) pid_track(&p, rq, yq, 0, Q15(u));
+        } else {
+            u = Q(pid_run(&p, rq, yq, 0));
+        }
+        if (k == 500) jump = fabs(u - u_prev);
+        u_prev = u;
+        y = plant_step(&pl, u);
+    }
+    return jump;
+}
+
+static void case_manual_auto(void)
+{
+    double j0 = manual_auto(0), j1 = manual_auto(1);
+    printf("4 manual → auto: u = 0.45 by hand, r = 0.2\n");
+    printf("    cold switch-over  |Δu| = %.4f\n", j0);
+    printf("    pid_track()       |Δu| = %.4f\n", j1);
+    check("tracked switch-over below 0.01", j1 < 0.01 && j1 < j0);
+}
+
+/* ——————————————————— 5: fixed point against double ——————————— */
+static void case_reference(void)
+{
+    pid_gains_t g = gains(3, 5e-3, 1e-3, 8, 3e-3, 0.8, 0.2);
+    pid_q15_t p;
+    pid_init(&p, &g, Q15(-0.9), Q15(0.9));
+
+    /* the same law in double, with the quantised gains */
+    double kp = g.kp / 32768.0 * (1 << PID_GAIN_SHIFT), kd = g.kd / 32768.0 * (1 << PID_GAIN_SHIFT);
+    double ki = Q(g.ki), kt = Q(g.kt), ad = Q(g.ad);
+    double I = 0, D = 0, ed_prev = 0, err_max = 0;
+    q15_t  r = 0, y = 0;
+    srand(3);
+    for (int k = 0; k < 200000; k++) {
+        /* in-range signals: r steps every 10 ms, y a random walk */
+        if (k % 200 == 0) r = (q15_t)((rand() % 16384) - 8192);
+        y = q15_sat((q31_t)y + (rand() % 201) - 100);
+        if (y >  9830) y =  9830;
+        if (y < -9830) y = -9830;
+        q15_t  u  = pid_run(&p, r, y, 0);
+
+        double rd = Q(r), yd = Q(y);
+        /* weighted setpoints quantised like pid_weight(): one LSB there
+           would otherwise show up multiplied by kd */
+        double ep = Q(pid_weight(g.b, r)) - yd, ed = Q(pid_weight(g.c, r)) - yd;
+        D = ad * D + kd * (ed - ed_prev);
+        ed_prev = ed;
+        double v  = kp * ep + I + D;
+        double ud = v > 0.9 ? Q(Q15(0.9)) : v < -0.9 ? Q(Q15(-0.9)) : v;
+        double aw = ud - v;                            /* q15_sat() in the header */
+        if (aw >  Q(Q15_MAX)) aw = Q(Q15_MAX);
+        if (aw < -1.0)        aw = -1.0;
+        I += ki * (rd - yd) + kt * aw;
+        if (I >  1.0) I =  1.0;
+        if (I < -1.0) I = -1.0;
+        double err = fabs(Q(u) - ud) * 32768.0;
+        if (err > err_max) err_max = err;
+    }
+    printf("5 reference: 200000 samples against the same law in double precision\n");
+    printf("    max |u − u_double| = %.1f LSB\n", err_max);
+    check("fixed point within 8 LSB of double", err_max <= 8.0);
+}
+
+int main(void)
+{
+    case_windup();
+    case_pid();
+    case_gain_step();
+    case_manual_auto();
+    case_reference();
+    printf("%s (%d failed)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,504 @@
+/**********************************************************************
+ *  pmsm_sim – foc_q15.h driving a PMSM model on the PC
+ *  cc -O2 -I.. -o pmsm_sim pmsm_sim.c -lm
+ *
+ *  The control side is 030_foc_pipeline.c period for period: same
+ *  constants, foc_init()/foc_step() from foc_q15.h, pwm_dtc_apply3()
+ *  from pwm_deadtime.h, the same offset calibration and a 10-bit
+ *  signed-fractional ADC with ±1 LSB of noise. Currents are sampled
+ *  at the carrier peak and the new duties latch at the next period
+ *  start (IUE = 0), so the plant sees them half a period later.
+ *
+ *  Plant, in double precision: surface PMSM (Ld = Lq) fed by a
+ *  period-averaged inverter, each leg losing −sign(i)·Td/T·Vdc to the
+ *  dead time; neutral floating. Each case prints its figures and
+ *  PASS/FAIL; the exit code is the number of failures.
+ *
+ *    1 svm         – duties of foc_svm() against the requested α/β
+ *                    voltage (line-to-line, counts) over the circle
+ *    2 step        – locked rotor, iq step: rise, overshoot, error
+ *    3 reference   – the Q15 pipeline against the same loop in double
+ *                    precision on the same motor, speed held
+ *    4 base speed  – encoder angle, full torque until back-EMF eats
+ *                    the voltage: limiter, d priority, no windup when
+ *                    braking back out of it
+ *    5 I/f start   – the firmware's open-loop angle ramp pulls the
+ *                    rotor into step from standstill
+ *    6 dead time   – iq ripple at low speed with and without
+ *                    pwm_dtc_apply3()
+ **********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+/* Same constants as 030_foc_pipeline.c */
+#define FCY            (7370000UL * 16UL / 4UL)
+#define PWM_FREQ_HZ    20000UL
+#define PTPER_VAL      ((FCY / (2UL * PWM_FREQ_HZ)) - 1)      /* 736 */
+#define PWM_DT_NS      1000
+#define PWM_DT_PERIOD_TCY  (2UL * (PTPER_VAL + 1))
+#define DTC_BAND_SHIFT 9U
+#define OPENLOOP_HZ    20UL
+#define THETA_STEP     ((uint16_t)((OPENLOOP_HZ * 65536UL) / PWM_FREQ_HZ))
+#define FOC_KP         Q15(0.25)
+#define FOC_KI         Q15(0.01)
+
+#include "foc_q15.h"
+#include "../../0020_dspic30f_pwm/pwm_deadtime.h"
+
+#define TS          (1.0 / PWM_FREQ_HZ)
+#define NSUB        20                  /* integration steps per period */
+#define Q(x)        ((x) / 32768.0)
+
+/* Motor and inverter: Kp = 0.25·Vdc/I_FS = 0.6 V/A, and Ki/Kp puts the
+   PI zero on R/L (800 rad/s) → first-order loop, τ ≈ 0.8 ms */
+#define VDC         24.0                /* V                            */
+#define I_FS        10.0                /* A at Q15 1.0                 */
+#define R_S         0.4                 /* Ω                            */
+#define L_S         0.5e-3              /* H, Ld = Lq                   */
+#define PSI_M       0.01                /* Wb, magnet flux linkage      */
+#define POLES       4                   /* pole pairs                   */
+#define J_M         2.0e-5              /* kg·m²                        */
+#define B_M         2.0e-5              /* N·m·s                        */
+#define TD_FRAC     ((double)PWM_DT_ACTUAL_TCY / PWM_DT_PERIOD_TCY)
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %-48s %s\n", what, ok ? "PASS" : "FAIL");
+    if (!ok) g_fail++;
+}
+
+static double sgn(double x) { return x > 0 ? 1.0 : x < 0 ? -1.0 : 0.0; }
+
+/* ——————————————————— plant ——————————————————— */
+typedef struct {
+    double id, iq;          /* A, rotor frame                 */
+    double we;              /* electrical speed, rad/s        */
+    double th;              /* electrical angle, rad          */
+    int    locked;          /* 1 → we held at its value       */
+    double tl;              /* load torque, N·m               */
+} motor_t;
+
+static void motor_iabc(const motor_t *m, double i[3])
+{
+    double c = cos(m->th), s = sin(m->th);
+    double ia = m->id * c - m->iq * s;
+    double ib = m->id * s + m->iq * c;
+    i[0] = ia;
+    i[1] = -0.5 * ia + sqrt(3.0) / 2 * ib;
+    i[2] = -i[0] - i[1];
+}
+
+/* One half period with the duties pdc[] latched */
+static void motor_run(motor_t *m, const uint16_t pdc[3], uint16_t half, int dead)
+{
+    double h = TS / 2 / NSUB;
+    for (int n = 0; n < NSUB; n++) {
+        double i[3], v[3];
+        motor_iabc(m, i);
+        for (int k = 0; k < 3; k++) {
+            v[k] = ((double)pdc[k] / (2.0 * half) - 0.5) * VDC;
+            if (dead) v[k] -= sgn(i[k]) * TD_FRAC * VDC;
+        }
+        double vn = (v[0] + v[1] + v[2]) / 3;
+        double va = v[0] - vn, vb = v[1] - vn, vc = v[2] - vn;
+        double valpha = (2.0 * va - vb - vc) / 3;
+        double vbeta  = (vb - vc) / sqrt(3.0);
+        double c = cos(m->th), s = sin(m->th);
+        double vd =  valpha * c + vbeta * s;
+        double vq = -valpha * s + vbeta * c;
+
+        double did = (vd - R_S * m->id + m->we * L_S * m->iq) / L_S;
+        double diq = (vq - R_S * m->iq - m->we * L_S * m->id - m->we * PSI_M) / L_S;
+        m->id += did * h;
+        m->iq += diq * h;
+        if (!m->locked) {
+            double te = 1.5 * POLES * PSI_M * m->iq;
+            m->we += POLES * (te - B_M * m->we / POLES - m->tl) / J_M * h;
+        }
+        m->th += m->we * h;
+        if (m->th >  M_PI) m->th -= 2 * M_PI;
+        if (m->th < -M_PI) m->th += 2 * M_PI;
+    }
+}
+
+/* Current sensor: 10 bits signed fractional (LSB = 64 in Q15), offset
+   in LSB, ±1 LSB of noise */
+static q15_t adc(double i, int offset, int noise)
+{
+    long q = lround(i / I_FS * 512.0) + offset;
+    if (noise) q += (rand() % 3) - 1;
+    if (q >  511) q =  511;
+    if (q < -512) q = -512;
+    return (q15_t)(q * 64);
+}
+
+static q15_ang enc_angle(const motor_t *m)
+{
+    double a = m->th < 0 ? m->th + 2 * M_PI : m->th;
+    return (q15_ang)((uint32_t)lround(a / (2 * M_PI) * 65536.0) & 0xFFFFU);
+}
+
+/* ——————————————————— the firmware loop ——————————————————— */
+typedef struct {
+    foc_t     foc;
+    pwm_dtc_t dtc;
+    int       dtc_on;
+    q15_t     ia_off, ib_off;
+    uint16_t  pdc_latched[3];       /* what the PWM module outputs */
+    uint16_t  pdc_next[3];          /* written by the ISR          */
+} ctl_t;
+
+#define OFF_A   3                   /* sensor offsets, LSB */
+#define OFF_B   (-2)
+
+static void ctl_init(ctl_t *c, int dtc_on)
+{
+    foc_init(&c->foc, PTPER_VAL, FOC_KP, FOC_KI);
+    pwm_dtc_init(&c->dtc, PWM_DT_COMP_CENTER, DTC_BAND_SHIFT,
+                 2U * (PTPER_VAL + 1));
+    c->dtc_on = dtc_on;
+
+    /* calibrate_offsets(): bridge off, 64 samples */
+    int32_t sa = 0, sb = 0;
+    for (int n = 0; n < 64; n++) {
+        sa += adc(0, OFF_A, 1);
+        sb += adc(0, OFF_B, 1);
+    }
+    c->ia_off = (q15_t)(sa >> 6);
+    c->ib_off = (q15_t)(sb >> 6);
+    for (int k = 0; k < 3; k++)
+        c->pdc_latched[k] = c->pdc_next[k] = c->foc.half;
+}
+
+/* _ADCInterrupt() without the hardware */
+static void ctl_isr(ctl_t *c, const motor_t *m)
+{
+    double i[3];
+    motor_iabc(m, i);
+    q15_t ia = q15_sat((q31_t)adc(i[0], OFF_A, 1) - c->ia_off);
+    q15_t ib = q15_sat((q31_t)adc(i[1], OFF_B, 1) - c->ib_off);
+
+    foc_step(&c->foc, ia, ib);
+    if (c->dtc_on) {
+        const q15_t iabc[3] = { ia, ib, q15_sat(-(q31_t)ia - ib) };
+        pwm_dtc_apply3(&c->dtc, c->foc.pdc, iabc);
+    }
+    memcpy(c->pdc_next, c->foc.pdc, sizeof c->pdc_next);
+}
+
+/* One PWM period: valley → peak, ADC + ISR, peak → valley, latch */
+static void period(ctl_t *c, motor_t *m)
+{
+    motor_run(m, c->pdc_latched, c->foc.half, 1);
+    ctl_isr(c, m);
+    motor_run(m, c->pdc_latched, c->foc.half, 1);
+    memcpy(c->pdc_latched, c->pdc_next, sizeof c->pdc_latched);
+}
+
+static double pu(double amps) { return amps / I_FS; }
+
+/* ——————————————————— 1: SVM ——————————————————— */
+static void case_svm(void)
+{
+    const uint16_t half = PTPER_VAL + 1;
+    double err_max = 0, margin = 1e9;
+    int out_of_range = 0;
+
+    for (int a = 0; a < 3600; a++) {
+        for (int r = 1; r <= 4; r++) {
+            double ang = 2 * M_PI * a / 3600.0;
+            double mag = Q(FOC_VMAX_LINEAR) * r / 4;
+            q15_t  va = (q15_t)lround(mag * cos(ang) * 32768.0);
+            q15_t  vb = (q15_t)lround(mag * sin(ang) * 32768.0);
+            uint16_t pdc[3];
+            foc_svm(va, vb, half, pdc);
+
+            for (int k = 0; k < 3; k++)
+                if (pdc[k] > 2U * half) out_of_range++;
+            /* line-to-line: (pdc_x − pdc_y)/(2·half) = v_x − v_y (base Vdc) */
+            double v[3] = { Q(va), -Q(va) / 2 + sqrt(3.0) / 2 * Q(vb),
+                            -Q(va) / 2 - sqrt(3.0) / 2 * Q(vb) };
+            for (int k = 0; k < 3; k++) {
+                int    j   = (k + 1) % 3;
+                double want = (v[k] - v[j]) * 2.0 * half;
+                double got  = (double)pdc[k] - pdc[j];
+                double e    = fabs(got - want);
+                if (e > err_max) err_max = e;
+            }
+            /* on the hexagon circle a leg touches a rail at six angles */
+            if (r == 4) {
+                uint16_t lo = pdc[0], hi = pdc[0];
+                for (int k = 1; k < 3; k++) {
+                    if (pdc[k] < lo) lo = pdc[k];
+                    if (pdc[k] > hi) hi = pdc[k];
+                }
+                double m = (double)(lo < 2U * half - hi ? lo : 2U * half - hi);
+                if (m < margin) margin = m;
+            }
+        }
+    }
+    printf("1 svm: 14400 vectors up to |v| = 1/√3, PDC span 0…%u\n", 2U * half);
+    printf("    max line-to-line error %.2f counts, closest approach to a rail at 1/√3: %.0f counts\n",
+           err_max, margin);
+    check("no duty outside 0..2*half", out_of_range == 0);
+    check("line-to-line voltages within 1.5 counts", err_max <= 1.5);
+    check("linear range reaches the hexagon circle", margin <= 2.0);
+}
+
+/* ——————————————————— 2: current step, locked rotor ——————————————————— */
+static void case_step(void)
+{
+    enum { N = 400 };                   /* 20 ms */
+    const double ref = 0.3;
+    ctl_t   c;
+    motor_t m = { 0 };
+    m.locked = 1;
+    srand(11);
+    ctl_init(&c, 1);
+
+    double iq[N], id_max = 0;
+    for (int k = 0; k < N; k++) {
+        c.foc.theta  = enc_angle(&m);
+        c.foc.iq_ref = k >= 20 ? Q15(ref) : 0;
+        c.foc.id_ref = 0;
+        period(&c, &m);
+        iq[k] = pu(m.iq);
+        if (k >= 20 && fabs(pu(m.id)) > id_max) id_max = fabs(pu(m.id));
+    }
+
+    int k10 = -1, k90 = -1;
+    double peak = 0, ss = 0;
+    for (int k = 20; k < N; k++) {
+        if (k10 < 0 && iq[k] >= 0.1 * ref) k10 = k;
+        if (k90 < 0 && iq[k] >= 0.9 * ref) k90 = k;
+        if (iq[k] > peak) peak = iq[k];
+    }
+    for (int k = N - 100; k < N; k++) ss += iq[k];
+    ss /= 100;
+
+    double rise = (k90 - k10) * TS * 1e3;
+    double os   = 100.0 * (peak - ref) / ref;
+    printf("2 step: iq 0 → %.2f pu, locked rotor, τ_design = L/Kp = %.2f ms\n",
+           ref, L_S / (Q(FOC_KP) * VDC / I_FS) * 1e3);
+    printf("    rise 10–90 %% %.2f ms, overshoot %.1f %%, final %.4f pu, |id| max %.4f pu\n",
+           rise, os, ss, id_max);
+    check("rise time 10-90 % under 2.5 ms", k10 >= 0 && k90 >= 0 && rise < 2.5);
+    check("overshoot under 10 %", os < 10.0);
+    check("steady state within 1 ADC LSB (1/512)", fabs(ss - ref) <= 1.0 / 512);
+    check("id stays within 2 % of full scale", id_max <= 0.02);
+}
+
+/* ——————————————————— 3: against double precision ——————————————————— */
+typedef struct { double kp, ki, integ, lim; } dpi_t;
+
+static double dpi_run(dpi_t *p, double e)
+{
+    p->integ += p->ki * e;
+    if (p->integ >  p->lim) p->integ =  p->lim;
+    if (p->integ < -p->lim) p->integ = -p->lim;
+    double u = p->kp * e + p->integ;
+    return u > p->lim ? p->lim : u < -p->lim ? -p->lim : u;
+}
+
+static void case_reference(void)
+{
+    enum { N = 6000 };                  /* 300 ms */
+    ctl_t   c;
+    motor_t mq = { 0 }, md;
+    mq.locked = 1;
+    mq.we = 2 * M_PI * 50.0;            /* speed held: compare the loops, not two */
+    md = mq;                            /* free rotors drifting apart            */
+    srand(5);
+    ctl_init(&c, 0);
+    const double vmax = Q(FOC_VMAX_LINEAR);
+    dpi_t pd = { Q(FOC_KP), Q(FOC_KI), 0, vmax }, pq = pd;
+    double dpdc_latched[3] = { 0.5, 0.5, 0.5 }, dpdc_next[3] = { 0.5, 0.5, 0.5 };
+    double err_max = 0, err_sum = 0;
+
+    for (int k = 0; k < N; k++) {
+        double ref = (k / 1000) % 2 ? -0.15 : 0.25;          /* ±steps every 50 ms */
+
+        /* fixed point, firmware path; ideal sensor for both loops */
+        c.foc.theta  = enc_angle(&mq);
+        c.foc.iq_ref = (q15_t)lround(ref * 32768.0);
+        motor_run(&mq, c.pdc_latched, c.foc.half, 0);
+        {
+            double i[3];
+            motor_iabc(&mq, i);
+            q15_t ia = (q15_t)lround(pu(i[0]) * 32768.0);
+            q15_t ib = (q15_t)lround(pu(i[1]) * 32768.0);
+            foc_step(&c.foc, ia, ib);
+            memcpy(c.pdc_next, c.foc.pdc, sizeof c.pdc_next);
+        }
+        motor_run(&mq, c.pdc_latched, c.foc.half, 0);
+        memcpy(c.pdc_latched, c.pdc_next, sizeof c.pdc_latched);
+
+        /* the same loop in double precision */
+        uint16_t pd16[3];
+        for (int j = 0; j < 3; j++) pd16[j] = 0;
+        {
+            /* duties as exact fractions: drive motor_run through a 2^16 carrier */
+            const uint16_t H = 32768;
+            for (int j = 0; j < 3; j++) pd16[j] = (uint16_t)lround(dpdc_latched[j] * 2.0 * H);
+            motor_run(&md, pd16, H, 0);
+
+            double i[3];
+            motor_iabc(&md, i);
+            double th = md.th, s = sin(th), co = cos(th);
+            double al = pu(i[0]), be = (pu(i[0]) + 2 * pu(i[1])) / sqrt(3.0);
+            double id = al * co + be * s, iq = be * co - al * s;
+            double vd = dpi_run(&pd, 0 - id), vq = dpi_run(&pq, ref - iq);
+            if (fabs(vd) > vmax) vd = sgn(vd) * vmax;
+            double room = sqrt(vmax * vmax - vd * vd);
+            if (fabs(vq) > room) vq = sgn(vq) * room;
+            double va = vd * co - vq * s, vb = vd * s + vq * co;
+            double v[3] = { va, -va / 2 + sqrt(3.0) / 2 * vb, -va / 2 - sqrt(3.0) / 2 * vb };
+            double hi = fmax(v[0], fmax(v[1], v[2])), lo = fmin(v[0], fmin(v[1], v[2]));
+            for (int j = 0; j < 3; j++) dpdc_next[j] = 0.5 + v[j] - (hi + lo) / 2;
+
+            motor_run(&md, pd16, H, 0);
+            memcpy(dpdc_latched, dpdc_next, sizeof dpdc_latched);
+        }
+
+        double e = fabs(pu(mq.iq) - pu(md.iq));
+        if (e > err_max) err_max = e;
+        err_sum += e;
+    }
+    printf("3 reference: %d periods of iq steps 0.25/-0.15 pu at 50 Hz electrical\n", N);
+    printf("    |iq − iq_double| max %.5f pu (%.1f LSB), mean %.5f pu\n",
+           err_max, err_max * 32768, err_sum / N);
+    check("Q15 pipeline within 0.2 % FS of double", err_max <= 0.002);
+}
+
+/* ——————————————————— 4: up to base speed ——————————————————— */
+static void case_base_speed(void)
+{
+    enum { N = 4000, BRAKE = 3000 };    /* 200 ms, braking from 150 ms */
+    ctl_t   c;
+    motor_t m = { 0 };
+    srand(7);
+    ctl_init(&c, 1);
+
+    double id_max = 0, id_lim = 0, vmag_max = 0, we_max = 0;
+    q31_t  integ_max = 0;
+    int    limited = 0, bad_pdc = 0, k_brake = -1;
+    for (int k = 0; k < N; k++) {
+        c.foc.theta  = enc_angle(&m);
+        c.foc.iq_ref = k < BRAKE ? Q15(0.3) : Q15(-0.3);
+        period(&c, &m);
+
+        double vm = sqrt((double)c.foc.vd * c.foc.vd + (double)c.foc.vq * c.foc.vq);
+        if (vm > vmag_max) vmag_max = vm;
+        if (vm >= FOC_VMAX_LINEAR - 2) {
+            limited++;
+            if (fabs(pu(m.id)) > id_lim) id_lim = fabs(pu(m.id));
+        }
+        if (c.foc.pi_q.integ > integ_max) integ_max = c.foc.pi_q.integ;
+        for (int j = 0; j < 3; j++)
+            if (c.pdc_latched[j] > 2U * c.foc.half) bad_pdc++;
+        if (k < BRAKE && fabs(pu(m.id)) > id_max) id_max = fabs(pu(m.id));
+        if (m.we > we_max) we_max = m.we;
+        if (k >= BRAKE && k_brake < 0 && pu(m.iq) <= -0.15) k_brake = k;
+    }
+    double we_base = Q(FOC_VMAX_LINEAR) * VDC / PSI_M;     /* no-load, no R */
+    double brk = k_brake < 0 ? 1e9 : (k_brake - BRAKE) * TS * 1e3;
+    printf("4 base speed: iq_ref 0.3 pu, -0.3 pu from %d ms, encoder angle\n", BRAKE / 20);
+    printf("    top %.0f rpm (EMF = Vmax at %.0f rpm), %d periods on the limiter, |v| max %.0f (limit %d)\n",
+           we_max / POLES * 60 / (2 * M_PI), we_base / POLES * 60 / (2 * M_PI),
+           limited, vmag_max, FOC_VMAX_LINEAR);
+    printf("    |id| max %.4f pu accelerating (ω·L·iq, no decoupling), %.4f pu on the limiter\n",
+           id_max, id_lim);
+    printf("    q integrator max %.0f (clamp %d), iq at half the braking step after %.2f ms\n",
+           integ_max / 32768.0, FOC_VMAX_LINEAR, brk);
+    check("speed reaches the voltage limit", limited > 100);
+    check("|vdq| never above FOC_VMAX_LINEAR + 1", vmag_max <= FOC_VMAX_LINEAR + 1);
+    check("duties always within 0..2*half", bad_pdc == 0);
+    check("|id| under 5 % FS up to and on the limiter", id_max <= 0.05);
+    check("q integrator never past the output clamp",
+          integ_max <= ((q31_t)FOC_VMAX_LINEAR << Q15_SHIFT));
+    check("braking from the limiter: half the step in 3 ms", brk <= 3.0);
+}
+
+/* ——————————————————— 5: I/f start ——————————————————— */
+static void case_if_start(void)
+{
+    enum { N = 20000 };                 /* 1 s */
+    ctl_t   c;
+    motor_t m = { 0 };
+    m.tl = 0.005;                       /* light load, N·m */
+    srand(9);
+    ctl_init(&c, 1);
+
+    double we_sum = 0;
+    int    n_avg = 0;
+    for (int k = 0; k < N; k++) {
+        c.foc.iq_ref = Q15(0.25);
+        c.foc.id_ref = 0;
+        c.foc.theta += THETA_STEP;      /* the firmware's open-loop ramp */
+        period(&c, &m);
+        if (k >= N / 2) { we_sum += m.we; n_avg++; }
+    }
+    double sync = THETA_STEP * (double)PWM_FREQ_HZ / 65536.0 * 2 * M_PI;
+    double got  = we_sum / n_avg;
+    printf("5 I/f start: θ step %u per period (%.2f Hz electrical), iq_ref 0.25 pu, load %.3f N·m\n",
+           THETA_STEP, sync / (2 * M_PI), m.tl);
+    printf("    mean speed over the last 0.5 s %.2f Hz electrical\n", got / (2 * M_PI));
+    check("rotor locked to the ramp (within 1 %)", fabs(got - sync) <= 0.01 * sync);
+}
+
+/* ——————————————————— 6: dead time ——————————————————— */
+static double ripple(int dtc_on, double *iq_mean)
+{
+    enum { N = 8000 };                  /* 400 ms, last 200 ms measured */
+    ctl_t   c;
+    motor_t m = { 0 };
+    m.locked = 1;
+    m.we = 2 * M_PI * 10.0;             /* 10 Hz electrical, held */
+    srand(13);
+    ctl_init(&c, dtc_on);
+
+    double e2 = 0, s = 0;
+    int    n = 0;
+    for (int k = 0; k < N; k++) {
+        c.foc.theta  = enc_angle(&m);
+        c.foc.iq_ref = Q15(0.15);
+        period(&c, &m);
+        if (k >= N / 2) {
+            double e = pu(m.iq) - 0.15;
+            e2 += e * e + pu(m.id) * pu(m.id);
+            s  += pu(m.iq);
+            n++;
+        }
+    }
+    *iq_mean = s / n;
+    return sqrt(e2 / n);
+}
+
+static void case_deadtime(void)
+{
+    double m0, m1;
+    double r0 = ripple(0, &m0);
+    double r1 = ripple(1, &m1);
+    printf("6 dead time: %u Tcy of %lu (%.2f %% of Vdc), 10 Hz, iq_ref 0.15 pu\n",
+           (unsigned)PWM_DT_ACTUAL_TCY, (unsigned long)PWM_DT_PERIOD_TCY, 100 * TD_FRAC);
+    printf("    rms current-vector error: raw %.4f pu, compensated %.4f pu\n", r0, r1);
+    check("compensation reduces the dq ripple", r1 < r0);
+    check("compensated ripple under 1 % FS", r1 < 0.01);
+}
+
+int main(void)
+{
+    case_svm();
+    case_step();
+    case_reference();
+    case_base_speed();
+    case_if_start();
+    case_deadtime();
+    printf("%s (%d failed)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
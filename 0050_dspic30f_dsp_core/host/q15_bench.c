@@ -0,0 +1,467 @@
+/**********************************************************************
+ *  q15_bench – q15_math.h against double precision and soft-float
+ *  cc -O2 -I.. -o q15_bench q15_bench.c -lm
+ *
+ *  Each case prints its figures and PASS/FAIL; the exit code is the
+ *  number of failures.
+ *
+ *    1 accuracy   – every bound documented in q15_math.h, measured
+ *                   against double: sin/cos, sqrt, log2, recip and
+ *                   exp2 over every 16-bit input; atan2/polar/mag on a
+ *                   dense grid of the full x/y plane (atan2 where
+ *                   |v| > 64 LSB); sqrt_q30 and q31_mul_q15 on 10^6
+ *                   random inputs plus the extremes, except (−1)·(−1)
+ *                   for q31_mul_q15, whose +1 is not representable
+ *    2 soft-float – the same jobs done the way a float port would on
+ *                   a core without FPU: IEEE single in software
+ *                   (sf_add/sf_mul/sf_div below: 32-bit integers only,
+ *                   16×16 partial products and a restoring divide as
+ *                   on a 16-bit core, round to nearest, denormals
+ *                   flushed) with the usual libm algorithms (Cody-Waite
+ *                   reduction + polynomials, Newton sqrt), including
+ *                   the Q15 ↔ float conversions the caller needs.
+ *                   Checked to be within 1 output LSB of double, so
+ *                   the comparison is like for like
+ *    3 cost       – host ns per call of each kernel and of its
+ *                   soft-float equivalent, and soft-float operations
+ *                   per call. Host figures only rank the two: on the
+ *                   16-bit target each soft-float add/mul/div is a
+ *                   multi-word library call while the kernels are the
+ *                   16×16 MUL/DIV they were written for. Not PASS/FAIL.
+ **********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "q15_math.h"
+
+#define NRAND   1000000L
+#define REPS    2000000L
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %-52s %s\n", what, ok ? "PASS" : "FAIL");
+    if (!ok) g_fail++;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t g_rng = 12345U;
+static uint32_t rnd32(void)  { g_rng ^= g_rng << 13; g_rng ^= g_rng >> 17; g_rng ^= g_rng << 5; return g_rng; }
+
+/* Angle error in q15_ang units, wrapped to ±π */
+static double ang_err(q15_ang a, double ref_rad)
+{
+    double e = a - ref_rad * 32768.0 / M_PI;
+    e = fmod(e, 65536.0);
+    if (e >  32768.0) e -= 65536.0;
+    if (e < -32768.0) e += 65536.0;
+    return fabs(e);
+}
+
+/*==================== IEEE single in software =====================*/
+typedef uint32_t sf_t;
+static unsigned long g_sf_ops;
+
+#define SF_SIGN(a)  ((a) >> 31)
+#define SF_EXP(a)   ((int32_t)(((a) >> 23) & 0xFF))
+#define SF_MAN(a)   (((a) & 0x7FFFFFUL) | 0x800000UL)
+#define SF_NEG(a)   ((a) ^ 0x80000000UL)
+
+static sf_t sf_pack(uint32_t s, int32_t e, uint32_t m)  /* m: hidden bit at 23 */
+{
+    if (e <= 0)   return s << 31;                       /* flush to zero */
+    if (e >= 255) return (s << 31) | 0x7F800000UL;
+    return (s << 31) | ((uint32_t)e << 23) | (m & 0x7FFFFFUL);
+}
+
+/* 24×24 → 48 bits from 16×16 partial products, as a 16-bit core does */
+static sf_t sf_mul(sf_t a, sf_t b)
+{
+    uint32_t s = SF_SIGN(a ^ b);
+    g_sf_ops++;
+    if (!SF_EXP(a) || !SF_EXP(b)) return s << 31;
+    int32_t  e  = SF_EXP(a) + SF_EXP(b) - 127;
+    uint32_t ah = SF_MAN(a) >> 16, al = SF_MAN(a) & 0xFFFF;
+    uint32_t bh = SF_MAN(b) >> 16, bl = SF_MAN(b) & 0xFFFF;
+    uint32_t mid = ah * bl + al * bh;
+    uint32_t lo  = al * bl;
+    uint32_t lo2 = lo + (mid << 16);
+    uint32_t hi  = ah * bh + (mid >> 16) + (lo2 < lo);  /* bits 32…47 */
+    uint32_t m;
+    if (hi >> 15) { m = ((hi << 8) | (lo2 >> 24)) + ((lo2 >> 23) & 1); e++; }
+    else            m = ((hi << 9) | (lo2 >> 23)) + ((lo2 >> 22) & 1);
+    if (m >> 24) { m >>= 1; e++; }
+    return sf_pack(s, e, m);
+}
+
+static sf_t sf_add(sf_t a, sf_t b)
+{
+    g_sf_ops++;
+    if (!SF_EXP(b)) return a;
+    if (!SF_EXP(a)) return b;
+    if ((a & 0x7FFFFFFFUL) < (b & 0x7FFFFFFFUL)) { sf_t t = a; a = b; b = t; }
+
+    int32_t  e  = SF_EXP(a);
+    int32_t  d  = e - SF_EXP(b);
+    uint32_t ma = SF_MAN(a) << 6, mb = SF_MAN(b) << 6, m;   /* 3 guard bits + room */
+    if (d > 29)  mb = 1;                                    /* sticky only */
+    else if (d)  mb = (mb >> d) | ((mb & ((1UL << d) - 1)) != 0);
+    if (SF_SIGN(a ^ b)) {
+        m = ma - mb;
+        if (!m) return 0;
+        while (!(m & (1UL << 29))) { m <<= 1; e--; }
+    } else {
+        m = ma + mb;
+        if (m & (1UL << 30)) { m = (m >> 1) | (m & 1); e++; }
+    }
+    m = (m + 32) >> 6;
+    if (m >> 24) { m >>= 1; e++; }
+    return sf_pack(SF_SIGN(a), e, m);
+}
+
+static sf_t sf_sub(sf_t a, sf_t b)   { return sf_add(a, SF_NEG(b)); }
+
+static sf_t sf_div(sf_t a, sf_t b)
+{
+    uint32_t s = SF_SIGN(a ^ b);
+    g_sf_ops++;
+    if (!SF_EXP(a)) return s << 31;
+    if (!SF_EXP(b)) return (s << 31) | 0x7F800000UL;
+    int32_t  e = SF_EXP(a) - SF_EXP(b) + 127;
+    uint32_t r = SF_MAN(a), d = SF_MAN(b), q = 0, m;
+    for (int i = 0; i < 26; i++) {                      /* restoring: ma·2^25 / mb */
+        q <<= 1;
+        if (r >= d) { r -= d; q |= 1; }
+        r <<= 1;
+    }
+    if (q >> 25) m = (q + 2) >> 2;
+    else       { m = (q + 1) >> 1; e--; }
+    if (m >> 24) { m >>= 1; e++; }
+    return sf_pack(s, e, m);
+}
+
+/* a · 2^n, exact (exponent only) */
+static sf_t sf_ldexp(sf_t a, int n)
+{
+    g_sf_ops++;
+    if (!SF_EXP(a)) return a;
+    return sf_pack(SF_SIGN(a), SF_EXP(a) + n, SF_MAN(a));
+}
+
+static sf_t sf_from_int(int32_t v)
+{
+    uint32_t s = v < 0, m = s ? (uint32_t)-v : (uint32_t)v;
+    int32_t  e = 127 + 23;
+    g_sf_ops++;
+    if (!m) return 0;
+    while (m >> 24) {                                   /* ≥ 2^24: round */
+        uint32_t r = m & 1; m >>= 1; e++;
+        if (r && (m >> 24) == 0) { m++; if (m >> 24) { m >>= 1; e++; } }
+    }
+    while (!(m & 0x800000UL)) { m <<= 1; e--; }
+    return sf_pack(s, e, m);
+}
+
+/* round to nearest integer (half away from zero), saturated to int32 */
+static int32_t sf_to_int(sf_t a)
+{
+    int32_t e = SF_EXP(a) - 127;
+    g_sf_ops++;
+    if (e < -1) return 0;
+    if (e > 30) return SF_SIGN(a) ? INT32_MIN : INT32_MAX;
+    uint32_t m = SF_MAN(a) << 7;                        /* value · 2^(30 − e) */
+    uint32_t v = e == 30 ? m : (m + (1UL << (29 - e))) >> (30 - e);
+    return SF_SIGN(a) ? -(int32_t)v : (int32_t)v;
+}
+
+/* floor, as an integer */
+static int32_t sf_floor(sf_t a)
+{
+    int32_t i = sf_to_int(a);
+    sf_t    d = sf_sub(a, sf_from_int(i));
+    return (SF_SIGN(d) && SF_EXP(d)) ? i - 1 : i;
+}
+
+static sf_t sf_c(double x)           { float f = (float)x; sf_t a; memcpy(&a, &f, 4); return a; }
+static double sf_d(sf_t a)           { float f; memcpy(&f, &a, 4); return f; }
+
+/* Constants, as a float port would have them */
+static sf_t K_2_PI, K_PIO2_HI, K_PIO2_LO, K_PI, K_PIO2, K_PIO4, K_TAN_PI8, K_HALF, K_ONE,
+            K_S1, K_S2, K_S3, K_C1, K_C2, K_C3, K_A1, K_A2, K_A3, K_A4,
+            K_L3, K_L5, K_L7, K_L9, K_2_LN2, K_LN2, K_E[8], K_SQRT2, K_ANG2RAD, K_RAD2ANG;
+
+static void sf_consts(void)
+{
+    K_2_PI = sf_c(2.0 / M_PI);  K_PIO2_HI = sf_c(1.5703125);  K_PIO2_LO = sf_c(M_PI_2 - 1.5703125);
+    K_PI = sf_c(M_PI);  K_PIO2 = sf_c(M_PI_2);  K_PIO4 = sf_c(M_PI_4);  K_TAN_PI8 = sf_c(0.41421356);
+    K_HALF = sf_c(0.5);  K_ONE = sf_c(1.0);
+    K_S1 = sf_c(-1.6666654611e-1); K_S2 = sf_c(8.3321608736e-3); K_S3 = sf_c(-1.9515295891e-4);
+    K_C1 = sf_c(4.166664568298827e-2); K_C2 = sf_c(-1.388731625493765e-3); K_C3 = sf_c(2.443315711809948e-5);
+    K_A1 = sf_c(8.05374449538e-2); K_A2 = sf_c(-1.38776856032e-1);
+    K_A3 = sf_c(1.99777106478e-1); K_A4 = sf_c(-3.33329491539e-1);
+    K_L3 = sf_c(1.0 / 3); K_L5 = sf_c(1.0 / 5); K_L7 = sf_c(1.0 / 7); K_L9 = sf_c(1.0 / 9);
+    K_2_LN2 = sf_c(2.0 / M_LN2);  K_LN2 = sf_c(M_LN2);  K_SQRT2 = sf_c(M_SQRT2);
+    for (int k = 0; k < 8; k++) K_E[k] = sf_c(1.0 / tgamma(k + 1.0));
+    K_ANG2RAD = sf_c(M_PI / 32768.0);  K_RAD2ANG = sf_c(32768.0 / M_PI);
+}
+
+/*------------------- libm-style functions on sf_t ------------------*/
+static sf_t sf_sinf(sf_t x)
+{
+    int32_t k = sf_to_int(sf_mul(x, K_2_PI));           /* nearest quadrant */
+    sf_t    kf = sf_from_int(k);
+    sf_t    r  = sf_sub(sf_sub(x, sf_mul(kf, K_PIO2_HI)), sf_mul(kf, K_PIO2_LO));
+    sf_t    z  = sf_mul(r, r), y;
+    if (k & 1)   /* cos poly */
+        y = sf_add(sf_sub(K_ONE, sf_mul(K_HALF, z)),
+                   sf_mul(sf_mul(z, z), sf_add(K_C1, sf_mul(z, sf_add(K_C2, sf_mul(z, K_C3))))));
+    else         /* sin poly */
+        y = sf_add(r, sf_mul(sf_mul(r, z), sf_add(K_S1, sf_mul(z, sf_add(K_S2, sf_mul(z, K_S3))))));
+    return (k & 2) ? SF_NEG(y) : y;
+}
+
+static sf_t sf_atan2f(sf_t y, sf_t x)
+{
+    if (!SF_EXP(x) && !SF_EXP(y)) return 0;
+    sf_t ax = x & 0x7FFFFFFFUL, ay = y & 0x7FFFFFFFUL, t, base = 0;
+    int  swap = ay > ax;
+    t = swap ? sf_div(ax, ay) : sf_div(ay, ax);         /* 0 … 1 */
+    if (t > K_TAN_PI8) { t = sf_div(sf_sub(t, K_ONE), sf_add(t, K_ONE)); base = K_PIO4; }
+    sf_t z = sf_mul(t, t);
+    sf_t p = sf_add(sf_mul(sf_mul(sf_add(sf_mul(sf_add(sf_mul(sf_add(sf_mul(K_A1, z), K_A2), z),
+                    K_A3), z), K_A4), z), t), t);
+    sf_t a = sf_add(base, p);
+    if (swap)           a = sf_sub(K_PIO2, a);
+    if (SF_SIGN(x))     a = sf_sub(K_PI, a);
+    return SF_SIGN(y) ? SF_NEG(a) : a;
+}
+
+static sf_t sf_sqrtf(sf_t x)
+{
+    if (!SF_EXP(x) || SF_SIGN(x)) return 0;
+    sf_t g = (x >> 1) + 0x1FC00000UL;                   /* exponent halved */
+    for (int i = 0; i < 3; i++) g = sf_mul(K_HALF, sf_add(g, sf_div(x, g)));
+    return g;
+}
+
+static sf_t sf_log2f(sf_t x)
+{
+    int32_t e = SF_EXP(x) - 127;
+    sf_t    m = sf_pack(0, 127, SF_MAN(x));             /* 1 … 2 */
+    if (m > K_SQRT2) { m = sf_ldexp(m, -1); e++; }
+    sf_t s = sf_div(sf_sub(m, K_ONE), sf_add(m, K_ONE));
+    sf_t z = sf_mul(s, s);
+    sf_t p = sf_add(K_ONE, sf_mul(z, sf_add(K_L3, sf_mul(z, sf_add(K_L5,
+                    sf_mul(z, sf_add(K_L7, sf_mul(z, K_L9))))))));
+    return sf_add(sf_mul(sf_mul(s, p), K_2_LN2), sf_from_int(e));
+}
+
+static sf_t sf_exp2f(sf_t x)
+{
+    int32_t n = sf_floor(x);
+    sf_t    f = sf_mul(sf_sub(x, sf_from_int(n)), K_LN2);
+    sf_t    p = K_E[7];
+    for (int k = 6; k >= 0; k--) p = sf_add(K_E[k], sf_mul(p, f));
+    return sf_ldexp(p, n);
+}
+
+/*------------- the same jobs as the kernels, Q15 in and out --------*/
+static q15_t   sfq_sin(q15_ang a)     { return (q15_t)q15_sat(sf_to_int(sf_ldexp(sf_sinf(sf_mul(sf_from_int((int16_t)a), K_ANG2RAD)), 15))); }
+static q15_ang sfq_atan2(q15_t y, q15_t x) { return (q15_ang)sf_to_int(sf_mul(sf_atan2f(sf_from_int(y), sf_from_int(x)), K_RAD2ANG)); }
+static q15_t   sfq_sqrt(q15_t x)      { return q15_sat(sf_to_int(sf_ldexp(sf_sqrtf(sf_ldexp(sf_from_int(x), -15)), 15))); }
+static q15_t   sfq_mag(q15_t x, q15_t y)
+{
+    sf_t fx = sf_ldexp(sf_from_int(x), -15), fy = sf_ldexp(sf_from_int(y), -15);
+    return q15_sat(sf_to_int(sf_ldexp(sf_sqrtf(sf_add(sf_mul(fx, fx), sf_mul(fy, fy))), 15)));
+}
+static q31_t   sfq_recip(q15_t x)     { return sf_to_int(sf_ldexp(sf_div(K_ONE, sf_ldexp(sf_from_int(x), -15)), 16)); }
+static int16_t sfq_log2(q15_t x)      { return (int16_t)sf_to_int(sf_ldexp(sf_log2f(sf_ldexp(sf_from_int(x), -15)), 11)); }
+static q15_t   sfq_exp2(int16_t x)    { return q15_sat(sf_to_int(sf_ldexp(sf_exp2f(sf_ldexp(sf_from_int(x), -11)), 15))); }
+
+/*======================= 1: accuracy ===============================*/
+typedef struct { const char *name; double bound; double q15; double sf; } acc_t;
+
+static acc_t g_acc[] = {
+    { "q15_sin / q15_cos",   1.5, 0, 0 },
+    { "q15_atan2",           4.0, 0, 0 },
+    { "q15_cordic_polar mag", 2.0, 0, 0 },
+    { "q15_mag",             1.0, 0, 0 },
+    { "q15_sqrt",            1.0, 0, 0 },
+    { "q15_sqrt_q30",        1.0, 0, 0 },
+    { "q15_recip (rel·2^14)", 1.0, 0, 0 },
+    { "q15_log2 (Q11)",      0.6, 0, 0 },
+    { "q15_exp2",            1.5, 0, 0 },
+    { "q31_mul_q15 (Q31)",   1.0, 0, 0 },
+};
+enum { A_SIN, A_ATAN, A_POLAR, A_MAG, A_SQRT, A_SQ30, A_RECIP, A_LOG2, A_EXP2, A_MUL31 };
+
+static void upd(double *m, double e)  { if (e > *m) *m = e; }
+
+static void case_accuracy(void)
+{
+    printf("1 accuracy (max |error| vs double, output LSB)\n");
+
+    for (long i = 0; i < 65536; i++) {
+        q15_ang a = (q15_ang)i;
+        double  r = i * M_PI / 32768.0;
+        double  s = fmin(sin(r) * 32768.0, 32767.0), c = fmin(cos(r) * 32768.0, 32767.0);
+        upd(&g_acc[A_SIN].q15, fabs(q15_sin(a) - s));
+        upd(&g_acc[A_SIN].q15, fabs(q15_cos(a) - c));
+        upd(&g_acc[A_SIN].sf,  fabs(sfq_sin(a) - s));
+    }
+
+    for (long y = -32768; y <= 32767; y += 97) {
+        for (long x = -32768; x <= 32767; x += 89) {
+            double  h = hypot((double)x, (double)y);
+            q15_t   m;
+            q15_ang a = q15_cordic_polar((q15_t)x, (q15_t)y, &m);
+            if (h > 64.0) {
+                upd(&g_acc[A_ATAN].q15, ang_err(a, atan2((double)y, (double)x)));
+                upd(&g_acc[A_ATAN].sf,  ang_err(sfq_atan2((q15_t)y, (q15_t)x), atan2((double)y, (double)x)));
+            }
+            upd(&g_acc[A_POLAR].q15, fabs(m - fmin(h, 32767.0)));
+            upd(&g_acc[A_MAG].q15,   fabs(q15_mag((q15_t)x, (q15_t)y) - fmin(floor(h), 32767.0)));
+            upd(&g_acc[A_MAG].sf,    fabs(sfq_mag((q15_t)x, (q15_t)y) - fmin(h, 32767.0)));
+        }
+    }
+    g_acc[A_POLAR].sf = g_acc[A_MAG].sf;
+
+    for (long x = -32768; x <= 32767; x++) {
+        q15_t q = (q15_t)x;
+        if (x >= 0) {
+            double s = sqrt(x * 32768.0);
+            upd(&g_acc[A_SQRT].q15, fabs(q15_sqrt(q) - s));
+            upd(&g_acc[A_SQRT].sf,  fabs(sfq_sqrt(q) - s));
+        }
+        if (x > 0) {
+            double l = log2(x / 32768.0) * 2048.0;
+            upd(&g_acc[A_LOG2].q15, fabs(q15_log2(q) - l));
+            upd(&g_acc[A_LOG2].sf,  fabs(sfq_log2(q) - l));
+        }
+        if (x != 0 && x != 1 && x != -1) {              /* ±2^15 does not fit Q16.16 */
+            double r = 32768.0 / x * 65536.0;
+            upd(&g_acc[A_RECIP].q15, fabs(q15_recip(q) - r) / fabs(r) * 16384.0);
+            upd(&g_acc[A_RECIP].sf,  fabs(sfq_recip(q) - r) / fabs(r) * 16384.0);
+        }
+        if (x < 0) {
+            double e = fmin(exp2(x / 2048.0) * 32768.0, 32767.0);
+            upd(&g_acc[A_EXP2].q15, fabs(q15_exp2(q) - e));
+            upd(&g_acc[A_EXP2].sf,  fabs(sfq_exp2(q) - e));
+        }
+    }
+
+    for (long i = 0; i < NRAND + 4; i++) {
+        uint32_t e = i < NRAND ? rnd32() : (i == NRAND ? 0 : i == NRAND + 1 ? 1 : 0xFFFFFFFFUL - (i & 1));
+        upd(&g_acc[A_SQ30].q15, fabs(q15_sqrt_q30(e) - fmin(floor(sqrt((double)e)), 32767.0)));
+
+        q31_t a = (q31_t)rnd32();
+        q15_t b = (q15_t)rnd32();
+        if (i >= NRAND) { a = (i & 1) ? INT32_MIN : INT32_MAX; b = (i & 2) ? -32768 : 32767; }
+        if (a == INT32_MIN && b == -32768) continue;    /* (−1)·(−1) = +1 is not Q31 */
+        upd(&g_acc[A_MUL31].q15, fabs(q31_mul_q15(a, b) - (double)a * b / 32768.0));
+    }
+
+    printf("    %-22s %7s %7s %9s\n", "kernel", "bound", "q15", "soft-fl.");
+    for (unsigned i = 0; i < sizeof g_acc / sizeof g_acc[0]; i++) {
+        char sf[16] = "-";
+        if (i != A_SQ30 && i != A_MUL31) snprintf(sf, sizeof sf, "%.2f", g_acc[i].sf);
+        printf("    %-22s %7.2f %7.2f %9s\n", g_acc[i].name, g_acc[i].bound, g_acc[i].q15, sf);
+    }
+    for (unsigned i = 0; i < sizeof g_acc / sizeof g_acc[0]; i++) {
+        char line[80];
+        snprintf(line, sizeof line, "%s within its documented bound", g_acc[i].name);
+        check(line, g_acc[i].q15 <= g_acc[i].bound);
+    }
+    double sfw = 0;
+    for (unsigned i = 0; i < sizeof g_acc / sizeof g_acc[0]; i++)
+        if (i != A_SQ30 && i != A_MUL31) upd(&sfw, g_acc[i].sf);
+    char line[80];
+    snprintf(line, sizeof line, "soft-float reference within 1 LSB (worst %.2f)", sfw);
+    check(line, sfw <= 1.0);
+}
+
+/*=========================== 2/3: cost =============================*/
+static volatile int32_t g_sink;
+static q15_t g_in_x[4096], g_in_y[4096];
+
+typedef struct { const char *name; int job; } job_t;
+static const job_t k_jobs[] = {
+    { "sin",        0 }, { "atan2",      1 }, { "polar",      2 }, { "mag",        3 },
+    { "sqrt",       4 }, { "recip",      5 }, { "log2",       6 }, { "exp2",       7 },
+};
+
+static int32_t run_q15(int job, q15_t x, q15_t y)
+{
+    q15_t m;
+    switch (job) {
+    case 0:  return q15_sin((q15_ang)x);
+    case 1:  return q15_atan2(y, x);
+    case 2:  return q15_cordic_polar(x, y, &m) + m;
+    case 3:  return q15_mag(x, y);
+    case 4:  return q15_sqrt(x < 0 ? -(x + 1) : x);
+    case 5:  return q15_recip(x ? x : 1);
+    case 6:  return q15_log2(x < 0 ? -(x + 1) : x ? x : 1);
+    default: return q15_exp2(x < 0 ? x : -x - 1);
+    }
+}
+
+static int32_t run_sf(int job, q15_t x, q15_t y)
+{
+    switch (job) {
+    case 0:  return sfq_sin((q15_ang)x);
+    case 1:  return sfq_atan2(y, x);
+    case 2:  return sfq_atan2(y, x) + sfq_mag(x, y);
+    case 3:  return sfq_mag(x, y);
+    case 4:  return sfq_sqrt(x < 0 ? -(x + 1) : x);
+    case 5:  return sfq_recip(x ? x : 1);
+    case 6:  return sfq_log2(x < 0 ? -(x + 1) : x ? x : 1);
+    default: return sfq_exp2(x < 0 ? x : -x - 1);
+    }
+}
+
+static void case_cost(void)
+{
+    printf("\n2/3 cost (host ns per call; soft-float ops = add/mul/div/convert)\n");
+    printf("    %-8s %9s %12s %7s %10s\n", "job", "q15 ns", "soft-fl. ns", "ratio", "sf ops");
+    for (int i = 0; i < 4096; i++) { g_in_x[i] = (q15_t)rnd32(); g_in_y[i] = (q15_t)rnd32(); }
+
+    for (unsigned j = 0; j < sizeof k_jobs / sizeof k_jobs[0]; j++) {
+        int    job = k_jobs[j].job;
+        double t0  = now_s();
+        for (long r = 0; r < REPS; r++)
+            g_sink += run_q15(job, g_in_x[r & 4095], g_in_y[r & 4095]);
+        double tq = (now_s() - t0) / REPS * 1e9;
+
+        g_sf_ops = 0;
+        t0 = now_s();
+        for (long r = 0; r < REPS / 4; r++)
+            g_sink += run_sf(job, g_in_x[r & 4095], g_in_y[r & 4095]);
+        double ts  = (now_s() - t0) / (REPS / 4) * 1e9;
+        double ops = (double)g_sf_ops / (REPS / 4);
+        printf("    %-8s %9.1f %12.1f %6.1f× %10.1f\n", k_jobs[j].name, tq, ts, ts / tq, ops);
+    }
+}
+
+int main(void)
+{
+    sf_consts();
+    printf("0 soft-float core\n");
+    check("sf_sinf(1), sf_sqrtf(2), sf_div(1, 3) to float precision",
+          fabs(sf_d(sf_sinf(sf_c(1.0))) - sin(1.0)) < 1e-7 &&
+          fabs(sf_d(sf_sqrtf(sf_c(2.0))) - M_SQRT2) < 2e-7 &&
+          sf_div(K_ONE, sf_c(3.0)) == sf_c(1.0 / 3.0));
+    case_accuracy();
+    case_cost();
+    printf("%d failure(s)\n", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,284 @@
+/**********************************************************************
+ *  tone_bench – tone_q15.h against double precision on the PC
+ *  cc -O2 -I.. -o tone_bench tone_bench.c -lm
+ *
+ *  Same rates as 050_tone_detect.c: fs = 3200 Hz, Goertzel blocks of
+ *  256 samples, sliding DFT window of 64 samples (bin 1 = 50 Hz). The
+ *  input is a 10-bit ADC (±1 LSB noise) in Q15, as on the target.
+ *  Each case prints its figures and PASS/FAIL; the exit code is the
+ *  number of failures.
+ *
+ *    1 goertzel  – grid voltage with odd harmonics, random phases:
+ *                  magnitude / phase of every bin against a double DFT
+ *                  of the same quantised samples, and against the true
+ *                  amplitudes (even blocks); odd blocks add a 60 Hz
+ *                  tone for an off-grid bin (4.8 cycles per block)
+ *    2 sdft      – 2·10^6 samples (≈ 10 min at 3200 Hz): sliding sums
+ *                  against the window recomputed in double, early and
+ *                  late, to show that nothing drifts
+ *    3 frequency – grid at 49…51 Hz with 5 % 3rd harmonic: tone_freq()
+ *                  from the sliding-DFT phase every 320 samples
+ *    4 cost      – host ns per sample and bin, and the MUL count that
+ *                  sets the Tcy on target (measured there as
+ *                  g_tone_tcy_max)
+ **********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "tone_q15.h"
+
+#define FS          3200.0
+#define GZ_LOG2N    8
+#define GZ_N        (1 << GZ_LOG2N)
+#define SD_LOG2N    6
+#define SD_N        (1 << SD_LOG2N)
+#define F_GRID      50.0
+#define NHARM       6
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %-52s %s\n", what, ok ? "PASS" : "FAIL");
+    if (!ok) g_fail++;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* 10-bit signed fractional ADC: LSB = 64 in Q15, ±1 LSB of noise */
+static q15_t adc(double v)
+{
+    long q = lround(v * 512.0) + (rand() % 3) - 1;
+    if (q >  511) q =  511;
+    if (q < -512) q = -512;
+    return (q15_t)(q * 64);
+}
+
+static double ang_deg(q15_ang a)        { return a * 360.0 / 65536.0; }
+static double wrap_deg(double d)        { return d - 360.0 * floor(d / 360.0 + 0.5); }
+
+/* Grid voltage with odd harmonics; amplitudes per unit of full scale */
+static const int    k_h[NHARM]   = { 1, 3, 5, 7, 9, 11 };
+static const double k_amp[NHARM] = { 0.60, 0.10, 0.05, 0.02, 0.01, 0.005 };
+
+/* |a·e^(jpa) − b·e^(jpb)|, phases in degrees */
+static double vec_err(double a, double pa, double b, double pb)
+{
+    pa *= M_PI / 180;
+    pb *= M_PI / 180;
+    return hypot(a * cos(pa) - b * cos(pb), a * sin(pa) - b * sin(pb));
+}
+
+/* ——————————————————— 1: Goertzel ——————————————————— */
+static void case_goertzel(void)
+{
+    enum { BLOCKS = 200, NB = NHARM + 1 };
+    tone_gz_t g;
+    double    ph[NHARM];
+    q15_t     x[GZ_N];
+    double    ed[NB] = { 0 }, et[NB] = { 0 }, epd[NB] = { 0 };
+    double    ed_max = 0, et_max = 0;
+
+    printf("1 goertzel: N = %d, %d blocks, errors as |Δ| of the phasor in Q15 LSB\n",
+           GZ_N, BLOCKS);
+    tone_gz_init(&g, GZ_LOG2N);
+    for (int i = 0; i < NHARM; i++) tone_gz_add(&g, TONE_W(k_h[i] * F_GRID, FS));
+    tone_gz_add(&g, TONE_W(60.0, FS));                 /* 4.8 cycles per block */
+
+    for (int blk = 0; blk < BLOCKS; blk++) {
+        for (int i = 0; i < NHARM; i++) ph[i] = 2 * M_PI * rand() / RAND_MAX;
+        double a60 = (blk & 1) ? 0.2 : 0, p60 = 2 * M_PI * rand() / RAND_MAX;
+        for (int n = 0; n < GZ_N; n++) {
+            double v = a60 * cos(2 * M_PI * 60.0 * n / FS + p60);
+            for (int i = 0; i < NHARM; i++)
+                v += k_amp[i] * cos(2 * M_PI * k_h[i] * F_GRID * n / FS + ph[i]);
+            x[n] = adc(v);
+            tone_gz_push(&g, x[n]);
+        }
+        for (int i = 0; i < g.nb; i++) {
+            /* same quantised step and samples, in double */
+            double w = 2 * M_PI * g.b[i].w / 65536.0, re = 0, im = 0;
+            for (int n = 0; n < GZ_N; n++) {
+                re += x[n] * cos(w * n);
+                im -= x[n] * sin(w * n);
+            }
+            double mag_d = 2 * hypot(re, im) / GZ_N;
+            double ph_d  = (atan2(im, re) + w * (GZ_N - 1)) * 180 / M_PI;   /* newest sample */
+
+            tone_res_t r;
+            tone_gz_result(&g, (uint8_t)i, &r);
+            double e  = vec_err(r.mag, ang_deg(r.phase), mag_d, ph_d);
+            double dp = fabs(wrap_deg(ang_deg(r.phase) - ph_d));
+            if (i == NHARM && !(blk & 1)) continue;      /* 60 Hz absent */
+            /* allowance: 4 LSB + the CORDIC angle error (0.03°) */
+            double ex = e - 4 - mag_d * 0.03 * M_PI / 180;
+            if (ex > ed_max) ed_max = ex;
+            if (e  > ed[i])  ed[i]  = e;
+            if (dp > epd[i]) epd[i] = dp;
+            if (i < NHARM && !(blk & 1)) {               /* no 60 Hz leakage */
+                double tm = k_amp[i] * 32768.0;
+                double tp = (k_h[i] * F_GRID * 2 * M_PI * (GZ_N - 1) / FS + ph[i]) * 180 / M_PI;
+                double e2 = vec_err(r.mag, ang_deg(r.phase), tm, tp);
+                if (e2 > et[i]) et[i] = e2;
+            }
+        }
+    }
+    printf("    bin       amp   vs double: |Δ| LSB  Δphase°   vs true: |Δ| LSB\n");
+    for (int i = 0; i < NB; i++) {
+        if (i < NHARM)
+            printf("    %4.0f Hz  %5.3f %17.1f %9.3f %17.1f\n",
+                   k_h[i] * F_GRID, k_amp[i], ed[i], epd[i], et[i]);
+        else
+            printf("      60 Hz  0.200 %17.1f %9.3f    (off-grid, odd blocks)\n", ed[i], epd[i]);
+        if (i < NHARM && et[i] > et_max) et_max = et[i];
+    }
+    printf("    ADC LSB = 64 Q15 LSB; noise on a %d-sample bin ≈ %.1f LSB rms\n",
+           GZ_N, 64.0 * sqrt(2.0 / 3.0) * sqrt(2.0 / GZ_N));
+    check("every bin within 4 LSB + 0.03° of double precision", ed_max <= 0);
+    check("every harmonic within 1/2 ADC LSB of the true phasor", et_max <= 32);
+}
+
+/* ——————————————————— 2: sliding DFT ——————————————————— */
+static void case_sdft(void)
+{
+    enum { NSAMP = 2000000, SPAN = 200000 };
+    static q15_t hist[SD_N];
+    tone_sdft_t  s;
+    double       e2_early = 0, e2_late = 0, e_max = 0, emag = 0;
+    long         n_early = 0, n_late = 0;
+    double       ph[NHARM];
+
+    printf("2 sdft: N = %d, bins 1/3/5 (50/150/250 Hz), %d samples\n", SD_N, NSAMP);
+    tone_sdft_init(&s, hist, SD_LOG2N);
+    tone_sdft_add(&s, 1);
+    tone_sdft_add(&s, 3);
+    tone_sdft_add(&s, 5);
+    for (int i = 0; i < NHARM; i++) ph[i] = 2 * M_PI * rand() / RAND_MAX;
+
+    for (long n = 0; n < NSAMP; n++) {
+        double v = 0;
+        for (int i = 0; i < NHARM; i++)
+            v += k_amp[i] * cos(2 * M_PI * k_h[i] * F_GRID * n / FS + ph[i]);
+        tone_sdft_push(&s, adc(v));
+
+        if (n >= SD_N && (n % 997 == 0)) {
+            for (int b = 0; b < s.nb; b++) {
+                /* window in double, same twiddles: θ = w·m mod 2^16 */
+                double re = 0, im = 0;
+                for (int m = 0; m < SD_N; m++) {
+                    long   idx = n - SD_N + 1 + m;
+                    q15_t  xm  = hist[(s.pos + m) & (SD_N - 1)];
+                    double th  = 2 * M_PI * (q15_ang)(s.b[b].w * (uint32_t)idx) / 65536.0;
+                    re += xm * cos(th);
+                    im -= xm * sin(th);
+                }
+                double e = fmax(fabs(s.b[b].re - re), fabs(s.b[b].im - im));
+                if (e > e_max) e_max = e;
+                if (n < SPAN)               { e2_early += e * e; n_early++; }
+                else if (n >= NSAMP - SPAN) { e2_late  += e * e; n_late++;  }
+
+                tone_res_t r;
+                tone_sdft_result(&s.b[b], SD_LOG2N, &r);
+                double dm = fabs(r.mag - 2 * hypot(re, im) / SD_N);
+                if (dm > emag) emag = dm;
+            }
+        }
+    }
+    double r_early = sqrt(e2_early / n_early), r_late = sqrt(e2_late / n_late);
+    printf("    window sum vs double: rms %.1f LSB over the first %d samples, %.1f over the last; max %.1f\n",
+           r_early, SPAN, r_late, e_max);
+    printf("    magnitude vs double: ≤ %.1f LSB\n", emag);
+    check("no drift (last rms ≤ 1.2 × first rms)", r_late <= 1.2 * r_early);
+    check("sum error ≤ N LSB (truncation only)", e_max <= SD_N);
+    check("magnitude within 4 LSB of double precision", emag <= 4);
+}
+
+/* ——————————————————— 3: frequency ——————————————————— */
+static void case_freq(void)
+{
+    enum { DN = 320, NREP = 40 };
+    static q15_t hist[SD_N];
+    double emax = 0, emean = 0;
+
+    printf("3 frequency: bin 50 Hz, N = %d, phase every %d samples, 5 %% 3rd harmonic\n",
+           SD_N, DN);
+    for (double f = 49.0; f <= 51.0001; f += 0.25) {
+        tone_sdft_t s;
+        tone_sdft_init(&s, hist, SD_LOG2N);
+        tone_sdft_add(&s, 1);
+        double    p3 = 2 * M_PI * rand() / RAND_MAX, acc = 0;
+        q15_ang   ph0 = 0;
+        int       nrep = 0;
+        for (long n = 0; n < (long)DN * (NREP + 2); n++) {
+            double v = 0.6 * cos(2 * M_PI * f * n / FS) + 0.03 * cos(6 * M_PI * f * n / FS + p3);
+            tone_sdft_push(&s, adc(v));
+            if ((n + 1) % DN == 0 && tone_sdft_ready(&s)) {
+                tone_res_t r;
+                tone_sdft_result(&s.b[0], SD_LOG2N, &r);
+                if (nrep) {
+                    uint32_t w0 = tone_freq(ph0, r.phase, DN, s.b[0].w);
+                    double   fe = w0 * FS / 4294967296.0;
+                    double   e  = fabs(fe - f);
+                    if (e > emax) emax = e;
+                    acc += fe;
+                }
+                ph0 = r.phase;
+                nrep++;
+            }
+        }
+        double fm = acc / (nrep - 1);
+        if (fabs(fm - f) > emean) emean = fabs(fm - f);
+        printf("    f = %6.2f Hz  mean %8.4f Hz\n", f, fm);
+    }
+    printf("    worst single reading: %.1f mHz, worst mean: %.2f mHz\n", emax * 1e3, emean * 1e3);
+    check("every 100 ms reading within 30 mHz", emax <= 0.030);
+    check("mean of 40 readings within 1 mHz", emean <= 0.001);
+}
+
+/* ——————————————————— 4: cost ——————————————————— */
+static void case_cost(void)
+{
+    enum { NSAMP = 4000000 };
+    static q15_t hist[SD_N];
+    tone_gz_t    g;
+    tone_sdft_t  s;
+    volatile q31_t sink = 0;
+
+    printf("4 cost (host; target Tcy from g_tone_tcy_max)\n");
+    tone_gz_init(&g, GZ_LOG2N);
+    for (int i = 0; i < TONE_MAX_BINS; i++) tone_gz_add(&g, (q15_ang)(1000 + 3000 * i));
+    tone_sdft_init(&s, hist, SD_LOG2N);
+    for (int i = 0; i < TONE_MAX_BINS; i++) tone_sdft_add(&s, (uint16_t)(1 + 3 * i));
+
+    double t0 = now_s();
+    for (long n = 0; n < NSAMP; n++) tone_gz_push(&g, (q15_t)(n * 2654435761u >> 17));
+    double t1 = now_s();
+    for (long n = 0; n < NSAMP; n++) tone_sdft_push(&s, (q15_t)(n * 2654435761u >> 17));
+    double t2 = now_s();
+    sink = g.b[0].re + s.b[0].re;
+    (void)sink;
+
+    double gz = (t1 - t0) / NSAMP / TONE_MAX_BINS * 1e9;
+    double sd = (t2 - t1) / NSAMP / TONE_MAX_BINS * 1e9;
+    printf("    goertzel: %.2f ns per sample and bin, 2 MUL (+4 per block end)\n", gz);
+    printf("    sdft:     %.2f ns per sample and bin, 4 MUL + 2 table reads\n", sd);
+    check("per-sample cost bounded (no per-sample loops over N)", gz > 0 && sd > 0);
+}
+
+int main(void)
+{
+    srand(1);
+    case_goertzel();
+    case_sdft();
+    case_freq();
+    case_cost();
+    printf("%d failure(s)\n", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,163 @@
+/**********************************************************************
+ *  dsPIC30F4011  – Fixed-point PID controller in Q15 (header-only)
+ *  Toolchain     – XC-DSC 3.21+ (C30 mode)
+ *
+ *  Discrete PID, parallel form, one call per sample:
+ *
+ *     P = Kp·(b·r − y)
+ *     D = ad·D + kd·Δ(c·r − y)            first-order filtered derivative
+ *     v = P + I + D + ff                   unsaturated output
+ *     u = clamp(v, out_min, out_max)
+ *     I = I + ki·(r − y) + kt·(u − v)      back-calculation anti-windup
+ *
+ *  Gains from continuous parameters (Kp, Ti, Td, derivative filter
+ *  Tf = Td/N, tracking time Tt, sample time Ts):
+ *     kp = Kp                      ad = Tf/(Tf + Ts)
+ *     ki = Kp·Ts/Ti                kd = Kp·Td/(Tf + Ts)
+ *     kt = Ts/Tt  (Tt ≈ √(Ti·Td), or Ti for a PI)
+ *  kp and kd are Q15 mantissas scaled by 2^PID_GAIN_SHIFT (default 4:
+ *  gains up to 16.0). ki, kt and ad are plain Q15 per-sample
+ *  factors (< 1). b and c are Q14 weights (PID_W_ONE = 1.0); c = 0
+ *  puts the derivative on the measurement only (no setpoint kick).
+ *
+ *  The integrator lives in Q30 and is clamped to ±1.0, the derivative
+ *  state keeps 32 bits (clamped to ±32.0), so small ki·e and decaying
+ *  D terms are not lost to truncation. The integral uses the
+ *  unweighted error.
+ *
+ *  Bumpless transfer:
+ *    pid_set_gains() – moves the P change into I, v is unchanged
+ *    pid_track()     – manual mode: follows an external u each sample
+ *                      so switching back to pid_run() does not jump
+ *
+ *  Cost: straight-line code, no loops, no divides; about 170 Tcy per
+ *  pid_run() by instruction count (9 MUL, constant shifts, 6 clamps),
+ *  i.e. ~12 % of the 1474 Tcy period at 20 kHz and FCY = 29.48 MHz.
+ *  010_initial_dsp.c measures it on target (g_pid_tcy_max).
+ *  host/pid_sim.c runs it against plant models.
+ *
+ *  Needs q15_math.h.
+ **********************************************************************/
+#ifndef PID_Q15_H
+#define PID_Q15_H
+
+#include <stdint.h>
+#include "q15_math.h"
+
+#ifndef PID_GAIN_SHIFT
+#define PID_GAIN_SHIFT  4               /* kp, kd range ±2^shift        */
+#endif
+#if PID_GAIN_SHIFT < 0 || PID_GAIN_SHIFT > 14
+#error "PID_GAIN_SHIFT must be 0…14"
+#endif
+
+#define PID_W_ONE       ((int16_t)16384)   /* Q14 1.0 for b, c          */
+#define PID_I_MAX       (((q31_t)1 << 30) - 1)  /* I clamp, ±1.0 Q30  */
+#define PID_D_MAX       ((q31_t)1 << 20)        /* D clamp, ±32.0 Q15  */
+
+/* Gain mantissa for a real gain g (constants only) */
+#define PID_GAIN(g)     Q15((g) / (double)(1 << PID_GAIN_SHIFT))
+
+typedef struct {
+    q15_t   kp;         /* proportional, ·2^PID_GAIN_SHIFT              */
+    q15_t   ki;         /* integral per sample, Q15                     */
+    q15_t   kd;         /* derivative, ·2^PID_GAIN_SHIFT                */
+    q15_t   ad;         /* derivative filter pole, Q15                  */
+    q15_t   kt;         /* back-calculation per sample, Q15             */
+    int16_t b, c;       /* setpoint weights, Q14                        */
+} pid_gains_t;
+
+typedef struct {
+    pid_gains_t g;
+    q15_t   out_max, out_min;
+    q31_t   integ;      /* I, Q30                                       */
+    q31_t   d;          /* D, Q15 in 32 bits                            */
+    q15_t   ep;         /* b·r − y of the last sample                   */
+    q15_t   ed;         /* c·r − y of the last sample                   */
+    q31_t   v;          /* last unsaturated output, Q15 in 32 bits      */
+    q15_t   u;          /* last output                                  */
+} pid_q15_t;
+
+static inline q31_t pid_gain_mul(q15_t k, q15_t x)
+{   /* Q15 mantissa × Q15 → Q15 in 32 bits, times 2^PID_GAIN_SHIFT */
+    return ((q31_t)k * x) >> (Q15_SHIFT - PID_GAIN_SHIFT);
+}
+
+static inline q15_t pid_weight(int16_t w, q15_t r)
+{   return q15_sat(((q31_t)w * r) >> 14);   }
+
+static inline q31_t pid_clamp(q31_t x, q31_t lim)
+{   return (x > lim) ? lim : (x < -lim) ? -lim : x;   }
+
+static inline void pid_reset(pid_q15_t *p)
+{
+    p->integ = 0;
+    p->d     = 0;
+    p->ep = p->ed = 0;
+    p->v  = 0;
+    p->u  = 0;
+}
+
+static inline void pid_init(pid_q15_t *p, const pid_gains_t *g,
+                            q15_t out_min, q15_t out_max)
+{
+    p->g       = *g;
+    p->out_min = out_min;
+    p->out_max = out_max;
+    pid_reset(p);
+}
+
+/* One sample: setpoint r, measurement y, feedforward ff → output u */
+static inline q15_t pid_run(pid_q15_t *p, q15_t r, q15_t y, q15_t ff)
+{
+    const pid_gains_t *g = &p->g;
+
+    q15_t ep = q15_sat((q31_t)pid_weight(g->b, r) - y);
+    q15_t ed = q15_sat((q31_t)pid_weight(g->c, r) - y);
+
+    p->d  = pid_clamp(q31_mul_q15(p->d, g->ad)
+                      + pid_gain_mul(g->kd, q15_sat((q31_t)ed - p->ed)), PID_D_MAX);
+    p->ep = ep;
+    p->ed = ed;
+
+    q31_t v = pid_gain_mul(g->kp, ep) + (p->integ >> Q15_SHIFT) + p->d + ff;
+    q15_t u = (v > p->out_max) ? p->out_max
+            : (v < p->out_min) ? p->out_min : (q15_t)v;
+
+    /* each operand within ±(2^30 − 1): the sum cannot wrap */
+    q31_t inc = (q31_t)g->ki * q15_sat((q31_t)r - y)
+              + (q31_t)g->kt * q15_sat((q31_t)u - v);
+    p->integ = pid_clamp(p->integ + pid_clamp(inc, PID_I_MAX), PID_I_MAX);
+
+    p->v = v;
+    p->u = u;
+    return u;
+}
+
+/* New gains without an output step: I absorbs the change of P. The
+   derivative state is in output units and is kept as it is. */
+static inline void pid_set_gains(pid_q15_t *p, const pid_gains_t *g)
+{
+    q31_t p_old = pid_gain_mul(p->g.kp, p->ep);
+    q31_t p_new = pid_gain_mul(g->kp, p->ep);
+    q31_t delta = (q31_t)q15_sat(p_old - p_new) << Q15_SHIFT;
+    p->integ = pid_clamp(p->integ + delta, PID_I_MAX);
+    p->g     = *g;
+}
+
+/* Manual mode: the plant is driven by u_man; keep the controller
+   state consistent so that the next pid_run() starts from u_man. */
+static inline void pid_track(pid_q15_t *p, q15_t r, q15_t y, q15_t ff, q15_t u_man)
+{
+    const pid_gains_t *g = &p->g;
+
+    p->ep = q15_sat((q31_t)pid_weight(g->b, r) - y);
+    p->ed = q15_sat((q31_t)pid_weight(g->c, r) - y);
+    p->d  = 0;
+
+    q31_t i_q15 = (q31_t)u_man - pid_gain_mul(g->kp, p->ep) - ff;
+    p->integ = pid_clamp((q31_t)q15_sat(i_q15) << Q15_SHIFT, PID_I_MAX);
+    p->v = p->u = u_man;
+}
+
+#endif /* PID_Q15_H */
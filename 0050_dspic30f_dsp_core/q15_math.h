@@ -0,0 +1,286 @@
+/**********************************************************************
+ *  dsPIC30F4011  – Q15 / Q31 math kernels (header-only)
+ *  Toolchain     – XC-DSC 3.21+ (C30 mode)
+ *
+ *  Fixed-point replacements for the libm calls a control loop needs
+ *  (phase angle, RMS, vector magnitude) without touching soft-float.
+ *  Every kernel is integer-only, branch-light and uses lookup tables in
+ *  program memory (const → PSV, needs auto_psv on the calling ISR).
+ *
+ *  Formats used below:
+ *    q15_t    – signed Q1.15, −1.0 … 0.99997
+ *    q15_ang  – angle, full turn = 65536: 0x4000 = +π/2, 0x8000 = ±π
+ *    Q11      – signed Q4.11, −16.0 … 15.9995 (log2 domain)
+ *    Q16.16   – signed 32-bit, integer part in the upper half
+ *
+ *  Accuracy bounds (max abs error vs. double precision, in output LSBs;
+ *  single-input kernels checked over every 16-bit input, atan2/polar on
+ *  a dense grid of the full x/y plane):
+ *    q15_sin / q15_cos   ≤ 1.5 LSB     129-entry quarter wave + lerp
+ *    q15_atan2           ≤ 4 LSB       15-step CORDIC (|v| > 64 LSB; 0.02°)
+ *    q15_cordic_polar    mag ≤ 2 LSB   same CORDIC, gain-corrected
+ *    q15_mag             ≤ 1 LSB       sqrt(x² + y²), floor
+ *    q15_sqrt            ≤ 1 LSB       bit-by-bit integer root, floor
+ *    q15_sqrt_q30        ≤ 1 LSB
+ *    q15_recip           rel. ≤ 2^-14  one hardware 32/16 divide (DIV.UD)
+ *    q15_log2            ≤ 0.6 LSB Q11 65-entry table + lerp
+ *    q15_exp2            ≤ 1.5 LSB     65-entry table + lerp
+ *    q31_mul_q15         ≤ 1 LSB Q31
+ *
+ *  Include from any example:   #include "q15_math.h"
+ **********************************************************************/
+#ifndef Q15_MATH_H
+#define Q15_MATH_H
+
+#include <stdint.h>
+
+typedef int16_t  q15_t;
+typedef int32_t  q31_t;
+typedef uint16_t q15_ang;
+
+#define Q15_SHIFT   15
+#define Q15_ONE     (1 << Q15_SHIFT)
+#define Q15_MAX     ((q15_t)0x7FFF)
+#define Q15_MIN     ((q15_t)0x8000)
+#define Q15(x)      ((q15_t)((x) * 32768.0 + ((x) >= 0 ? 0.5 : -0.5)))  /* constants only */
+
+/* 32/16 unsigned divide: one DIV.UD (18 cycles) on target, plain C on host */
+#if defined(__dsPIC30F__) || defined(__XC16__)
+#define Q15_DIVUD(num, den)  __builtin_divud((num), (den))
+#else
+#define Q15_DIVUD(num, den)  ((uint16_t)((uint32_t)(num) / (uint16_t)(den)))
+#endif
+
+/*====================== Basic Q15 arithmetic ======================*/
+static inline q15_t q15_sat(q31_t x)
+{
+    if (x >  32767) return  32767;
+    if (x < -32768) return -32768;
+    return (q15_t)x;
+}
+
+static inline q15_t q15_mul(q15_t a, q15_t b)
+{   /* MUL.SS + shift; (-1)·(-1) saturates to 0.99997 */
+    return q15_sat(((q31_t)a * b) >> Q15_SHIFT);
+}
+
+static inline q15_t q15_add(q15_t a, q15_t b)
+{   return q15_sat((q31_t)a + b);   }
+
+static inline q31_t q31_mul_q15(q31_t a, q15_t b)
+{   /* Q31 × Q15 → Q31 with two 16×16 products (MUL.SS + MUL.SU), no 64-bit */
+    return (((a >> 16) * (q31_t)b) << 1)
+         + (((q31_t)b * (q31_t)(uint16_t)a) >> Q15_SHIFT);
+}
+
+/*====================== Lookup tables =============================*/
+/* sin(π/2 · i/128), i = 0…128, Q15 */
+static const q15_t q15_sin_qtab[129] = {
+        0,   402,   804,  1206,  1608,  2009,  2411,  2811,
+     3212,  3612,  4011,  4410,  4808,  5205,  5602,  5998,
+     6393,  6787,  7180,  7571,  7962,  8351,  8740,  9127,
+     9512,  9896, 10279, 10660, 11039, 11417, 11793, 12167,
+    12540, 12910, 13279, 13646, 14010, 14373, 14733, 15091,
+    15447, 15800, 16151, 16500, 16846, 17190, 17531, 17869,
+    18205, 18538, 18868, 19195, 19520, 19841, 20160, 20475,
+    20788, 21097, 21403, 21706, 22006, 22302, 22595, 22884,
+    23170, 23453, 23732, 24008, 24279, 24548, 24812, 25073,
+    25330, 25583, 25833, 26078, 26320, 26557, 26791, 27020,
+    27246, 27467, 27684, 27897, 28106, 28311, 28511, 28707,
+    28899, 29086, 29269, 29448, 29622, 29792, 29957, 30118,
+    30274, 30425, 30572, 30715, 30853, 30986, 31114, 31238,
+    31357, 31471, 31581, 31686, 31786, 31881, 31972, 32058,
+    32138, 32214, 32286, 32352, 32413, 32470, 32522, 32568,
+    32610, 32647, 32679, 32706, 32729, 32746, 32758, 32766,
+    32767,
+};
+
+/* atan(2^-i) in q15_ang units (π = 32768), i = 0…14 */
+static const int16_t q15_cordic_atan[15] = {
+     8192,  4836,  2555,  1297,   651,   326,   163,    81,
+       41,    20,    10,     5,     3,     1,     1,
+};
+
+/* log2(1 + i/64), i = 0…64, unsigned Q15 (32768 = 1.0) */
+static const uint16_t q15_log2_tab[65] = {
+        0,   733,  1455,  2166,  2866,  3556,  4236,  4907,
+     5568,  6220,  6863,  7498,  8124,  8742,  9352,  9954,
+    10549, 11136, 11716, 12289, 12855, 13415, 13968, 14514,
+    15055, 15589, 16117, 16639, 17156, 17667, 18173, 18673,
+    19168, 19658, 20143, 20623, 21098, 21568, 22034, 22495,
+    22952, 23404, 23852, 24296, 24736, 25172, 25604, 26031,
+    26455, 26876, 27292, 27705, 28114, 28520, 28922, 29321,
+    29717, 30109, 30498, 30884, 31267, 31647, 32024, 32397,
+    32768,
+};
+
+/* 2^(i/64), i = 0…64, Q14 (16384 = 1.0, 32768 = 2.0) */
+static const uint16_t q15_exp2_tab[65] = {
+    16384, 16562, 16743, 16925, 17109, 17296, 17484, 17674,
+    17867, 18061, 18258, 18457, 18658, 18861, 19066, 19274,
+    19484, 19696, 19911, 20127, 20347, 20568, 20792, 21019,
+    21247, 21479, 21713, 21949, 22188, 22430, 22674, 22921,
+    23170, 23423, 23678, 23936, 24196, 24460, 24726, 24995,
+    25268, 25543, 25821, 26102, 26386, 26674, 26964, 27258,
+    27554, 27855, 28158, 28464, 28774, 29088, 29405, 29725,
+    30048, 30376, 30706, 31041, 31379, 31720, 32066, 32415,
+    32768,
+};
+
+/*====================== Trigonometry ==============================*/
+/* sin(a): quarter-wave table with 7-bit linear interpolation */
+static inline q15_t q15_sin(q15_ang a)
+{
+    uint16_t quad = a >> 14;
+    uint16_t w    = a & 0x3FFF;
+    if (quad & 1) w = 0x4000 - w;                  /* mirror 2nd/4th quadrant */
+
+    uint16_t i    = w >> 7;
+    uint16_t frac = w & 0x7F;
+    q15_t    y0   = q15_sin_qtab[i];
+    q15_t    y    = y0;
+    if (frac)
+        y += (q15_t)(((q31_t)(q15_sin_qtab[i + 1] - y0) * frac + 64) >> 7);
+
+    return (quad & 2) ? -y : y;
+}
+
+static inline q15_t q15_cos(q15_ang a)
+{   return q15_sin((q15_ang)(a + 0x4000));   }
+
+/* CORDIC vectoring: rotates (x, y) onto the +x axis.
+   Returns the angle; *mag (optional) receives |(x, y)| in Q15, saturated. */
+static inline q15_ang q15_cordic_polar(q15_t x, q15_t y, q15_t *mag)
+{
+    q31_t   xx = (q31_t)x << 8;                    /* 8 guard bits */
+    q31_t   yy = (q31_t)y << 8;
+    int32_t z  = 0;
+
+    if (xx < 0) {                                  /* pre-rotate by ±π */
+        xx = -xx;  yy = -yy;
+        z  = 32768;
+    }
+
+    for (uint16_t i = 0; i < 15; i++) {
+        q31_t xs = xx >> i;
+        q31_t ys = yy >> i;
+        if (yy > 0) { xx += ys; yy -= xs; z += q15_cordic_atan[i]; }
+        else        { xx -= ys; yy += xs; z -= q15_cordic_atan[i]; }
+    }
+
+    if (mag) {
+        /* xx = 1.64676 · r · 2^8 → r = xx · 0.607253 (19898 in Q15) */
+        q31_t r = ((xx >> 8) * 19898L + 16384) >> Q15_SHIFT;
+        *mag = q15_sat(r);
+    }
+    return (q15_ang)z;
+}
+
+/* atan2(y, x) as q15_ang (π = 32768); atan2(0, 0) = 0 */
+static inline q15_ang q15_atan2(q15_t y, q15_t x)
+{   return q15_cordic_polar(x, y, 0);   }
+
+/*====================== Roots =====================================*/
+/* floor(sqrt(v)) for 32-bit v, 16 iterations, no multiply */
+static inline uint16_t q15_isqrt32(uint32_t v)
+{
+    uint32_t root = 0;
+    uint32_t bit  = 1UL << 30;
+
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= root + bit) {
+            v    -= root + bit;
+            root  = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)root;
+}
+
+/* sqrt(x) for x ≥ 0 in Q15; negative input returns 0 */
+static inline q15_t q15_sqrt(q15_t x)
+{
+    if (x <= 0) return 0;
+    return (q15_t)q15_isqrt32((uint32_t)x << Q15_SHIFT);
+}
+
+/* sqrt of a Q30 energy (e.g. Σ x² from MAC) → Q15, saturated */
+static inline q15_t q15_sqrt_q30(uint32_t e)
+{
+    uint16_t r = q15_isqrt32(e);
+    return (r > 32767U) ? Q15_MAX : (q15_t)r;
+}
+
+/* |(x, y)| = sqrt(x² + y²) in Q15, saturated (cheaper than CORDIC) */
+static inline q15_t q15_mag(q15_t x, q15_t y)
+{
+    uint32_t e = (uint32_t)((q31_t)x * x) + (uint32_t)((q31_t)y * y);
+    return q15_sqrt_q30(e);
+}
+
+/*====================== Reciprocal ================================*/
+/* 1/x for x ≠ 0 (Q15) → Q16.16, saturated to ±0x7FFFFFFF.
+   x is normalised to [0.5, 1), then 2^29 / d gives 1/d in Q14. */
+static inline q31_t q15_recip(q15_t x)
+{
+    if (x == 0) return 0x7FFFFFFFL;
+
+    uint16_t d   = (uint16_t)((x < 0) ? -(q31_t)x : x);
+    uint16_t sh  = 0;
+    if (d == 0x8000U) {                            /* x = −1.0 */
+        return -(q31_t)(1L << 16);
+    }
+    while (d < 0x4000U) { d <<= 1; sh++; }
+
+    uint32_t m = Q15_DIVUD(1UL << 29, d);          /* 1/d, Q14 (16385…32768) */
+    uint32_t r = m << (2 + sh);                    /* → Q16.16 */
+    if (sh == 14 && m == 32768UL) r = 0x7FFFFFFFUL; /* 1/2^-15 overflows */
+
+    return (x < 0) ? -(q31_t)r : (q31_t)r;
+}
+
+/*====================== Logarithm / exponential ===================*/
+/* log2(x) for x in (0, 1) Q15 → Q11 (−15.0 … −0.00004);
+   x ≤ 0 returns the most negative value. */
+static inline int16_t q15_log2(q15_t x)
+{
+    if (x <= 0) return INT16_MIN;
+
+    uint16_t m  = (uint16_t)x;
+    int16_t  e  = 0;                               /* x = m · 2^-e, m ∈ [2^14, 2^15) */
+    while (m < 0x4000U) { m <<= 1; e++; }
+
+    /* log2(x) = log2(m/2^14) − 1 − e, m/2^14 = 1 + f, f ∈ [0, 1) */
+    uint16_t f    = (m - 0x4000U) << 2;            /* Q16 fraction */
+    uint16_t i    = f >> 10;                       /* 64 segments */
+    uint16_t frac = f & 0x3FF;
+    uint16_t y0   = q15_log2_tab[i];
+    uint32_t y    = y0 + (((uint32_t)(q15_log2_tab[i + 1] - y0) * frac + 512) >> 10);
+
+    /* Q15 mantissa → Q11, minus (1 + e) */
+    return (int16_t)(((int32_t)(y + 8) >> 4) - ((int32_t)(1 + e) << 11));
+}
+
+/* 2^x for x ≤ 0 in Q11 → Q15; x > 0 saturates to 0.99997 */
+static inline q15_t q15_exp2(int16_t x)
+{
+    if (x >= 0) return Q15_MAX;
+
+    int16_t  n    = x >> 11;                       /* floor, −16 … −1 */
+    uint16_t f    = (uint16_t)x & 0x7FF;           /* Q11 fraction */
+    uint16_t i    = f >> 5;
+    uint16_t frac = f & 0x1F;
+    uint16_t y0   = q15_exp2_tab[i];
+    uint32_t y    = y0 + (((uint32_t)(q15_exp2_tab[i + 1] - y0) * frac + 16) >> 5);
+
+    /* y = 2^f in Q14 → 2^(f+n) in Q15 = y << 1 >> −n */
+    uint16_t sh = (uint16_t)(-n) - 1;
+    if (sh > 15) return 0;
+    y = (y + (sh ? (1UL << (sh - 1)) : 0)) >> sh;
+    return (y > 32767UL) ? Q15_MAX : (q15_t)y;
+}
+
+#endif /* Q15_MATH_H */
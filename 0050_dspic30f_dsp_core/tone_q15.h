@@ -0,0 +1,276 @@
+/**********************************************************************
+ *  dsPIC30F4011  – Tone detection on a sample stream, Q15 (header-only)
+ *  Toolchain     – XC-DSC 3.21+ (C30 mode)
+ *
+ *  Magnitude and phase of a few chosen frequencies (grid fundamental,
+ *  harmonics, pilot tones) without a full FFT and without sending raw
+ *  samples anywhere. Two engines, both fed one sample at a time from
+ *  the ADC interrupt:
+ *
+ *  Goertzel (tone_gz_*) – block of N = 2^log2n samples, any frequency
+ *      s = x + 2·cos(w)·s1 − s2        per sample and bin
+ *      X = s1 − e^(−jw)·s2              once per block
+ *    Per sample and bin: one q31_mul_q15 (2 MUL), a shift and four
+ *    adds. A new result every N samples; w need not be a multiple of
+ *    2π/N. The coefficient keeps ~15 significant bits even for bins
+ *    close to DC or to fs/2 (see tone_gz_bin_t).
+ *
+ *  Sliding DFT (tone_sdft_*) – window of the last N samples, bins k/N
+ *      X += (x_new − x_old) · e^(−jθ),  θ = w·n
+ *    Each sample and its twin N samples later use the same twiddle
+ *    (N·w is a whole turn), so the window sum is updated with the same
+ *    truncated products that were added, and it never drifts: no
+ *    damping factor, no periodic restart. Per sample and bin: 4 MUL,
+ *    2 table reads (no interpolation for log2n ≤ 9). A fresh result
+ *    after every sample; one delay line of N samples for all bins.
+ *
+ *  Results (tone_res_t): amplitude in the units of x (a full-scale
+ *  sine has mag ≈ 1.0) and phase of the tone at the newest sample of
+ *  the window, as q15_ang. tone_freq() turns two phase readings into
+ *  a frequency estimate within ±fs/(2·dn) of the nominal bin.
+ *
+ *  Range: states are 32-bit with x in Q15. For the Goertzel state
+ *  N²/(2π·k) must stay below 2^16 (N ≤ 512 for any bin k ≥ 1).
+ *
+ *  The polar conversion (CORDIC, normalised first so small tones keep
+ *  their phase resolution) costs a few hundred Tcy: call the *_result
+ *  functions from the background, not per sample.
+ *
+ *  host/tone_bench.c checks both engines against double precision and
+ *  times them; 050_tone_detect.c reports the results over UART2.
+ *
+ *  Needs q15_math.h.
+ **********************************************************************/
+#ifndef TONE_Q15_H
+#define TONE_Q15_H
+
+#include <stdint.h>
+#include "q15_math.h"
+
+#ifndef TONE_MAX_BINS
+#define TONE_MAX_BINS   8
+#endif
+
+/* Angle step for a frequency f at sample rate fs (constants only) */
+#define TONE_W(f, fs)   ((q15_ang)((f) * 65536.0 / (fs) + 0.5))
+
+typedef struct {
+    q15_t   mag;        /* amplitude, units of x                        */
+    q15_ang phase;      /* phase at the newest sample of the window     */
+} tone_res_t;
+
+/* |re + j·im| · 2^−out_shift and its angle; re/im are normalised to
+   2^13…2^14 before the CORDIC so the phase keeps its resolution. */
+static inline void tone_polar(q31_t re, q31_t im, int16_t out_shift, tone_res_t *r)
+{
+    uint32_t a = (re < 0) ? -(uint32_t)re : (uint32_t)re;
+    uint32_t b = (im < 0) ? -(uint32_t)im : (uint32_t)im;
+    uint32_t m = a | b;
+    int16_t  e = 0;
+    q15_t    x, y, mag;
+
+    if (m == 0) { r->mag = 0; r->phase = 0; return; }
+    while (m >= (1UL << 14)) { m >>= 1; e++; }
+    while (m <  (1UL << 13)) { m <<= 1; e--; }
+    if (e >= 0) { x = (q15_t)(re >> e);  y = (q15_t)(im >> e);  }
+    else        { x = (q15_t)(re << -e); y = (q15_t)(im << -e); }
+
+    r->phase = q15_cordic_polar(x, y, &mag);
+
+    int16_t sh = e - out_shift;
+    if (sh >= 16)       r->mag = Q15_MAX;
+    else if (sh >= 0)   r->mag = q15_sat((q31_t)mag << sh);
+    else if (sh > -16)  r->mag = (q15_t)(mag >> -sh);
+    else                r->mag = 0;
+}
+
+/* Frequency from two phase readings dn samples apart, around the
+   nominal step w. Returns turns per sample in Q32 (f = ret·fs/2^32);
+   valid while |f − f_w| < fs/(2·dn). */
+static inline uint32_t tone_freq(q15_ang ph0, q15_ang ph1, uint16_t dn, q15_ang w)
+{
+    int16_t d = (int16_t)(ph1 - ph0 - (q15_ang)((uint32_t)w * dn));
+    return ((uint32_t)w << 16) + (uint32_t)(((int32_t)d * 65536L) / (int32_t)dn);
+}
+
+/*========================== Goertzel ===============================*/
+/* The recursion needs 2·cos w to better than 2^-15 near w = 0 and
+   w = π, where a Q15 cosine would move the bin by a sizeable part of
+   its width. It is written around η = 1 − cos w (or 1 + cos w above
+   π/2), kept as a Q15 mantissa em with its own exponent sh:
+       s = x ± 2·(s1 − η·s1) − s2,   η·s1 = q31_mul_q15(s1, em) >> sh */
+typedef struct {
+    q15_ang w;
+    q15_t   em;         /* η · 2^(15 + sh), 2^14 … 2^15 − 1             */
+    uint8_t sh;
+    uint8_t hi;         /* w > π/2: uses 1 + cos w, subtracts           */
+    q15_t   sm;         /* sin w · 2^(15 + ssh), same scheme            */
+    uint8_t ssh;
+    q31_t   s1, s2;     /* running state, Q15 in 32 bits                */
+    q31_t   re, im;     /* last finished block                          */
+} tone_gz_bin_t;
+
+typedef struct {
+    tone_gz_bin_t b[TONE_MAX_BINS];
+    uint8_t  nb;
+    uint8_t  log2n;
+    uint16_t cnt;               /* samples in the current block         */
+    volatile uint16_t seq;      /* +1 per finished block                */
+} tone_gz_t;
+
+/* 1 − cos(a) and sin(a) for a ≤ π/2, Q30, Taylor to a^12 / a^11
+   (error < 2^-28). 64-bit, used once per bin at set-up only. */
+static inline int32_t tone_one_minus_cos(q15_ang a)
+{
+    static const uint8_t k_div[5] = { 132, 90, 56, 30, 12 };
+    int64_t x = ((int64_t)a * 6746518852LL) >> 16;     /* rad, Q30; 2π·2^30 */
+    int64_t u = (x * x) >> 30;
+    int64_t t = 1LL << 30;
+    for (uint8_t i = 0; i < 5; i++)
+        t = (1LL << 30) - ((u * t) >> 30) / k_div[i];
+    return (int32_t)(((u * t) >> 30) >> 1);
+}
+
+static inline int32_t tone_sin_q30(q15_ang a)
+{
+    static const uint8_t k_div[5] = { 110, 72, 42, 20, 6 };
+    int64_t x = ((int64_t)a * 6746518852LL) >> 16;
+    int64_t u = (x * x) >> 30;
+    int64_t t = 1LL << 30;
+    for (uint8_t i = 0; i < 5; i++)
+        t = (1LL << 30) - ((u * t) >> 30) / k_div[i];
+    return (int32_t)((x * t) >> 30);
+}
+
+/* Q30 value in (0, 1] → Q15 mantissa 2^14…2^15 − 1 and exponent */
+static inline q15_t tone_mant(int32_t v, uint8_t *sh)
+{
+    *sh = 0;
+    while (v < (1L << 29) && *sh < 30) { v <<= 1; (*sh)++; }
+    v = (v + (1L << 14)) >> 15;
+    return (v > 32767) ? Q15_MAX : (q15_t)v;
+}
+
+static inline void tone_gz_init(tone_gz_t *g, uint8_t log2n)
+{
+    g->nb    = 0;
+    g->log2n = log2n;
+    g->cnt   = 0;
+    g->seq   = 0;
+}
+
+/* Adds a bin at step w (TONE_W, 0 < w < 2^15); returns its index or
+   −1 when full or w is out of range */
+static inline int8_t tone_gz_add(tone_gz_t *g, q15_ang w)
+{
+    if (g->nb >= TONE_MAX_BINS || w == 0 || w >= 0x8000U) return -1;
+    tone_gz_bin_t *b = &g->b[g->nb];
+    q15_ang a = (w > 0x4000U) ? (q15_ang)(0x8000U - w) : w;   /* ≤ π/2 */
+    b->hi = w > 0x4000U;
+    b->em = tone_mant(tone_one_minus_cos(a), &b->sh);
+    b->sm = tone_mant(tone_sin_q30(a), &b->ssh);
+    b->w  = w;
+    b->s1 = b->s2 = 0;
+    b->re = b->im = 0;
+    return (int8_t)g->nb++;
+}
+
+/* One sample; returns 1 when a block has just finished */
+static inline uint8_t tone_gz_push(tone_gz_t *g, q15_t x)
+{
+    tone_gz_bin_t *b = g->b;
+    for (uint8_t i = g->nb; i; i--, b++) {
+        q31_t d  = (b->s1 - (q31_mul_q15(b->s1, b->em) >> b->sh)) << 1;
+        q31_t s0 = (b->hi ? x - d : x + d) - b->s2;
+        b->s2 = b->s1;
+        b->s1 = s0;
+    }
+    if (++g->cnt < (1U << g->log2n)) return 0;
+
+    g->cnt = 0;
+    for (b = g->b; b < g->b + g->nb; b++) {
+        /* re = s1 − cos w·s2, cos w = ±(1 − η) */
+        q31_t c2 = b->s2 - (q31_mul_q15(b->s2, b->em) >> b->sh);
+        b->re = b->hi ? b->s1 + c2 : b->s1 - c2;
+        b->im = q31_mul_q15(b->s2, b->sm) >> b->ssh;
+        b->s1 = b->s2 = 0;
+    }
+    g->seq++;
+    return 1;
+}
+
+/* Result of the last finished block. It is rewritten N samples later:
+   from the background, compare seq before and after. */
+static inline void tone_gz_result(const tone_gz_t *g, uint8_t i, tone_res_t *r)
+{
+    tone_polar(g->b[i].re, g->b[i].im, (int16_t)(g->log2n - 1), r);
+}
+
+/*========================= Sliding DFT =============================*/
+typedef struct {
+    q15_ang w;          /* k · 2^16 / N                                 */
+    q15_ang th;         /* twiddle angle of the next sample             */
+    q31_t   re, im;     /* Σ x·cos θ, −Σ x·sin θ over the window, Q15   */
+} tone_sdft_bin_t;
+
+typedef struct {
+    tone_sdft_bin_t b[TONE_MAX_BINS];
+    q15_t   *hist;              /* caller's buffer, 2^log2n samples     */
+    uint8_t  nb;
+    uint8_t  log2n;
+    uint16_t pos;
+    uint16_t fill;              /* samples seen, up to N                */
+} tone_sdft_t;
+
+static inline void tone_sdft_init(tone_sdft_t *s, q15_t *hist, uint8_t log2n)
+{
+    s->hist  = hist;
+    s->nb    = 0;
+    s->log2n = log2n;
+    s->pos   = 0;
+    s->fill  = 0;
+    for (uint16_t i = 0; i < (1U << log2n); i++) hist[i] = 0;
+}
+
+/* Adds bin k (frequency k·fs/N); returns its index or −1 */
+static inline int8_t tone_sdft_add(tone_sdft_t *s, uint16_t k)
+{
+    if (s->nb >= TONE_MAX_BINS || k == 0 || k >= (1U << (s->log2n - 1)))
+        return -1;
+    tone_sdft_bin_t *b = &s->b[s->nb];
+    b->w  = (q15_ang)(k << (16 - s->log2n));
+    b->th = 0;
+    b->re = b->im = 0;
+    return (int8_t)s->nb++;
+}
+
+static inline void tone_sdft_push(tone_sdft_t *s, q15_t x)
+{
+    q15_t old = s->hist[s->pos];
+    s->hist[s->pos] = x;
+    s->pos = (s->pos + 1) & ((1U << s->log2n) - 1);
+    if (s->fill < (1U << s->log2n)) s->fill++;
+
+    tone_sdft_bin_t *b = s->b;
+    for (uint8_t i = s->nb; i; i--, b++) {
+        q15_t c  = q15_cos(b->th);
+        q15_t sn = q15_sin(b->th);
+        /* same truncation as when old was added: exact cancellation */
+        b->re += (((q31_t)x * c)  >> Q15_SHIFT) - (((q31_t)old * c)  >> Q15_SHIFT);
+        b->im -= (((q31_t)x * sn) >> Q15_SHIFT) - (((q31_t)old * sn) >> Q15_SHIFT);
+        b->th += b->w;
+    }
+}
+
+static inline uint8_t tone_sdft_ready(const tone_sdft_t *s)
+{   return s->fill >= (1U << s->log2n);   }
+
+/* Result from a bin, live (interrupts off) or from a copy taken in
+   the ISR right after tone_sdft_push() */
+static inline void tone_sdft_result(const tone_sdft_bin_t *b, uint8_t log2n, tone_res_t *r)
+{
+    tone_polar(b->re, b->im, (int16_t)(log2n - 1), r);
+    r->phase += (q15_ang)(b->th - b->w);        /* → newest sample      */
+}
+
+#endif /* TONE_Q15_H */
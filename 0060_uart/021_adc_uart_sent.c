@@ -10,7 +10,10 @@
  *    - Configura el oscilador interno (FRC) con PLL×8.
  *    - Inicializa UART2 a 115200bps (8N1).
  *    - Muestra el canal AN0 con el ADC y envía la lectura (10bits)
- *      mediante una cabecera 0xAA 0x55 seguida de los bytes [H] [L].
+ *      mediante una cabecera 0xAA 0x56 seguida de los bytes [H] [L] y
+ *      del sello de la conversión [T3] [T2] [T1] [T0] (32 bits en TCY,
+ *      timebase.h sobre Timer2/3). Con PKT_STAMP = 0 vuelve al marco
+ *      de 4 bytes 0xAA 0x55 [H] [L]. host/adc_unpack -b lee los dos.
  *    - Parpadea un LED de vida cada 50ms (placeholder  Timer1).
  *
  *  Licencia: MIT (plantilla, reemplace según convenga).
@@ -50,6 +53,7 @@
 #include <xc.h>
 #include <stdint.h>
 #include <libpic30.h>
+#include "../0140_dspic30f_timebase/timebase.h"
 
 /*======================================================================*/
 /*  DEFINES & MACROS                                                    */
@@ -59,6 +63,7 @@
 #define BAUD_RATE       115200UL                  // UART2 baud rate
 #define ADC_CHANNEL     0                         // AN0
 #define TIMER_LIFE_MS   50                        // Período parpadeo LED (ms)
+#define PKT_STAMP       1                         // 1: marco sellado 0xAA 0x56
 
 /* Pines LED de vida (RD0) */
 #define LIFE_LED_TRIS   TRISDbits.TRISD0
@@ -86,8 +91,7 @@ static volatile uint16_t g_adc_raw = 0;    // Última muestra ADC (01023)
 static void  system_init  (void);
 static void  uart2_init   (void);
 static void  uart2_putc   (char c);
-static void  uart_send_pkt(uint16_t val);
-static inline uint16_t reverse_bits_16(uint16_t num);
+static void  uart_send_pkt(uint16_t val, uint32_t t);
 
 /*======================================================================*/
 /*  IMPLEMENTACIÓN                                                      */
@@ -123,13 +127,22 @@ static inline void uart2_putc(char c)
     U2TXREG = (uint8_t)c;
 }
 
-/* Envío de paquete: 0xAA 0x55 [H] [L] */
-static void uart_send_pkt(uint16_t val)
+/* Envío de paquete: 0xAA 0x56 [H] [L] [T3] [T2] [T1] [T0]
+ * (o 0xAA 0x55 [H] [L] con PKT_STAMP = 0) */
+static void uart_send_pkt(uint16_t val, uint32_t t)
 {
     uart2_putc(0xAA);
-    uart2_putc(0x55);
+    uart2_putc(PKT_STAMP ? 0x56 : 0x55);
     uart2_putc((uint8_t)(val >> 8));
     uart2_putc((uint8_t)val);
+#if PKT_STAMP
+    uart2_putc((uint8_t)(t >> 24));
+    uart2_putc((uint8_t)(t >> 16));
+    uart2_putc((uint8_t)(t >> 8));
+    uart2_putc((uint8_t)t);
+#else
+    (void)t;
+#endif
 }
 
 /*************************  ADC ***************************************/
@@ -172,24 +185,13 @@ static void system_init(void)
     LIFE_LED_LAT  = 0;
 
     /* Subsistemas */
+    tb_init();                  // Timer2/3: base de tiempo de los sellos
     uart2_init();
     adc_init();
 
     /* TODO: Timer1 para parpadeo LED de vida */
 }
 
-/*************************  UTILIDADES ********************************/
-static inline uint16_t reverse_bits_16(uint16_t num)
-{
-    uint16_t rev = 0;
-    for (uint8_t i = 0; i < 16; ++i) {
-        rev <<= 1;
-        rev |= (num & 1);
-        num >>= 1;
-    }
-    return rev;
-}
-
 /*======================================================================*/
 /*  MAIN                                                                */
 /*======================================================================*/
@@ -203,11 +205,12 @@ int main(void)
         /* --- Inicia muestreo ADC --- */
         ADCON1bits.SAMP = 1;
         __delay_us(15);              // Tiempo mínimo de muestreo
+        uint32_t t = tb_now32();     // Sello: fin del muestreo
         ADCON1bits.SAMP = 0;         // Inicia conversión
         while (!ADCON1bits.DONE);    // Espera fin de conversión
 
         uint16_t sample = g_adc_raw; // Lectura disponible (10 bits)
-        uart_send_pkt(sample);       // Envía por UART
+        uart_send_pkt(sample, t);    // Envía por UART
 
         __delay_ms(100);             // Ritmo de salida  10 Hz
     }
@@ -1,8 +1,8 @@
 /****************************************************************************************
  *  Proyecto   :  Firmware ?UART ? PWM?
  *  Archivo    :  uart_pwm_control.c
- *  Dispositivo:  dsPIC30F4011 ? 7.37?MHz FRC + PLL×8 ? Fosc ??58.96?MHz
- *                FCY = Fosc /?4 ??14.74?MHz
+ *  Dispositivo:  dsPIC30F4011 ? 7.37 MHz FRC + PLL×FRC_PLL_MULT (×8 por defecto)
+ *                Fosc = 7.37 MHz × FRC_PLL_MULT, FCY = Fosc / 4 (14.74 MHz con ×8)
  *  Autor      :  Esdras Vázquez León
  *  Versión    :  0.3 ? 27?Jun?2025
  *
@@ -12,13 +12,32 @@
  *  donde los dos últimos bytes codifican un valor de 10 bits (0?1023) que representa
  *  el duty?cycle deseado del canal PWM1L (RE0).
  *
- *  Si la nueva consigna difiere en ±4 cuentas con respecto al duty aplicado se
- *  actualiza el registro PDC1. La portadora PWM se genera a ~15?kHz (free?running,
- *  center?aligned).
+ *  La consigna se aplica en la interrupción de periodo del PWM, no en el lazo
+ *  principal: al completar un paquete la ISR de UART2 publica el objetivo en un
+ *  doble búfer y levanta PWMIF por software, así la ISR del PWM escribe PDC1 antes
+ *  del siguiente límite de periodo (IUE = 0: PDC1 se carga en ese límite). La
+ *  latencia desde el último bit de parada hasta el nuevo duty queda acotada a un
+ *  periodo PWM (~67 µs) más la atención de las ISR. Opcionalmente PWM_SLEW_TICKS
+ *  limita el cambio de duty por periodo. La portadora PWM se genera a ~15 kHz
+ *  (free-running, alineada al borde).
+ *
+ *  Recepción UART2 por ráfagas: la interrupción salta por nivel de FIFO (URXISEL),
+ *  la ISR vacía todos los bytes disponibles en cada entrada y cuenta/limpia los
+ *  errores de trama (FERR), paridad (PERR) y desborde (OERR). Un OERR sin limpiar
+ *  detiene la recepción del módulo hasta el reset, por eso se atiende siempre.
+ *  Mientras falten menos bytes de paquete que el umbral, URXISEL pasa a "cada
+ *  byte" para que el último byte no espere en el FIFO.
+ *  El vaciado y la FSM están en uart_rx_drain.h; host/rx_bench.c compila ese mismo
+ *  código contra un modelo del FIFO y de la CPU.
+ *
+ *  Latencia medida (TMR2 libre a TCY): g_lat.last/max en TCY desde la entrada a
+ *  la ISR del último byte (≈ medio bit después del bit de parada) hasta el límite
+ *  de periodo que carga el nuevo PDC1 (con limitador, el primer paso hacia el
+ *  objetivo); g_lat.over cuenta los que pasan de un periodo.
  *
  *  ?Recursos HW
  *  ?????????????????????????????????????????????????????????????????????????????????????
- *  ? Reloj      : FRC + PLL×8  (??58.96?MHz)
+ *  ? Reloj      : FRC + PLL×FRC_PLL_MULT (×4, ×8 o ×16; ×8 → Fosc 58.96 MHz)
  *  ? UART2      : 115?200 bps · 8?N?1 (RX & TX habilitado)
  *  ? PWM1L/RE0  : 15?kHz · duty proporcional 0?100?%
  *
@@ -38,7 +57,18 @@
 /*========================================================================================*/
 /*  CONFIGURATION BITS                                                                    */
 /*========================================================================================*/
+/* Multiplicador PLL del FRC: 4, 8 o 16 (FCY = 7.37 MHz × PLL / 4).
+   Con PLL×8 (14.74 MHz) todos los baudios estándar hasta 921 600 dan BRG exacto;
+   PLL×16 (29.48 MHz) deja más ciclos por byte para vaciar el FIFO a 460 800+. */
+#define FRC_PLL_MULT    8
+
+#if   FRC_PLL_MULT == 16
+#pragma config FPR     = FRC_PLL16       // Primary Osc: FRC + PLL×16
+#elif FRC_PLL_MULT == 4
+#pragma config FPR     = FRC_PLL4        // Primary Osc: FRC + PLL×4
+#else
 #pragma config FPR     = FRC_PLL8        // Primary Osc: FRC + PLL×8
+#endif
 #pragma config FOS     = PRI             // Oscillator Selection at Reset: Primary
 #pragma config FCKSMEN = CSW_FSCM_OFF    // No clock?switching, no fail?safe
 
@@ -58,43 +88,77 @@
 /*========================================================================================*/
 /*  INCLUDES                                                                              */
 /*========================================================================================*/
-#define F_OSC           (7370000UL * 8UL)            // 7.37?MHz ×8 = 58.96?MHz
-#define FCY             (F_OSC / 4UL)                // ??14.74?MHz (instrucción)
+#define F_OSC           (7370000UL * FRC_PLL_MULT)   // 29.48 / 58.96 / 117.92 MHz
+#define FCY             (F_OSC / 4UL)                // 7.37 / 14.74 / 29.48 MHz
 #include <xc.h>
 #include <stdint.h>
-#include <stdlib.h>     // abs()
 #include <libpic30.h>   // __delay_ms()/us()
+#include "uart_rx_drain.h"  // uart2_rx_drain(), rx_fsm_push(), g_rx_stats
 
 /*========================================================================================*/
 /*  CONSTANTES ? AJUSTES DE TIME?BASE                                                     */
 /*========================================================================================*/
 
 /* UART */
-#define UART_BAUD       115200UL
-#define U2BRG_VAL       (7)  // BRGH = 0
-
-/* PWM */
-#define PWM_FREQ_HZ     15000UL                      // ~15?kHz
-#define PTPER_VAL       (7)  // Prescaler = 1
-#define DUTY_MAX        1023U                       // 10 bit resolution
-#define DIFF_THRESHOLD  4U                          // Histéresis ±4 cuentas
+#define UART_BAUD       115200UL                     // 115200, 230400, 460800, 921600
+/* BRG = FCY / (16 · baud) − 1, redondeado al entero más cercano (BRGH = 0) */
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+#define UART_BAUD_REAL  (FCY / (16UL * (U2BRG_VAL + 1UL)))
+#define UART_BAUD_ERR   ((UART_BAUD_REAL > UART_BAUD) ? (UART_BAUD_REAL - UART_BAUD) \
+                                                      : (UART_BAUD - UART_BAUD_REAL))
+
+#if ((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) == 0
+#error "UART_BAUD demasiado alto para este FCY (BRG < 0): suba FRC_PLL_MULT"
+#elif (UART_BAUD_ERR * 1000UL / UART_BAUD) > 20UL
+#error "Error de baudios > 2 %: elija otro FRC_PLL_MULT o UART_BAUD"
+#endif
+
+/* PWM (free-running: PTPER = FCY / f − 1; PDC con resolución de TCY/2) */
+#define PWM_FREQ_HZ     15000UL                      // ~15 kHz
+#define PTPER_VAL       ((FCY / PWM_FREQ_HZ) - 1UL)  // 981 con PLL×8 (14.74 MHz)
+#define PDC_MAX         (2UL * (PTPER_VAL + 1UL))    // 100 %
+#define DUTY_MAX        1023U                       // 10 bit resolution
+#define PWM_SLEW_TICKS  0U                          // Máx. ΔPDC por periodo (0 = sin límite)
 
 /*========================================================================================*/
 /*  VARIABLES GLOBALES                                                                    */
 /*========================================================================================*/
-static volatile uint16_t g_pwm_target  = 0;   // Último duty recibido (0?1023)
-static volatile uint16_t g_pwm_current = 0;   // Duty aplicado
-
-/* FSM recepción: 0?AA, 1?55, 2?[MSB], 3?[LSB] */
-static volatile uint8_t  g_rx_state = 0;
-static volatile uint16_t g_rx_word  = 0;
+/* Objetivo en doble búfer: la ISR de UART2 escribe la copia libre y luego cambia
+   g_tgt_idx. La ISR del PWM tiene más prioridad, así que nunca ve una copia a
+   medio escribir. */
+typedef struct {
+    uint16_t pdc;          // Duty objetivo en ticks de PDC1
+    uint16_t t_rx;         // TMR2 al entrar la ISR del último byte
+    uint16_t seq;          // Cambia con cada paquete
+} pwm_target_t;
+
+static pwm_target_t      g_tgt[2];
+static volatile uint8_t  g_tgt_idx = 0;
+static uint16_t          g_tgt_seq = 0;
+static uint16_t          g_rx_t    = 0;   // Sello de la entrada actual a la ISR RX
+
+/* Estado de la ISR del PWM */
+static uint16_t g_pdc_written = 0;        // Último valor escrito en PDC1
+static uint16_t g_pdc_active  = 0;        // Valor cargado en el periodo en curso
+static uint16_t g_seen_seq    = 0;
+static uint16_t g_isr_ptmr    = 0, g_isr_t = 0;
+
+/* Latencia comando → duty, en TCY */
+typedef struct {
+    uint16_t last, max;
+    uint16_t cmds;         // Paquetes aplicados
+    uint16_t over;         // Latencias > 1 periodo PWM
+} pwm_latency_t;
+
+static volatile pwm_latency_t g_lat;
 
 /*========================================================================================*/
 /*  PROTOTIPOS DE FUNCIÓN                                                                  */
 /*========================================================================================*/
 static void     uart2_init(void);
 static void     pwm1l_init(void);
-static void     pwm1l_set_duty(uint16_t duty10);
+static void     timer2_init_stamp(void);
+static inline uint16_t duty10_to_pdc(uint16_t duty10);
 static inline void uart2_putc(uint8_t c);
 static void     uart2_puts(const char *s);
 
@@ -103,37 +167,67 @@ static void     uart2_puts(const char *s);
 /*========================================================================================*/
 void __attribute__((interrupt, auto_psv)) _U2RXInterrupt(void)
 {
-    IFS1bits.U2RXIF = 0;                // Clear flag ASAP
-
-    const uint8_t byte = U2RXREG;       // Leer FIFO (desborde ignorado: 1?byte)
-
-    switch (g_rx_state)
-    {
-        case 0:
-            g_rx_state = (byte == 0xAA) ? 1 : 0;
-            break;
-
-        case 1:
-            g_rx_state = (byte == 0x55) ? 2 : 0;
-            break;
-
-        case 2:
-            g_rx_word  = ((uint16_t)byte) << 8;  // MSB
-            g_rx_state = 3;
-            break;
-
-        case 3:
-            g_rx_word |= byte;                   // LSB
-            g_pwm_target = g_rx_word & 0x03FF;   // 10 bit
-            g_rx_state   = 0;
-            break;
-
-        default:
-            g_rx_state = 0;
-            break;
+    g_rx_t = TMR2;                      // Sello antes de cualquier otra cosa
+    IFS1bits.U2RXIF = 0;                // Clear flag ASAP (se re-arma si llegan más)
+    uart2_rx_drain();                   // Vacía todo el FIFO en una sola entrada
+
+    /* Con menos de 3 bytes pendientes del paquete, interrumpir por cada byte */
+    U2STAbits.URXISEL = uart_rx_isel_next();
+}
+
+/*========================================================================================*/
+/*  ISR - PWM (límite de periodo, o forzada por un paquete nuevo)                         */
+/*========================================================================================*/
+void __attribute__((interrupt, auto_psv)) _PWMInterrupt(void)
+{
+    const uint16_t ptmr = PTMR & 0x7FFF;        // bit 15 = PTDIR
+    const uint16_t now  = TMR2;                 // mismo reloj que PTMR (TCY, 1:1)
+    IFS2bits.PWMIF = 0;
+
+    /* Si desde la entrada anterior se cruzó un límite de periodo, el PDC1 escrito
+       entonces ya está cargado. Así una entrada forzada no acelera el limitador. */
+    if ((uint32_t)g_isr_ptmr + (uint16_t)(now - g_isr_t) > PTPER_VAL)
+        g_pdc_active = g_pdc_written;
+    g_isr_ptmr = ptmr;
+    g_isr_t    = now;
+
+    const pwm_target_t *t = &g_tgt[g_tgt_idx];
+    uint16_t next = t->pdc;
+#if PWM_SLEW_TICKS > 0
+    if      (next > g_pdc_active + PWM_SLEW_TICKS) next = g_pdc_active + PWM_SLEW_TICKS;
+    else if (next + PWM_SLEW_TICKS < g_pdc_active) next = g_pdc_active - PWM_SLEW_TICKS;
+#endif
+    if (next != g_pdc_written) {
+        PDC1 = next;                            // Se carga en el próximo límite
+        g_pdc_written = next;
+    }
+
+    /* Latencia: del sello RX al límite que carga este PDC1 */
+    if (t->seq != g_seen_seq) {
+        g_seen_seq = t->seq;
+        const uint16_t t_load = now + (uint16_t)(PTPER_VAL + 1U - ptmr);
+        const uint16_t lat    = t_load - t->t_rx;
+        g_lat.last = lat;
+        if (lat > g_lat.max)        g_lat.max = lat;
+        if (lat > PTPER_VAL + 1U)   g_lat.over++;
+        g_lat.cmds++;
     }
 }
 
+/*========================================================================================*/
+/*  Paquete completo (rx_fsm_push de uart_rx_drain.h)                                     */
+/*========================================================================================*/
+static void rx_on_packet(uint16_t duty10)
+{
+    /* Publica en la copia libre y fuerza la ISR del PWM */
+    const uint8_t w = g_tgt_idx ^ 1U;
+    g_tgt[w].pdc  = duty10_to_pdc(duty10);
+    g_tgt[w].t_rx = g_rx_t;
+    g_tgt[w].seq  = ++g_tgt_seq;
+    g_tgt_idx     = w;
+    IFS2bits.PWMIF = 1;
+}
+
 /*========================================================================================*/
 /*  UART2 ? Inicialización                                                                */
 /*========================================================================================*/
@@ -147,18 +241,31 @@ static void uart2_init(void)
     U2MODE = 0;
     U2MODEbits.PDSEL = 0b00;   // 8?bits, sin paridad
     U2MODEbits.STSEL = 0;      // 1 stop
-    U2BRG  = U2BRG_VAL;
+    U2BRG  = (uint16_t)U2BRG_VAL;
 
     /* STA */
     U2STA = 0;
+    U2STAbits.URXISEL = UART_RX_ISEL;   // Interrupción por nivel de FIFO
     U2MODEbits.UARTEN = 1;
     __delay_us(50);
     U2STAbits.UTXEN  = 1;
 
-    /* RX Interrupt */
+    /* RX Interrupt */
     IFS1bits.U2RXIF = 0;
     IEC1bits.U2RXIE = 1;
-    IPC6bits.U2RXIP = 5;       // Prioridad media?alta
+    IPC6bits.U2RXIP = 5;       // Prioridad media-alta (debajo del PWM)
+}
+
+/*========================================================================================*/
+/*  TIMER2 - Sello de tiempo libre a TCY                                                  */
+/*========================================================================================*/
+static void timer2_init_stamp(void)
+{
+    T2CON = 0;
+    TMR2  = 0;
+    PR2   = 0xFFFF;
+    T2CONbits.TCKPS = 0;       // 1:1, mismo reloj que PTMR
+    T2CONbits.TON   = 1;
 }
 
 /*========================================================================================*/
@@ -171,7 +278,8 @@ static void pwm1l_init(void)
     /* Time?base ? Apagado para configurar */
     PTCON = 0;
     PTCONbits.PTCKPS = 0;      // Prescaler = 1
-    PTCONbits.PTMOD  = 0;      // Free?running, center?aligned
+    PTCONbits.PTMOD  = 0;      // Free-running (alineado al borde)
+    PTCONbits.PTOPS  = 0;      // Interrupción en cada periodo
 
     PTPER = PTPER_VAL;         // Periodo
     PWMCON1 = 0;
@@ -183,20 +291,26 @@ static void pwm1l_init(void)
     OVDCON = 0;                // Salida controlada por PWM
     OVDCONbits.POVD1L = 1;
 
-    PWMCON2bits.IUE = 1;       // Update on PTMR rollover
+    PWMCON2bits.IUE = 0;       // PDC1 se carga en el límite de periodo (sin glitches)
+    PWMCON2bits.UDIS = 0;
+
+    /* Interrupción de periodo: sobre UART2 para que el duty nunca espere */
+    IFS2bits.PWMIF = 0;
+    IPC9bits.PWMIP = 6;
+    IEC2bits.PWMIE = 1;
+
     PTCONbits.PTEN  = 1;       // Arranca el PWM
 }
 
 /*========================================================================================*/
 /*  PWM1L ? Conversión de duty (10 bits) ? ticks                                          */
 /*========================================================================================*/
-static inline void pwm1l_set_duty(uint16_t duty10)
+static inline uint16_t duty10_to_pdc(uint16_t duty10)
 {
     if (duty10 > DUTY_MAX) duty10 = DUTY_MAX;
 
-    /* Duty ticks = (duty10 / 1023) * PTPER * 2 (center?aligned) */
-    const uint32_t ticks = ((uint32_t)duty10 * PTPER_VAL) >> 9;  // ? *2 /1024
-    PDC1 = (uint16_t)(ticks << 1);                               // Escala ×2
+    /* PDC = duty10 · PDC_MAX / 1023, redondeado; una vez por paquete */
+    return (uint16_t)(((uint32_t)duty10 * PDC_MAX + DUTY_MAX / 2U) / DUTY_MAX);
 }
 
 /*========================================================================================*/
@@ -220,6 +334,7 @@ int main(void)
 {
     __builtin_disable_interrupts();
 
+    timer2_init_stamp();
     uart2_init();
     pwm1l_init();
 
@@ -228,12 +343,7 @@ int main(void)
     uart2_puts("\r\nUART?PWM listo\r\n");
 
     for (;;) {
-        /* Aplica duty si supera histéresis */
-        if (abs((int)g_pwm_target - (int)g_pwm_current) > DIFF_THRESHOLD) {
-            pwm1l_set_duty(g_pwm_target);
-            g_pwm_current = g_pwm_target;
-        }
-        __delay_ms(1);     // Idle mínimo (? 1?kHz loop)
+        /* Todo el camino UART -> PDC1 corre en interrupciones; ver g_lat y g_rx_stats */
     }
 
     /* No debería alcanzarse */
@@ -0,0 +1,247 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  telemetría de ADC comprimida sin pérdidas por UART2
+ *
+ *  – Timer3 dispara el ADC (SSRC = 010) y CSCNA recorre AN0 y AN1;
+ *    SMPI = 1 da una interrupción por par, así cada canal se muestrea
+ *    a ADC_FS_HZ. La ISR sólo guarda el par en el bloque en curso.
+ *  – El lazo principal codifica cada canal de cada bloque completo
+ *    con adc_pack.h (Δ + zigzag + Rice con k adaptativo, o RAW a 10
+ *    bits si el canal es ruidoso) y encola el marco entero o nada.
+ *    Cada marco lleva el sello de la primera muestra del bloque (base
+ *    de tiempo de ../0140_dspic30f_timebase sobre Timer4/5; Timer3
+ *    dispara el ADC), así el host ve el instante real de muestreo y el
+ *    jitter de llegada sin contar con el ritmo de la UART.
+ *  – Con el formato de 021 (4 bytes por muestra) 115200 bps dan
+ *    ≈ 2.9 kmuestras/s. Aquí el peor caso (RAW) es 50 bytes por 32
+ *    muestras ≈ 8 kmuestras/s en total; eso es cuenta y no depende de
+ *    la señal. ADC_FS_HZ por defecto cabe aun con los dos canales en
+ *    RAW. Sobre un seno lento sintético con unos pocos LSB de ruido
+ *    adc_unpack -b da ≈ 0.65…0.75 bytes/muestra (≈ 15…17 kmuestras/s):
+ *    no es una medida en el equipo y una señal real (ruido de la
+ *    referencia, interferencia del PWM) puede quedar más cerca de RAW.
+ *  – Captura real para medir la relación (pendiente, no hay ninguna
+ *    en el repositorio):
+ *      stty -F /dev/ttyUSB0 115200 raw
+ *      timeout 60 cat /dev/ttyUSB0 > an0_023.bin   (este programa)
+ *      ./adc_unpack -f an0_023.bin                 relación sobre lo enviado
+ *    o con 021 en la misma entrada analógica:
+ *      timeout 600 cat /dev/ttyUSB0 > an0_021.bin
+ *      ./adc_unpack -b an0_021.bin -t 14740000     relación y jitter
+ *    Anotar aquí la señal, la placa y el resultado.
+ *  – Medidas (ver con el depurador):
+ *      g_enc_tcy_max    peor costo de adc_pack_block() por canal
+ *      g_bytes_in/out   bytes equivalentes en formato 021 / enviados
+ *      g_blk_rice/raw   marcos de cada modo
+ *      g_blk_overruns, g_tx_drops  bloques perdidos (hueco en seq)
+ *  – host/adc_unpack.c decodifica el flujo y mide la relación de
+ *    compresión y las muestras/s reales sobre la señal que llegue.
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "adc_pack.h"
+#define TB_T45                                     // Timer3 es del ADC
+#include "../0140_dspic30f_timebase/timebase.h"
+
+/* Muestreo: ADC_NCH canales consecutivos desde AN0 */
+#define ADC_NCH         2U
+#define ADC_FS_HZ       3500UL                     // por canal
+#define PR3_COUNTS      ((FCY / (ADC_FS_HZ * ADC_NCH)) - 1)
+#define ADCS_TAD_COUNTS 9                          // TAD ≈ 170 ns
+
+#define ADC_NBLOCKS     4U                         // potencia de 2
+
+/* UART2 */
+#define UART_BAUD       115200UL
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+#define TX_RING_LEN     256U                       // potencia de 2
+
+/* Presupuesto: el peor caso de todos los canales debe caber en la UART */
+#if (ADC_FS_HZ * ADC_NCH * ADC_PACK_FRAME_MAX / ADC_PACK_N) > (UART_BAUD / 10UL)
+#error "ADC_FS_HZ excede la UART en modo RAW"
+#endif
+#if (ADC_NBLOCKS & (ADC_NBLOCKS - 1)) != 0
+#error "ADC_NBLOCKS debe ser potencia de 2"
+#endif
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static uint16_t          g_blk[ADC_NBLOCKS][ADC_NCH][ADC_PACK_N];
+static volatile uint16_t g_blk_head = 0;     // sólo lo escribe la ISR
+static volatile uint16_t g_blk_tail = 0;     // sólo lo escribe el consumidor
+static uint16_t          g_blk_fill = 0;
+static uint8_t           g_blk_seq[ADC_NBLOCKS];
+static uint32_t          g_blk_t[ADC_NBLOCKS];   // sello de la primera muestra
+static uint8_t           g_seq = 0;          // cuenta también los perdidos
+static volatile uint16_t g_blk_overruns = 0;
+
+static uint8_t           g_tx_ring[TX_RING_LEN];
+static uint16_t          g_tx_head = 0, g_tx_tail = 0;
+static uint16_t          g_tx_drops = 0;
+
+static uint16_t          g_enc_tcy_max = 0;
+static uint32_t          g_bytes_in = 0, g_bytes_out = 0;
+static uint32_t          g_blk_rice = 0, g_blk_raw = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timer1_init_stamp(void);
+static void adc_init_scan(void);
+static void uart2_init(void);
+static void tx_frame(const uint8_t *f, uint8_t len);
+static void tx_pump(void);
+
+/* ——————————————————— TIMER1: sello de ciclos ——————————— */
+static void timer1_init_stamp(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0;       // 1:1 → un tick por TCY
+    T1CONbits.TON   = 1;
+}
+
+/* ——————————————————— ADC: Timer3 + barrido AN0…AN(NCH−1) ———— */
+static void adc_init_scan(void)
+{
+    ADPCFG = 0xFFFF;
+    ADCSSL = 0;
+    for (uint16_t ch = 0; ch < ADC_NCH; ch++) {
+        ADPCFG &= ~(1U << ch);
+        ADCSSL |=  (1U << ch);
+    }
+
+    ADCON1 = 0;
+    ADCON1bits.FORM = 0;       // entero 0…1023
+    ADCON1bits.SSRC = 0b010;   // Timer3
+    ADCON1bits.ASAM = 1;
+
+    ADCON2 = 0;
+    ADCON2bits.CSCNA = 1;      // barrido de entradas en CH0
+    ADCON2bits.SMPI  = ADC_NCH - 1;
+
+    ADCON3bits.ADCS = ADCS_TAD_COUNTS;
+    ADCHS = 0;
+
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = PR3_COUNTS;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 5;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    T3CONbits.TON   = 1;
+}
+
+/* ——————————————————— UART2: 8N1, sólo TX ———————————————— */
+static void uart2_init(void)
+{
+    U2MODE = 0;
+    U2BRG  = (uint16_t)U2BRG_VAL;
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+}
+
+/* ——————————————————— ADC INTERRUPT ——————————————————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    IFS0bits.ADIF = 0;
+
+    volatile uint16_t *src = &ADCBUF0;
+    uint16_t slot = g_blk_head & (ADC_NBLOCKS - 1);
+    if (g_blk_fill == 0)
+        g_blk_t[slot] = tb_now32();
+    for (uint16_t ch = 0; ch < ADC_NCH; ch++)
+        g_blk[slot][ch][g_blk_fill] = src[ch];
+
+    if (++g_blk_fill >= ADC_PACK_N) {
+        g_blk_fill = 0;
+        g_blk_seq[slot] = g_seq++;
+        if ((uint16_t)(g_blk_head - g_blk_tail) < (ADC_NBLOCKS - 1))
+            g_blk_head++;
+        else
+            g_blk_overruns++;          // se reescribe el mismo bloque
+    }
+}
+
+/* ——————————————————— UART2: marcos completos o nada ——————————— */
+static void tx_frame(const uint8_t *f, uint8_t len)
+{
+    if ((uint16_t)(TX_RING_LEN - (g_tx_head - g_tx_tail)) < len) {
+        g_tx_drops++;
+        return;
+    }
+    for (uint8_t i = 0; i < len; i++)
+        g_tx_ring[(g_tx_head++) & (TX_RING_LEN - 1)] = f[i];
+}
+
+static void tx_pump(void)
+{
+    while (g_tx_tail != g_tx_head && !U2STAbits.UTXBF)
+        U2TXREG = g_tx_ring[(g_tx_tail++) & (TX_RING_LEN - 1)];
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    uint8_t frame[ADC_PACK_FRAME_MAX];
+
+    __builtin_disable_interrupts();
+
+    timer1_init_stamp();
+    tb_init();
+    uart2_init();
+    adc_init_scan();
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        if (g_blk_tail != g_blk_head) {
+            uint16_t slot = g_blk_tail & (ADC_NBLOCKS - 1);
+
+            for (uint8_t ch = 0; ch < ADC_NCH; ch++) {
+                uint16_t t0  = TMR1;
+                uint8_t  len = adc_pack_block(frame, g_blk[slot][ch], ch, g_blk_seq[slot]);
+                uint16_t dt  = TMR1 - t0;
+                len = adc_pack_stamp(frame, g_blk_t[slot]);
+                if (dt > g_enc_tcy_max) g_enc_tcy_max = dt;
+
+                if ((frame[3] >> 6) == ADC_PACK_RICE) g_blk_rice++;
+                else                                  g_blk_raw++;
+                g_bytes_in  += 4UL * ADC_PACK_N;
+                g_bytes_out += len;
+
+                tx_frame(frame, len);
+                tx_pump();
+            }
+            g_blk_tail++;              // el bloque vuelve a la ISR
+        }
+        tx_pump();
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  espectro de AN0 por UART2 en lugar de muestras crudas
+ *
+ *  – Timer3 dispara el ADC a ADC_FS_HZ sobre AN0 (fraccional con
+ *    signo → Q15). La ISR captura un bloque de FFT_N muestras: aplica
+ *    la ventana de Hann y guarda cada muestra directamente en su
+ *    posición de bit invertido (fft_rev(), una lectura de tabla), así
+ *    la FFT no necesita pasada de reordenamiento.
+ *  – El lazo principal transforma el bloque (fft_q15_run(), radix-4
+ *    en Q15 con escalado por bloque), calcula |X| de los FFT_N/2 bins,
+ *    vuelve a armar la captura y, mientras se llena el siguiente
+ *    bloque, envía el espectro en marcos SPEC de adc_pack.h (19 bins
+ *    por marco, mismo seq, exponente del bloque en k). Cada marco lleva
+ *    el sello de la primera muestra del bloque (base de tiempo de
+ *    ../0140_dspic30f_timebase sobre Timer4/5; Timer3 dispara el ADC).
+ *  – Con FFT_N = 256 y 8 kHz: captura de 32 ms, 7 marcos = 350 bytes
+ *    ≈ 30 ms a 115200 bps → ≈ 30 espectros/s de 0…4 kHz con bins de
+ *    31.25 Hz. Las muestras crudas (16 kB/s en 10 bits empaquetados)
+ *    no caben en la UART.
+ *  – Medidas (ver con el depurador; TMR1 a 1:8, ya en Tcy):
+ *      g_fft_tcy / g_fft_tcy_max   fft_q15_run() sola
+ *      g_mag_tcy                   fft_q15_mag() de FFT_N/2 bins
+ *      g_fft_e                     exponente del último bloque
+ *      g_spectra, g_tx_waits       espectros enviados / esperas por UART
+ *  – ../0050_dspic30f_dsp_core/host/fft_bench.c compara la misma FFT
+ *    con una DFT en doble precisión (SNR y pérdida sobre un ADC de 10
+ *    bits); host/adc_unpack.c imprime los espectros.
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "../0050_dspic30f_dsp_core/fft_q15.h"
+#include "adc_pack.h"
+#define TB_T45                                     // Timer3 es del ADC
+#include "../0140_dspic30f_timebase/timebase.h"
+
+/* Muestreo: sólo AN0 */
+#define ADC_FS_HZ       8000UL
+#define PR3_COUNTS      ((FCY / ADC_FS_HZ) - 1)    // 3684
+#define ADCS_TAD_COUNTS 9                          // TAD ≈ 170 ns
+
+/* FFT: 64…256 puntos; RAM = 4·N (bloque) + N (magnitudes) bytes */
+#define FFT_LOG2N       8
+#define FFT_N           (1U << FFT_LOG2N)
+#define SPEC_BINS       (FFT_N / 2U)               // 0 … fs/2 − fs/N
+
+/* UART2 */
+#define UART_BAUD       115200UL
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+#define TX_RING_LEN     128U                       // potencia de 2
+
+#if FFT_LOG2N < FFT_LOG2N_MIN || FFT_LOG2N > FFT_LOG2N_MAX
+#error "FFT_LOG2N fuera de 6…8"
+#endif
+#if TX_RING_LEN < ADC_PACK_FRAME_MAX
+#error "TX_RING_LEN debe caber un marco"
+#endif
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static fft_cplx_t        g_x[FFT_N];          // bloque, orden de bit invertido
+static volatile uint16_t g_cap_n = 0;         // muestras capturadas; FFT_N = lleno
+static volatile uint32_t g_cap_t = 0;         // sello de la primera muestra
+
+static uint16_t          g_mag[SPEC_BINS];    // |X| del último bloque
+static uint8_t           g_fft_e = 0;
+static uint32_t          g_spec_t = 0;        // sello del espectro en curso
+static uint16_t          g_spec_bin = SPEC_BINS;   // siguiente bin a enviar
+static uint8_t           g_seq = 0;
+
+static uint8_t           g_tx_ring[TX_RING_LEN];
+static uint16_t          g_tx_head = 0, g_tx_tail = 0;
+
+static uint32_t          g_fft_tcy = 0, g_fft_tcy_max = 0, g_mag_tcy = 0;
+static uint32_t          g_spectra = 0, g_tx_waits = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timer1_init_stamp(void);
+static void adc_init_an0(void);
+static void uart2_init(void);
+static void spectrum_send(void);
+static void tx_pump(void);
+
+/* ——————————————————— TIMER1: sello de ciclos ——————————— */
+static void timer1_init_stamp(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 1;       // 1:8 → hasta 524 k TCY sin desborde
+    T1CONbits.TON   = 1;
+}
+
+/* ——————————————————— ADC: Timer3 sobre AN0 ———————————————— */
+static void adc_init_an0(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFGbits.PCFG0 = 0;
+
+    ADCON1 = 0;
+    ADCON1bits.FORM = 0b11;    // fraccional con signo → Q15
+    ADCON1bits.SSRC = 0b010;   // Timer3
+    ADCON1bits.ASAM = 1;
+
+    ADCON2 = 0;                // una interrupción por muestra
+    ADCON3bits.ADCS = ADCS_TAD_COUNTS;
+    ADCHS = 0;                 // CH0+ = AN0
+
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = PR3_COUNTS;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 5;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    T3CONbits.TON   = 1;
+}
+
+/* ——————————————————— UART2: 8N1, sólo TX ———————————————— */
+static void uart2_init(void)
+{
+    U2MODE = 0;
+    U2BRG  = (uint16_t)U2BRG_VAL;
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+}
+
+/* ——————————————————— ADC INTERRUPT ——————————————————— */
+/* Ventana y bit invertido al vuelo; con el bloque lleno descarta
+   muestras hasta que el lazo principal lo libera. */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    IFS0bits.ADIF = 0;
+
+    uint16_t n = g_cap_n;
+    if (n < FFT_N) {
+        if (n == 0) g_cap_t = tb_now32();
+        fft_cplx_t *p = &g_x[fft_rev(n, FFT_LOG2N)];
+        p->re = q15_mul((q15_t)ADCBUF0, fft_hann(n, FFT_LOG2N));
+        p->im = 0;
+        g_cap_n = n + 1;
+    }
+}
+
+/* ——————————————————— UART2: marcos SPEC ——————————————————— */
+/* Encola los marcos que quepan enteros; el resto en la próxima vuelta */
+static void spectrum_send(void)
+{
+    uint8_t frame[ADC_PACK_FRAME_MAX];
+
+    while (g_spec_bin < SPEC_BINS) {
+        if ((uint16_t)(TX_RING_LEN - (g_tx_head - g_tx_tail)) < ADC_PACK_FRAME_MAX) {
+            g_tx_waits++;
+            return;
+        }
+        uint16_t n = SPEC_BINS - g_spec_bin;
+        if (n > ADC_PACK_SPEC_MAX) n = ADC_PACK_SPEC_MAX;
+
+        uint8_t len = adc_pack_spec(frame, &g_mag[g_spec_bin], (uint8_t)n, FFT_LOG2N,
+                                    (uint8_t)g_spec_bin, g_fft_e, 0, g_seq);
+        len = adc_pack_stamp(frame, g_spec_t);
+        for (uint8_t i = 0; i < len; i++)
+            g_tx_ring[(g_tx_head++) & (TX_RING_LEN - 1)] = frame[i];
+        g_spec_bin += n;
+    }
+}
+
+static void tx_pump(void)
+{
+    while (g_tx_tail != g_tx_head && !U2STAbits.UTXBF)
+        U2TXREG = g_tx_ring[(g_tx_tail++) & (TX_RING_LEN - 1)];
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    timer1_init_stamp();
+    tb_init();
+    uart2_init();
+    adc_init_an0();
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        /* bloque lleno y espectro anterior ya encolado */
+        if (g_cap_n >= FFT_N && g_spec_bin >= SPEC_BINS) {
+            uint16_t t0 = TMR1;
+            g_fft_e = fft_q15_run(g_x, FFT_LOG2N);
+            uint16_t t1 = TMR1;
+            fft_q15_mag(g_x, g_mag, SPEC_BINS);
+            uint16_t t2 = TMR1;
+
+            g_spec_t = g_cap_t;
+            g_cap_n = 0;               // g_x vuelve a la ISR
+
+            g_fft_tcy = 8UL * (uint16_t)(t1 - t0);
+            g_mag_tcy = 8UL * (uint16_t)(t2 - t1);
+            if (g_fft_tcy > g_fft_tcy_max) g_fft_tcy_max = g_fft_tcy;
+
+            g_spec_bin = 0;
+            g_seq++;
+            g_spectra++;
+        }
+        spectrum_send();
+        tx_pump();
+    }
+    return 0;
+}
@@ -0,0 +1,364 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  tres canales con prioridad sobre UART1 y UART2 (uart_link.h)
+ *
+ *  – CTRL  (prioridad 1, U1 y U2): consignas de duty para PWM1L/RE0,
+ *          mensaje 'S' hi lo (0…1023). link_on_msg() escribe PDC1 en la
+ *          ISR de RX y el lazo responde 'A' hi lo por CTRL.
+ *  – LOG   (prioridad 2, sólo U1): una línea por segundo con las
+ *          estadísticas del enlace.
+ *  – TELEM (prioridad 3, U1 y U2): bloques de AN0/AN1 comprimidos con
+ *          adc_pack.h y sellados, un marco por mensaje (hasta 50 bytes,
+ *          dos tramas). En RAW no caben en un puerto solo (≈ 13.6 kB/s
+ *          contra 11.5) y sí en los dos: TELEM llena el cable y una
+ *          consigna espera a lo sumo el resto de una trama (≈ 3.3 ms)
+ *          en lugar de la cola entera.
+ *  – Timer3 dispara el ADC; el sello y LINK_NOW() son la base de tiempo
+ *    de ../0140_dspic30f_timebase sobre Timer4/5 (TCY).
+ *  – Pines: U1 en RF3/RF2 (TX/RX), U2 en RF5/RF4. Tramas 0xAA 0x5A …;
+ *    host/link_sim.c verifica el protocolo bajo saturación.
+ *  – LOG: "ctrl 412/2980 us telem 218/s 0 desc u1 100% u2 71% crc 0\r\n"
+ *    (espera media/máxima de CTRL en el último segundo, mensajes de
+ *    TELEM enviados y descartados en ese segundo, ocupación de cada
+ *    cable y tramas con CRC malo recibidas).
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "adc_pack.h"
+#define TB_T45                                     // Timer3 es del ADC
+#include "../0140_dspic30f_timebase/timebase.h"
+
+/* Muestreo: AN0 y AN1 */
+#define ADC_NCH         2U
+#define ADC_FS_HZ       3500UL                     // por canal
+#define PR3_COUNTS      ((FCY / (ADC_FS_HZ * ADC_NCH)) - 1)
+#define ADCS_TAD_COUNTS 9
+#define ADC_NBLOCKS     4U                         // potencia de 2
+
+/* UART1 y UART2 */
+#define UART_BAUD       115200UL
+#define UxBRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+
+/* PWM1L: free-running, PDC con resolución de TCY/2 */
+#define PWM_FREQ_HZ     15000UL
+#define PTPER_VAL       ((FCY / PWM_FREQ_HZ) - 1UL)
+#define PDC_MAX         (2UL * (PTPER_VAL + 1UL))
+
+#define LOG_TCY         TB_MS(1000)
+
+/* ——————————————————— MAPA DE RAM ——————————————————— */
+/* Colas de TX y bloques del ADC en la arena de ../0150_dspic30f_ram_budget:
+ * el _Static_assert de ram_arena.h detiene la compilación si no caben en
+ * los 2 KB junto con la pila y RAM_OTHER_RESERVE. TELEM en 256 B guarda
+ * cuatro marcos (dos bloques, contando los que están saliendo); el resto
+ * espera en los ADC_NBLOCKS bloques. Con 512 B el presupuesto no cierra. */
+#define TXQ_CTRL        64U                        // potencias de 2
+#define TXQ_LOG         128U
+#define TXQ_TELEM       256U
+
+#define RAM_STACK_RESERVE   320U
+#define RAM_OTHER_RESERVE   704U                   // g_link (462 B), rx de CTRL, globales
+
+typedef uint16_t adc_blk_t[ADC_NCH][ADC_PACK_N];  // un bloque de los dos canales
+
+/* X(módulo, nombre, tipo, cantidad, alineación, espacio) */
+#define LINK_RAM(X) \
+    X(link, txq_CTRL,  uint8_t,   TXQ_CTRL,    2, RAM_ANY) \
+    X(link, txq_LOG,   uint8_t,   TXQ_LOG,     2, RAM_ANY) \
+    X(link, txq_TELEM, uint8_t,   TXQ_TELEM,   2, RAM_ANY)
+#define ADC_RAM(X) \
+    X(adc,  blk,       adc_blk_t, ADC_NBLOCKS, 2, RAM_ANY)
+
+#define RAM_LAYOUT(X)   LINK_RAM(X) ADC_RAM(X)
+#include "../0150_dspic30f_ram_budget/ram_arena.h"
+
+#define LINK_NOW()      tb_now32()
+#define LINK_TXQ(n)     RAM(link, txq_##n)
+#define LINK_CHANNELS(X) \
+    X(CTRL,  TXQ_CTRL,  8, LINK_U1 | LINK_U2) \
+    X(LOG,   TXQ_LOG,   0, LINK_U1) \
+    X(TELEM, TXQ_TELEM, 0, LINK_U1 | LINK_U2)
+#include "uart_link.h"
+
+_Static_assert(sizeof g_link + 128U <= RAM_OTHER_RESERVE,
+               "g_link no deja lugar en RAM_OTHER_RESERVE para las demás globales");
+
+/* TELEM en RAW: más que un puerto, menos que dos */
+#define TELEM_WIRE      (ADC_PACK_FRAME_MAX + LINK_OVH * ((ADC_PACK_FRAME_MAX + LINK_MTU - 1U) / LINK_MTU))
+#if (ADC_FS_HZ * ADC_NCH * TELEM_WIRE / ADC_PACK_N) > (2UL * UART_BAUD / 10UL)
+#error "ADC_FS_HZ excede los dos puertos en modo RAW"
+#endif
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static volatile uint16_t g_blk_head = 0;
+static volatile uint16_t g_blk_tail = 0;
+static uint16_t          g_blk_fill = 0;
+static uint8_t           g_blk_seq[ADC_NBLOCKS];
+static uint32_t          g_blk_t[ADC_NBLOCKS];
+static uint8_t           g_seq = 0;
+static volatile uint16_t g_blk_overruns = 0;
+
+static volatile uint16_t g_duty = 0;               // última consigna
+static volatile uint8_t  g_ack_due = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void pwm_init(void);
+static void adc_init_scan(void);
+static void uarts_init(void);
+static uint8_t log_format(char *buf);
+
+/* ——————————————————— PWM1L/RE0 ——————————————————— */
+static void pwm_init(void)
+{
+    PTCON = 0;
+    PTCONbits.PTMOD = 0;       // free-running
+    PTPER = PTPER_VAL;
+    PWMCON1 = 0;
+    PWMCON1bits.PMOD1 = 1;     // independiente
+    PWMCON1bits.PEN1L = 1;
+    OVDCON = 0;
+    OVDCONbits.POVD1L = 1;
+    PWMCON2bits.IUE = 0;       // PDC1 se carga en el límite de periodo
+    PDC1 = 0;
+    PTCONbits.PTEN = 1;
+}
+
+/* ——————————————————— ADC: Timer3 + barrido AN0…AN1 ———————— */
+static void adc_init_scan(void)
+{
+    ADPCFG = 0xFFFF;
+    ADCSSL = 0;
+    for (uint16_t ch = 0; ch < ADC_NCH; ch++) {
+        ADPCFG &= ~(1U << ch);
+        ADCSSL |=  (1U << ch);
+    }
+
+    ADCON1 = 0;
+    ADCON1bits.FORM = 0;       // entero 0…1023
+    ADCON1bits.SSRC = 0b010;   // Timer3
+    ADCON1bits.ASAM = 1;
+
+    ADCON2 = 0;
+    ADCON2bits.CSCNA = 1;
+    ADCON2bits.SMPI  = ADC_NCH - 1;
+
+    ADCON3bits.ADCS = ADCS_TAD_COUNTS;
+    ADCHS = 0;
+
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = PR3_COUNTS;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 4;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    T3CONbits.TON   = 1;
+}
+
+/* ——————————————————— UART1/UART2: 8N1, TX y RX ——————————————— */
+static void uarts_init(void)
+{
+    U1MODE = 0;
+    U1BRG  = (uint16_t)UxBRG_VAL;
+    U1STA  = 0;
+    U1MODEbits.ALTIO  = 0;     // RF3/RF2
+    U1MODEbits.UARTEN = 1;
+    U1STAbits.UTXEN   = 1;
+
+    U2MODE = 0;
+    U2BRG  = (uint16_t)UxBRG_VAL;
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+
+    /* misma prioridad: las dos ISR de RX no se anidan */
+    IFS0bits.U1RXIF = 0;
+    IPC2bits.U1RXIP = 5;
+    IEC0bits.U1RXIE = 1;
+    IFS1bits.U2RXIF = 0;
+    IPC6bits.U2RXIP = 5;
+    IEC1bits.U2RXIE = 1;
+}
+
+/* ——————————————————— ISR ——————————————————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    IFS0bits.ADIF = 0;
+
+    volatile uint16_t *src = &ADCBUF0;
+    uint16_t slot = g_blk_head & (ADC_NBLOCKS - 1);
+    if (g_blk_fill == 0)
+        g_blk_t[slot] = tb_now32();
+    for (uint16_t ch = 0; ch < ADC_NCH; ch++)
+        RAM(adc, blk)[slot][ch][g_blk_fill] = src[ch];
+
+    if (++g_blk_fill >= ADC_PACK_N) {
+        g_blk_fill = 0;
+        g_blk_seq[slot] = g_seq++;
+        if ((uint16_t)(g_blk_head - g_blk_tail) < (ADC_NBLOCKS - 1))
+            g_blk_head++;
+        else
+            g_blk_overruns++;
+    }
+}
+
+void __attribute__((interrupt, auto_psv)) _U1RXInterrupt(void)
+{
+    IFS0bits.U1RXIF = 0;
+    while (U1STAbits.URXDA) link_rx_byte(0, (uint8_t)U1RXREG);
+    if (U1STAbits.OERR) U1STAbits.OERR = 0;
+}
+
+void __attribute__((interrupt, auto_psv)) _U2RXInterrupt(void)
+{
+    IFS1bits.U2RXIF = 0;
+    while (U2STAbits.URXDA) link_rx_byte(1, (uint8_t)U2RXREG);
+    if (U2STAbits.OERR) U2STAbits.OERR = 0;
+}
+
+/* Desde las ISR de RX: la consigna va directo a PDC1; el acuse lo
+   manda el lazo (CTRL tiene un solo productor) */
+static void link_on_msg(uint8_t p, uint8_t ch, const uint8_t *m, uint8_t len)
+{
+    (void)p;
+    if (ch != LINK_CH_CTRL || len != 3 || m[0] != 'S') return;
+
+    uint16_t d = (uint16_t)((m[1] << 8) | m[2]);
+    if (d > 1023U) d = 1023U;
+    PDC1 = (uint16_t)(((uint32_t)d * PDC_MAX) >> 10);
+    g_duty = d;
+    g_ack_due = 1;
+}
+
+/* ——————————————————— LOG ——————————————————— */
+static char *put_u(char *p, uint16_t v)
+{
+    char d[5];
+    uint8_t n = 0;
+    do { d[n++] = (char)('0' + v % 10U); v /= 10U; } while (v);
+    while (n) *p++ = d[--n];
+    return p;
+}
+
+static char *put_s(char *p, const char *s)
+{
+    while (*s) *p++ = *s++;
+    return p;
+}
+
+static uint16_t tcy_to_us(uint32_t t)
+{
+    t = t / (FCY / 1000000UL);
+    return (uint16_t)(t > 0xFFFFU ? 0xFFFFU : t);
+}
+
+/* Cifras del último segundo; las de envío sólo las escribe el lazo,
+   así que se leen y reinician sin bloqueo */
+static uint8_t log_format(char *buf)
+{
+    static uint32_t last_msgs, last_telem, last_wire[LINK_NPORT], last_crc;
+    static uint16_t last_drops;
+    link_stats_t *c = &g_link.st[LINK_CH_CTRL];
+    link_stats_t *t = &g_link.st[LINK_CH_TELEM];
+    uint32_t      n_ctrl = c->msgs - last_msgs;
+    uint32_t      crc = (uint32_t)g_link.port[0].crc_err + g_link.port[1].crc_err;
+    char         *p = buf;
+
+    p = put_s(p, "ctrl ");
+    p = put_u(p, n_ctrl ? tcy_to_us(c->wait_sum / n_ctrl) : 0);
+    *p++ = '/';
+    p = put_u(p, tcy_to_us(c->wait_max));
+    p = put_s(p, " us telem ");
+    p = put_u(p, (uint16_t)(t->msgs - last_telem));
+    p = put_s(p, "/s ");
+    p = put_u(p, (uint16_t)(t->drops - last_drops));
+    p = put_s(p, " desc");
+    for (uint8_t k = 0; k < LINK_NPORT; k++) {
+        uint32_t w = g_link.port[k].wire_bytes - last_wire[k];
+        p = put_s(p, k ? " u2 " : " u1 ");
+        p = put_u(p, (uint16_t)(w * 100UL / (UART_BAUD / 10UL)));
+        *p++ = '%';
+        last_wire[k] = g_link.port[k].wire_bytes;
+    }
+    p = put_s(p, " crc ");
+    p = put_u(p, (uint16_t)(crc - last_crc));
+    *p++ = '\r';
+    *p++ = '\n';
+
+    last_msgs  = c->msgs;
+    last_drops = t->drops;
+    last_telem = t->msgs;
+    last_crc   = crc;
+    c->wait_sum = c->wait_max = 0;
+    return (uint8_t)(p - buf);
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    uint8_t  frame[ADC_PACK_FRAME_MAX];
+    char     line[80];
+    uint32_t t_log;
+
+    __builtin_disable_interrupts();
+
+    tb_init();
+    link_init();
+    pwm_init();
+    uarts_init();
+    adc_init_scan();
+    t_log = tb_now32() + LOG_TCY;
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        if (g_ack_due) {
+            uint16_t d = g_duty;
+            uint8_t  a[3] = { 'A', (uint8_t)(d >> 8), (uint8_t)d };
+            g_ack_due = 0;
+            link_send(LINK_CH_CTRL, a, 3);
+        }
+        if (tb_due32(tb_now32(), t_log)) {
+            t_log += LOG_TCY;
+            link_send(LINK_CH_LOG, (const uint8_t *)line, log_format(line));
+        }
+        if (g_blk_tail != g_blk_head) {
+            uint16_t slot = g_blk_tail & (ADC_NBLOCKS - 1);
+
+            for (uint8_t ch = 0; ch < ADC_NCH; ch++) {
+                adc_pack_block(frame, RAM(adc, blk)[slot][ch], ch, g_blk_seq[slot]);
+                link_send(LINK_CH_TELEM, frame, adc_pack_stamp(frame, g_blk_t[slot]));
+                link_pump();
+            }
+            g_blk_tail++;
+        }
+        link_pump();
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×8 PLL  (FCY ≈ 14.74 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  autobaud en UART2 y ajuste del FRC con OSCTUN (uart_autobaud.h)
+ *
+ *  – Al arrancar, y cada vez que llega un BREAK (byte 0 con FERR), el
+ *    dsPIC mide 'U' (0x55) con IC2 sobre U2RX (U2MODE.ABAUD) y Timer2
+ *    a TCY. El host manda 'U' seguidos a la velocidad que quiera
+ *    (2400…921600) hasta ver la respuesta.
+ *  – Con AB_USE_TRIM la velocidad medida se lleva a la estándar más
+ *    cercana: la diferencia es el error del FRC (tolerancia y
+ *    temperatura) y OSCTUN se mueve paso a paso hasta anularlo; el BRG
+ *    sale de la medida con el mejor TUN. Sin ajuste, con BRG = 7 fijo
+ *    (021) un FRC a ±4 % ya no llega a 115200; con ajuste, 921600
+ *    (BRG = 0) funciona en ±5 % (host/autobaud_sim.c, con pasos de
+ *    TUN de 0.75 y 1.5 %).
+ *  – Respuesta a la velocidad nueva:
+ *      "AB 921600 brg 0 tun -3 reloj +2.1% err +0.4%\r\n"
+ *    (velocidad estándar, BRG, TUN, error del FRC antes de ajustar y
+ *    error que queda entre el BRG y la línea). Después hace eco y
+ *    cuenta errores de trama en g_ferr.
+ *  – Pines: U2TX RF5, U2RX RF4.
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL8  *****************/
+#pragma config FPR     = FRC_PLL8      // Primary Osc = FRC ×8 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*8)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 14.74 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "uart_autobaud.h"
+
+#define AB_USE_TRIM     1                          // 0: sólo BRG
+#define AB_TRIES        4U                         // tandas por medida
+#define AB_WRAPS        2U                         // vueltas de Timer2 por tanda (≈ 13 ms)
+#define AB_SETTLE_MS    2U                         // tras mover OSCTUN
+
+#define UART_BAUD       115200UL                   // hasta el primer autobaud
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static int8_t   g_tun = 0;
+static uint16_t g_ferr = 0;
+static uint16_t g_ab_runs = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void uart2_init(void);
+static void autobaud(void);
+static void uart2_putc(char c);
+static void uart2_write(const char *s, uint8_t len);
+
+/* ——————————————————— UART2: 8N1, TX y RX ———————————————— */
+static void uart2_init(void)
+{
+    U2MODE = 0;
+    U2BRG  = (uint16_t)U2BRG_VAL;
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+}
+
+static void uart2_putc(char c)
+{
+    while (U2STAbits.UTXBF);
+    U2TXREG = (uint8_t)c;
+}
+
+static void uart2_write(const char *s, uint8_t len)
+{
+    for (uint8_t i = 0; i < len; i++) uart2_putc(s[i]);
+}
+
+/* ——————————————————— RESPUESTA ——————————————————— */
+static char *put_u(char *p, uint32_t v)
+{
+    char d[10];
+    uint8_t n = 0;
+    do { d[n++] = (char)('0' + v % 10U); v /= 10U; } while (v);
+    while (n) *p++ = d[--n];
+    return p;
+}
+
+static char *put_s(char *p, const char *s)
+{
+    while (*s) *p++ = *s++;
+    return p;
+}
+
+static char *put_i(char *p, int16_t v)
+{
+    if (v < 0) { *p++ = '-'; v = (int16_t)-v; }
+    return put_u(p, (uint16_t)v);
+}
+
+/* Q16 → "+1.4%" */
+static char *put_pct(char *p, int32_t q16)
+{
+    int32_t pm = q16 * 1000L / 65536L;
+    *p++ = pm < 0 ? '-' : '+';
+    if (pm < 0) pm = -pm;
+    p = put_u(p, (uint32_t)pm / 10U);
+    *p++ = '.';
+    *p++ = (char)('0' + pm % 10);
+    *p++ = '%';
+    return p;
+}
+
+/* ——————————————————— AUTOBAUD ——————————————————— */
+/* Espera 'U' del host el tiempo que haga falta */
+static void measure(ab_t *a)
+{
+    while (!ab_measure(a, AB_TRIES, AB_WRAPS))
+        ;
+}
+
+static void autobaud(void)
+{
+    ab_t     a;
+    uint32_t ref;
+    int32_t  clk = 0;
+    char     line[64], *p = line;
+
+    measure(&a);
+    ref = ab_ref(ab_baud(&a, FCY));
+#if AB_USE_TRIM
+    if (ref) {
+        ab_trim_t t;
+        ab_trim_init(&t, g_tun);
+        clk = ab_clk_err(&a, FCY, ref);
+        while (ab_trim_next(&t, &a, ab_clk_err(&a, FCY, ref))) {
+            ab_tun_set(t.tun);
+            __delay_ms(AB_SETTLE_MS);
+            measure(&a);
+        }
+        g_tun = t.tun;
+        ab_tun_set(g_tun);
+        a.span = t.best_span;
+        a.bits = t.best_bits;
+    }
+#endif
+    uint16_t brg = ab_brg(&a);
+    ab_apply(brg);
+    g_ab_runs++;
+
+    p = put_s(p, "AB ");
+    p = put_u(p, ref ? ref : ab_baud(&a, FCY));
+    p = put_s(p, " brg ");
+    p = put_u(p, brg);
+    p = put_s(p, " tun ");
+    p = put_i(p, g_tun);
+    p = put_s(p, " reloj ");
+    p = put_pct(p, clk);
+    p = put_s(p, " err ");
+    p = put_pct(p, ab_err(&a, brg));
+    *p++ = '\r';
+    *p++ = '\n';
+    uart2_write(line, (uint8_t)(p - line));
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    uart2_init();
+    ab_hw_init();
+    autobaud();
+
+    for (;;)
+    {
+        if (U2STAbits.OERR) U2STAbits.OERR = 0;
+        if (!U2STAbits.URXDA) continue;
+
+        uint8_t ferr = U2STAbits.FERR;             // del byte en la cabeza del FIFO
+        uint8_t c    = (uint8_t)U2RXREG;
+        if (ferr) {
+            g_ferr++;
+            if (c == 0) autobaud();                // BREAK: el host pide medir otra vez
+            continue;
+        }
+        uart2_putc((char)c);
+    }
+    return 0;
+}
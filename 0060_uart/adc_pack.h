@@ -0,0 +1,375 @@
+/*************************************************************
+ *  Compresión sin pérdidas de bloques de ADC – header-only
+ *  (firmware y PC: 023_adc_uart_compressed.c, host/adc_unpack.c)
+ *
+ *  Marco:  0xAA 0x55  len  hdr  seq  payload[len]  chk
+ *     hdr = modo<<6 | canal<<4 | k      chk = suma de len…payload
+ *
+ *  Modo RICE (1): primera muestra en ADC_PACK_BITS bits y luego
+ *  ADC_PACK_N − 1 diferencias en zigzag, código Rice de parámetro k
+ *  (MSB primero): q = z >> k en unario (q unos y un cero) seguido de
+ *  los k bits bajos. Si q ≥ ADC_PACK_QESC se escriben QESC unos y z
+ *  completo en ADC_PACK_BITS + 1 bits, así ninguna muestra pasa de
+ *  QESC + BITS + 1 bits.
+ *
+ *  Modo RAW (0): ADC_PACK_N muestras empaquetadas a ADC_PACK_BITS.
+ *  Se elige cuando RICE no ahorra nada (canal ruidoso), así el peor
+ *  caso es el tamaño fijo de RAW.
+ *
+ *  Modo TONE (2): no lleva muestras sino resultados de tone_q15.h
+ *  (../0050_dspic30f_dsp_core/050_tone_detect.c). k = 0 y el payload
+ *  es f0 (uint16, centésimas de Hz, 0 = sin estimar) y hasta
+ *  ADC_PACK_TONE_MAX registros de 5 bytes: id (armónica o bin), mag
+ *  (Q15) y fase (q15_ang), los uint16 con el byte alto primero.
+ *
+ *  Modo SPEC (3): un tramo de un espectro de fft_q15.h
+ *  (024_adc_uart_spectrum.c). k = exponente del bloque e, payload =
+ *  log2(N), primer bin y hasta ADC_PACK_SPEC_MAX magnitudes uint16
+ *  (byte alto primero); |X[bin]| = mag · 2^e en unidades Q15. Un
+ *  espectro de N/2 bins ocupa varios marcos con el mismo seq.
+ *
+ *  Sello de tiempo (opcional, cualquier modo): con el bit 7 de len
+ *  puesto (ADC_PACK_STAMP) el payload va seguido de 4 bytes, los 32
+ *  bits bajos de tb_now32() (../0140_dspic30f_timebase/timebase.h)
+ *  tomados al adquirir el bloque, byte alto primero, y la suma los
+ *  incluye. El PC los extiende a 64 bits (vuelta cada 2^32 TCY).
+ *  adc_pack_stamp() sella un marco ya cerrado.
+ *
+ *  k se adapta por bloque a la media de |Δ|. El costo por muestra
+ *  está acotado: tres pasadas de trabajo constante (Δ y suma, tamaño,
+ *  escritura) y a lo sumo 2 bytes emitidos por llamada a bw_put().
+ *************************************************************/
+#ifndef ADC_PACK_H
+#define ADC_PACK_H
+
+#include <stdint.h>
+
+#ifndef ADC_PACK_N
+#define ADC_PACK_N      32U            // muestras por bloque
+#endif
+#ifndef ADC_PACK_BITS
+#define ADC_PACK_BITS   10U            // resolución del ADC
+#endif
+#define ADC_PACK_QESC   12U
+#define ADC_PACK_KMAX   (ADC_PACK_BITS - 1U)
+
+#define ADC_PACK_SYNC0  0xAA
+#define ADC_PACK_SYNC1  0x55
+#define ADC_PACK_RAW    0U
+#define ADC_PACK_RICE   1U
+#define ADC_PACK_TONE   2U
+#define ADC_PACK_SPEC   3U
+
+#define ADC_PACK_RAW_LEN    ((ADC_PACK_N * ADC_PACK_BITS + 7U) / 8U)
+#define ADC_PACK_HDR_LEN    5U                      // sync×2, len, hdr, seq
+#define ADC_PACK_STAMP      0x80U                   // bit de len
+#define ADC_PACK_STAMP_LEN  4U
+#define ADC_PACK_FRAME_MAX  (ADC_PACK_HDR_LEN + ADC_PACK_RAW_LEN + ADC_PACK_STAMP_LEN + 1U)
+
+#define ADC_PACK_TONE_MAX   ((ADC_PACK_RAW_LEN - 2U) / 5U)
+#define ADC_PACK_SPEC_MAX   ((ADC_PACK_RAW_LEN - 2U) / 2U)
+
+#if ADC_PACK_RAW_LEN >= ADC_PACK_STAMP
+#error "ADC_PACK_N * ADC_PACK_BITS no cabe en los 7 bits de longitud"
+#endif
+
+/* ——————————————————— ESCRITOR / LECTOR DE BITS ——————————————————— */
+typedef struct {
+    uint8_t *p;
+    uint32_t acc;
+    uint8_t  n;                         // bits pendientes en acc (< 8)
+} adc_bw_t;
+
+/* n ≤ 16 */
+static inline void bw_put(adc_bw_t *w, uint16_t v, uint8_t n)
+{
+    w->acc = (w->acc << n) | (v & ((1UL << n) - 1U));
+    w->n  += n;
+    while (w->n >= 8U) {
+        w->n -= 8U;
+        *w->p++ = (uint8_t)(w->acc >> w->n);
+    }
+}
+
+static inline void bw_flush(adc_bw_t *w)
+{
+    if (w->n) bw_put(w, 0, (uint8_t)(8U - w->n));
+}
+
+typedef struct {
+    const uint8_t *p, *end;
+    uint32_t acc;
+    uint8_t  n;
+} adc_br_t;
+
+/* n ≤ 16; devuelve 0 si el payload se acaba */
+static inline int br_get(adc_br_t *r, uint8_t n, uint16_t *v)
+{
+    while (r->n < n) {
+        if (r->p >= r->end) return 0;
+        r->acc = (r->acc << 8) | *r->p++;
+        r->n  += 8U;
+    }
+    r->n -= n;
+    *v = (uint16_t)((r->acc >> r->n) & ((1UL << n) - 1U));
+    return 1;
+}
+
+static inline uint16_t adc_zz(int16_t d)   { return (uint16_t)(((uint16_t)d << 1) ^ (uint16_t)(d >> 15)); }
+static inline int16_t  adc_unzz(uint16_t z){ return (int16_t)((z >> 1) ^ (uint16_t)-(int16_t)(z & 1U)); }
+
+/* ——————————————————— MARCO ——————————————————— */
+/* Encabezado y suma alrededor de un payload de len bytes ya escrito */
+static inline uint8_t adc_pack_close(uint8_t *out, uint8_t len, uint8_t mode,
+                                     uint8_t ch, uint8_t k, uint8_t seq)
+{
+    uint8_t chk = 0;
+    out[0] = ADC_PACK_SYNC0;
+    out[1] = ADC_PACK_SYNC1;
+    out[2] = len;
+    out[3] = (uint8_t)((mode << 6) | ((ch & 3U) << 4) | k);
+    out[4] = seq;
+    for (uint16_t i = 2; i < ADC_PACK_HDR_LEN + len; i++) chk += out[i];
+    out[ADC_PACK_HDR_LEN + len] = chk;
+    return (uint8_t)(ADC_PACK_HDR_LEN + len + 1U);
+}
+
+/* Sella un marco cerrado con t (TCY); devuelve la nueva longitud */
+static inline uint8_t adc_pack_stamp(uint8_t *f, uint32_t t)
+{
+    uint8_t  len = f[2];
+    uint8_t *p   = f + ADC_PACK_HDR_LEN + len;
+    uint8_t  chk = p[0];
+
+    p[0] = (uint8_t)(t >> 24);
+    p[1] = (uint8_t)(t >> 16);
+    p[2] = (uint8_t)(t >> 8);
+    p[3] = (uint8_t)t;
+    f[2] = (uint8_t)(len | ADC_PACK_STAMP);
+    p[4] = (uint8_t)(chk + ADC_PACK_STAMP + p[0] + p[1] + p[2] + p[3]);
+    return (uint8_t)(ADC_PACK_HDR_LEN + len + ADC_PACK_STAMP_LEN + 1U);
+}
+
+/* Longitud del payload, sin el sello */
+static inline uint8_t adc_pack_len(const uint8_t *f)
+{   return (uint8_t)(f[2] & ~ADC_PACK_STAMP);   }
+
+/* Bytes del marco completo */
+static inline uint16_t adc_pack_size(const uint8_t *f)
+{
+    return ADC_PACK_HDR_LEN + adc_pack_len(f)
+         + ((f[2] & ADC_PACK_STAMP) ? ADC_PACK_STAMP_LEN : 0U) + 1U;
+}
+
+/* 1 si sync, longitud y suma son válidos */
+static inline int adc_pack_check(const uint8_t *f)
+{
+    uint8_t  chk = 0;
+    uint16_t n   = adc_pack_size(f) - 1U;
+    if (f[0] != ADC_PACK_SYNC0 || f[1] != ADC_PACK_SYNC1 || adc_pack_len(f) > ADC_PACK_RAW_LEN)
+        return 0;
+    for (uint16_t i = 2; i < n; i++) chk += f[i];
+    return chk == f[n];
+}
+
+/* Marco válido con sello → 1 y *t; sin sello → 0 */
+static inline int adc_unpack_stamp(const uint8_t *f, uint32_t *t)
+{
+    if (!(f[2] & ADC_PACK_STAMP) || !adc_pack_check(f)) return 0;
+    const uint8_t *p = f + ADC_PACK_HDR_LEN + adc_pack_len(f);
+    *t = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    return 1;
+}
+
+/* ——————————————————— CODIFICADOR ——————————————————— */
+/* Escribe un marco completo en out (ADC_PACK_FRAME_MAX bytes);
+   devuelve su longitud. x: ADC_PACK_N muestras < 2^ADC_PACK_BITS. */
+static inline uint8_t adc_pack_block(uint8_t *out, const uint16_t *x, uint8_t ch, uint8_t seq)
+{
+    uint16_t z[ADC_PACK_N];
+    uint32_t sum = 0, bits;
+    uint8_t  k = 0, mode;
+    adc_bw_t w;
+
+    /* 1) Δ en zigzag y su suma */
+    z[0] = 0;
+    for (uint16_t i = 1; i < ADC_PACK_N; i++) {
+        z[i] = adc_zz((int16_t)(x[i] - x[i - 1]));
+        sum += z[i];
+    }
+
+    /* 2) k ≈ log2(media) y tamaño exacto del bloque RICE */
+    while (k < ADC_PACK_KMAX && ((uint32_t)(ADC_PACK_N - 1U) << (k + 1U)) <= sum)
+        k++;
+    bits = ADC_PACK_BITS;
+    for (uint16_t i = 1; i < ADC_PACK_N; i++) {
+        uint16_t q = z[i] >> k;
+        bits += (q >= ADC_PACK_QESC) ? (ADC_PACK_QESC + ADC_PACK_BITS + 1U)
+                                     : (q + 1U + k);
+    }
+    mode = (bits < ADC_PACK_N * ADC_PACK_BITS) ? ADC_PACK_RICE : ADC_PACK_RAW;
+
+    /* 3) Escritura */
+    w.p = out + ADC_PACK_HDR_LEN;
+    w.acc = 0;
+    w.n = 0;
+    if (mode == ADC_PACK_RICE) {
+        bw_put(&w, x[0], ADC_PACK_BITS);
+        for (uint16_t i = 1; i < ADC_PACK_N; i++) {
+            uint16_t q = z[i] >> k;
+            if (q >= ADC_PACK_QESC) {
+                bw_put(&w, (1U << ADC_PACK_QESC) - 1U, ADC_PACK_QESC);
+                bw_put(&w, z[i], ADC_PACK_BITS + 1U);
+            } else {
+                bw_put(&w, (uint16_t)(((1U << q) - 1U) << 1), (uint8_t)(q + 1U));
+                if (k) bw_put(&w, z[i], k);
+            }
+        }
+    } else {
+        k = 0;
+        for (uint16_t i = 0; i < ADC_PACK_N; i++)
+            bw_put(&w, x[i], ADC_PACK_BITS);
+    }
+    bw_flush(&w);
+
+    return adc_pack_close(out, (uint8_t)(w.p - (out + ADC_PACK_HDR_LEN)), mode, ch, k, seq);
+}
+
+/* Marco TONE: f0_chz en centésimas de Hz, n ≤ ADC_PACK_TONE_MAX */
+typedef struct {
+    uint8_t  id;                        // armónica o bin
+    uint16_t mag;                       // Q15
+    uint16_t phase;                     // q15_ang
+} adc_tone_t;
+
+static inline uint8_t adc_pack_tone(uint8_t *out, const adc_tone_t *t, uint8_t n,
+                                    uint16_t f0_chz, uint8_t ch, uint8_t seq)
+{
+    uint8_t *p = out + ADC_PACK_HDR_LEN;
+
+    if (n > ADC_PACK_TONE_MAX) n = ADC_PACK_TONE_MAX;
+    *p++ = (uint8_t)(f0_chz >> 8);
+    *p++ = (uint8_t)f0_chz;
+    for (uint8_t i = 0; i < n; i++) {
+        *p++ = t[i].id;
+        *p++ = (uint8_t)(t[i].mag >> 8);
+        *p++ = (uint8_t)t[i].mag;
+        *p++ = (uint8_t)(t[i].phase >> 8);
+        *p++ = (uint8_t)t[i].phase;
+    }
+    return adc_pack_close(out, (uint8_t)(p - (out + ADC_PACK_HDR_LEN)), ADC_PACK_TONE, ch, 0, seq);
+}
+
+/* Marco SPEC: mag[0…n−1] = bins bin0…bin0+n−1, n ≤ ADC_PACK_SPEC_MAX */
+static inline uint8_t adc_pack_spec(uint8_t *out, const uint16_t *mag, uint8_t n,
+                                    uint8_t log2n, uint8_t bin0, uint8_t e,
+                                    uint8_t ch, uint8_t seq)
+{
+    uint8_t *p = out + ADC_PACK_HDR_LEN;
+
+    if (n > ADC_PACK_SPEC_MAX) n = ADC_PACK_SPEC_MAX;
+    *p++ = log2n;
+    *p++ = bin0;
+    for (uint8_t i = 0; i < n; i++) {
+        *p++ = (uint8_t)(mag[i] >> 8);
+        *p++ = (uint8_t)mag[i];
+    }
+    return adc_pack_close(out, (uint8_t)(p - (out + ADC_PACK_HDR_LEN)), ADC_PACK_SPEC,
+                          ch, (uint8_t)(e & 0x0FU), seq);
+}
+
+/* ——————————————————— DECODIFICADOR ——————————————————— */
+/* f apunta a 0xAA y contiene el marco completo (adc_pack_size()
+   bytes). Devuelve 1 y llena x[ADC_PACK_N] si el marco es
+   válido. */
+static inline int adc_unpack_block(const uint8_t *f, uint16_t *x, uint8_t *ch, uint8_t *seq)
+{
+    uint8_t len = adc_pack_len(f), hdr = f[3];
+    uint8_t mode = hdr >> 6, k = hdr & 0x0FU;
+    adc_br_t r;
+    uint16_t v;
+
+    if (!adc_pack_check(f)) return 0;
+
+    r.p = f + ADC_PACK_HDR_LEN;
+    r.end = r.p + len;
+    r.acc = 0;
+    r.n = 0;
+    *ch = (hdr >> 4) & 3U;
+    *seq = f[4];
+
+    if (mode == ADC_PACK_RAW) {
+        for (uint16_t i = 0; i < ADC_PACK_N; i++)
+            if (!br_get(&r, ADC_PACK_BITS, &x[i])) return 0;
+        return 1;
+    }
+    if (mode != ADC_PACK_RICE || k > ADC_PACK_KMAX) return 0;
+
+    if (!br_get(&r, ADC_PACK_BITS, &x[0])) return 0;
+    for (uint16_t i = 1; i < ADC_PACK_N; i++) {
+        uint16_t q = 0, z;
+        for (;;) {
+            if (!br_get(&r, 1, &v)) return 0;
+            if (!v) break;
+            if (++q == ADC_PACK_QESC) break;
+        }
+        if (q == ADC_PACK_QESC) {
+            if (!br_get(&r, ADC_PACK_BITS + 1U, &z)) return 0;
+        } else {
+            z = (uint16_t)(q << k);
+            if (k) {
+                if (!br_get(&r, k, &v)) return 0;
+                z |= v;
+            }
+        }
+        x[i] = (uint16_t)(x[i - 1] + adc_unzz(z)) & ((1U << ADC_PACK_BITS) - 1U);
+    }
+    return 1;
+}
+
+/* Marco TONE válido → 1, con t[ADC_PACK_TONE_MAX] y *n registros */
+static inline int adc_unpack_tone(const uint8_t *f, adc_tone_t *t, uint8_t *n,
+                                  uint16_t *f0_chz, uint8_t *ch, uint8_t *seq)
+{
+    uint8_t len = adc_pack_len(f);
+    const uint8_t *p = f + ADC_PACK_HDR_LEN;
+
+    if (!adc_pack_check(f) || (f[3] >> 6) != ADC_PACK_TONE || len < 2U || (len - 2U) % 5U)
+        return 0;
+    *ch  = (f[3] >> 4) & 3U;
+    *seq = f[4];
+    *f0_chz = (uint16_t)((p[0] << 8) | p[1]);
+    *n = (uint8_t)((len - 2U) / 5U);
+    p += 2;
+    for (uint8_t i = 0; i < *n; i++, p += 5) {
+        t[i].id    = p[0];
+        t[i].mag   = (uint16_t)((p[1] << 8) | p[2]);
+        t[i].phase = (uint16_t)((p[3] << 8) | p[4]);
+    }
+    return 1;
+}
+
+/* Marco SPEC válido → 1, con mag[ADC_PACK_SPEC_MAX] y *n bins */
+static inline int adc_unpack_spec(const uint8_t *f, uint16_t *mag, uint8_t *n,
+                                  uint8_t *log2n, uint8_t *bin0, uint8_t *e,
+                                  uint8_t *ch, uint8_t *seq)
+{
+    uint8_t len = adc_pack_len(f);
+    const uint8_t *p = f + ADC_PACK_HDR_LEN;
+
+    if (!adc_pack_check(f) || (f[3] >> 6) != ADC_PACK_SPEC || len < 2U || (len & 1U)
+        || p[0] > 15U)
+        return 0;
+    *ch    = (f[3] >> 4) & 3U;
+    *e     = f[3] & 0x0FU;
+    *seq   = f[4];
+    *log2n = p[0];
+    *bin0  = p[1];
+    *n = (uint8_t)((len - 2U) / 2U);
+    p += 2;
+    for (uint8_t i = 0; i < *n; i++, p += 2)
+        mag[i] = (uint16_t)((p[0] << 8) | p[1]);
+    return 1;
+}
+
+#endif /* ADC_PACK_H */
@@ -0,0 +1,473 @@
+/*************************************************************
+ *  adc_unpack – decodificador PC de la telemetría de 023
+ *  POSIX (Linux / macOS):  cc -O2 -I.. -o adc_unpack adc_unpack.c
+ *
+ *  Uso:
+ *    adc_unpack <puerto> [baud]         en vivo, estadísticas cada 1 s
+ *    adc_unpack -f <captura.bin>        flujo grabado (cat /dev/ttyUSB0)
+ *    adc_unpack -b <señal>              codifica/decodifica una señal
+ *                                       grabada y mide relación y MB/s
+ *  Opcional al final:  -o <salida.csv>  muestras decodificadas
+ *                      -t <Hz>          reloj de los sellos (FCY, por
+ *                                       omisión 29480000)
+ *
+ *  – Se sincroniza con 0xAA 0x55 y valida longitud y suma; un marco
+ *    malo avanza un byte y vuelve a buscar.
+ *  – Los huecos de seq por canal se cuentan como bloques perdidos.
+ *  – La relación se da contra el formato de 021 (4 bytes/muestra) y
+ *    contra 10 bits empaquetados.
+ *  – Los marcos TONE (050_tone_detect.c) se imprimen por stdout:
+ *    canal, seq, f0 y magnitud / fase de cada registro.
+ *  – Los marcos SPEC (024_adc_uart_spectrum.c) también: canal, seq,
+ *    N, primer bin y la amplitud de cada bin relativa a un seno de
+ *    escala completa (ventana de Hann: |X| = N/4 · amplitud).
+ *  – Marcos sellados (timebase.h): el sello de 32 bits se extiende a
+ *    64 por flujo (modo, canal). Entre marcos consecutivos (seq + 1)
+ *    se mide el intervalo real de adquisición: medio, mínimo, máximo
+ *    y jitter = máx − mín, en µs. En vivo además se compara la llegada
+ *    al PC con el sello: el reloj del equipo se estima sobre toda la
+ *    corrida (FRC ±2 %: se informa en ppm) y la latencia extremo a
+ *    extremo se da sobre la mínima de cada ventana (el desfase fijo
+ *    entre relojes no es observable sin otra referencia).
+ *    Con -o la columna 4 del CSV es el sello en TCY de 64 bits.
+ *  – -b acepta una captura del 021 (0xAA 0x55 H L por muestra, o
+ *    0xAA 0x56 H L T3 T2 T1 T0 sellada) o un texto con una muestra por
+ *    línea; verifica que el decodificador devuelva exactamente la
+ *    entrada. Con sellos informa además el intervalo entre muestras
+ *    (medio, mínimo, máximo y jitter, en µs según -t; el 021 corre a
+ *    FCY = 14740000).
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include "adc_pack.h"
+
+#define NCH_MAX     4
+#define NSTREAM     12                  // muestras, TONE, SPEC × canal
+
+/* Sellos por flujo: intervalos entre marcos consecutivos, en TCY */
+typedef struct {
+    int      have;
+    uint8_t  seq;
+    uint32_t t32;
+    uint64_t t64;
+    unsigned long n;
+    double   sum, min, max;
+} tstream_t;
+
+static tstream_t g_ts[NSTREAM];
+static double    g_hz = 29480000.0;     // -t
+static double    g_arrival;             // llegada del último read(), s
+static int       g_live;
+
+/* Llegada contra sello (sólo en vivo) */
+static struct {
+    int      have;
+    double   h0;                        // primer marco sellado
+    uint64_t k0;
+    double   hz_est;                    // fijo durante cada ventana
+    double   h1;                        // último marco sellado
+    uint64_t k1;
+    unsigned long n;                    // ventana actual
+    double   sum, min, max;
+} g_lat;
+
+typedef struct {
+    unsigned long frames, samples, bytes, rice, raw, bad, lost, tones, specs;
+    int           last_seq[NCH_MAX];
+} stats_t;
+
+static FILE *g_csv;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ——————————————————— SELLOS DE TIEMPO ——————————————————— */
+/* Registra el sello de f; devuelve el tiempo de 64 bits (0 sin sello) */
+static uint64_t stamp_frame(const uint8_t *f)
+{
+    uint32_t t;
+    uint8_t  mode = f[3] >> 6, ch = (f[3] >> 4) & 3U;
+    if (!adc_unpack_stamp(f, &t)) return 0;
+
+    tstream_t *s = &g_ts[(mode <= ADC_PACK_RICE ? 0 : mode == ADC_PACK_TONE ? 4 : 8) + ch];
+    if (!s->have) {
+        s->t64 = t;
+    } else {
+        s->t64 += (uint32_t)(t - s->t32);          // vuelta cada 2^32
+        if ((uint8_t)(f[4] - s->seq) == 1U) {
+            double d = (double)(uint32_t)(t - s->t32);
+            if (!s->n || d < s->min) s->min = d;
+            if (!s->n || d > s->max) s->max = d;
+            s->sum += d;
+            s->n++;
+        }
+    }
+    s->have = 1;
+    s->seq  = f[4];
+    s->t32  = t;
+
+    if (g_live) {
+        if (!g_lat.have) {
+            g_lat.have = 1;
+            g_lat.h0 = g_arrival;
+            g_lat.k0 = s->t64;
+            g_lat.hz_est = g_hz;
+        }
+        g_lat.h1 = g_arrival;
+        g_lat.k1 = s->t64;
+        double off = g_arrival - (double)(s->t64 - g_lat.k0) / g_lat.hz_est;
+        if (!g_lat.n || off < g_lat.min) g_lat.min = off;
+        if (!g_lat.n || off > g_lat.max) g_lat.max = off;
+        g_lat.sum += off;
+        g_lat.n++;
+    }
+    return s->t64;
+}
+
+static void stamp_report(void)
+{
+    static const char *k_kind[3] = { "muestras", "tonos", "espectro" };
+    double hz = (g_live && g_lat.have) ? g_lat.hz_est : g_hz;
+
+    for (int i = 0; i < NSTREAM; i++) {
+        tstream_t *s = &g_ts[i];
+        if (!s->n) continue;
+        fprintf(stderr, "    %-8s ch%d: intervalo %.2f µs (%.2f … %.2f), jitter %.2f µs, %lu\n",
+                k_kind[i / 4], i % 4, s->sum / s->n / hz * 1e6,
+                s->min / hz * 1e6, s->max / hz * 1e6, (s->max - s->min) / hz * 1e6, s->n);
+        s->n = 0;
+        s->sum = 0;
+    }
+    if (g_lat.n) {
+        double mean = g_lat.sum / g_lat.n;
+        fprintf(stderr, "    reloj del equipo %.0f Hz (%+.0f ppm), latencia sobre la mínima: "
+                "media %.2f ms, máx %.2f ms\n",
+                g_lat.hz_est, (g_lat.hz_est / g_hz - 1.0) * 1e6,
+                (mean - g_lat.min) * 1e3, (g_lat.max - g_lat.min) * 1e3);
+        g_lat.n = 0;
+        g_lat.sum = 0;
+    }
+    /* reloj estimado sobre toda la corrida, para la ventana siguiente */
+    if (g_lat.have && g_lat.h1 - g_lat.h0 > 2.0 && g_lat.k1 > g_lat.k0)
+        g_lat.hz_est = (double)(g_lat.k1 - g_lat.k0) / (g_lat.h1 - g_lat.h0);
+}
+
+/* ——————————————————— MARCOS TONE ——————————————————— */
+static int tone_frame(stats_t *st, const uint8_t *f)
+{
+    adc_tone_t t[ADC_PACK_TONE_MAX];
+    uint8_t    n, ch, seq;
+    uint16_t   f0;
+
+    if (!adc_unpack_tone(f, t, &n, &f0, &ch, &seq)) return 0;
+    printf("tono ch%u seq %3u", ch, seq);
+    if (f0) printf("  f0 %6.2f Hz", f0 / 100.0);
+    for (uint8_t i = 0; i < n; i++)
+        printf("  [%u] %.4f %6.1f°", t[i].id, (int16_t)t[i].mag / 32768.0, t[i].phase * 360.0 / 65536.0);
+    printf("\n");
+    fflush(stdout);
+    st->tones++;
+    return 1;
+}
+
+/* ——————————————————— MARCOS SPEC ——————————————————— */
+static int spec_frame(stats_t *st, const uint8_t *f)
+{
+    uint16_t mag[ADC_PACK_SPEC_MAX];
+    uint8_t  n, log2n, bin0, e, ch, seq;
+
+    if (!adc_unpack_spec(f, mag, &n, &log2n, &bin0, &e, &ch, &seq)) return 0;
+    /* |X| = mag · 2^e (Q15); seno de escala completa → 32768 · N/4 */
+    double esc = (double)(1UL << e) * 4.0 / (32768.0 * (double)(1UL << log2n));
+    printf("espectro ch%u seq %3u N %u bin %3u", ch, seq, 1U << log2n, bin0);
+    for (uint8_t i = 0; i < n; i++)
+        printf(" %.5f", mag[i] * esc);
+    printf("\n");
+    fflush(stdout);
+    st->specs++;
+    return 1;
+}
+
+/* ——————————————————— PARSER DE FLUJO ——————————————————— */
+static uint8_t g_buf[4096];
+static size_t  g_len;
+
+static void parse(stats_t *st)
+{
+    size_t i = 0;
+    while (g_len - i >= ADC_PACK_HDR_LEN) {
+        const uint8_t *f = g_buf + i;
+        if (f[0] != ADC_PACK_SYNC0 || f[1] != ADC_PACK_SYNC1) { i++; continue; }
+        size_t need = adc_pack_size(f);
+        if (adc_pack_len(f) > ADC_PACK_RAW_LEN) { st->bad++; i++; continue; }
+        if (g_len - i < need) break;
+        if (!adc_pack_check(f)) { st->bad++; i++; continue; }
+        uint64_t t64 = stamp_frame(f);
+
+        if ((f[3] >> 6) == ADC_PACK_TONE) {
+            if (!tone_frame(st, f)) { st->bad++; i++; continue; }
+            i += need;
+            continue;
+        }
+        if ((f[3] >> 6) == ADC_PACK_SPEC) {
+            if (!spec_frame(st, f)) { st->bad++; i++; continue; }
+            i += need;
+            continue;
+        }
+
+        uint16_t x[ADC_PACK_N];
+        uint8_t  ch, seq;
+        if (!adc_unpack_block(f, x, &ch, &seq)) { st->bad++; i++; continue; }
+
+        if (st->last_seq[ch] >= 0)
+            st->lost += (uint8_t)(seq - st->last_seq[ch] - 1);
+        st->last_seq[ch] = seq;
+        st->frames++;
+        st->samples += ADC_PACK_N;
+        st->bytes   += need;
+        if ((f[3] >> 6) == ADC_PACK_RICE) st->rice++; else st->raw++;
+
+        if (g_csv)
+            for (unsigned k = 0; k < ADC_PACK_N; k++)
+                fprintf(g_csv, "%u,%u,%u,%llu\n", seq, ch, x[k], (unsigned long long)t64);
+        i += need;
+    }
+    memmove(g_buf, g_buf + i, g_len - i);
+    g_len -= i;
+}
+
+static void report(const stats_t *st, double dt, const char *tag)
+{
+    if (!st->samples && (st->tones || st->specs)) {
+        fprintf(stderr, "%s %lu marcos de tonos, %lu de espectro, malos %lu\n",
+                tag, st->tones, st->specs, st->bad);
+        stamp_report();
+        return;
+    }
+    if (!st->samples) { fprintf(stderr, "%s sin marcos válidos\n", tag); return; }
+    fprintf(stderr, "%s ", tag);
+    if (dt > 0)
+        fprintf(stderr, "%.0f muestras/s, %.0f B/s, ", st->samples / dt, st->bytes / dt);
+    else
+        fprintf(stderr, "%lu muestras, %lu B, ", st->samples, st->bytes);
+    fprintf(stderr,
+            "%.3f B/muestra (×%.2f vs 021, ×%.2f vs 10 bits) "
+            "rice %lu raw %lu perdidos %lu malos %lu\n",
+            (double)st->bytes / st->samples,
+            4.0 * st->samples / st->bytes, 1.25 * st->samples / st->bytes,
+            st->rice, st->raw, st->lost, st->bad);
+    stamp_report();
+}
+
+static int run_stream(int fd, int live)
+{
+    stats_t st;
+    memset(&st, 0, sizeof st);
+    for (int c = 0; c < NCH_MAX; c++) st.last_seq[c] = -1;
+
+    g_live = live;
+    double tlast = now_s();
+    for (;;) {
+        ssize_t n = read(fd, g_buf + g_len, sizeof g_buf - g_len);
+        if (n < 0) { perror("read"); return 1; }
+        if (n == 0 && !live) break;
+        g_arrival = now_s();
+        g_len += (size_t)n;
+        parse(&st);
+
+        double t = now_s();
+        if (live && t - tlast >= 1.0) {
+            report(&st, t - tlast, "[1 s]");
+            memset(&st, 0, offsetof(stats_t, last_seq));   // seq sigue
+            tlast = t;
+        }
+    }
+    report(&st, 0, "[archivo]");          // sin reloj: sólo la relación
+    return 0;
+}
+
+/* ——————————————————— PUERTO SERIE ——————————————————— */
+static int open_port(const char *dev, long baud)
+{
+    speed_t sp = (baud == 57600) ? B57600 : (baud == 230400) ? B230400 : B115200;
+    int fd = open(dev, O_RDONLY | O_NOCTTY);
+    if (fd < 0) { perror(dev); return -1; }
+
+    struct termios t;
+    tcgetattr(fd, &t);
+    cfmakeraw(&t);
+    cfsetispeed(&t, sp);
+    cfsetospeed(&t, sp);
+    t.c_cflag |= CLOCAL | CREAD;
+    t.c_cc[VMIN]  = 1;
+    t.c_cc[VTIME] = 1;
+    tcsetattr(fd, TCSANOW, &t);
+    tcflush(fd, TCIFLUSH);
+    return fd;
+}
+
+/* ——————————————————— BANCO DE PRUEBA SOBRE SEÑAL GRABADA ——————————— */
+/* Sellos de la captura: *nt = 0 si no los trae */
+static uint16_t *load_signal(const char *path, size_t *n, uint32_t **ts, size_t *nt)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) { perror(path); return NULL; }
+    size_t cap = 1 << 16, k = 0;
+    uint16_t *x = malloc(cap * sizeof *x);
+    uint32_t *t = malloc(cap * sizeof *t);
+    int c0 = fgetc(f);
+    ungetc(c0, f);
+    *nt = 0;
+
+    if (c0 == 0xAA) {                       // captura del 021
+        uint8_t p[8];
+        int a;
+        while ((a = fgetc(f)) != EOF) {
+            if (a != 0xAA) continue;
+            if ((a = fgetc(f)) == EOF) break;
+            if (a != 0x55 && a != 0x56) { ungetc(a, f); continue; }
+            size_t len = (a == 0x56) ? 6U : 2U;
+            if (fread(p, 1, len, f) != len) break;
+            if (k == cap) {
+                x = realloc(x, (cap *= 2) * sizeof *x);
+                t = realloc(t, cap * sizeof *t);
+            }
+            x[k] = (uint16_t)(((p[0] << 8) | p[1]) & 0x3FF);
+            if (len == 6U && *nt == k)      // sólo si todas las anteriores lo traen
+                t[(*nt)++] = (uint32_t)p[2] << 24 | (uint32_t)p[3] << 16 |
+                             (uint32_t)p[4] << 8 | p[5];
+            k++;
+        }
+    } else {                                // texto
+        unsigned v;
+        while (fscanf(f, "%u", &v) == 1) {
+            if (k == cap) x = realloc(x, (cap *= 2) * sizeof *x);
+            x[k++] = (uint16_t)(v & 0x3FF);
+        }
+    }
+    fclose(f);
+    if (*nt != k) *nt = 0;                  // captura mezclada: sin sellos
+    if (*nt) *ts = t; else free(t);
+    *n = k - k % ADC_PACK_N;
+    return x;
+}
+
+/* Intervalo entre muestras consecutivas según los sellos de 32 bits */
+static void bench_stamps(const uint32_t *t, size_t nt)
+{
+    double sum = 0, mn = 0, mx = 0;
+    for (size_t i = 1; i < nt; i++) {
+        double d = (double)(uint32_t)(t[i] - t[i - 1]);
+        sum += d;
+        if (i == 1 || d < mn) mn = d;
+        if (i == 1 || d > mx) mx = d;
+    }
+    if (nt < 2) return;
+    printf("sellos: %zu, intervalo medio %.1f us (%.1f muestras/s), mín %.1f, máx %.1f, "
+           "jitter %.1f us (reloj %.0f Hz, -t)\n",
+           nt, 1e6 * sum / (nt - 1) / g_hz, g_hz * (nt - 1) / sum, 1e6 * mn / g_hz,
+           1e6 * mx / g_hz, 1e6 * (mx - mn) / g_hz, g_hz);
+}
+
+static int bench(const char *path)
+{
+    size_t n, nt;
+    uint32_t *ts = NULL;
+    uint16_t *x = load_signal(path, &n, &ts, &nt);
+    if (!x || n == 0) { fprintf(stderr, "%s: sin muestras\n", path); return 1; }
+
+    size_t nblk = n / ADC_PACK_N;
+    uint8_t *enc = malloc(nblk * ADC_PACK_FRAME_MAX);
+    size_t  *off = malloc((nblk + 1) * sizeof *off);
+    unsigned long rice = 0, bad = 0;
+    int reps = 0;
+
+    double t0 = now_s(), te;
+    do {
+        off[0] = 0;
+        for (size_t b = 0; b < nblk; b++)
+            off[b + 1] = off[b] + adc_pack_block(enc + off[b], x + b * ADC_PACK_N, 0, (uint8_t)b);
+        reps++;
+    } while ((te = now_s() - t0) < 0.5);
+    double enc_rate = (double)n * reps / te;
+
+    reps = 0;
+    t0 = now_s();
+    double td;
+    do {
+        rice = bad = 0;
+        for (size_t b = 0; b < nblk; b++) {
+            uint16_t y[ADC_PACK_N];
+            uint8_t ch, seq;
+            if (!adc_unpack_block(enc + off[b], y, &ch, &seq) ||
+                memcmp(y, x + b * ADC_PACK_N, sizeof y) != 0) bad++;
+            if ((enc[off[b] + 3] >> 6) == ADC_PACK_RICE) rice++;
+        }
+        reps++;
+    } while ((td = now_s() - t0) < 0.5);
+    double dec_rate = (double)n * reps / td;
+
+    double bps = (double)off[nblk] / n;
+    printf("%s: %zu muestras, %zu bytes, %.3f B/muestra (×%.2f vs 021, ×%.2f vs 10 bits)\n",
+           path, n, off[nblk], bps, 4.0 / bps, 1.25 / bps);
+    printf("bloques rice %lu / raw %lu, %lu no coinciden\n", rice, nblk - rice, bad);
+    printf("a 115200 bps: %.0f muestras/s (021: %.0f, sellado: %.0f)\n",
+           11520.0 / bps, 11520.0 / 4.0, 11520.0 / 8.0);
+    printf("PC: codificar %.1f M muestras/s, decodificar %.1f M muestras/s\n",
+           enc_rate * 1e-6, dec_rate * 1e-6);
+    bench_stamps(ts, nt);
+    free(x); free(ts); free(enc); free(off);
+    return bad ? 1 : 0;
+}
+
+/* ——————————————————— MAIN ——————————————————— */
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "uso: %s <puerto> [baud] | -f <captura> | -b <señal>"
+                "  [-o salida.csv] [-t Hz]\n", argv[0]);
+        return 2;
+    }
+    int nargs = argc;
+    for (int i = 2; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0) {
+            g_csv = fopen(argv[i + 1], "w");
+            if (!g_csv) { perror(argv[i + 1]); return 1; }
+        } else if (strcmp(argv[i], "-t") == 0) {
+            g_hz = atof(argv[i + 1]);
+            if (g_hz <= 0) { fprintf(stderr, "-t: Hz > 0\n"); return 2; }
+        } else {
+            continue;
+        }
+        if (i < nargs) nargs = i;
+        i++;
+    }
+    argc = nargs;
+
+    if (strcmp(argv[1], "-b") == 0 && argc > 2) return bench(argv[2]);
+
+    int live = strcmp(argv[1], "-f") != 0;
+    int fd;
+    if (!live) {
+        if (argc < 3) return 2;
+        fd = open(argv[2], O_RDONLY);
+        if (fd < 0) { perror(argv[2]); return 1; }
+    } else {
+        fd = open_port(argv[1], argc > 2 ? atol(argv[2]) : 115200L);
+        if (fd < 0) return 1;
+    }
+    int r = run_stream(fd, live);
+    if (g_csv) fclose(g_csv);
+    return r;
+}
@@ -0,0 +1,368 @@
+/*************************************************************
+ *  autobaud_sim – uart_autobaud.h contra un FRC desviado, en PC
+ *
+ *  cc -O2 -Wall -I.. -o autobaud_sim autobaud_sim.c -lm
+ *
+ *  El dsPIC corre a FCY = 7.37 MHz × 8 / 4 con el FRC desviado
+ *  (tolerancia de fábrica más temperatura, −5…+5 %) y OSCTUN con un
+ *  paso por unidad que el firmware no conoce (0.75 % y 1.5 %). El
+ *  host es exacto. Se simulan:
+ *    – las capturas de IC2: cada flanco de la línea en el TCY del
+ *      dsPIC que sigue, con Timer2 de 16 bits y una fase al azar
+ *    – la recepción de una UART con muestreo ×16: el arranque se
+ *      detecta en el primer tick bajo y cada bit es la mayoría de los
+ *      ticks 7, 8 y 9; error si algún bit o el de parada no coincide.
+ *      Vale para los dos sentidos (el host también muestrea ×16).
+ *  Un enlace es bueno si AB_LINK_BYTES al azar, sin pausas, pasan sin
+ *  error en los dos sentidos. Casos (PASS/FAIL; el código de salida
+ *  es el número de fallas):
+ *    1 medida      – bit medido contra el real, dentro de la
+ *                    resolución de captura, con 'U' seguidos o con
+ *                    pausas de 1 a 3 bits; ningún BRG falso con
+ *                    texto, con 'U' más rápidos que BRG = 0 ni con
+ *                    glitches y pausas entre caracteres
+ *    2 velocidad   – la más alta que sirve para cada desvío: BRG fijo
+ *                    (como 021), autobaud y autobaud + OSCTUN
+ *    3 OSCTUN      – el lazo converge en pocas medidas y deja el
+ *                    reloj dentro de medio paso
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#define AB_HOST
+#include "uart_autobaud.h"
+
+#define FCY_NOM         (7370000.0 * 8.0 / 4.0)    // ≈ 14.74 MHz
+#define AB_LINK_BYTES   400U
+#define NSTD            (sizeof ab_std / sizeof ab_std[0])
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static uint32_t g_rng = 777U;
+static uint32_t rnd32(void)              { g_rng ^= g_rng << 13; g_rng ^= g_rng >> 17; g_rng ^= g_rng << 5; return g_rng; }
+static double   rndu(void)               { return (rnd32() + 0.5) / 4294967296.0; }
+
+/* ——————————————————— LÍNEA ——————————————————— */
+/* Caracteres 8N1 a partir de t0; antes de cada uno, al azar, ninguna
+   pausa o una de 1 a gap_bits_max bits. Lista de flancos en segundos */
+#define MAX_EDGES       4096U
+
+typedef struct {
+    double  t[MAX_EDGES];
+    int     n;
+} edges_t;
+
+static void line_bytes(edges_t *e, const uint8_t *b, int nb, double baud, double t0,
+                       double gap_bits_max)
+{
+    double  tb = 1.0 / baud, t = t0;
+    uint8_t lvl = 1;
+
+    e->n = 0;
+    for (int i = 0; i < nb; i++) {
+        if (gap_bits_max >= 1.0 && (rnd32() & 1U)) t += tb * (1.0 + (gap_bits_max - 1.0) * rndu());
+        for (int k = 0; k < 10; k++) {
+            uint8_t v = (k == 0) ? 0 : (k == 9) ? 1 : (uint8_t)((b[i] >> (k - 1)) & 1U);
+            if (v != lvl && e->n < (int)MAX_EDGES) e->t[e->n++] = t;
+            lvl = v;
+            t += tb;
+        }
+    }
+}
+
+/* Capturas de IC2: TMR2 del primer TCY en o después del flanco */
+static int capture(const edges_t *e, double fcy, uint16_t *cap, int max)
+{
+    double ph = rndu() * 65536.0;
+    int    n = e->n < max ? e->n : max;
+
+    for (int i = 0; i < n; i++)
+        cap[i] = (uint16_t)(uint32_t)fmod(ceil(e->t[i] * fcy + ph), 65536.0);
+    return n;
+}
+
+/* Medida completa como ab_measure(): tandas de AB_CAP_N capturas de
+   un chorro de 'U' que arranca en cualquier flanco */
+static int measure(ab_t *a, double baud, double fcy, double gap_bits)
+{
+    static edges_t e;
+    static uint8_t u[64];
+    static edges_t w;
+    uint16_t       cap[AB_CAP_N];
+
+    for (int i = 0; i < 64; i++) u[i] = 'U';
+    for (int tries = 0; tries < 4; tries++) {
+        line_bytes(&e, u, AB_NRUNS + 2, baud, 0.0, gap_bits);
+        int skip = (int)(rnd32() % 10U);
+        w.n = 0;
+        for (int i = skip; i < e.n && w.n < (int)AB_CAP_N; i++) w.t[w.n++] = e.t[i];
+        if (capture(&w, fcy, cap, (int)AB_CAP_N) < (int)AB_CAP_N) continue;
+        ab_reset(a);
+        for (unsigned i = 0; i < AB_CAP_N; i++)
+            if (ab_feed(a, cap[i])) return 1;
+    }
+    return 0;
+}
+
+/* ——————————————————— UART ×16 ——————————————————— */
+static const uint8_t *g_b;              // bytes en la línea
+static int            g_nb;
+static double         g_tx;             // bit del transmisor
+
+static int line_at(double t)
+{
+    long i = (long)floor(t / g_tx);
+    int  f = (int)(i / 10), k = (int)(i % 10);
+
+    if (f >= g_nb || k == 9) return 1;
+    if (k == 0) return 0;
+    return (g_b[f] >> (k - 1)) & 1;
+}
+
+/* El transmisor manda nb bytes seguidos a bit tx; el receptor muestrea
+   con ticks de rx/16 y una fase al azar. Devuelve los bytes malos. */
+static unsigned uart_rx(const uint8_t *b, int nb, double tx, double rx)
+{
+    double   tick = rx / 16.0, t = rndu() * tick;
+    double   end = nb * 10.0 * tx;
+    unsigned bad = 0;
+    int      got = 0;
+
+    g_b = b; g_nb = nb; g_tx = tx;
+    while (t < end && got < nb) {
+        if (line_at(t)) { t += tick; continue; }
+        /* arranque en t: cada bit por mayoría de los ticks 7, 8, 9 */
+        uint16_t v = 0;
+        for (int k = 0; k < 10; k++) {
+            int s = line_at(t + (16 * k + 7) * tick) + line_at(t + (16 * k + 8) * tick) +
+                    line_at(t + (16 * k + 9) * tick);
+            v |= (uint16_t)((s >= 2) << k);
+        }
+        if (v != (uint16_t)(0x200U | ((uint16_t)b[got] << 1))) bad++;
+        got++;
+        t += (16 * 9 + 9) * tick;        // después de la muestra de parada
+        while (t < end && !line_at(t)) t += tick;
+    }
+    return bad + (unsigned)(nb - got);
+}
+
+static int link_ok(double baud, double fcy_dev, uint16_t brg)
+{
+    static uint8_t b[AB_LINK_BYTES];
+    double         host = 1.0 / baud, dev = 16.0 * (brg + 1U) / fcy_dev;
+
+    for (unsigned i = 0; i < AB_LINK_BYTES; i++) b[i] = (uint8_t)rnd32();
+    return uart_rx(b, AB_LINK_BYTES, host, dev) == 0 &&
+           uart_rx(b, AB_LINK_BYTES, dev, host) == 0;
+}
+
+/* ——————————————————— MODOS ——————————————————— */
+enum { M_FIXED, M_AUTO, M_TRIM, NMODE };
+static const char *const k_mname[NMODE] = { "BRG fijo", "autobaud", "autobaud+TUN" };
+
+typedef struct {
+    uint16_t brg;
+    int8_t   tun;
+    uint8_t  meas;                      // medidas hechas
+    uint8_t  ok;                        // hubo medida
+    double   fcy;                       // reloj final
+} result_t;
+
+static double fcy_of(double skew, double step, int tun)
+{
+    return FCY_NOM * (1.0 + skew) * (1.0 + step * tun);
+}
+
+static result_t run_mode(int mode, double baud, double skew, double step)
+{
+    result_t r = { 0 };
+    ab_t     a;
+
+    r.fcy = fcy_of(skew, step, 0);
+    if (mode == M_FIXED) {
+        r.brg = (uint16_t)(FCY_NOM / (16.0 * baud) - 1.0);   // BRGVAL de 021
+        r.ok  = 1;
+        return r;
+    }
+    if (!measure(&a, baud, r.fcy, 2.0)) return r;
+    r.meas = 1;
+    r.ok   = 1;
+    r.brg  = ab_brg(&a);
+    if (mode == M_AUTO) return r;
+
+    uint32_t ref = ab_ref(ab_baud(&a, (uint32_t)FCY_NOM));
+    if (!ref) return r;
+    ab_trim_t t;
+    ab_trim_init(&t, 0);
+    while (ab_trim_next(&t, &a, ab_clk_err(&a, (uint32_t)FCY_NOM, ref))) {
+        if (!measure(&a, baud, fcy_of(skew, step, t.tun), 2.0)) { r.ok = 0; return r; }
+        r.meas++;
+    }
+    r.tun = t.tun;
+    r.fcy = fcy_of(skew, step, t.tun);
+    a.span = t.best_span;
+    a.bits = t.best_bits;
+    r.brg  = ab_brg(&a);
+    return r;
+}
+
+/* ——————————————————— 1 MEDIDA ——————————————————— */
+static int cmp_d(const void *x, const void *y)
+{
+    double a = *(const double *)x, b = *(const double *)y;
+    return (a > b) - (a < b);
+}
+
+static void case_measure(void)
+{
+    double   worst = 0;
+    unsigned false_lock = 0, text_locks = 0, fast_lock = 0;
+    ab_t     a;
+
+    printf("1 medida: bit medido contra el real, −5…+5 %% de FRC, 2400…921600 bps\n");
+    for (int s = -5; s <= 5; s++) {
+        double fcy = fcy_of(s / 100.0, 0, 0);
+        for (unsigned i = 0; i < NSTD; i++) {
+            double baud = ab_std[i];
+            for (int rep = 0; rep < 20; rep++) {
+                if (!measure(&a, baud, fcy, rep & 1 ? 3.0 : 0.0)) { worst = 1e9; continue; }
+                double real = fcy / baud;                  // TCY por bit
+                double got  = (double)a.span / a.bits;
+                double lim  = (double)AB_NRUNS / a.span + 1e-9; // < 1 TCY por racha
+                double e    = fabs(got - real) / real / lim;
+                if (e > worst) worst = e;
+            }
+        }
+    }
+    printf("    peor error / resolución de captura: %.2f\n", worst);
+    check("bit medido dentro de la resolución de captura", worst <= 1.0);
+
+    /* texto a la velocidad correcta: o no mide o mide bien */
+    {
+        static const char txt[] = "Hola dsPIC, esto no es autobaud: 0123456789 {}[]\r\n";
+        static uint16_t   cap[MAX_EDGES];
+        static edges_t    e;
+        double            fcy = FCY_NOM, baud = 115200.0;
+        for (int rep = 0; rep < 200; rep++) {
+            line_bytes(&e, (const uint8_t *)txt, sizeof txt - 1, baud, 0.0, rep & 1 ? 2.0 : 0.0);
+            int n = capture(&e, fcy, cap, MAX_EDGES);
+            ab_reset(&a);
+            for (int i = 0; i < n; i++)
+                if (ab_feed(&a, cap[i])) {
+                    text_locks++;
+                    if (ab_brg(&a) != 7U) false_lock++;
+                    break;
+                }
+        }
+    }
+    /* 'U' con bits de menos de 16 TCY y con glitches de 200 ns */
+    {
+        static uint16_t cap[MAX_EDGES];
+        static edges_t  e;
+        static uint8_t  u[32];
+        for (int i = 0; i < 32; i++) u[i] = 'U';
+        line_bytes(&e, u, 32, 1843200.0, 0.0, 0.0);
+        int n = capture(&e, FCY_NOM, cap, MAX_EDGES);
+        ab_reset(&a);
+        for (int i = 0; i < n; i++) if (ab_feed(&a, cap[i])) { fast_lock++; break; }
+
+        for (int rep = 0; rep < 200; rep++) {
+            line_bytes(&e, u, 8, 115200.0, 0.0, 4.0);
+            int k = e.n;                               // un glitch en algún bit
+            double tg = e.t[rnd32() % (unsigned)e.n] + 2e-6;
+            e.t[k] = tg; e.t[k + 1] = tg + 200e-9; e.n = k + 2;
+            qsort(e.t, (size_t)e.n, sizeof e.t[0], cmp_d);
+            n = capture(&e, FCY_NOM, cap, MAX_EDGES);
+            ab_reset(&a);
+            for (int i = 0; i < n; i++)
+                if (ab_feed(&a, cap[i])) { if (ab_brg(&a) != 7U) false_lock++; break; }
+        }
+    }
+    printf("    texto: %u de 200 corridas completaron una medida; BRG falsos %u\n", text_locks, false_lock);
+    check("ningún BRG falso (texto, glitches, pausas)", false_lock == 0);
+    check("'U' a 1843200 bps (8 TCY por bit) no da medida", fast_lock == 0);
+}
+
+/* ——————————————————— 2 VELOCIDAD MÁXIMA ——————————————————— */
+static double max_baud(int mode, double skew, double step)
+{
+    double best = 0;
+    for (unsigned i = 0; i < NSTD; i++) {
+        double   baud = ab_std[i];
+        result_t r = run_mode(mode, baud, skew, step);
+        if (r.ok && link_ok(baud, r.fcy, r.brg)) best = baud;
+    }
+    return best;
+}
+
+static void case_speed(void)
+{
+    double mx[NMODE][11];
+    int    auto_ge = 1, trim_all = 1, fixed_fails = 0;
+
+    printf("2 velocidad más alta sin errores (%u bytes por sentido), paso de TUN 0.75 %%\n", AB_LINK_BYTES);
+    printf("      FRC      ");
+    for (int m = 0; m < NMODE; m++) printf("%14s", k_mname[m]);
+    printf("\n");
+    for (int s = -5; s <= 5; s++) {
+        printf("    %+3d %%     ", s);
+        for (int m = 0; m < NMODE; m++) {
+            mx[m][s + 5] = max_baud(m, s / 100.0, 0.0075);
+            printf("%14.0f", mx[m][s + 5]);
+        }
+        printf("\n");
+        if (mx[M_AUTO][s + 5] < mx[M_FIXED][s + 5]) auto_ge = 0;
+        if (mx[M_TRIM][s + 5] < 921600.0) trim_all = 0;
+        if (mx[M_FIXED][s + 5] < 115200.0) fixed_fails = 1;
+    }
+    check("con BRG fijo algún desvío ya no llega a 115200", fixed_fails);
+    check("autobaud nunca peor que BRG fijo", auto_ge);
+    check("autobaud + OSCTUN: 921600 (BRG = 0) en todo el rango", trim_all);
+}
+
+/* ——————————————————— 3 OSCTUN ——————————————————— */
+static void case_trim(void)
+{
+    static const double k_step[] = { 0.0075, 0.015 };
+    int      conv = 1;
+    unsigned meas_all = 0;
+
+    printf("3 OSCTUN: medidas y error final del reloj (921600 bps)\n");
+    for (unsigned k = 0; k < 2; k++) {
+        double   step = k_step[k], worst = 0;
+        unsigned meas_max = 0;
+        for (int s10 = -50; s10 <= 50; s10 += 5) {
+            double   skew = s10 / 1000.0;
+            result_t r = run_mode(M_TRIM, 921600.0, skew, step);
+            double   e = fabs(r.fcy / FCY_NOM - 1.0);
+            if (!r.ok) { conv = 0; continue; }
+            if (r.meas > meas_max) meas_max = r.meas;
+            /* medio paso más la resolución de una medida a 16 TCY por bit */
+            if (e > step / 2 + 1.0 / (AB_RUN * 16.0)) conv = 0;
+            if (e / step > worst) worst = e / step;
+        }
+        printf("    paso %.2f %%: hasta %u medidas, error final ≤ %.2f pasos\n",
+               100 * step, meas_max, worst);
+        if (meas_max > meas_all) meas_all = meas_max;
+    }
+    check("converge dentro de medio paso (más la resolución)", conv);
+    check("a lo sumo 10 medidas", meas_all <= 10U);
+}
+
+int main(void)
+{
+    printf("uart_autobaud: FCY nominal %.0f Hz, %u 'U' por medida\n\n", FCY_NOM, AB_NRUNS);
+    case_measure();
+    case_speed();
+    case_trim();
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,356 @@
+/*************************************************************
+ *  link_sim – uart_link.h bajo saturación, simulado en PC
+ *
+ *  cc -O2 -Wall -I.. -o link_sim link_sim.c
+ *
+ *  El tiempo avanza de a un bit a LINK_BAUD. Cada UART tiene un FIFO
+ *  de 4 bytes más el registro de desplazamiento (UTXBF = FIFO lleno);
+ *  cada byte que termina de salir entra a link_rx_byte() del otro
+ *  extremo. link_pump() corre en cada bit (el lazo del dsPIC es mucho
+ *  más rápido que un bit). Tráfico:
+ *    CTRL   consignas de 6 bytes, llegadas de Poisson a 50/s
+ *    LOG    24 bytes a 10/s
+ *    TELEM  marcos de 50 bytes (el peor caso de adc_pack.h) al 150 %
+ *           de lo que cabe en un puerto: la cola siempre está llena
+ *  Cada mensaje lleva tipo, número y un contenido que se verifica al
+ *  llegar. Casos (PASS/FAIL; el código de salida es el número de
+ *  fallas):
+ *    1 un puerto    – todo mensaje aceptado llega una vez, en orden y
+ *                     sin cambios; el cable va lleno; cada CTRL llega
+ *                     antes del resto de una trama (LINK_FRAME_MAX
+ *                     bytes) más el FIFO, las CTRL que ya estaban en su
+ *                     cola y la propia
+ *    2 sin canales  – el mismo tráfico con CTRL metido en la cola de
+ *                     TELEM (como hoy en 021/022): CTRL espera la cola
+ *                     entera y se pierde cuando está llena
+ *    3 dos puertos  – TELEM y CTRL por U1 y U2, LOG sólo por U1: el
+ *                     doble de tráfico útil, mismas cotas para CTRL,
+ *                     orden por (puerto, canal)
+ *    4 errores      – un bit errado cada 10^4: ninguna entrega mala,
+ *                     se resincroniza y se cuentan CRC y huecos
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define LINK_BAUD       115200UL
+#define SIM_SECONDS     20UL
+#define DRAIN_SECONDS   2UL
+
+static uint32_t g_bit;                  // tiempo, en bits
+static int      sim_tx_ready(uint8_t p);
+static void     sim_tx_put(uint8_t p, uint8_t b);
+
+#define LINK_HOST
+#define LINK_NOW()              g_bit
+#define LINK_TX_READY(p)        sim_tx_ready(p)
+#define LINK_TX_PUT(p, b)       sim_tx_put((p), (b))
+#define LINK_CHANNELS(X) \
+    X(CTRL,   64, 255, LINK_U1 | LINK_U2) \
+    X(LOG,   128, 255, LINK_U1 | LINK_U2) \
+    X(TELEM, 512, 255, LINK_U1 | LINK_U2)
+#include "uart_link.h"
+
+#define BYTE_BITS       10U             // 8N1
+#define FIFO_DEPTH      4U
+#define NTYPE           3U
+#define MAX_ID          65536U
+
+enum { T_CTRL, T_LOG, T_TELEM };
+static const char   *const k_tname[NTYPE] = { "CTRL", "LOG", "TELEM" };
+static const uint8_t k_tlen[NTYPE] = { 6, 24, 50 };
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static uint32_t g_rng = 1U;
+static uint32_t rnd32(void)              { g_rng ^= g_rng << 13; g_rng ^= g_rng >> 17; g_rng ^= g_rng << 5; return g_rng; }
+static double   rndu(void)               { return (rnd32() + 0.5) / 4294967296.0; }
+
+/* ——————————————————— UART SIMULADA ——————————————————— */
+typedef struct {
+    uint8_t  fifo[FIFO_DEPTH];
+    uint8_t  n, rd;
+    uint8_t  sh;                        // byte en el registro de desplazamiento
+    uint8_t  busy;                      // bits que le faltan
+    uint32_t bits_busy;                 // utilización
+} sim_uart_t;
+
+static sim_uart_t g_u[LINK_NPORT];
+static double     g_ber;
+static uint32_t   g_flips;
+
+static int sim_tx_ready(uint8_t p)       { return g_u[p].n < FIFO_DEPTH; }
+
+static void sim_tx_put(uint8_t p, uint8_t b)
+{
+    sim_uart_t *u = &g_u[p];
+    if (u->n >= FIFO_DEPTH) { fprintf(stderr, "escritura con UTXBF\n"); exit(99); }
+    u->fifo[(u->rd + u->n++) % FIFO_DEPTH] = b;
+}
+
+/* Un bit de tiempo; el byte que termina va al receptor */
+static void sim_uart_bit(uint8_t p)
+{
+    sim_uart_t *u = &g_u[p];
+
+    if (u->busy == 0 && u->n) {
+        u->sh = u->fifo[u->rd];
+        u->rd = (uint8_t)((u->rd + 1U) % FIFO_DEPTH);
+        u->n--;
+        u->busy = BYTE_BITS;
+    }
+    if (u->busy == 0) return;
+    u->bits_busy++;
+    if (g_ber > 0 && rndu() < g_ber) {
+        u->sh ^= (uint8_t)(1U << (rnd32() & 7U));
+        g_flips++;
+    }
+    if (--u->busy == 0) link_rx_byte(p, u->sh);
+}
+
+/* ——————————————————— TRÁFICO Y VERIFICACIÓN ——————————————————— */
+static uint32_t g_sent_t[NTYPE][MAX_ID];
+static uint8_t  g_state[NTYPE][MAX_ID]; // 0 no enviado, 1 aceptado, 2 descartado, 3 recibido
+static uint32_t g_next_id[NTYPE];
+static uint32_t g_last_id[LINK_NPORT][NTYPE];
+static uint32_t g_rx_n[NTYPE], g_dup, g_bad, g_order;
+static uint64_t g_lat_sum[NTYPE];
+static uint32_t g_lat_max[NTYPE];
+static uint8_t  g_route[NTYPE];         // canal de cada tipo
+static uint8_t  g_ahead[MAX_ID];        // CTRL ya en su cola al enviar
+static uint32_t g_ctrl_over, g_ctrl_queued;
+static double   g_ctrl_bound0, g_ctrl_bits;
+
+static void fill(uint8_t *m, uint8_t type, uint32_t id)
+{
+    m[0] = type;
+    for (uint8_t k = 0; k < 4; k++) m[1 + k] = (uint8_t)(id >> (8 * k));
+    for (uint8_t k = 5; k < k_tlen[type]; k++) m[k] = (uint8_t)(id * 7U + k * 13U + type);
+}
+
+static void produce(uint8_t type)
+{
+    uint8_t  m[64];
+    uint32_t id = g_next_id[type]++;
+
+    if (id >= MAX_ID) { fprintf(stderr, "MAX_ID\n"); exit(99); }
+    fill(m, type, id);
+    if (type == T_CTRL) {
+        const link_ch_t *c = &g_link.ch[g_route[type]];
+        g_ahead[id] = (uint8_t)((uint16_t)(c->head - c->tail) / (LINK_QHDR + k_tlen[T_CTRL]));
+        if (g_ahead[id]) g_ctrl_queued++;
+    }
+    g_sent_t[type][id] = g_bit;
+    g_state[type][id]  = link_send(g_route[type], m, k_tlen[type]) ? 1 : 2;
+}
+
+static void link_on_msg(uint8_t p, uint8_t ch, const uint8_t *m, uint8_t len)
+{
+    uint8_t  ref[64];
+    uint8_t  type = m[0];
+    uint32_t id = 0;
+
+    (void)ch;
+    if (len < 5 || type >= NTYPE || len != k_tlen[type]) { g_bad++; return; }
+    for (uint8_t k = 0; k < 4; k++) id |= (uint32_t)m[1 + k] << (8 * k);
+    if (id >= g_next_id[type]) { g_bad++; return; }
+    fill(ref, type, id);
+    if (memcmp(ref, m, len) != 0) { g_bad++; return; }
+    if (g_state[type][id] == 3) { g_dup++; return; }
+    if (g_state[type][id] != 1) { g_bad++; return; }
+
+    g_state[type][id] = 3;
+    if (g_last_id[p][type] != UINT32_MAX && id < g_last_id[p][type]) g_order++;
+    g_last_id[p][type] = id;
+
+    uint32_t lat = g_bit - g_sent_t[type][id];
+    g_rx_n[type]++;
+    g_lat_sum[type] += lat;
+    if (lat > g_lat_max[type]) g_lat_max[type] = lat;
+    /* cota: el resto de una trama, el FIFO y las CTRL de adelante más la propia */
+    if (type == T_CTRL && lat > g_ctrl_bound0 + (g_ahead[id] + 1U) * g_ctrl_bits) g_ctrl_over++;
+}
+
+/* ——————————————————— CORRIDA ——————————————————— */
+typedef struct {
+    double   rate[NTYPE];               // mensajes/s
+    uint8_t  route[NTYPE];              // canal por tipo
+    uint8_t  ports[LINK_NCH];           // puertos por canal
+    double   ber;
+} sim_cfg_t;
+
+typedef struct {
+    uint32_t accepted[NTYPE], dropped[NTYPE], lost[NTYPE];
+    double   util[LINK_NPORT];          // fracción del tiempo con el cable ocupado
+    double   useful_bps;                // bytes de payload entregados por segundo
+} sim_res_t;
+
+static void run(const sim_cfg_t *cfg, sim_res_t *res)
+{
+    const uint32_t bits_run = SIM_SECONDS * LINK_BAUD;
+    const uint32_t bits_end = bits_run + DRAIN_SECONDS * LINK_BAUD;
+    double next[NTYPE];
+
+    memset(g_u, 0, sizeof g_u);
+    memset(g_state, 0, sizeof g_state);
+    memset(g_next_id, 0, sizeof g_next_id);
+    memset(g_last_id, 0xFF, sizeof g_last_id);
+    memset(g_rx_n, 0, sizeof g_rx_n);
+    memset(g_lat_sum, 0, sizeof g_lat_sum);
+    memset(g_lat_max, 0, sizeof g_lat_max);
+    g_dup = g_bad = g_order = g_flips = 0;
+    g_ctrl_over = g_ctrl_queued = 0;
+    g_ber = cfg->ber;
+    g_bit = 0;
+
+    link_init();
+    for (uint8_t c = 0; c < LINK_NCH; c++) g_link.ch[c].ports = cfg->ports[c];
+    for (uint8_t t = 0; t < NTYPE; t++) {
+        g_route[t] = cfg->route[t];
+        next[t] = cfg->rate[t] > 0 ? LINK_BAUD / cfg->rate[t] * rndu() : 1e30;
+    }
+
+    for (; g_bit < bits_end; g_bit++) {
+        for (uint8_t t = 0; t < NTYPE && g_bit < bits_run; t++) {
+            while (next[t] <= g_bit) {
+                produce(t);
+                /* CTRL: Poisson; el resto periódico con un poco de jitter */
+                double gap = LINK_BAUD / cfg->rate[t];
+                next[t] += (t == T_CTRL) ? -gap * log(rndu()) : gap * (0.9 + 0.2 * rndu());
+            }
+        }
+        link_pump();
+        for (uint8_t p = 0; p < LINK_NPORT; p++) sim_uart_bit(p);
+    }
+
+    uint64_t payload = 0;
+    for (uint8_t t = 0; t < NTYPE; t++) {
+        res->accepted[t] = res->dropped[t] = res->lost[t] = 0;
+        for (uint32_t id = 0; id < g_next_id[t]; id++) {
+            if (g_state[t][id] == 2) res->dropped[t]++;
+            else res->accepted[t]++;
+            if (g_state[t][id] == 1) res->lost[t]++;
+        }
+        payload += (uint64_t)g_rx_n[t] * k_tlen[t];
+    }
+    for (uint8_t p = 0; p < LINK_NPORT; p++)
+        res->util[p] = (double)g_u[p].bits_busy / bits_run;
+    res->useful_bps = (double)payload / (bits_end / (double)LINK_BAUD);
+}
+
+static double bits_to_ms(double b)   { return b * 1000.0 / LINK_BAUD; }
+
+static void print_res(const sim_res_t *r)
+{
+    printf("      tipo    aceptados descartados  recibidos  latencia media / máx (ms)\n");
+    for (uint8_t t = 0; t < NTYPE; t++)
+        printf("      %-6s %10lu %11lu %10lu   %8.2f / %8.2f\n", k_tname[t],
+               (unsigned long)r->accepted[t], (unsigned long)r->dropped[t],
+               (unsigned long)g_rx_n[t],
+               g_rx_n[t] ? bits_to_ms((double)g_lat_sum[t] / g_rx_n[t]) : 0.0,
+               bits_to_ms(g_lat_max[t]));
+    printf("      canal   espera media / máx (ms)   tramas\n");
+    for (uint8_t c = 0; c < LINK_NCH; c++) {
+        const link_stats_t *s = &g_link.st[c];
+        printf("      %-6s %8.2f / %8.2f       %8lu\n", k_tname[c],
+               s->msgs ? bits_to_ms((double)s->wait_sum / s->msgs) : 0.0,
+               bits_to_ms(s->wait_max), (unsigned long)s->frames);
+    }
+    printf("      cable ocupado U1 %.1f %%  U2 %.1f %%, útil %.0f B/s\n",
+           100.0 * r->util[0], 100.0 * r->util[1], r->useful_bps);
+}
+
+static int all_delivered(const sim_res_t *r)
+{
+    uint32_t lost = 0;
+    for (uint8_t t = 0; t < NTYPE; t++) lost += r->lost[t];
+    return lost == 0 && g_dup == 0 && g_bad == 0;
+}
+
+/* ——————————————————— CASOS ——————————————————— */
+int main(void)
+{
+    const double frame_bits = (double)LINK_FRAME_MAX * BYTE_BITS;
+    const double ctrl_bits  = (double)(k_tlen[T_CTRL] + LINK_OVH) * BYTE_BITS;
+    const double fifo_bits  = (double)(FIFO_DEPTH + 1U) * BYTE_BITS;
+    /* TELEM cabe: 50 bytes en tramas de LINK_MTU */
+    const double telem_wire = k_tlen[T_TELEM] + LINK_OVH * ((k_tlen[T_TELEM] + LINK_MTU - 1U) / LINK_MTU);
+    const double telem_cap  = LINK_BAUD / BYTE_BITS / telem_wire;
+    sim_res_t    r1, r2, r3;
+    double       ctrl_mean1;
+
+    g_ctrl_bound0 = frame_bits + fifo_bits;
+    g_ctrl_bits   = ctrl_bits;
+
+    printf("uart_link: %lu baud, LINK_MTU %u, trama máx %u B (%.2f ms), TELEM cabe a %.0f/s por puerto\n\n",
+           LINK_BAUD, LINK_MTU, LINK_FRAME_MAX, bits_to_ms(frame_bits), telem_cap);
+
+    sim_cfg_t one = {
+        .rate  = { 50, 10, 1.5 * telem_cap },
+        .route = { LINK_CH_CTRL, LINK_CH_LOG, LINK_CH_TELEM },
+        .ports = { LINK_U2, LINK_U2, LINK_U2 },
+    };
+
+    printf("1 un puerto (U2), TELEM al 150 %%\n");
+    run(&one, &r1);
+    print_res(&r1);
+    ctrl_mean1 = (double)g_lat_sum[T_CTRL] / g_rx_n[T_CTRL];
+    printf("      CTRL con otras CTRL delante al llegar: %lu\n", (unsigned long)g_ctrl_queued);
+    check("todo lo aceptado llega una vez y sin cambios", all_delivered(&r1));
+    check("en orden", g_order == 0);
+    check("saturado: TELEM descarta en la cola, CTRL y LOG no",
+          r1.dropped[T_TELEM] > 0 && r1.dropped[T_CTRL] == 0 && r1.dropped[T_LOG] == 0);
+    check("cable U2 ocupado ≥ 98 %", r1.util[1] >= 0.98);
+    check("entrega de CTRL ≤ trama + FIFO + las CTRL de adelante y la propia", g_ctrl_over == 0);
+
+    printf("\n2 sin canales: CTRL en la cola de TELEM\n");
+    sim_cfg_t flat = one;
+    flat.route[T_CTRL] = LINK_CH_TELEM;
+    run(&flat, &r2);
+    print_res(&r2);
+    double ctrl_mean2 = (double)g_lat_sum[T_CTRL] / g_rx_n[T_CTRL];
+    printf("      CTRL media: %.2f ms con canales, %.2f ms sin ellos\n",
+           bits_to_ms(ctrl_mean1), bits_to_ms(ctrl_mean2));
+    check("sin canales CTRL espera toda la cola (media ≥ 10×) y se descarta",
+          ctrl_mean2 >= 10.0 * ctrl_mean1 && r2.dropped[T_CTRL] > 0);
+
+    printf("\n3 dos puertos, TELEM al 150 %% de los dos\n");
+    sim_cfg_t two = {
+        .rate  = { 50, 10, 3.0 * telem_cap },
+        .route = { LINK_CH_CTRL, LINK_CH_LOG, LINK_CH_TELEM },
+        .ports = { LINK_U1 | LINK_U2, LINK_U1, LINK_U1 | LINK_U2 },
+    };
+    run(&two, &r3);
+    print_res(&r3);
+    check("todo lo aceptado llega una vez y sin cambios", all_delivered(&r3));
+    check("en orden por (puerto, canal)", g_order == 0);
+    check("útil ≥ 1.9× un puerto", r3.useful_bps >= 1.9 * r1.useful_bps);
+    check("entrega de CTRL ≤ trama + FIFO + las CTRL de adelante y la propia", g_ctrl_over == 0);
+
+    printf("\n4 errores de línea: un bit cada 10^4, un puerto\n");
+    sim_cfg_t noisy = one;
+    noisy.ber = 1e-4;
+    sim_res_t r4;
+    run(&noisy, &r4);
+    uint32_t acc = 0, got = 0;
+    for (uint8_t t = 0; t < NTYPE; t++) { acc += r4.accepted[t]; got += g_rx_n[t]; }
+    uint32_t gaps = 0;
+    for (uint8_t c = 0; c < LINK_NCH; c++) gaps += g_link.st[c].rx_gaps;
+    printf("      bits errados %lu, tramas con CRC malo %u, longitud mala %u, huecos %lu\n",
+           (unsigned long)g_flips, g_link.port[1].crc_err, g_link.port[1].len_err, (unsigned long)gaps);
+    printf("      entregados %lu de %lu (%.1f %%)\n", (unsigned long)got, (unsigned long)acc, 100.0 * got / acc);
+    check("ninguna entrega mala ni repetida", g_bad == 0 && g_dup == 0);
+    check("los errores se detectan", g_link.port[1].crc_err + g_link.port[1].len_err > 0 && gaps > 0);
+    check("se resincroniza: entrega ≥ 90 %", got >= 0.9 * acc);
+
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,350 @@
+/*************************************************************
+ *  rx_bench – recepción UART2 de 022 a 115200/230400/460800,
+ *  simulada en PC a resolución de TCY
+ *
+ *  cc -O2 -Wall -I.. -o rx_bench rx_bench.c
+ *
+ *  dsPIC30F4011 con FRC + PLL×8 (FCY = 14.74 MHz), PWM a 15 kHz
+ *  como en 022_uart_pwm_control.c. Se modela:
+ *    – U2RX: FIFO de 4 bytes; el 5.º byte con el FIFO lleno activa
+ *      OERR y se pierde, y con OERR = 1 no entra nada más. Borrar
+ *      OERR vacía el FIFO. U2RXIF se activa al pasar un byte al
+ *      FIFO: con URXISEL = 0b00 siempre, con 0b10 si quedan ≥ 3
+ *    – la CPU: ISR de UART2 a IPL5, ISR del PWM a IPL6 (en cada
+ *      límite de periodo y forzada por paquete), una ventana
+ *      opcional a IPL7 (escritura de flash, sección crítica) y
+ *      anidamiento por prioridad. Los costos C_* son estimados del
+ *      código de 022 con XC16 -O1 (prólogo auto_psv incluido); cada
+ *      uno corre el reloj y las ISR de más prioridad en el medio
+ *    – tráfico: paquetes AA 55 MSB LSB seguidos, sin pausas. Cada
+ *      byte lleva el número de su paquete, así se detecta un
+ *      paquete armado con bytes de dos paquetes distintos
+ *  Motores:
+ *    drain   – el de 022: uart2_rx_drain(), rx_fsm_push() y
+ *              uart_rx_isel_next() de uart_rx_drain.h, compilados
+ *              con UART_RX_HOST sobre el FIFO simulado. Vacía el FIFO
+ *              en cada entrada, URXISEL 0b10 / 0b00 según lo que falta
+ *              del paquete, OERR se cuenta y se borra
+ *    legado  – la ISR anterior: un byte por entrada a la misma
+ *              rx_fsm_push(), URXISEL = 0b00, OERR nunca se borra
+ *              (misma entrega al PWM, para comparar sólo la recepción)
+ *  Latencia: del bit de parada del LSB al límite de periodo que
+ *  carga el PDC1 nuevo.
+ *  Casos (PASS/FAIL; el código de salida es el número de fallas):
+ *    1 línea llena    – drain entrega todo a las tres velocidades,
+ *                       sin OERR ni paquetes mezclados, con menos
+ *                       entradas por paquete que legado y latencia
+ *                       ≤ un periodo PWM + costos de las ISR
+ *    2 bloqueo IPL7   – 600 µs cada 10 ms: drain cuenta el OERR,
+ *                       se resincroniza y sigue recibiendo hasta el
+ *                       final; legado se traba en el primer bloqueo
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FCY             (7370000UL * 8UL / 4UL)     // PLL×8: 14.74 MHz
+#define PWM_FREQ_HZ     15000UL
+#define PTPER_VAL       ((FCY / PWM_FREQ_HZ) - 1UL)  // 981
+#define PWM_PERIOD      (PTPER_VAL + 1UL)
+#define SIM_MS          200UL
+#define SIM_TCY         (FCY / 1000UL * SIM_MS)
+#define TX_END          (SIM_TCY - 4UL * PWM_PERIOD) // margen para entregar el último
+
+#define FIFO_DEPTH      4U
+
+/* Costos estimados en TCY */
+#define C_ENTRY         20U     // latencia de interrupción + prólogo + sello + borrar IF
+#define C_BYTE          25U     // URXDA, FERR/PERR, U2RXREG, bytes++, FSM
+#define C_PKT           45U     // duty10_to_pdc (32 bits) y publicar
+#define C_TAIL          12U     // OERR y URXISEL
+#define C_EXIT          15U     // epílogo + RETFIE
+#define C_PWM_W         50U     // ISR PWM hasta escribir PDC1
+#define C_PWM           80U     // ISR PWM completa
+
+#define BLK_EVERY       (FCY / 100UL)               // cada 10 ms
+#define BLK_TCY         (FCY / 10000UL * 6UL)       // 600 µs
+#define BLK_PHASE       (FCY / 1000UL * 3UL + 123UL)
+
+enum { ENG_DRAIN, ENG_LEGACY };
+
+static int g_fail = 0;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+typedef struct {
+    uint8_t  v;
+    uint32_t pkt;          // paquete de origen (sólo para el banco)
+    uint32_t t_stop;       // TCY del bit de parada
+} rx_byte_t;
+
+typedef struct {
+    uint32_t sent, delivered;
+    uint32_t lost_bytes, overrun;
+    uint32_t splice, bad, dup;
+    uint32_t irq_uart;
+    uint64_t busy_uart, busy_pwm;
+    uint64_t lat_sum;
+    uint32_t lat_n, lat_max;
+    uint32_t last_pkt;
+} res_t;
+
+/* ——— estado del periférico y de la CPU ——— */
+static rx_byte_t g_fifo[FIFO_DEPTH];
+static uint8_t   g_fh, g_fn;
+static uint8_t   g_oerr, g_rxif, g_pwmif, g_blk_pend, g_isel;
+static int       g_eng, g_block;
+static uint32_t  g_now;                 // TCY
+static uint32_t  g_n, g_t_next, g_byte_tcy;
+static res_t    *R;
+
+/* ——— registros de U2 para uart_rx_drain.h ——— */
+static uint8_t bench_read(void);
+static uint8_t bench_oerr(void);
+
+#define UART_RX_HOST
+#define UART_RX_AVAIL()         (g_fn != 0)
+#define UART_RX_FERR()          0
+#define UART_RX_PERR()          0
+#define UART_RX_READ()          bench_read()
+#define UART_RX_OERR()          bench_oerr()
+#define UART_RX_OERR_CLEAR()    (g_oerr = 0, g_fn = 0)      // borrar OERR vacía el FIFO
+#include "uart_rx_drain.h"
+
+/* ——— lo que 022 publica, visto por el banco ——— */
+static uint32_t  g_msb_pkt;
+static rx_byte_t g_cur;                 // último byte leído de U2RXREG
+static struct { uint16_t pdc; uint32_t t_stop; uint32_t pkt; uint16_t seq; } g_tgt;
+static uint16_t  g_tgt_seq, g_seen_seq;
+
+static uint16_t pkt_duty(uint32_t pkt)
+{
+    return (uint16_t)((pkt * 389UL + 17UL) & 0x03FF);
+}
+
+static uint8_t pkt_byte(uint32_t n)
+{
+    const uint32_t pkt = n / RX_PKT_LEN;
+    switch (n % RX_PKT_LEN) {
+        case 0:  return 0xAA;
+        case 1:  return 0x55;
+        case 2:  return (uint8_t)(pkt_duty(pkt) >> 8);
+        default: return (uint8_t)pkt_duty(pkt);
+    }
+}
+
+/* Un byte termina su bit de parada */
+static void uart_receive(uint32_t n, uint32_t now)
+{
+    if (g_oerr) { R->lost_bytes++; return; }
+    if (g_fn == FIFO_DEPTH) { g_oerr = 1; R->lost_bytes++; return; }
+
+    rx_byte_t *b = &g_fifo[(g_fh + g_fn) % FIFO_DEPTH];
+    b->v = pkt_byte(n);
+    b->pkt = n / RX_PKT_LEN;
+    b->t_stop = now;
+    g_fn++;
+    if (g_isel == UART_RX_ISEL_1 || g_fn >= 3U) g_rxif = 1;
+}
+
+/* ——— tiempo: cada TCY corre los eventos y, antes, las ISR de más prioridad ——— */
+static void isr_uart(void);
+static void isr_pwm(void);
+static void isr_blk(void);
+
+/* Eventos del instante g_now: fin de un byte, límite de periodo, bloqueo */
+static void events(void)
+{
+    if (g_now == g_t_next && g_now < TX_END) {
+        uart_receive(g_n++, g_now);
+        g_t_next += g_byte_tcy;
+    }
+    if (g_now % PWM_PERIOD == 0) g_pwmif = 1;
+    if (g_block && g_now % BLK_EVERY == BLK_PHASE) g_blk_pend = 1;
+}
+
+/* Un TCY del código que corre a IPL level */
+static void cycle(int level)
+{
+    for (;;) {
+        if      (g_blk_pend && level < 7) { g_blk_pend = 0; isr_blk(); }
+        else if (g_pwmif && level < 6)    { g_pwmif = 0; isr_pwm(); }
+        else if (g_rxif && level < 5)     { R->irq_uart++; isr_uart(); }
+        else break;
+    }
+    if      (level == 5) R->busy_uart++;
+    else if (level == 6) R->busy_pwm++;
+    g_now++;
+    events();
+}
+
+static void spend(int level, uint32_t tcy)
+{
+    while (tcy--) cycle(level);
+}
+
+/* U2RXREG: C_BYTE por byte leído */
+static uint8_t bench_read(void)
+{
+    spend(5, C_BYTE);
+    g_cur = g_fifo[g_fh];
+    g_fh = (uint8_t)((g_fh + 1U) % FIFO_DEPTH);
+    g_fn--;
+    if (g_rx_state == 2) g_msb_pkt = g_cur.pkt;         // la FSM espera el MSB
+    return g_cur.v;
+}
+
+/* OERR al final del vaciado: C_TAIL con URXISEL */
+static uint8_t bench_oerr(void)
+{
+    spend(5, C_TAIL);
+    return g_oerr;
+}
+
+/* Paquete completo desde rx_fsm_push() */
+static void rx_on_packet(uint16_t duty)
+{
+    spend(5, C_PKT);
+    if (g_cur.pkt != g_msb_pkt)                         R->splice++;
+    else if (duty != pkt_duty(g_cur.pkt))               R->bad++;
+    else if (R->delivered && g_cur.pkt <= R->last_pkt)  R->dup++;
+    R->delivered++;
+    R->last_pkt = g_cur.pkt;
+
+    g_tgt.pdc    = duty;
+    g_tgt.t_stop = g_cur.t_stop;
+    g_tgt.pkt    = g_cur.pkt;
+    g_tgt.seq    = ++g_tgt_seq;
+    g_pwmif = 1;                        // IFS2bits.PWMIF = 1
+}
+
+/* _U2RXInterrupt de 022 (o la anterior, en legado) */
+static void isr_uart(void)
+{
+    spend(5, C_ENTRY);
+    g_rxif = 0;                         // IFS1bits.U2RXIF = 0
+    if (g_eng == ENG_DRAIN) {
+        uart2_rx_drain();
+        g_isel = uart_rx_isel_next();
+    } else if (g_fn) {
+        rx_fsm_push(bench_read());      // un byte; OERR queda puesto
+    } else {
+        spend(5, C_BYTE);               // U2RXREG vacío
+    }
+    spend(5, C_EXIT);
+}
+
+/* _PWMInterrupt: PDC1 escrito en el último TCY de C_PWM_W */
+static void isr_pwm(void)
+{
+    spend(6, C_PWM_W);
+    if (g_tgt.seq != g_seen_seq) {
+        g_seen_seq = g_tgt.seq;
+        const uint32_t t_load = ((g_now - 1UL) / PWM_PERIOD + 1UL) * PWM_PERIOD;
+        const uint32_t lat = t_load - g_tgt.t_stop;
+        R->lat_sum += lat;
+        R->lat_n++;
+        if (lat > R->lat_max) R->lat_max = lat;
+    }
+    spend(6, C_PWM - C_PWM_W);
+}
+
+static void isr_blk(void)
+{
+    spend(7, BLK_TCY);
+}
+
+static void run(int eng, uint32_t baud, int block, res_t *r)
+{
+    memset(r, 0, sizeof *r);
+    R = r;
+    g_eng = eng;
+    g_block = block;
+    g_fh = g_fn = 0;
+    g_oerr = g_rxif = g_pwmif = g_blk_pend = 0;
+    g_isel = (eng == ENG_LEGACY) ? UART_RX_ISEL_1 : UART_RX_ISEL;
+    g_rx_state = 0;
+    g_rx_word  = 0;
+    g_rx_stats = (uart_rx_stats_t){ 0 };
+    g_tgt_seq = g_seen_seq = 0;
+    memset(&g_tgt, 0, sizeof g_tgt);
+
+    /* BRG redondeado como en 022; un byte 8N1 = 10 bits × 16 × (BRG + 1) TCY */
+    const uint32_t brg = (FCY + 8UL * baud) / (16UL * baud) - 1UL;
+    g_byte_tcy = 10UL * 16UL * (brg + 1UL);
+    g_n = 0;
+    g_t_next = 1000UL + g_byte_tcy;
+
+    g_now = 0;
+    events();
+    while (g_now < SIM_TCY) cycle(0);
+    r->sent    = g_n / RX_PKT_LEN;
+    r->overrun = g_rx_stats.overrun;
+}
+
+static void print_res(const char *name, uint32_t baud, const res_t *r)
+{
+    const double line = baud / 10.0;
+    const double got  = r->delivered * 4.0 / (SIM_MS / 1000.0);
+    printf("      %-6s %6lu  %6lu/%-6lu %5.1f %%  %4.2f irq/paq  UART %4.1f %%  PWM %4.1f %%"
+           "  lat %5.1f/%5.1f us  OERR %lu\n",
+           name, (unsigned long)baud, (unsigned long)r->delivered, (unsigned long)r->sent,
+           100.0 * got / line,
+           r->delivered ? (double)r->irq_uart / r->delivered : 0.0,
+           100.0 * r->busy_uart / SIM_TCY, 100.0 * r->busy_pwm / SIM_TCY,
+           r->lat_n ? r->lat_sum / (double)r->lat_n * 1e6 / FCY : 0.0,
+           r->lat_max * 1e6 / FCY, (unsigned long)r->overrun);
+}
+
+int main(void)
+{
+    static const uint32_t bauds[] = { 115200UL, 230400UL, 460800UL };
+    const uint32_t nb = sizeof bauds / sizeof bauds[0];
+    const uint32_t lat_bound = PWM_PERIOD + C_ENTRY + C_BYTE + C_PKT + C_TAIL + C_EXIT + 2U * C_PWM;
+    char what[96];
+    res_t d, l;
+
+    printf("rx_bench: FCY %.2f MHz, PWM %lu TCY, %lu ms por corrida\n",
+           FCY / 1e6, (unsigned long)PWM_PERIOD, (unsigned long)SIM_MS);
+
+    printf("\n1 línea llena, sin bloqueos\n");
+    for (uint32_t i = 0; i < nb; i++) {
+        run(ENG_DRAIN,  bauds[i], 0, &d); print_res("drain",  bauds[i], &d);
+        run(ENG_LEGACY, bauds[i], 0, &l); print_res("legado", bauds[i], &l);
+        snprintf(what, sizeof what, "%6lu: drain entrega todo, sin OERR ni mezclas",
+                 (unsigned long)bauds[i]);
+        check(what, d.delivered == d.sent && d.overrun == 0 && d.lost_bytes == 0 &&
+                    d.splice == 0 && d.bad == 0 && d.dup == 0);
+        snprintf(what, sizeof what, "%6lu: menos entradas por paquete que legado",
+                 (unsigned long)bauds[i]);
+        check(what, (uint64_t)d.irq_uart * l.delivered < (uint64_t)l.irq_uart * d.delivered);
+        snprintf(what, sizeof what, "%6lu: latencia <= periodo PWM + ISR (%.1f us)",
+                 (unsigned long)bauds[i], lat_bound * 1e6 / FCY);
+        check(what, d.lat_n == d.delivered && d.lat_max <= lat_bound);
+    }
+
+    printf("\n2 bloqueo IPL7 de %lu us cada %lu ms\n",
+           (unsigned long)(BLK_TCY * 1000000UL / FCY), (unsigned long)(BLK_EVERY * 1000UL / FCY));
+    const uint32_t nblk = (SIM_TCY - BLK_PHASE + BLK_EVERY - 1UL) / BLK_EVERY;
+    for (uint32_t i = 0; i < nb; i++) {
+        run(ENG_DRAIN,  bauds[i], 1, &d); print_res("drain",  bauds[i], &d);
+        run(ENG_LEGACY, bauds[i], 1, &l); print_res("legado", bauds[i], &l);
+        snprintf(what, sizeof what, "%6lu: drain cuenta un OERR por bloqueo y no mezcla",
+                 (unsigned long)bauds[i]);
+        check(what, d.overrun == nblk && d.splice == 0 && d.bad == 0 && d.dup == 0);
+        snprintf(what, sizeof what, "%6lu: drain sigue recibiendo (>= 80 %%, hasta el final)",
+                 (unsigned long)bauds[i]);
+        check(what, d.delivered * 10UL >= d.sent * 8UL && d.last_pkt + 1U == d.sent);
+        snprintf(what, sizeof what, "%6lu: legado se traba en el primer bloqueo",
+                 (unsigned long)bauds[i]);
+        check(what, l.delivered * 10UL < l.sent && l.last_pkt + 1U < d.sent / 10U);
+    }
+
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
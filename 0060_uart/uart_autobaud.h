@@ -0,0 +1,275 @@
+/*************************************************************
+ *  Autobaud por Input Capture y ajuste del FRC – header-only
+ *  (firmware y PC: 026_uart_autobaud.c, host/autobaud_sim.c)
+ *
+ *  El host manda 'U' (0x55): con 8N1 la línea alterna en cada bit,
+ *  10 flancos y 9 intervalos de un bit por carácter, seguidos o con
+ *  pausas. Con U2MODE.ABAUD = 1 el pin U2RX entra a IC2, que captura
+ *  cada flanco contra Timer2 libre a TCY.
+ *    ab_feed()    un intervalo por captura: las rachas de AB_RUN
+ *                 intervalos parejos (±1/16 del primero y 2 TCY de
+ *                 captura) suman al total; una pausa, un glitch o un
+ *                 byte que no es 'U' cortan la racha sin ensuciar la
+ *                 medida. Una pausa de menos de 1/16 de bit no se
+ *                 distingue de un bit de parada largo y entra en la
+ *                 medida (a lo sumo 1/144 por racha).
+ *    ab_brg()     BRG = round(TCY por bit / 16) − 1 sobre todas las
+ *                 rachas (AB_NRUNS caracteres, ±1 TCY de captura
+ *                 repartido en AB_NRUNS · 9 bits)
+ *    ab_err()     error del BRG elegido contra la línea (Q16): con BRG
+ *                 chico el redondeo solo no alcanza (BRG 7 ± 0.5 ya es
+ *                 ±6 %) y el error del FRC pasa entero al enlace
+ *  Referencia: ab_ref() lleva la velocidad medida (con FCY nominal) a
+ *  la estándar más cercana si está a menos de AB_SNAP_PERMIL; la
+ *  diferencia es el error del reloj propio, ab_clk_err() (Q16).
+ *  ab_trim_next() mueve OSCTUN un paso contra ese error y pide otra
+ *  medida hasta quedar dentro de AB_TRIM_PERMIL o hasta que el error
+ *  cambia de signo (se queda con el mejor). El paso de TUN no se
+ *  supone: el lazo mide después de cada uno.
+ *
+ *  Límites: un intervalo de al menos AB_MIN_TCY (12 TCY: BRG = 0 con
+ *  el FRC hasta 25 % lento) y de menos de 65536 TCY (2 bits a ≈ 450
+ *  bps con FCY = 14.74 MHz).
+ *  Una racha continua de otro patrón puede simular 'U' a otra
+ *  velocidad (p. ej. 0xCC seguidos a la mitad): el autobaud se pide
+ *  con la línea en reposo y el host manda sólo 'U' hasta la respuesta.
+ *
+ *  AB_HOST: sólo la parte de cálculo, para el banco de PC.
+ *************************************************************/
+#ifndef UART_AUTOBAUD_H
+#define UART_AUTOBAUD_H
+
+#ifndef AB_HOST
+#include <xc.h>
+#endif
+#include <stdint.h>
+
+#ifndef AB_NRUNS
+#define AB_NRUNS        4U              // caracteres 'U' por medida
+#endif
+#define AB_RUN          9U              // intervalos de un bit por 'U'
+#define AB_MIN_TCY      12U             // bit más corto: BRG = 0 con FRC lento
+#define AB_CAP_N        ((AB_NRUNS + 1U) * (AB_RUN + 1U))   // capturas por tanda
+#ifndef AB_SNAP_PERMIL
+#define AB_SNAP_PERMIL  60              // ±6 % hasta la velocidad estándar
+#endif
+#ifndef AB_TRIM_PERMIL
+#define AB_TRIM_PERMIL  3               // error de reloj aceptado
+#endif
+#define AB_TUN_MIN      (-8)            // TUN<3:0> en complemento a 2
+#define AB_TUN_MAX      7
+
+#define AB_Q16_PERMIL(x)    ((int32_t)(x) * 65536L / 1000L)
+
+_Static_assert(AB_NRUNS * AB_RUN <= 145U, "FCY · bits debe caber en 32 bits");
+
+/* ——————————————————— MEDIDA ——————————————————— */
+typedef struct {
+    uint16_t last;                      // captura anterior
+    uint16_t ref;                       // primer intervalo de la racha
+    uint32_t run_span;
+    uint8_t  have;                      // hay captura anterior
+    uint8_t  run;                       // intervalos parejos en la racha
+    uint32_t span;                      // rachas completas, en TCY
+    uint16_t bits;
+    uint16_t breaks;                    // rachas cortadas
+    uint16_t fast;                      // intervalos < AB_MIN_TCY
+} ab_t;
+
+static inline void ab_reset(ab_t *a)
+{
+    *a = (ab_t){ 0 };
+}
+
+/* Una captura (TCY, módulo 2^16); 1 cuando ya hay AB_NRUNS rachas */
+static inline uint8_t ab_feed(ab_t *a, uint16_t cap)
+{
+    uint16_t d = (uint16_t)(cap - a->last);
+
+    a->last = cap;
+    if (!a->have) { a->have = 1; return 0; }
+    if (d < AB_MIN_TCY) {               // glitch o más rápido que BRG = 0
+        a->fast++;
+        a->run = 0;
+        return 0;
+    }
+    uint16_t tol = (uint16_t)((a->ref >> 4) + 2U);
+    if (a->run && d <= a->ref + tol && d + tol >= a->ref) {
+        a->run++;
+        a->run_span += d;
+    } else {                            // este intervalo empieza otra racha
+        if (a->run) a->breaks++;
+        a->ref      = d;
+        a->run      = 1;
+        a->run_span = d;
+    }
+    if (a->run == AB_RUN) {
+        a->span += a->run_span;
+        a->bits += AB_RUN;
+        a->run   = 0;
+    }
+    return (uint8_t)(a->bits >= AB_NRUNS * AB_RUN);
+}
+
+/* BRG redondeado (divisor 16, BRGH no existe en dsPIC30F) */
+static inline uint16_t ab_brg(const ab_t *a)
+{
+    uint32_t div = (a->span + 8UL * a->bits) / (16UL * a->bits);
+    return (uint16_t)(div ? div - 1U : 0U);
+}
+
+/* (bit de la UART − bit de la línea) / bit de la línea, Q16 */
+static inline int32_t ab_err(const ab_t *a, uint16_t brg)
+{
+    int32_t diff = (int32_t)((brg + 1UL) * 16UL * a->bits) - (int32_t)a->span;
+    return (int32_t)(diff * 65536L / (int32_t)a->span);
+}
+
+/* Velocidad medida suponiendo FCY nominal */
+static inline uint32_t ab_baud(const ab_t *a, uint32_t fcy)
+{
+    return (fcy * a->bits + a->span / 2U) / a->span;
+}
+
+static const uint32_t ab_std[] = {
+    2400UL, 4800UL, 9600UL, 19200UL, 38400UL, 57600UL, 115200UL,
+    230400UL, 460800UL, 921600UL };
+
+/* Velocidad estándar más cercana, 0 si ninguna está a AB_SNAP_PERMIL */
+static inline uint32_t ab_ref(uint32_t baud)
+{
+    for (uint8_t i = 0; i < sizeof ab_std / sizeof ab_std[0]; i++) {
+        uint32_t r = ab_std[i];
+        uint32_t d = baud > r ? baud - r : r - baud;
+        if (d <= r * AB_SNAP_PERMIL / 1000U) return r;
+    }
+    return 0;
+}
+
+/* (reloj propio − nominal) / nominal, Q16: positivo = FRC rápido */
+static inline int32_t ab_clk_err(const ab_t *a, uint32_t fcy, uint32_t ref)
+{
+    uint32_t nom  = (fcy / ref) * a->bits + (fcy % ref) * a->bits / ref;
+    int32_t  diff = (int32_t)a->span - (int32_t)nom;
+
+    if (diff >  32767) diff =  32767;
+    if (diff < -32767) diff = -32767;
+    return (int32_t)(diff * 65536L / (int32_t)nom);
+}
+
+/* ——————————————————— AJUSTE DE OSCTUN ——————————————————— */
+typedef struct {
+    int8_t   tun;                       // valor a medir / final
+    int8_t   dir;                       // último paso: −1, 0, +1
+    int8_t   best_tun;
+    uint8_t  steps;
+    int32_t  best_err;
+    uint32_t best_span;                 // medida del mejor, para su BRG
+    uint16_t best_bits;
+} ab_trim_t;
+
+static inline void ab_trim_init(ab_trim_t *t, int8_t tun)
+{
+    *t = (ab_trim_t){ 0 };
+    t->tun = t->best_tun = tun;
+    t->best_err = INT32_MAX;
+}
+
+/* Medida a ab_trim_t.tun con error de reloj err: 1 = poner el nuevo
+   tun y medir otra vez; 0 = listo, tun/best_span son los mejores */
+static inline uint8_t ab_trim_next(ab_trim_t *t, const ab_t *a, int32_t err)
+{
+    int32_t mag = err < 0 ? -err : err;
+    int8_t  d   = err > 0 ? -1 : 1;     // FRC rápido → bajar TUN
+
+    if (mag < (t->best_err < 0 ? -t->best_err : t->best_err)) {
+        t->best_err  = err;
+        t->best_tun  = t->tun;
+        t->best_span = a->span;
+        t->best_bits = a->bits;
+    }
+    if (mag <= AB_Q16_PERMIL(AB_TRIM_PERMIL) ||
+        (t->dir && d != t->dir) ||
+        t->tun + d < AB_TUN_MIN || t->tun + d > AB_TUN_MAX) {
+        t->tun = t->best_tun;
+        return 0;
+    }
+    t->dir = d;
+    t->tun = (int8_t)(t->tun + d);
+    t->steps++;
+    return 1;
+}
+
+#ifndef AB_HOST
+/* ——————————————————— HARDWARE: U2RX → IC2, Timer2 ——————————— */
+/* Timer2 libre a TCY como base de IC2. Llamar con la UART2 activa. */
+static inline void ab_hw_init(void)
+{
+    T2CON = 0;
+    TMR2  = 0;
+    PR2   = 0xFFFF;
+    T2CONbits.TON = 1;
+
+    IEC0bits.IC2IE = 0;
+    IC2CON = 0;
+    IC2CONbits.ICTMR = 1;               // Timer2
+}
+
+/* Junta n capturas de cada flanco; 0 si pasan wraps vueltas de Timer2
+   sin terminar o si el FIFO de IC2 desborda. El lazo sólo copia: a
+   921600 bps con FCY = 14.74 MHz hay un flanco cada 16 TCY y el FIFO
+   de 4 capturas cubre la diferencia. */
+static inline uint8_t ab_capture(uint16_t *cap, uint8_t n, uint16_t wraps)
+{
+    uint8_t i = 0;
+
+    U2MODEbits.ABAUD = 1;
+    IC2CONbits.ICM = 0;                 // limpia FIFO e ICOV
+    IFS0bits.T2IF  = 0;
+    IC2CONbits.ICM = 0b001;             // cada flanco
+    while (i < n) {
+        if (IC2CONbits.ICBNE) {
+            cap[i++] = IC2BUF;
+        } else if (IFS0bits.T2IF) {
+            IFS0bits.T2IF = 0;
+            if (wraps-- == 0) break;
+        }
+    }
+    if (IC2CONbits.ICOV) i = 0;
+    IC2CONbits.ICM = 0;
+    U2MODEbits.ABAUD = 0;
+    return (uint8_t)(i == n);
+}
+
+/* Mide hasta tener AB_NRUNS rachas. Cada tanda son AB_NRUNS + 1
+   caracteres seguidos, así aun con pausas y empezando a mitad de uno
+   quedan AB_NRUNS enteros; a lo sumo tries tandas de hasta wraps
+   vueltas de Timer2. 0 si no alcanzó. */
+static inline uint8_t ab_measure(ab_t *a, uint8_t tries, uint16_t wraps)
+{
+    uint16_t cap[AB_CAP_N];
+
+    while (tries--) {
+        if (!ab_capture(cap, (uint8_t)AB_CAP_N, wraps)) continue;
+        ab_reset(a);
+        for (uint8_t i = 0; i < AB_CAP_N; i++)
+            if (ab_feed(a, cap[i])) return 1;
+    }
+    return 0;
+}
+
+/* BRG nuevo con la línea quieta; descarta lo recibido mientras tanto */
+static inline void ab_apply(uint16_t brg)
+{
+    U2BRG = brg;
+    while (U2STAbits.URXDA) (void)U2RXREG;
+    U2STAbits.OERR = 0;
+}
+
+static inline void ab_tun_set(int8_t tun)
+{
+    OSCTUN = (uint16_t)tun & 0x000FU;
+}
+#endif  /* AB_HOST */
+
+#endif  /* UART_AUTOBAUD_H */
@@ -0,0 +1,443 @@
+/*************************************************************
+ *  Canales virtuales con prioridad sobre UART1/UART2 – header-only
+ *  (firmware y PC: 025_uart_link_mux.c, host/link_sim.c)
+ *
+ *  Antes de incluir se define la lista de canales, en orden de
+ *  prioridad (el primero gana), con el tamaño de su cola de
+ *  transmisión, el de su búfer de recepción y los puertos que puede
+ *  usar:
+ *    #define LINK_CHANNELS(X) \
+ *        X(CTRL,  32,  8, LINK_U1 | LINK_U2) \
+ *        X(TELEM, 256, 0, LINK_U2)
+ *  y LINK_NOW(), un reloj libre de 32 bits (sellos de latencia).
+ *
+ *  Trama:  0xAA 0x5A  hdr  len  payload[len]  crcH crcL
+ *     hdr = canal<<5 | FIRST<<4 | MORE<<3 | seq (3 bits, por puerto
+ *           y canal)
+ *     len = 1…LINK_MTU      crc = CRC-16/CCITT de hdr…payload
+ *  Un mensaje de hasta 255 bytes sale en tramas de LINK_MTU; FIRST
+ *  marca la primera y MORE que sigue otra del mismo mensaje.
+ *
+ *  – Cola por canal: anillo de bytes con [len][sello ×4][mensaje];
+ *    link_send() copia todo o nada (un productor por canal: el lazo
+ *    o una ISR, sin bloqueo).
+ *  – link_pump(), desde el lazo o la ISR de TX: en cada límite de
+ *    trama, y sólo cuando el FIFO de la UART tiene lugar, cada puerto
+ *    toma la siguiente trama del canal más prioritario con datos. Un
+ *    mensaje largo queda a medias en su puerto y sigue cuando no hay
+ *    nada más urgente: una trama de control espera a lo sumo el resto
+ *    de una trama (LINK_FRAME_MAX bytes) más el FIFO.
+ *  – Un mensaje sale entero por el puerto que lo toma; con dos
+ *    puertos cada uno lleva su propio mensaje del mismo canal y la cola
+ *    se libera en orden. Entre puertos el orden de llegada no está
+ *    garantizado: el mensaje lleva su propio número si importa.
+ *  – Recepción: link_rx_byte() desde la ISR de RX de cada puerto;
+ *    sincroniza, valida CRC y rearma por (puerto, canal); un hueco de
+ *    seq descarta el mensaje a medias y lo que siga hasta una FIRST.
+ *    Cada mensaje completo llama a link_on_msg(), que define quien
+ *    incluye.
+ *  – Estadísticas por canal: mensajes, bytes y tramas enviados,
+ *    descartes por cola llena, espera en cola (de link_send() a la
+ *    primera trama) y latencia hasta el último byte en el FIFO, suma
+ *    y máximo en unidades de LINK_NOW(); recibidos, huecos y
+ *    demasiado largos. Por puerto: bytes en el cable y tramas con CRC
+ *    o longitud malos.
+ *
+ *  LINK_HOST: sin registros; quien incluye define LINK_TX_READY(p) y
+ *  LINK_TX_PUT(p, b).
+ *  LINK_TXQ(n): si quien incluye la define, las colas de TX son suyas
+ *  (p. ej. RAM(link, txq_##n) de ram_arena.h, que las cuenta en el
+ *  presupuesto) y aquí sólo se verifica que midan lo que dice
+ *  LINK_CHANNELS.
+ *************************************************************/
+#ifndef UART_LINK_H
+#define UART_LINK_H
+
+#ifndef LINK_HOST
+#include <xc.h>
+#endif
+#include <stdint.h>
+
+#ifndef LINK_CHANNELS
+#error "definir LINK_CHANNELS(X) antes de incluir uart_link.h"
+#endif
+#ifndef LINK_NOW
+#error "definir LINK_NOW() (reloj libre de 32 bits) antes de incluir uart_link.h"
+#endif
+
+#define LINK_U1         0x01U           // puerto 0
+#define LINK_U2         0x02U           // puerto 1
+#define LINK_NPORT      2U
+#ifndef LINK_PORTS
+#define LINK_PORTS      (LINK_U1 | LINK_U2)
+#endif
+
+#ifndef LINK_MTU
+#define LINK_MTU        32U             // payload por trama
+#endif
+#define LINK_SYNC0      0xAA
+#define LINK_SYNC1      0x5A
+#define LINK_FIRST      0x10U           // bits de hdr
+#define LINK_MORE       0x08U
+#define LINK_SEQ        0x07U
+#define LINK_OVH        6U              // sync×2, hdr, len, crc×2
+#define LINK_FRAME_MAX  (LINK_MTU + LINK_OVH)
+#define LINK_QHDR       5U              // len + sello en la cola
+#define LINK_NONE       0xFFU
+
+#ifndef LINK_HOST
+#define LINK_TX_READY(p)    ((p) ? !U2STAbits.UTXBF : !U1STAbits.UTXBF)
+#define LINK_TX_PUT(p, b)   do { if (p) U2TXREG = (b); else U1TXREG = (b); } while (0)
+#endif
+
+/* ——————————————————— CANALES ——————————————————— */
+enum {
+#define X(n, txn, rxn, pm)      LINK_CH_##n,
+    LINK_CHANNELS(X)
+#undef X
+    LINK_NCH
+};
+
+_Static_assert(LINK_NCH <= 8, "a lo sumo 8 canales (3 bits de hdr)");
+_Static_assert(LINK_MTU >= 1 && LINK_MTU <= 255, "LINK_MTU fuera de 1...255");
+
+#ifdef LINK_TXQ
+#define LINK_TXQ_DECL(n, txn) \
+    _Static_assert(sizeof LINK_TXQ(n) == (txn), "cola de " #n ": no mide lo que dice LINK_CHANNELS");
+#else
+#define LINK_TXQ(n)             link_txq_##n
+#define LINK_TXQ_DECL(n, txn)   static uint8_t link_txq_##n[txn];
+#endif
+
+#define X(n, txn, rxn, pm) \
+    _Static_assert(((txn) & ((txn) - 1)) == 0 && (txn) > LINK_QHDR, "cola de " #n ": potencia de 2 mayor que LINK_QHDR"); \
+    _Static_assert((rxn) <= 255, "rx de " #n ": a lo sumo 255"); \
+    LINK_TXQ_DECL(n, txn) \
+    static uint8_t link_rxb_##n[LINK_NPORT][(rxn) ? (rxn) : 1];
+LINK_CHANNELS(X)
+#undef X
+
+typedef struct {
+    uint8_t          *q;
+    uint16_t          mask;
+    volatile uint16_t head;             // escrito por link_send()
+    volatile uint16_t tail;             // liberado por link_pump(), en orden
+    uint16_t          next;             // primer mensaje sin tomar
+    uint8_t           ports;
+    uint8_t           rx_max;
+} link_ch_t;
+
+typedef struct {
+    uint32_t msgs, bytes, frames;       // enviados
+    uint16_t drops;                     // link_send() sin lugar
+    uint32_t wait_sum, wait_max;        // link_send() → primera trama
+    uint32_t lat_sum, lat_max;          // link_send() → último byte al FIFO
+    uint32_t rx_msgs, rx_bytes;
+    uint16_t rx_gaps, rx_big;           // huecos de seq / mensajes > rx
+} link_stats_t;
+
+typedef struct {                        // mensaje a medias de un canal en un puerto
+    uint16_t pos;                       // en la cola
+    uint8_t  len, off;
+    uint8_t  busy;
+    uint32_t t0;
+} link_cur_t;
+
+typedef struct {
+    uint8_t *buf;
+    uint8_t  len;
+    uint8_t  seq;                       // próximo esperado
+    uint8_t  sync;                      // 0 hasta la primera trama
+    uint8_t  act;                       // dentro de un mensaje
+    uint8_t  drop;                      // descartándolo
+} link_rx_t;
+
+typedef struct {
+    /* TX */
+    uint8_t    f[LINK_FRAME_MAX];
+    uint8_t    fi, flen;                // trama en curso: enviados / total
+    uint8_t    ch, seg;
+    uint8_t    seq[LINK_NCH];
+    link_cur_t cur[LINK_NCH];
+    uint32_t   wire_bytes;
+    /* RX */
+    uint8_t    st, hdr, len, ri;
+    uint16_t   crc;
+    uint8_t    r[LINK_MTU];
+    link_rx_t  rx[LINK_NCH];
+    uint16_t   crc_err, len_err;
+    uint32_t   rx_frames;
+} link_port_t;
+
+typedef struct {
+    link_ch_t    ch[LINK_NCH];
+    link_stats_t st[LINK_NCH];
+    link_port_t  port[LINK_NPORT];
+} link_t;
+
+static link_t g_link;
+
+/* Lo define quien incluye: mensaje completo recibido por el puerto p */
+static void link_on_msg(uint8_t p, uint8_t ch, const uint8_t *m, uint8_t len);
+
+/* ——————————————————— CRC-16/CCITT (tabla de nibbles) ——————————— */
+static const uint16_t link_crc_nib[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF };
+
+static inline uint16_t link_crc16(uint16_t crc, uint8_t b)
+{
+    crc = (uint16_t)((crc << 4) ^ link_crc_nib[(crc >> 12) ^ (b >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ link_crc_nib[(crc >> 12) ^ (b & 0x0FU)]);
+    return crc;
+}
+
+/* ——————————————————— INICIO ——————————————————— */
+static inline void link_init(void)
+{
+    uint8_t i = 0;
+#define X(n, txn, rxn, pm) \
+    g_link.ch[i].q = LINK_TXQ(n); g_link.ch[i].mask = (txn) - 1U; \
+    g_link.ch[i].ports = (uint8_t)((pm) & LINK_PORTS); g_link.ch[i].rx_max = (rxn); \
+    for (uint8_t p = 0; p < LINK_NPORT; p++) g_link.port[p].rx[i].buf = link_rxb_##n[p]; \
+    i++;
+    LINK_CHANNELS(X)
+#undef X
+    for (i = 0; i < LINK_NCH; i++) {
+        link_ch_t *c = &g_link.ch[i];
+        c->head = c->tail = c->next = 0;
+        g_link.st[i] = (link_stats_t){ 0 };
+    }
+    for (uint8_t p = 0; p < LINK_NPORT; p++) {
+        link_port_t *pt = &g_link.port[p];
+        pt->fi = pt->flen = 0;
+        pt->st = 0;
+        pt->wire_bytes = pt->rx_frames = 0;
+        pt->crc_err = pt->len_err = 0;
+        for (i = 0; i < LINK_NCH; i++) {
+            pt->seq[i] = 0;
+            pt->cur[i].busy = 0;
+            pt->rx[i].len = pt->rx[i].sync = pt->rx[i].act = pt->rx[i].drop = 0;
+        }
+    }
+}
+
+/* ——————————————————— ENVÍO ——————————————————— */
+/* Todo o nada; 0 si no hay lugar (se cuenta en drops) */
+static inline uint8_t link_send(uint8_t ch, const uint8_t *m, uint8_t len)
+{
+    link_ch_t *c = &g_link.ch[ch];
+    uint16_t   h = c->head;
+    uint32_t   t = LINK_NOW();
+
+    if (len == 0) return 1;
+    if ((uint16_t)(c->mask + 1U - (uint16_t)(h - c->tail)) < LINK_QHDR + len) {
+        g_link.st[ch].drops++;
+        return 0;
+    }
+    c->q[h++ & c->mask] = len;
+    for (uint8_t k = 0; k < 4; k++, t >>= 8) c->q[h++ & c->mask] = (uint8_t)t;
+    for (uint8_t k = 0; k < len; k++) c->q[h++ & c->mask] = m[k];
+    c->head = h;                        // publica al final
+    return 1;
+}
+
+/* Arma en el puerto p la siguiente trama del canal más prioritario:
+   la que sigue de su mensaje a medias o la primera de uno nuevo */
+static inline uint8_t link_next_frame(uint8_t p)
+{
+    link_port_t *pt = &g_link.port[p];
+
+    for (uint8_t i = 0; i < LINK_NCH; i++) {
+        link_ch_t  *c = &g_link.ch[i];
+        link_cur_t *m = &pt->cur[i];
+
+        if (!(c->ports & (1U << p))) continue;
+        if (!m->busy) {
+            uint16_t at = c->next;
+            if (at == c->head) continue;
+            m->pos = at;
+            m->len = c->q[at & c->mask];
+            m->off = 0;
+            m->t0  = 0;
+            for (uint8_t k = 4; k; k--) m->t0 = (m->t0 << 8) | c->q[(at + k) & c->mask];
+            c->q[(at + 1U) & c->mask] = 0;          // sello copiado: marca "en vuelo"
+            m->busy = 1;
+            c->next = (uint16_t)(at + LINK_QHDR + m->len);
+
+            uint32_t w = LINK_NOW() - m->t0;
+            g_link.st[i].wait_sum += w;
+            if (w > g_link.st[i].wait_max) g_link.st[i].wait_max = w;
+        }
+
+        uint8_t  seg = (uint8_t)(m->len - m->off);
+        if (seg > LINK_MTU) seg = LINK_MTU;
+        uint8_t  hdr = (uint8_t)((i << 5) | (pt->seq[i]++ & LINK_SEQ));
+        if (m->off == 0)          hdr |= LINK_FIRST;
+        if (m->off + seg < m->len) hdr |= LINK_MORE;
+        uint16_t crc = 0xFFFF;
+        uint16_t src = (uint16_t)(m->pos + LINK_QHDR + m->off);
+        uint8_t *f   = pt->f;
+
+        *f++ = LINK_SYNC0;
+        *f++ = LINK_SYNC1;
+        *f++ = hdr;  crc = link_crc16(crc, hdr);
+        *f++ = seg;  crc = link_crc16(crc, seg);
+        for (uint8_t k = 0; k < seg; k++) {
+            uint8_t b = c->q[(src + k) & c->mask];
+            *f++ = b;
+            crc = link_crc16(crc, b);
+        }
+        *f++ = (uint8_t)(crc >> 8);
+        *f++ = (uint8_t)crc;
+
+        pt->fi   = 0;
+        pt->flen = (uint8_t)(f - pt->f);
+        pt->ch   = i;
+        pt->seg  = seg;
+        return 1;
+    }
+    return 0;
+}
+
+/* Trama entera en el FIFO: avanza el mensaje; al terminarlo lo marca y
+   libera desde tail todos los terminados (el otro puerto puede tener
+   uno anterior todavía en vuelo) */
+static inline void link_frame_done(uint8_t p)
+{
+    link_port_t  *pt = &g_link.port[p];
+    link_ch_t    *c  = &g_link.ch[pt->ch];
+    link_cur_t   *m  = &pt->cur[pt->ch];
+    link_stats_t *s  = &g_link.st[pt->ch];
+
+    s->frames++;
+    pt->wire_bytes += pt->flen;
+    m->off = (uint8_t)(m->off + pt->seg);
+    if (m->off < m->len) return;
+
+    uint32_t l = LINK_NOW() - m->t0;
+    s->msgs++;
+    s->bytes += m->len;
+    s->lat_sum += l;
+    if (l > s->lat_max) s->lat_max = l;
+    m->busy = 0;
+
+    c->q[(m->pos + 1U) & c->mask] = 1;              // terminado
+    uint16_t tl = c->tail;
+    while (tl != c->next && c->q[(tl + 1U) & c->mask] == 1)
+        tl = (uint16_t)(tl + LINK_QHDR + c->q[tl & c->mask]);
+    c->tail = tl;
+}
+
+/* Llena el FIFO de la UART p; elige trama sólo cuando hay lugar */
+static inline void link_pump_port(uint8_t p)
+{
+    link_port_t *pt = &g_link.port[p];
+
+    for (;;) {
+        if (pt->fi == pt->flen) {
+            if (!LINK_TX_READY(p) || !link_next_frame(p)) return;
+        }
+        while (pt->fi < pt->flen && LINK_TX_READY(p))
+            LINK_TX_PUT(p, pt->f[pt->fi++]);
+        if (pt->fi < pt->flen) return;
+        link_frame_done(p);
+        pt->fi = pt->flen = 0;
+    }
+}
+
+static inline void link_pump(void)
+{
+    for (uint8_t p = 0; p < LINK_NPORT; p++)
+        if (LINK_PORTS & (1U << p)) link_pump_port(p);
+}
+
+/* ——————————————————— RECEPCIÓN ——————————————————— */
+static inline void link_rx_frame(uint8_t p, uint8_t hdr, const uint8_t *d, uint8_t n)
+{
+    uint8_t       ch = (uint8_t)(hdr >> 5);
+    uint8_t       sq = (uint8_t)(hdr & LINK_SEQ);
+    uint8_t       gap;
+    link_rx_t    *r;
+    link_stats_t *s;
+
+    if (ch >= LINK_NCH) { g_link.port[p].len_err++; return; }
+    r = &g_link.port[p].rx[ch];
+    s = &g_link.st[ch];
+
+    gap = (uint8_t)(r->sync && sq != r->seq);
+    if (gap) s->rx_gaps++;
+    r->sync = 1;
+    r->seq  = (uint8_t)((sq + 1U) & LINK_SEQ);
+
+    if (hdr & LINK_FIRST) {             // empieza limpio; uno a medias se pierde
+        r->act  = 1;
+        r->drop = 0;
+        r->len  = 0;
+    } else if (gap || !r->act) {        // continuación sin su principio
+        r->act  = 1;
+        r->drop = 1;
+    }
+
+    if (!r->drop) {
+        if ((uint16_t)r->len + n > g_link.ch[ch].rx_max) {
+            s->rx_big++;
+            r->drop = 1;
+        } else {
+            for (uint8_t k = 0; k < n; k++) r->buf[r->len + k] = d[k];
+            r->len = (uint8_t)(r->len + n);
+        }
+    }
+    if (hdr & LINK_MORE) return;
+
+    if (!r->drop) {
+        s->rx_msgs++;
+        s->rx_bytes += r->len;
+        link_on_msg(p, ch, r->buf, r->len);
+    }
+    r->act = 0;
+}
+
+/* Un byte recibido por el puerto p (desde su ISR de RX) */
+static inline void link_rx_byte(uint8_t p, uint8_t b)
+{
+    link_port_t *pt = &g_link.port[p];
+
+    switch (pt->st) {
+    case 0:
+        pt->st = (b == LINK_SYNC0) ? 1 : 0;
+        break;
+    case 1:
+        pt->st = (b == LINK_SYNC1) ? 2 : (b == LINK_SYNC0) ? 1 : 0;
+        break;
+    case 2:
+        pt->hdr = b;
+        pt->crc = link_crc16(0xFFFF, b);
+        pt->st  = 3;
+        break;
+    case 3:
+        if (b == 0 || b > LINK_MTU) { pt->len_err++; pt->st = (b == LINK_SYNC0) ? 1 : 0; break; }
+        pt->len = b;
+        pt->ri  = 0;
+        pt->crc = link_crc16(pt->crc, b);
+        pt->st  = 4;
+        break;
+    case 4:
+        pt->r[pt->ri++] = b;
+        pt->crc = link_crc16(pt->crc, b);
+        if (pt->ri == pt->len) pt->st = 5;
+        break;
+    case 5:
+        pt->st = (b == (uint8_t)(pt->crc >> 8)) ? 6 : 0;
+        if (!pt->st) pt->crc_err++;
+        break;
+    default:
+        pt->st = 0;
+        if (b != (uint8_t)pt->crc) { pt->crc_err++; break; }
+        pt->rx_frames++;
+        link_rx_frame(p, pt->hdr, pt->r, pt->len);
+        break;
+    }
+}
+
+#endif  /* UART_LINK_H */
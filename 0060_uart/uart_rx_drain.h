@@ -0,0 +1,125 @@
+/*************************************************************
+ *  Recepción UART2 por ráfagas y FSM de paquetes – header-only
+ *  (firmware y PC: 022_uart_pwm_control.c, host/rx_bench.c)
+ *
+ *  Paquete de 4 bytes:  0xAA 0x55 [MSB] [LSB]  (duty de 10 bits)
+ *
+ *  – uart2_rx_drain(), desde la ISR de RX: vacía todos los bytes del
+ *    FIFO en una sola entrada, descarta y cuenta los que traen FERR o
+ *    PERR (leídos antes de U2RXREG: describen el byte de la cabeza) y
+ *    al final cuenta y borra OERR. Un OERR sin borrar detiene la
+ *    recepción del módulo hasta el reset.
+ *  – rx_fsm_push(): sincroniza con 0xAA 0x55 y, con el LSB, llama a
+ *    rx_on_packet(duty10), que define quien incluye.
+ *  – uart_rx_isel_next(): umbral de interrupción para la próxima
+ *    entrada. Mientras falten menos de 3 bytes del paquete pasa a
+ *    "cada byte" para que el último no espere en el FIFO.
+ *
+ *  UART_RX_HOST: sin registros; quien incluye define UART_RX_AVAIL(),
+ *  UART_RX_FERR(), UART_RX_PERR(), UART_RX_READ(), UART_RX_OERR() y
+ *  UART_RX_OERR_CLEAR().
+ *************************************************************/
+#ifndef UART_RX_DRAIN_H
+#define UART_RX_DRAIN_H
+
+#ifndef UART_RX_HOST
+#include <xc.h>
+#endif
+#include <stdint.h>
+
+/* Umbral de interrupción RX: 0b00 = cada byte, 0b10 = 3 bytes en FIFO, 0b11 = FIFO lleno.
+   UART_RX_ISEL se usa mientras quedan ≥ 3 bytes del paquete; el final va byte a byte. */
+#define UART_RX_ISEL    0b10
+#define UART_RX_ISEL_1  0b00
+#define RX_PKT_LEN      4U
+
+#ifndef UART_RX_HOST
+#define UART_RX_AVAIL()         U2STAbits.URXDA
+#define UART_RX_FERR()          U2STAbits.FERR
+#define UART_RX_PERR()          U2STAbits.PERR
+#define UART_RX_READ()          ((uint8_t)U2RXREG)
+#define UART_RX_OERR()          U2STAbits.OERR
+#define UART_RX_OERR_CLEAR()    (U2STAbits.OERR = 0)
+#endif
+
+/* FSM recepción: 0→AA, 1→55, 2→[MSB], 3→[LSB] */
+static volatile uint8_t  g_rx_state = 0;
+static volatile uint16_t g_rx_word  = 0;
+
+/* Estadísticas del receptor (sólo escritas por uart2_rx_drain) */
+typedef struct {
+    uint32_t bytes;        // Bytes válidos entregados a la FSM
+    uint16_t overrun;      // OERR detectados (FIFO desbordado, ≥1 byte perdido)
+    uint16_t framing;      // Bytes descartados por FERR
+    uint16_t parity;       // Bytes descartados por PERR
+} uart_rx_stats_t;
+
+static volatile uart_rx_stats_t g_rx_stats;
+
+/* Lo define quien incluye: paquete completo, duty de 10 bits */
+static void rx_on_packet(uint16_t duty10);
+
+/* ——————————————————— FSM de paquetes ——————————————————— */
+static inline void rx_fsm_push(uint8_t byte)
+{
+    switch (g_rx_state)
+    {
+        case 0:
+            g_rx_state = (byte == 0xAA) ? 1 : 0;
+            break;
+
+        case 1:
+            g_rx_state = (byte == 0x55) ? 2 : 0;
+            break;
+
+        case 2:
+            g_rx_word  = ((uint16_t)byte) << 8;  // MSB
+            g_rx_state = 3;
+            break;
+
+        case 3:
+            g_rx_word |= byte;                   // LSB
+            g_rx_state = 0;
+            rx_on_packet(g_rx_word & 0x03FF);
+            break;
+
+        default:
+            g_rx_state = 0;
+            break;
+    }
+}
+
+/* ——————————————————— Vaciado del FIFO ——————————————————— */
+static inline void uart2_rx_drain(void)
+{
+    while (UART_RX_AVAIL())
+    {
+        /* FERR/PERR describen el byte en la cabeza del FIFO: leer antes de U2RXREG */
+        const uint8_t ferr = UART_RX_FERR();
+        const uint8_t perr = UART_RX_PERR();
+        const uint8_t byte = UART_RX_READ();
+
+        if (ferr) { g_rx_stats.framing++; g_rx_state = 0; continue; }
+        if (perr) { g_rx_stats.parity++;  g_rx_state = 0; continue; }
+
+        g_rx_stats.bytes++;
+        rx_fsm_push(byte);
+    }
+
+    /* Con OERR = 1 el módulo no acepta más bytes: los 4 del FIFO ya se leyeron,
+       el del registro de desplazamiento se perdió. Limpiar reanuda la recepción. */
+    if (UART_RX_OERR())
+    {
+        UART_RX_OERR_CLEAR();
+        g_rx_stats.overrun++;
+        g_rx_state = 0;                 // Paquete en curso ya no es fiable
+    }
+}
+
+/* URXISEL para la próxima entrada */
+static inline uint8_t uart_rx_isel_next(void)
+{
+    return ((RX_PKT_LEN - g_rx_state) < 3U) ? UART_RX_ISEL_1 : UART_RX_ISEL;
+}
+
+#endif  /* UART_RX_DRAIN_H */
@@ -0,0 +1,250 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz × PLL16  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  encoder en QEA/QEB/INDX → posición + velocidad M/T
+ *
+ *  Pines (fijos en el dsPIC30F4011):
+ *    RB3 = INDX/CN5   RB4 = QEA/IC7   RB5 = QEB/IC8
+ *
+ *  Método M/T:
+ *    v = M / T, donde M = cuentas entre los dos últimos flancos
+ *    capturados y T = tiempo exacto entre esos mismos flancos.
+ *    – QEI en modo x2: POSCNT avanza en cada flanco de QEA.
+ *    – IC7 (mismo pin que QEA) marca el tiempo de los flancos de
+ *      subida con Timer3 extendido a 32 bits por software.
+ *    – El preescalador de captura (1, 4 o 16 flancos) se adapta a la
+ *      velocidad para que la ISR de IC7 no pase de ~4 por muestra.
+ *    – A baja velocidad (sin flancos en la ventana) la estimación
+ *      decae con la cota (cuentas + 1) / tiempo desde el último flanco.
+ *
+ *  El muestreo (qei_velocity_sample) se llama desde el lazo de
+ *  control; aquí Timer1 a 1 kHz hace ese papel. El cálculo está en
+ *  qei_mt.h y host/qei_sim.c lo prueba contra un encoder simulado.
+ *************************************************************/
+
+/* ——— CONFIG BITS ——— */
+#pragma config FPR     = FRC_PLL16     // FRC ×16 → FCY ≈ 29.48 MHz
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_IOPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define FCY             (7370000UL * 16UL / 4UL)     // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+
+/* Encoder */
+#define QEI_PPR         500UL                      // líneas por vuelta
+#define QEI_EDGES_REV   (2UL * QEI_PPR)            // x2 → 1000 cuentas/vuelta
+#define QEI_RPM_MAX     6000UL                     // 1.0 en Q15
+#define QEI_VEL_MAX     (QEI_RPM_MAX * QEI_EDGES_REV / 60UL)   // cuentas/s a 1.0
+
+/* Base de tiempo de captura: Timer3, 1:8 → ≈ 3.685 MHz */
+#define T3_PRESC        8UL
+#define T3_TICK_HZ      (FCY / T3_PRESC)
+
+/* Lazo de control (muestreo de velocidad): Timer1 a 1 kHz */
+#define SAMPLE_HZ       1000UL
+#define T1_PR           ((FCY / SAMPLE_HZ) - 1)    // 1:1 → 29 479
+
+/* v_q15 = M · K / T_ticks con T en ticks de Timer3 */
+#define QEI_TICK_HZ     T3_TICK_HZ
+#include "qei_mt.h"
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static qei_state_t       g_qei;
+
+/* Escritas por las ISR de prioridad 6 (IC7, T3, CN) */
+static volatile uint16_t g_t3_hi       = 0;   // extensión de Timer3
+static volatile uint32_t g_cap_time    = 0;   // último flanco capturado
+static volatile int16_t  g_cap_pos     = 0;   // POSCNT en ese flanco
+static volatile uint16_t g_cap_count   = 0;   // capturas desde el último muestreo
+static volatile int16_t  g_idx_pos     = 0;   // POSCNT en el último índice
+static volatile uint8_t  g_idx_flag    = 0;
+
+static const uint8_t     k_icm_mode[3] = { 0b011, 0b100, 0b101 };  // 1, 4, 16
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void qei_init(void);
+static void qei_capture_init(void);
+static void qei_set_prescaler(uint8_t sel);
+static void qei_velocity_sample(qei_state_t *q);
+static void timer1_init(void);
+
+/* ——————————————————— SECCIÓN CRÍTICA (ISRs nivel 6) ———————— */
+#define QEI_ATOMIC_BEGIN()  do { IEC1bits.IC7IE = 0; IEC0bits.T3IE = 0; IEC0bits.CNIE = 0; } while (0)
+#define QEI_ATOMIC_END()    do { IEC1bits.IC7IE = 1; IEC0bits.T3IE = 1; IEC0bits.CNIE = 1; } while (0)
+
+/* ——————————————————— INICIALIZAR QEI (x2, 16 bits libres) ———— */
+static void qei_init(void)
+{
+    ADPCFGbits.PCFG3 = 1;      // RB3/INDX digital
+    ADPCFGbits.PCFG4 = 1;      // RB4/QEA  digital
+    ADPCFGbits.PCFG5 = 1;      // RB5/QEB  digital
+    TRISB |= (1 << 3) | (1 << 4) | (1 << 5);
+
+    QEICON = 0;
+    DFLTCON = 0;
+    DFLTCONbits.QEOUT  = 1;    // filtro digital en QEA/QEB/INDX
+    DFLTCONbits.QECK   = 0b010;// reloj filtro = Tcy/4 (≈ 0.5 µs de rechazo)
+
+    MAXCNT = 0xFFFF;           // POSCNT envuelve en 16 bits: Δ con int16
+    POSCNT = 0;
+    QEICONbits.SWPAB = 0;
+    QEICONbits.QEIM  = 0b101;  // x2, reset sólo por MAXCNT (índice por CN5)
+
+    /* Índice por cambio de nivel en CN5 */
+    CNEN1bits.CN5IE = 1;
+    IFS0bits.CNIF   = 0;
+    IPC3bits.CNIP   = 6;
+    IEC0bits.CNIE   = 1;
+}
+
+/* ——————————————————— IC7 + TIMER3 (marcas de tiempo) ——————————— */
+static void qei_capture_init(void)
+{
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = 0xFFFF;
+    T3CONbits.TCKPS = 0b01;    // 1:8
+    IFS0bits.T3IF = 0;
+    IPC1bits.T3IP = 6;
+    IEC0bits.T3IE = 1;
+    T3CONbits.TON = 1;
+
+    IC7CON = 0;
+    IC7CONbits.ICTMR = 0;      // Timer3
+    IC7CONbits.ICI   = 0;      // interrupción en cada captura
+    IFS1bits.IC7IF = 0;
+    IPC4bits.IC7IP = 6;
+    IEC1bits.IC7IE = 1;
+
+    qei_set_prescaler(0);
+}
+
+static void qei_set_prescaler(uint8_t sel)
+{
+    IC7CONbits.ICM = 0;        // apagar reinicia el preescalador y el FIFO
+    qei_mt_presc(&g_qei, sel);
+    IC7CONbits.ICM = k_icm_mode[sel];
+}
+
+/* Timer3: extiende la base de tiempo a 32 bits */
+void __attribute__((interrupt, auto_psv)) _T3Interrupt(void)
+{
+    IFS0bits.T3IF = 0;
+    g_t3_hi++;
+}
+
+/* IC7: marca de tiempo + POSCNT del flanco */
+void __attribute__((interrupt, auto_psv)) _IC7Interrupt(void)
+{
+    IFS1bits.IC7IF = 0;
+
+    while (IC7CONbits.ICBNE) {
+        uint16_t lo = IC7BUF;
+        uint16_t hi = g_t3_hi;
+        /* Desborde pendiente aún no contado y captura posterior a él */
+        if (IFS0bits.T3IF && lo < 0x8000U) hi++;
+        g_cap_time = ((uint32_t)hi << 16) | lo;
+    }
+    /* POSCNT se lee unos ciclos después del flanco: con prioridad 6 la
+       latencia es << medio periodo de QEA incluso a QEI_RPM_MAX */
+    g_cap_pos = (int16_t)POSCNT;
+    g_cap_count++;
+}
+
+/* CN5: flanco de subida de INDX → homing y verificación de cuentas */
+void __attribute__((interrupt, auto_psv)) _CNInterrupt(void)
+{
+    IFS0bits.CNIF = 0;
+    if (PORTBbits.RB3) {
+        g_idx_pos  = (int16_t)POSCNT;
+        g_idx_flag = 1;
+    }
+}
+
+/* ——————————————————— TIEMPO ACTUAL EN 32 BITS ————————————————— */
+static uint32_t t3_now32(void)
+{
+    uint16_t hi = g_t3_hi;
+    uint16_t lo = TMR3;
+    if (IFS0bits.T3IF && lo < 0x8000U) hi++;
+    return ((uint32_t)hi << 16) | lo;
+}
+
+/* ——————————————————— ESTIMADOR M/T ——————————————————— */
+static void qei_velocity_sample(qei_state_t *q)
+{
+    qei_snap_t s;
+
+    QEI_ATOMIC_BEGIN();
+    s.cap_time  = g_cap_time;
+    s.cap_pos   = g_cap_pos;
+    s.cap_count = g_cap_count;
+    s.idx_flag  = g_idx_flag;
+    s.idx_pos   = g_idx_pos;
+    s.poscnt    = POSCNT;
+    s.now       = t3_now32();
+    g_cap_count = 0;
+    g_idx_flag  = 0;
+    QEI_ATOMIC_END();
+
+    uint8_t sel = qei_mt_update(q, &s);
+    if (sel != q->presc_sel) qei_set_prescaler(sel);
+}
+
+/* ——————————————————— TIMER1: LAZO DE CONTROL 1 kHz ———————————— */
+static void timer1_init(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = T1_PR;
+    T1CONbits.TCKPS = 0;       // 1:1
+    IFS0bits.T1IF = 0;
+    IPC0bits.T1IP = 5;         // por debajo de IC7/T3/CN
+    IEC0bits.T1IE = 1;
+    T1CONbits.TON = 1;
+}
+
+void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
+{
+    IFS0bits.T1IF = 0;
+    qei_velocity_sample(&g_qei);
+    /* … aquí el lazo de velocidad usaría g_qei.vel_q15 … */
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    qei_init();
+    qei_capture_init();
+    timer1_init();
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        /* Lectura coherente desde el fondo */
+        IEC0bits.T1IE = 0;
+        int16_t vel = g_qei.vel_q15;
+        int32_t pos = g_qei.pos;
+        IEC0bits.T1IE = 1;
+        (void)vel; (void)pos;
+    }
+    return 0;
+}
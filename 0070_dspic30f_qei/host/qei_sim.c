@@ -0,0 +1,262 @@
+/*************************************************************
+ *  qei_sim – qei_mt.h contra un encoder simulado, en PC
+ *
+ *  cc -O2 -Wall -I.. -o qei_sim qei_sim.c -lm
+ *
+ *  El modelo corre tick a tick de Timer3 (FCY/8 ≈ 3.685 MHz) como en
+ *  10_qei_velocity_mt.c: un perfil de velocidad mueve el eje, QEA
+ *  cambia en cada cuenta (x2), IC7 captura los flancos de subida con
+ *  el preescalador que pide el estimador y la "ISR" lee POSCNT
+ *  LAT_TICKS después; el índice cae en una cuenta fija por vuelta.
+ *  Cada milisegundo se toma la foto y se llama qei_mt_update(). El
+ *  tiempo de 32 bits y POSCNT arrancan cerca de su vuelta.
+ *
+ *    1 constante    – ±3…5900 rpm: error ≤ 2 LSB + 0.1 % de la
+ *                     velocidad, capturas por muestra acotadas,
+ *                     posición multivuelta exacta, ángulo exacto y
+ *                     ningún error de índice (adelante y atrás)
+ *    2 rampa        – 0 → 5900 → 0 rpm en 0.5 s por tramo: error por
+ *                     debajo del retardo de una muestra y una captura
+ *    3 frenada      – de 5900 rpm a 0 de golpe: la estimación decae
+ *                     aunque el preescalador baje de 16 a 1
+ *    4 inversión    – posición senoidal (±3000 rpm a 5 Hz): signo
+ *                     correcto y, con |v| ≥ 5 %, error acotado por la
+ *                     aceleración
+ *    5 cuenta perdida – POSCNT atrasado una cuenta: index_errors
+ *  Cada caso imprime sus cifras y PASS/FAIL; el código de salida es
+ *  el número de fallas.
+ *************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+
+#define FCY             (7370000UL * 16UL / 4UL)
+#define QEI_PPR         500UL
+#define QEI_EDGES_REV   (2UL * QEI_PPR)
+#define QEI_RPM_MAX     6000UL
+#define QEI_VEL_MAX     (QEI_RPM_MAX * QEI_EDGES_REV / 60UL)
+#define QEI_TICK_HZ     (FCY / 8UL)
+#include "qei_mt.h"
+
+#define SAMPLE_TICKS    (QEI_TICK_HZ / 1000UL)      // Timer1 a 1 kHz
+#define LAT_TICKS       5U                          // ≈ 40 TCY hasta leer POSCNT
+#define IDX_COUNT       250                         // cuenta del índice en la vuelta
+#define RPM2CPS(r)      ((r) * QEI_EDGES_REV / 60.0)
+#define FS_LSB          32768.0
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static const uint8_t k_div[3] = { 1, 4, 16 };
+
+/* ——————————————————— MODELO ——————————————————— */
+typedef double (*profile_t)(double t);      // cuentas/s
+
+typedef struct {
+    /* resultados */
+    double   err_max;           // |estimado − real|, LSB
+    double   err_rel_max;       // error / (2 LSB + 0.1 % de |v|)
+    double   err_fs_min;        // sólo con |v| ≥ v_min: error máx., LSB
+    int      sign_bad;          // signo opuesto con |v| ≥ v_min
+    unsigned cap_max;           // capturas por muestra
+    int      pos_bad;           // posición multivuelta distinta
+    int      angle_bad;         // ángulo distinto del real
+    qei_state_t q;
+} run_t;
+
+/* t_skip: no evaluar el error antes; v_min: umbral de signo/err_fs;
+   lose_at: atrasar POSCNT una cuenta en ese instante (< 0: nunca) */
+static void run(run_t *r, profile_t v, double secs, double t_skip,
+                double v_min, double lose_at)
+{
+    const uint32_t t0 = 0xFFFFFFFFUL - 2UL * QEI_TICK_HZ / 10UL;   // vuelta a 0.2 s
+    const long     p0 = 65536L - 700L - IDX_COUNT;                  // POSCNT envuelve
+    const uint64_t n  = (uint64_t)(secs * QEI_TICK_HZ);
+    double   theta  = 0.5;                 // cuentas desde el arranque
+    long     cnt    = 0;                   // floor(theta)
+    long     skew   = 0;                   // cuentas perdidas
+    unsigned ic_n   = 0;                   // preescalador de IC7
+    uint64_t pend_k = 0;
+    uint32_t pend_t = 0;
+    uint8_t  pend   = 0;
+    qei_snap_t isr  = { 0 };
+
+    *r = (run_t){ 0 };
+    r->q.last_poscnt = (uint16_t)p0;
+
+    for (uint64_t k = 1; k <= n; k++) {
+        double   t   = (double)k / QEI_TICK_HZ;
+        uint32_t now = t0 + (uint32_t)k;
+        theta += v(t) / QEI_TICK_HZ;
+        long c = (long)floor(theta);
+
+        if (lose_at >= 0 && t >= lose_at && !skew) skew = 1;
+        while (c != cnt) {                  // una cuenta por vez
+            long prev = cnt;
+            cnt += c > cnt ? 1 : -1;
+            uint16_t poscnt = (uint16_t)(p0 + cnt - skew);
+            if (!(prev & 1) && (cnt & 1) && ++ic_n >= k_div[r->q.presc_sel]) {
+                ic_n   = 0;                 // flanco de subida de QEA capturado
+                pend   = 1;
+                pend_t = now;
+                pend_k = k + LAT_TICKS;
+            }
+            if (((cnt % (long)QEI_EDGES_REV) + QEI_EDGES_REV) % QEI_EDGES_REV == IDX_COUNT) {
+                isr.idx_pos  = (int16_t)poscnt;
+                isr.idx_flag = 1;
+            }
+        }
+        if (pend && k >= pend_k) {          // ISR de IC7
+            pend = 0;
+            isr.cap_time = pend_t;
+            isr.cap_pos  = (int16_t)(uint16_t)(p0 + cnt - skew);
+            isr.cap_count++;
+        }
+
+        if (k % SAMPLE_TICKS) continue;
+        qei_snap_t s = isr;
+        s.poscnt = (uint16_t)(p0 + cnt - skew);
+        s.now    = now;
+        isr.cap_count = 0;
+        isr.idx_flag  = 0;
+        if (s.cap_count > r->cap_max && t > 0.02) r->cap_max = s.cap_count;
+
+        uint8_t sel = qei_mt_update(&r->q, &s);
+        if (sel != r->q.presc_sel) { qei_mt_presc(&r->q, sel); ic_n = 0; }
+
+        if (r->q.pos != cnt - skew) r->pos_bad++;
+        if (r->q.homed) {
+            long m = (((cnt - skew) - IDX_COUNT) % (long)QEI_EDGES_REV + QEI_EDGES_REV) % QEI_EDGES_REV;
+            if (r->q.angle != (uint16_t)((m << 16) / QEI_EDGES_REV)) r->angle_bad++;
+        }
+        if (t < t_skip) continue;
+        double vt  = v(t) / QEI_VEL_MAX * FS_LSB;
+        double err = fabs(r->q.vel_q15 - vt);
+        double rel = err / (2.0 + 0.001 * fabs(vt));
+        if (err > r->err_max) r->err_max = err;
+        if (rel > r->err_rel_max) r->err_rel_max = rel;
+        if (fabs(vt) >= v_min) {
+            if (err > r->err_fs_min) r->err_fs_min = err;
+            if ((vt > 0) != (r->q.vel_q15 > 0)) r->sign_bad++;
+        }
+    }
+}
+
+/* ——————————————————— PERFILES ——————————————————— */
+static double g_rpm;
+static double prof_const(double t) { (void)t; return RPM2CPS(g_rpm); }
+
+static double prof_ramp(double t)
+{
+    double top = RPM2CPS(5900.0);
+    if (t < 0.5) return top * t / 0.5;
+    if (t < 0.7) return top;
+    if (t < 1.2) return top * (1.2 - t) / 0.5;
+    return 0.0;
+}
+
+static double prof_stop(double t)  { return t < 0.1 ? RPM2CPS(5900.0) : 0.0; }
+
+#define SINE_HZ         5.0
+static double prof_sine(double t)  { return RPM2CPS(3000.0) * cos(2.0 * M_PI * SINE_HZ * t); }
+
+/* ——————————————————— CASOS ——————————————————— */
+static void case_const(void)
+{
+    static const double rpm[] = { 3, 30, 300, 1500, 3000, 5900, -5900, -300, -3 };
+    run_t r;
+
+    printf("1 velocidad constante (0.8 s, error tras 0.1 s)\n");
+    printf("      rpm  err LSB  err/tol  presc  cap/muestra  índice\n");
+    for (unsigned i = 0; i < sizeof rpm / sizeof rpm[0]; i++) {
+        char what[96];
+        g_rpm = rpm[i];
+        run(&r, prof_const, 0.8, 0.1, 0.0, -1.0);
+        printf("    %5.0f  %7.2f  %7.2f  %5u  %11u  %6u\n", rpm[i], r.err_max,
+               r.err_rel_max, k_div[r.q.presc_sel], r.cap_max, r.q.index_errors);
+        snprintf(what, sizeof what, "%.0f rpm: error ≤ 2 LSB + 0.1 %%, ≤ %u capturas, "
+                 "posición/ángulo/índice", rpm[i], QEI_CAP_HI * 2U);
+        /* a baja velocidad puede no llegar al índice en 0.8 s */
+        double c = RPM2CPS(rpm[i]) * 0.8;
+        int reach = c > 0 ? c > IDX_COUNT : -c > (double)(QEI_EDGES_REV - IDX_COUNT);
+        check(what, r.err_rel_max <= 1.0 && r.cap_max <= QEI_CAP_HI * 2U &&
+                    !r.pos_bad && !r.angle_bad && r.q.homed == reach && !r.q.index_errors);
+    }
+}
+
+static void case_ramp(void)
+{
+    run_t r;
+    /* lo que cambia la velocidad en una muestra y una captura (a 5 %) */
+    double a   = RPM2CPS(5900.0) / 0.5;
+    double lag = a * (1e-3 + 2.0 / RPM2CPS(300.0)) / QEI_VEL_MAX * FS_LSB;
+
+    printf("\n2 rampa 0 → 5900 → 0 rpm\n");
+    run(&r, prof_ramp, 1.4, 0.0, 0.05 * FS_LSB, -1.0);
+    printf("    error máx. con |v| ≥ 5 %%: %.0f LSB (cota %.0f), máx. total %.0f LSB\n",
+           r.err_fs_min, lag, r.err_max);
+    check("error acotado por el retardo de muestra + captura, signo y posición",
+          r.err_fs_min <= lag && !r.sign_bad && !r.pos_bad);
+    check("parado al final", r.q.vel_q15 == 0 || (r.q.vel_q15 > -40 && r.q.vel_q15 < 40));
+}
+
+static void case_stop(void)
+{
+    run_t r;
+    int16_t v50, v500;
+
+    printf("\n3 frenada de 5900 rpm a 0\n");
+    run(&r, prof_stop, 0.15, 1.0, 0.0, -1.0);
+    v50 = r.q.vel_q15;
+    run(&r, prof_stop, 0.6, 1.0, 0.0, -1.0);
+    v500 = r.q.vel_q15;
+    printf("    50 ms después: %d LSB, 500 ms después: %d LSB, preescalador %u\n",
+           v50, v500, k_div[r.q.presc_sel]);
+    check("< 1 % a los 50 ms", v50 >= 0 && v50 < 328);
+    check("< 0.1 % a los 500 ms con el preescalador en 1", v500 >= 0 && v500 < 33 &&
+          r.q.presc_sel == 0);
+}
+
+static void case_sine(void)
+{
+    run_t r;
+    double a   = 2.0 * M_PI * SINE_HZ * RPM2CPS(3000.0);
+    double lag = a * (1e-3 + 2.0 / (0.05 * QEI_VEL_MAX)) / QEI_VEL_MAX * FS_LSB;
+
+    printf("\n4 inversión: ±3000 rpm a %.0f Hz\n", SINE_HZ);
+    run(&r, prof_sine, 1.0, 0.05, 0.05 * FS_LSB, -1.0);
+    printf("    error máx. con |v| ≥ 5 %%: %.0f LSB (cota a·(muestra + captura) %.0f), "
+           "máx. total %.0f LSB, signo mal: %d\n", r.err_fs_min, lag, r.err_max, r.sign_bad);
+    check("signo correcto con |v| ≥ 5 %", !r.sign_bad);
+    check("error acotado por la aceleración", r.err_fs_min <= lag);
+    check("posición multivuelta exacta", !r.pos_bad);
+}
+
+static void case_lost(void)
+{
+    run_t r;
+
+    printf("\n5 cuenta perdida en POSCNT\n");
+    g_rpm = 1500.0;
+    run(&r, prof_const, 0.5, 1.0, 0.0, 0.2);
+    printf("    index_errors: %u\n", r.q.index_errors);
+    check("el índice la detecta", r.q.index_errors > 0);
+}
+
+int main(void)
+{
+    printf("qei_mt.h: K = %lu, M máx. %u, muestra %lu ticks\n\n",
+           (unsigned long)QEI_K, QEI_M_MAX, (unsigned long)SAMPLE_TICKS);
+    case_const();
+    case_ramp();
+    case_stop();
+    case_sine();
+    case_lost();
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,147 @@
+/*************************************************************
+ *  Posición y velocidad M/T de un encoder – header-only
+ *  (firmware y PC: 10_qei_velocity_mt.c, host/qei_sim.c)
+ *
+ *  Antes de incluir:
+ *      #define QEI_TICK_HZ    …        // base de tiempo de las capturas, Hz
+ *      #define QEI_EDGES_REV  …        // cuentas de POSCNT por vuelta
+ *      #define QEI_VEL_MAX    …        // cuentas/s que valen 1.0 en Q15
+ *
+ *  qei_mt_update() trabaja sobre una foto (qei_snap_t) que el
+ *  firmware toma con las ISR de QEI/IC/índice bloqueadas:
+ *    – posición multivuelta con el Δ de POSCNT en 16 bits;
+ *    – índice: el primero fija el origen y los siguientes deben caer
+ *      a un múltiplo exacto de QEI_EDGES_REV (si no, index_errors);
+ *    – velocidad v = M · QEI_K / T entre los dos últimos flancos
+ *      capturados (M cuentas, T ticks), saturada a ±32767;
+ *    – sin capturas en la muestra, |v| ≤ (cuentas desde la última
+ *      captura + 1) / tiempo desde ella: la estimación decae sola al
+ *      frenar, sea cual sea el preescalador de captura.
+ *  Devuelve el preescalador de captura que conviene (0 → 1 flanco,
+ *  1 → 4, 2 → 16) para que haya entre QEI_CAP_LO y QEI_CAP_HI
+ *  capturas por muestra; el firmware lo aplica y avisa con
+ *  qei_mt_presc(). Cambiar el preescalador no invalida la referencia:
+ *  cada captura es un flanco real con su POSCNT.
+ *************************************************************/
+#ifndef QEI_MT_H
+#define QEI_MT_H
+
+#include <stdint.h>
+
+#if !defined(QEI_TICK_HZ) || !defined(QEI_EDGES_REV) || !defined(QEI_VEL_MAX)
+#error "definir QEI_TICK_HZ, QEI_EDGES_REV y QEI_VEL_MAX antes de incluir qei_mt.h"
+#endif
+
+/* Umbrales del preescalador de captura (capturas por muestra) */
+#ifndef QEI_CAP_HI
+#define QEI_CAP_HI      8U
+#endif
+#ifndef QEI_CAP_LO
+#define QEI_CAP_LO      2U
+#endif
+
+/* K = QEI_TICK_HZ · 32768 / QEI_VEL_MAX (≈ 1 207 500 en la demo): el
+   producto intermedio no cabe en 32 bits → ULL */
+#define QEI_K_ULL       ((QEI_TICK_HZ * 32768ULL) / QEI_VEL_MAX)
+#define QEI_K           ((uint32_t)QEI_K_ULL)
+/* M · K en 32 bits: con más cuentas entre capturas la velocidad ya
+   satura (a QEI_VEL_MAX y 1 kHz hay 100 cuentas por muestra) */
+#define QEI_M_MAX       ((uint16_t)(0xFFFFFFFFULL / QEI_K_ULL))   // ≤ 42 949 con el #if
+
+#if QEI_K_ULL < 100000ULL || QEI_K_ULL > 0xFFFFFFFFULL / 64ULL
+#error "QEI_K fuera de rango (≈ 1 207 500): revisar QEI_TICK_HZ, QEI_EDGES_REV y QEI_VEL_MAX"
+#endif
+
+/* ——————————————————— TIPOS ——————————————————— */
+typedef struct {
+    /* salida (válida tras cada qei_mt_update) */
+    int16_t  vel_q15;          // velocidad, 1.0 = QEI_VEL_MAX
+    int32_t  pos;              // posición multivuelta, cuentas
+    uint16_t angle;            // ángulo mecánico, 65536 = 1 vuelta (tras homing)
+    uint8_t  homed;            // 1 tras el primer índice
+    uint16_t index_errors;     // índices con cuentas perdidas/sobrantes
+
+    /* estado interno del estimador */
+    uint16_t last_poscnt;
+    int16_t  prev_cap_pos;     // POSCNT en la captura de referencia
+    uint32_t prev_cap_time;    // tiempo de esa captura (ticks)
+    uint8_t  ref_valid;
+    uint8_t  presc_sel;        // 0 → 1 flanco, 1 → 4, 2 → 16
+    int16_t  index_pos;        // POSCNT en el último índice
+} qei_state_t;
+
+/* Foto de lo que escriben las ISR, más POSCNT y el tiempo actual */
+typedef struct {
+    uint32_t cap_time;         // último flanco capturado (ticks)
+    int16_t  cap_pos;          // POSCNT en ese flanco
+    uint16_t cap_count;        // capturas desde la muestra anterior
+    uint8_t  idx_flag;         // hubo índice
+    int16_t  idx_pos;          // POSCNT en el índice
+    uint16_t poscnt;
+    uint32_t now;
+} qei_snap_t;
+
+/* ——————————————————— ESTIMADOR ——————————————————— */
+static inline void qei_mt_presc(qei_state_t *q, uint8_t sel)
+{
+    q->presc_sel = sel;
+}
+
+static inline int16_t qei_mt_sat(int16_t sign, uint32_t mag)
+{
+    if (mag > 32767UL) mag = 32767UL;
+    return (int16_t)(sign < 0 ? -(int16_t)mag : (int16_t)mag);
+}
+
+static inline uint8_t qei_mt_update(qei_state_t *q, const qei_snap_t *s)
+{
+    /* Posición multivuelta (POSCNT envuelve en 16 bits) */
+    q->pos += (int16_t)(s->poscnt - q->last_poscnt);
+    q->last_poscnt = s->poscnt;
+
+    if (s->idx_flag) {
+        if (q->homed) {
+            int16_t d = (int16_t)(s->idx_pos - q->index_pos);
+            if (d < 0) d = (int16_t)-d;
+            if ((uint16_t)d % QEI_EDGES_REV) q->index_errors++;
+        }
+        q->index_pos = s->idx_pos;
+        q->homed = 1;
+    }
+    if (q->homed) {
+        int16_t rel = (int16_t)(s->poscnt - (uint16_t)q->index_pos);
+        int16_t m   = (int16_t)(rel % (int16_t)QEI_EDGES_REV);
+        if (m < 0) m = (int16_t)(m + QEI_EDGES_REV);
+        q->angle = (uint16_t)(((uint32_t)m << 16) / QEI_EDGES_REV);
+    }
+
+    if (s->cap_count) {
+        if (q->ref_valid) {
+            int16_t  m  = (int16_t)(s->cap_pos - q->prev_cap_pos);   // cuentas entre flancos
+            uint32_t t  = s->cap_time - q->prev_cap_time;            // ticks entre flancos
+            uint16_t am = (uint16_t)(m < 0 ? -m : m);
+            if (t)
+                q->vel_q15 = qei_mt_sat(m, am > QEI_M_MAX ? 32768UL
+                                               : ((uint32_t)am * QEI_K) / t);
+        }
+        q->prev_cap_pos  = s->cap_pos;
+        q->prev_cap_time = s->cap_time;
+        q->ref_valid     = 1;
+    } else if (q->ref_valid) {
+        /* Sin capturas: desde la última pasaron |Δ| cuentas y la
+           siguiente todavía no llegó */
+        uint32_t t  = s->now - q->prev_cap_time;
+        int16_t  dp = (int16_t)(s->poscnt - (uint16_t)q->prev_cap_pos);
+        uint16_t m  = (uint16_t)((dp < 0 ? -dp : dp) + 1);
+        uint32_t bound = (t && m <= QEI_M_MAX) ? ((uint32_t)m * QEI_K) / t : 32767UL;
+        int16_t  mag   = q->vel_q15 < 0 ? (int16_t)-q->vel_q15 : q->vel_q15;
+        if ((uint32_t)mag > bound) q->vel_q15 = qei_mt_sat(q->vel_q15, bound);
+    }
+
+    /* Preescalador de captura para la próxima muestra */
+    if (s->cap_count > QEI_CAP_HI && q->presc_sel < 2) return (uint8_t)(q->presc_sel + 1U);
+    if (s->cap_count < QEI_CAP_LO && q->presc_sel > 0) return (uint8_t)(q->presc_sel - 1U);
+    return q->presc_sel;
+}
+
+#endif  /* QEI_MT_H */
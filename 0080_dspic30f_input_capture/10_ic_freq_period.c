@@ -0,0 +1,227 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz × PLL16  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  medición de frecuencia, periodo y duty con Input Capture
+ *
+ *  Canales y pines (fijos en el dsPIC30F4011):
+ *    IC1 = RD0   IC2 = RD1   IC7 = RB4   IC8 = RB5
+ *
+ *  – Los cuatro módulos capturan contra Timer2 (1:1, Tcy) extendido
+ *    a 32 bits por software (vuelve a los ~145 s).
+ *  – Captura en cada flanco; la ISR sólo acumula Σperiodo y Σalto
+ *    y, cada IC_WINDOW periodos o en cuanto Σperiodo pasa de
+ *    IC_WINDOW_MAX_MS, publica el bloque para el fondo: Σperiodo
+ *    queda por debajo de IC_WINDOW_MAX_MS + un periodo y no desborda
+ *    los 32 bits con ninguna ventana.
+ *  – Frecuencia, periodo y duty se calculan fuera de la ISR en punto
+ *    fijo: Hz en Q16.16 (satura en 65 535.99 Hz; más arriba vale
+ *    period_ns), periodo en ns, duty en Q15.
+ *  – Sin flancos durante IC_TIMEOUT_MS la señal se da por parada: el
+ *    periodo más largo que se mide es ~2 · IC_TIMEOUT_MS (duty 50 %).
+ *  – El cálculo está en ic_meas.h; host/ic_sim.c lo prueba con trenes
+ *    de flancos y un modelo del FIFO de captura.
+ *************************************************************/
+
+/* ——— CONFIG BITS ——— */
+#pragma config FPR     = FRC_PLL16     // FRC ×16 → FCY ≈ 29.48 MHz
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_IOPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define FCY             (7370000UL * 16UL / 4UL)     // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+
+#define IC_TICK_HZ      FCY                // Timer2 1:1
+#define IC_CHANNELS     4
+#define IC_WINDOW       16U                // periodos promediados (por defecto)
+#define IC_TIMEOUT_MS   500UL              // sin flancos → frecuencia 0
+#define IC_WINDOW_MAX_MS 1000UL            // ventana más larga en tiempo
+#include "ic_meas.h"
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static ic_chan_t         g_ic[IC_CHANNELS];
+static ic_result_t       g_ic_res[IC_CHANNELS];
+static volatile uint16_t g_t2_hi = 0;        // extensión de Timer2
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timer2_init(void);
+static void ic_init(void);
+static void ic_set_window(uint8_t ch, uint16_t periods);
+static void ic_process(uint8_t ch);
+
+/* ——————————————————— SECCIÓN CRÍTICA (ISRs nivel 6) ———————— */
+/* Sólo desde el fondo (IPL 0): eleva la CPU por encima de T2/ICx */
+#define IC_ATOMIC_BEGIN()  do { SRbits.IPL = 6; } while (0)
+#define IC_ATOMIC_END()    do { SRbits.IPL = 0; } while (0)
+
+/* ——————————————————— TIMER2: BASE DE TIEMPO COMPARTIDA ————————— */
+static void timer2_init(void)
+{
+    T2CON = 0;
+    TMR2  = 0;
+    PR2   = 0xFFFF;
+    T2CONbits.TCKPS = 0;       // 1:1 → resolución Tcy ≈ 34 ns
+    IFS0bits.T2IF = 0;
+    IPC1bits.T2IP = 6;         // misma prioridad que las capturas
+    IEC0bits.T2IE = 1;
+    T2CONbits.TON = 1;
+}
+
+void __attribute__((interrupt, auto_psv)) _T2Interrupt(void)
+{
+    IFS0bits.T2IF = 0;
+    g_t2_hi++;
+}
+
+/* Captura 16 bits → 32 bits. Misma prioridad que T2: si el desborde
+   está pendiente y la captura es "baja", ocurrió después de él. */
+static inline uint32_t ic_extend(uint16_t lo)
+{
+    uint16_t hi = g_t2_hi;
+    if (IFS0bits.T2IF && lo < 0x8000U) hi++;
+    return ((uint32_t)hi << 16) | lo;
+}
+
+static uint32_t t2_now32(void)
+{
+    IC_ATOMIC_BEGIN();
+    uint32_t t = ic_extend(TMR2);
+    IC_ATOMIC_END();
+    return t;
+}
+
+/* Cuerpo común de las cuatro ISR: vacía el FIFO y atiende ICOV */
+#define IC_ISR_BODY(n, ch, pin)                                   \
+    do {                                                          \
+        while (IC##n##CONbits.ICBNE)                              \
+            ic_edge(&g_ic[ch], ic_extend(IC##n##BUF));            \
+        if (IC##n##CONbits.ICOV) {                                \
+            IC##n##CONbits.ICM = 0;      /* limpia FIFO y ICOV */ \
+            g_ic[ch].overflows++;                                 \
+            ic_sync(&g_ic[ch], (pin));                            \
+            IC##n##CONbits.ICM = 0b001;                           \
+        }                                                         \
+    } while (0)
+
+void __attribute__((interrupt, auto_psv)) _IC1Interrupt(void)
+{
+    IFS0bits.IC1IF = 0;
+    IC_ISR_BODY(1, 0, PORTDbits.RD0);
+}
+
+void __attribute__((interrupt, auto_psv)) _IC2Interrupt(void)
+{
+    IFS0bits.IC2IF = 0;
+    IC_ISR_BODY(2, 1, PORTDbits.RD1);
+}
+
+void __attribute__((interrupt, auto_psv)) _IC7Interrupt(void)
+{
+    IFS1bits.IC7IF = 0;
+    IC_ISR_BODY(7, 2, PORTBbits.RB4);
+}
+
+void __attribute__((interrupt, auto_psv)) _IC8Interrupt(void)
+{
+    IFS1bits.IC8IF = 0;
+    IC_ISR_BODY(8, 3, PORTBbits.RB5);
+}
+
+/* ——————————————————— INICIALIZAR CAPTURAS ——————————————————— */
+static void ic_init(void)
+{
+    ADPCFGbits.PCFG4 = 1;                  // RB4, RB5 digitales
+    ADPCFGbits.PCFG5 = 1;
+    TRISB |= (1 << 4) | (1 << 5);
+    TRISD |= (1 << 0) | (1 << 1);
+
+    for (uint8_t i = 0; i < IC_CHANNELS; i++) {
+        g_ic[i].window = IC_WINDOW;
+    }
+    ic_sync(&g_ic[0], PORTDbits.RD0);
+    ic_sync(&g_ic[1], PORTDbits.RD1);
+    ic_sync(&g_ic[2], PORTBbits.RB4);
+    ic_sync(&g_ic[3], PORTBbits.RB5);
+
+    /* ICTMR = 1 → Timer2; ICI = 0 → IRQ en cada captura; ICM = 001 → cada flanco */
+    IC1CON = 0; IC1CONbits.ICTMR = 1; IC1CONbits.ICM = 0b001;
+    IC2CON = 0; IC2CONbits.ICTMR = 1; IC2CONbits.ICM = 0b001;
+    IC7CON = 0; IC7CONbits.ICTMR = 1; IC7CONbits.ICM = 0b001;
+    IC8CON = 0; IC8CONbits.ICTMR = 1; IC8CONbits.ICM = 0b001;
+
+    IFS0bits.IC1IF = 0; IPC0bits.IC1IP = 6; IEC0bits.IC1IE = 1;
+    IFS0bits.IC2IF = 0; IPC1bits.IC2IP = 6; IEC0bits.IC2IE = 1;
+    IFS1bits.IC7IF = 0; IPC4bits.IC7IP = 6; IEC1bits.IC7IE = 1;
+    IFS1bits.IC8IF = 0; IPC4bits.IC8IP = 6; IEC1bits.IC8IE = 1;
+}
+
+/* Cambia la ventana de promediado de un canal en tiempo de ejecución */
+static void ic_set_window(uint8_t ch, uint16_t periods)
+{
+    if (periods == 0) periods = 1;
+    IC_ATOMIC_BEGIN();
+    g_ic[ch].window = periods;
+    g_ic[ch].acc_period = 0;
+    g_ic[ch].acc_high   = 0;
+    g_ic[ch].acc_n      = 0;
+    IC_ATOMIC_END();
+}
+
+/* ——————————————————— CÁLCULO EN PUNTO FIJO (FONDO) ————————————— */
+static void ic_process(uint8_t ch)
+{
+    ic_chan_t   *c = &g_ic[ch];
+    ic_result_t *r = &g_ic_res[ch];
+
+    if (c->pub_ready) {
+        IC_ATOMIC_BEGIN();
+        uint32_t sp = c->pub_period;
+        uint32_t sh = c->pub_high;
+        uint16_t n  = c->pub_n;
+        c->pub_ready = 0;
+        IC_ATOMIC_END();
+
+        ic_calc(r, sp, sh, n);
+    } else if (r->running) {
+        IC_ATOMIC_BEGIN();
+        uint32_t last = c->last_edge;
+        IC_ATOMIC_END();
+        if (ic_stale(last, t2_now32())) ic_stop(r);
+    }
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    timer2_init();
+    ic_init();
+
+    __builtin_enable_interrupts();
+
+    ic_set_window(2, 4);        // ej.: IC7 (tacómetro lento) con 4 periodos
+
+    for (;;)
+    {
+        for (uint8_t ch = 0; ch < IC_CHANNELS; ch++) {
+            ic_process(ch);
+        }
+        /* g_ic_res[] listo para telemetría o para el lazo de control */
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*************************************************************
+ *  ic_sim – ic_meas.h con trenes de flancos simulados, en PC
+ *
+ *  cc -O2 -Wall -I.. -o ic_sim ic_sim.c -lm
+ *
+ *  Los flancos de una señal (frecuencia, duty y jitter dados) se
+ *  capturan a TCY (29.48 MHz) contra un tiempo de 32 bits que vuelve
+ *  a 0 a los 0.5 s. Un modelo del módulo reproduce lo que importa de
+ *  la ISR de 10_ic_freq_period.c: FIFO de 4 capturas, ICOV cuando
+ *  llega la quinta, entrada a la ISR ISR_IN_TCY después de la primera
+ *  captura pendiente, ISR_EDGE_TCY por flanco vaciado y, si hubo
+ *  ICOV, ic_sync() con el nivel del pin. Cada bloque publicado pasa
+ *  por ic_calc() y se compara con la señal.
+ *
+ *    1 barrido      – 2.2 Hz … 65 kHz con duty 10/50/90 %, ventana
+ *                     16: error de frecuencia ≤ 1 tick / Σperiodo +
+ *                     1 LSB, periodo ≤ 1 ns + lo mismo, duty ≤ 1 tick
+ *                     por periodo + 2 LSB; bloques con n ≤ ventana y Σperiodo
+ *                     ≤ IC_WINDOW_MAX_MS + un periodo; ningún ICOV
+ *    2 ventana larga – 1000 periodos a 2 Hz y 1.1 Hz (Σ de 500 s y más
+ *                     sin el límite de tiempo): bloques de ~1 s, exactos
+ *  Ningún tramo sin flancos pasa de IC_TIMEOUT_MS (sería parada).
+ *    3 > 65 535 Hz  – 80 y 200 kHz: freq_q16 saturada, period_ns exacto
+ *    4 demasiado rápida – 700 kHz: hay ICOV y cada uno descarta la
+ *                     ventana (con 16 no se publica nada: el resultado
+ *                     queda en el último bloque bueno); con ventana 1
+ *                     lo que se publica entre ICOV es correcto
+ *    5 jitter       – 1 kHz con σ = 300 ns por flanco: la ventana
+ *                     telescópica deja σ·√2 / Σperiodo
+ *    6 timeout      – parada: ic_stale() justo después de IC_TIMEOUT_MS
+ *  Cada caso imprime sus cifras y PASS/FAIL; el código de salida es
+ *  el número de fallas.
+ *************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+
+#define FCY             (7370000UL * 16UL / 4UL)
+#define IC_TICK_HZ      FCY
+#include "ic_meas.h"
+
+#define ISR_IN_TCY      20U             // entrada + cambio de contexto
+#define ISR_EDGE_TCY    60U             // ic_extend + ic_edge + lazo
+#define ISR_OUT_TCY     15U
+#define FIFO_LEN        4U
+#define T0              (0xFFFFFFFFULL - FCY / 2ULL)   // vuelta a 0.5 s
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static uint32_t g_rng = 12345U;
+static uint32_t rnd32(void)  { g_rng ^= g_rng << 13; g_rng ^= g_rng >> 17; g_rng ^= g_rng << 5; return g_rng; }
+static double   rndu(void)   { return (rnd32() + 0.5) / 4294967296.0; }
+static double   rndn(void)   { return sqrt(-2.0 * log(rndu())) * cos(2.0 * M_PI * rndu()); }
+
+/* ——————————————————— MODELO DEL MÓDULO ——————————————————— */
+typedef struct {
+    ic_chan_t   c;
+    ic_result_t r;
+    uint64_t    fifo[FIFO_LEN];         // capturas (ticks absolutos)
+    unsigned    fifo_n;
+    uint8_t     icov;
+    uint8_t     active;                 // ISR en curso
+    uint64_t    next;                   // próxima lectura de la ISR
+    uint64_t    free;                   // fin de la ISR anterior
+    uint8_t     pin;                    // nivel actual de la señal
+
+    /* señal y resultados */
+    double      f, duty, sigma;         // Hz, 0…1, s
+    unsigned    blocks, bad_f, bad_p, bad_d, bad_n, bad_sp;
+    double      ef_max, ed_max;         // error / tolerancia
+    double      jit_max;                // |Δf|/f en el caso 5
+} sim_t;
+
+static void check_block(sim_t *s, uint32_t sp, uint16_t n)
+{
+    const double tick = 1.0 / IC_TICK_HZ;
+    double f  = s->r.freq_q16 / 65536.0;
+    double p  = s->r.period_ns;
+    double d  = s->r.duty_q15 / 32768.0;
+    /* cuantización: Σp a ±1 tick, cada alto a ±1 tick; truncado de Q16/Q15 */
+    double tf = s->f * (1.0 + s->sigma * 4.0 * 1.42 * IC_TICK_HZ) / sp + 1.0 / 65536.0;
+    double tp = 1e9 / s->f * (1.0 + s->sigma * 4.0 * 1.42 * IC_TICK_HZ) / sp + 1.0;
+    double td = (double)n / sp * (1.0 + s->sigma * 4.0 * 1.42 * IC_TICK_HZ) + 2.0 / 32768.0;
+    double fs = s->f < 65535.99 ? s->f : 65535.99;
+
+    s->blocks++;
+    if (n > s->c.window) s->bad_n++;
+    if (sp > IC_WINDOW_MAX_TICKS + IC_TICK_HZ / s->f + 2.0) s->bad_sp++;
+    if (s->f < 65535.0) {
+        if (fabs(f - fs) > tf) s->bad_f++;
+        if (fabs(f - fs) / tf > s->ef_max) s->ef_max = fabs(f - fs) / tf;
+    } else if (s->r.freq_q16 != 0xFFFFFFFFUL) {
+        s->bad_f++;
+    }
+    if (fabs(p - 1e9 / s->f) > tp) s->bad_p++;
+    if (fabs(d - s->duty) > td) s->bad_d++;
+    if (fabs(d - s->duty) / td > s->ed_max) s->ed_max = fabs(d - s->duty) / td;
+    if (fabs(1.0 / (sp * tick / n) - s->f) / s->f > s->jit_max)
+        s->jit_max = fabs(1.0 / (sp * tick / n) - s->f) / s->f;
+}
+
+/* El fondo: lo que hace ic_process() con un bloque publicado */
+static void poll(sim_t *s)
+{
+    if (!s->c.pub_ready) return;
+    uint32_t sp = s->c.pub_period, sh = s->c.pub_high;
+    uint16_t n  = s->c.pub_n;
+    s->c.pub_ready = 0;
+    ic_calc(&s->r, sp, sh, n);
+    check_block(s, sp, n);
+}
+
+/* La ISR hasta el tick t */
+static void isr_run(sim_t *s, uint64_t t)
+{
+    for (;;) {
+        if (!s->active) {
+            if (!s->fifo_n && !s->icov) return;
+            uint64_t start = s->fifo_n ? s->fifo[0] + ISR_IN_TCY : t;
+            if (start < s->free) start = s->free;
+            if (start > t) return;
+            s->active = 1;
+            s->next   = start;
+        }
+        if (s->next > t) return;
+        if (s->fifo_n) {                /* while (ICxCONbits.ICBNE) */
+            uint32_t cap = (uint32_t)s->fifo[0];
+            for (unsigned i = 1; i < s->fifo_n; i++) s->fifo[i - 1] = s->fifo[i];
+            s->fifo_n--;
+            ic_edge(&s->c, cap);
+            poll(s);
+            s->next += ISR_EDGE_TCY;
+            continue;
+        }
+        if (s->icov) {                  /* ICM = 0 → ic_sync → ICM = 001 */
+            s->icov = 0;
+            s->c.overflows++;
+            ic_sync(&s->c, s->pin);
+        }
+        s->active = 0;
+        s->free   = s->next + ISR_OUT_TCY;
+    }
+}
+
+static void edge(sim_t *s, uint64_t t)
+{
+    isr_run(s, t);
+    s->pin ^= 1;
+    if (s->icov) return;                /* capturas perdidas hasta el ICM = 0 */
+    if (s->fifo_n == FIFO_LEN) { s->icov = 1; return; }
+    s->fifo[s->fifo_n++] = t;
+}
+
+/* secs de señal; devuelve el tick del último flanco */
+static uint64_t run(sim_t *s, double f, double duty, double sigma,
+                    uint16_t window, double secs)
+{
+    *s = (sim_t){ 0 };
+    s->f = f; s->duty = duty; s->sigma = sigma;
+    s->c.window = window;
+    ic_sync(&s->c, 0);
+
+    const double   per = 1.0 / f;
+    const unsigned np  = (unsigned)(secs * f) + 1U;
+    uint64_t last = T0;
+    for (unsigned k = 1; k <= np; k++) {
+        double tr = k * per, tf = tr + duty * per;
+        uint64_t a = T0 + (uint64_t)floor((tr + sigma * rndn()) * IC_TICK_HZ);
+        uint64_t b = T0 + (uint64_t)floor((tf + sigma * rndn()) * IC_TICK_HZ);
+        edge(s, a);
+        edge(s, b);
+        last = b;
+    }
+    isr_run(s, last + 100000U);
+    return last;
+}
+
+/* ——————————————————— CASOS ——————————————————— */
+static void case_sweep(void)
+{
+    static const double f[]    = { 2.2, 10.0, 97.3, 1000.0, 1234.5, 10000.0, 33333.3, 65000.0 };
+    static const double duty[] = { 0.1, 0.5, 0.9 };
+    sim_t s;
+
+    printf("1 barrido, ventana 16\n");
+    printf("          Hz  duty  bloques  err f/tol  err d/tol  ICOV\n");
+    for (unsigned i = 0; i < sizeof f / sizeof f[0]; i++) {
+        unsigned bad = 0, ov = 0, few = 0;
+        for (unsigned j = 0; j < 3; j++) {
+            double secs = f[i] < 20.0 ? 8.0 : 0.8;
+            run(&s, f[i], duty[j], 0.0, 16, secs);
+            printf("    %8.1f  %3.0f%%  %7u  %9.2f  %9.2f  %4u\n", f[i], duty[j] * 100.0,
+                   s.blocks, s.ef_max, s.ed_max, s.c.overflows);
+            bad += s.bad_f + s.bad_p + s.bad_d + s.bad_n + s.bad_sp;
+            ov  += s.c.overflows;
+            if (s.blocks < 4) few++;
+        }
+        char what[80];
+        snprintf(what, sizeof what, "%.1f Hz: frecuencia, periodo, duty y bloques", f[i]);
+        check(what, !bad && !ov && !few);
+    }
+}
+
+static void case_long(void)
+{
+    static const double f[] = { 2.0, 1.1 };
+    sim_t s;
+
+    printf("\n2 ventana de 1000 periodos\n");
+    for (unsigned i = 0; i < 2; i++) {
+        run(&s, f[i], 0.5, 0.0, 1000, 12.0);
+        printf("    %.1f Hz: %u bloques (n = %u), err f/tol %.2f\n", f[i], s.blocks,
+               s.c.pub_n, s.ef_max);
+        char what[80];
+        snprintf(what, sizeof what, "%.1f Hz: bloques de ≤ 1 s + un periodo, exactos", f[i]);
+        check(what, s.blocks >= 5 && !s.bad_f && !s.bad_p && !s.bad_d && !s.bad_sp);
+    }
+}
+
+static void case_fast(void)
+{
+    static const double f[] = { 80000.0, 200000.0 };
+    sim_t s;
+
+    printf("\n3 por encima de 65 535 Hz\n");
+    for (unsigned i = 0; i < 2; i++) {
+        run(&s, f[i], 0.5, 0.0, 16, 0.2);
+        printf("    %.0f Hz: freq_q16 0x%08lX, period_ns %lu, ICOV %u\n", f[i],
+               (unsigned long)s.r.freq_q16, (unsigned long)s.r.period_ns, s.c.overflows);
+        char what[80];
+        snprintf(what, sizeof what, "%.0f Hz: freq_q16 saturada, period_ns exacto", f[i]);
+        check(what, s.blocks > 0 && !s.bad_f && !s.bad_p && !s.c.overflows);
+    }
+}
+
+static void case_too_fast(void)
+{
+    sim_t s16, s1;
+
+    printf("\n4 700 kHz: la ISR no alcanza\n");
+    run(&s16, 700000.0, 0.5, 0.0, 16, 0.05);
+    run(&s1,  700000.0, 0.5, 0.0, 1, 0.05);
+    printf("    ventana 16: ICOV %u, bloques %u\n", s16.c.overflows, s16.blocks);
+    printf("    ventana 1:  ICOV %u, bloques %u, malos %u\n", s1.c.overflows, s1.blocks,
+           s1.bad_p + s1.bad_d + s1.bad_n);
+    check("hay ICOV y cada uno descarta la ventana (16: nada publicado)",
+          s16.c.overflows > 0 && s16.blocks == 0);
+    check("ventana 1: entre ICOV se publica y es correcto",
+          s1.c.overflows > 0 && s1.blocks > 0 && !s1.bad_p && !s1.bad_d && !s1.bad_n);
+}
+
+static void case_jitter(void)
+{
+    const double sigma = 300e-9;
+    sim_t s;
+
+    printf("\n5 jitter σ = %.0f ns a 1 kHz\n", sigma * 1e9);
+    run(&s, 1000.0, 0.5, sigma, 16, 2.0);
+    double lim = 4.0 * sigma * 1.42 / (16.0 / 1000.0);
+    printf("    |Δf|/f máx. %.2e (4σ·√2/Σp = %.2e, un periodo solo %.2e)\n",
+           s.jit_max, lim, 4.0 * sigma * 1.42 * 1000.0);
+    check("error de la ventana = jitter de sus dos extremos", s.jit_max <= lim &&
+          !s.bad_f && !s.bad_p && !s.bad_d);
+}
+
+static void case_timeout(void)
+{
+    sim_t s;
+
+    printf("\n6 timeout\n");
+    uint64_t last = run(&s, 100.0, 0.5, 0.0, 16, 0.8);
+    uint32_t le   = s.c.last_edge;
+    int before = ic_stale(le, (uint32_t)(last + IC_TIMEOUT_TICKS));
+    int after  = ic_stale(le, (uint32_t)(last + IC_TIMEOUT_TICKS + 1U));
+    printf("    last_edge 0x%08lX: a IC_TIMEOUT_MS %d, un tick después %d\n",
+           (unsigned long)le, before, after);
+    check("parada detectada justo después de IC_TIMEOUT_MS (con la vuelta de 32 bits)",
+          (uint32_t)last == le && last > 0xFFFFFFFFULL && !before && after);
+}
+
+int main(void)
+{
+    printf("ic_meas.h: TICK %lu Hz, ventana máx. %lu ticks, timeout %lu ticks\n\n",
+           (unsigned long)IC_TICK_HZ, (unsigned long)IC_WINDOW_MAX_TICKS,
+           (unsigned long)IC_TIMEOUT_TICKS);
+    case_sweep();
+    case_long();
+    case_fast();
+    case_too_fast();
+    case_jitter();
+    case_timeout();
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,141 @@
+/*************************************************************
+ *  Frecuencia, periodo y duty por flancos capturados – header-only
+ *  (firmware y PC: 10_ic_freq_period.c, host/ic_sim.c)
+ *
+ *  Antes de incluir:
+ *      #define IC_TICK_HZ   …          // base de tiempo de las capturas, Hz
+ *  Opcionales: IC_WINDOW_MAX_MS (1000), IC_TIMEOUT_MS (500).
+ *
+ *    ic_edge()   un flanco con su tiempo de 32 bits, desde la ISR:
+ *                acumula Σperiodo (subida a subida) y Σalto y publica
+ *                el bloque cada window periodos o en cuanto Σperiodo
+ *                pasa de IC_WINDOW_MAX_MS. Así Σperiodo queda por
+ *                debajo de IC_WINDOW_MAX_MS + un periodo y no desborda
+ *                con ninguna ventana.
+ *    ic_sync()   arranque o resincronización tras ICOV: el nivel del
+ *                pin dice cuál es el próximo flanco; descarta la
+ *                ventana en curso.
+ *    ic_calc()   bloque publicado → Hz en Q16.16 (satura en
+ *                65 535.99 Hz; más arriba vale period_ns), periodo en
+ *                ns y duty en Q15. Divisiones de 64 bits: va en el
+ *                fondo, no en la ISR.
+ *    ic_stale()  sin flancos durante IC_TIMEOUT_MS: el periodo más
+ *                largo que se mide es ~2 · IC_TIMEOUT_MS (duty 50 %).
+ *  Las lecturas de pub_* y last_edge desde el fondo van con las ISR
+ *  de captura bloqueadas (lo hace el firmware).
+ *************************************************************/
+#ifndef IC_MEAS_H
+#define IC_MEAS_H
+
+#include <stdint.h>
+
+#ifndef IC_TICK_HZ
+#error "definir IC_TICK_HZ antes de incluir ic_meas.h"
+#endif
+#ifndef IC_WINDOW_MAX_MS
+#define IC_WINDOW_MAX_MS    1000UL      // ventana más larga en tiempo
+#endif
+#ifndef IC_TIMEOUT_MS
+#define IC_TIMEOUT_MS       500UL       // sin flancos → frecuencia 0
+#endif
+
+#define IC_WINDOW_MAX_TICKS ((IC_TICK_HZ / 1000UL) * IC_WINDOW_MAX_MS)
+#define IC_TIMEOUT_TICKS    ((IC_TICK_HZ / 1000UL) * IC_TIMEOUT_MS)
+
+/* Σperiodo < IC_WINDOW_MAX_TICKS + un periodo ≤ 2^32 con periodos de
+   hasta 2^31 ticks (≈ 72 s a 29.48 MHz), muy por encima del timeout */
+#if IC_WINDOW_MAX_TICKS > 0x80000000UL
+#error "IC_WINDOW_MAX_MS demasiado largo para Σperiodo en 32 bits"
+#endif
+
+/* ——————————————————— TIPOS ——————————————————— */
+typedef struct {
+    /* estado de la ISR */
+    uint32_t last_rise;        // tiempo del último flanco de subida
+    uint32_t last_edge;        // tiempo del último flanco (timeout)
+    uint32_t acc_period;       // Σ periodos de la ventana actual (ticks)
+    uint32_t acc_high;         // Σ tiempos en alto
+    uint16_t acc_n;            // periodos acumulados
+    uint16_t window;           // periodos por bloque (configurable)
+    uint8_t  next_rise;        // 1 → el próximo flanco es de subida
+    uint8_t  have_rise;        // hay referencia de subida
+    uint16_t overflows;        // FIFO de captura desbordado (resincronizado)
+
+    /* bloque publicado (lo consume el fondo) */
+    volatile uint32_t pub_period;
+    volatile uint32_t pub_high;
+    volatile uint16_t pub_n;
+    volatile uint8_t  pub_ready;
+} ic_chan_t;
+
+typedef struct {
+    uint32_t freq_q16;         // Hz, Q16.16 (satura en 65 535.99 Hz)
+    uint32_t period_ns;        // periodo medio
+    int16_t  duty_q15;         // 0 … 0.99997
+    uint8_t  running;          // 0 = sin señal (timeout)
+} ic_result_t;
+
+/* ——————————————————— TRABAJO POR FLANCO (ISR) ————————————————— */
+static inline void ic_edge(ic_chan_t *c, uint32_t t)
+{
+    c->last_edge = t;
+
+    if (c->next_rise) {
+        if (c->have_rise) {
+            c->acc_period += t - c->last_rise;
+            if (++c->acc_n >= c->window || c->acc_period >= IC_WINDOW_MAX_TICKS) {
+                c->pub_period = c->acc_period;
+                c->pub_high   = c->acc_high;
+                c->pub_n      = c->acc_n;
+                c->pub_ready  = 1;
+                c->acc_period = 0;
+                c->acc_high   = 0;
+                c->acc_n      = 0;
+            }
+        }
+        c->last_rise = t;
+        c->have_rise = 1;
+    } else if (c->have_rise) {
+        c->acc_high += t - c->last_rise;
+    }
+    c->next_rise ^= 1;
+}
+
+static inline void ic_sync(ic_chan_t *c, uint8_t pin_level)
+{
+    c->next_rise  = pin_level ? 0 : 1;
+    c->have_rise  = 0;
+    c->acc_period = 0;
+    c->acc_high   = 0;
+    c->acc_n      = 0;
+}
+
+/* ——————————————————— CÁLCULO EN PUNTO FIJO (FONDO) ————————————— */
+static inline void ic_calc(ic_result_t *r, uint32_t sp, uint32_t sh, uint16_t n)
+{
+    if (!sp) return;
+    /* f = n · TICK_HZ / Σp  → Q16.16, saturado */
+    uint64_t f   = ((uint64_t)n * IC_TICK_HZ << 16) / sp;
+    r->freq_q16  = f > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)f;
+    /* T = Σp / n ticks → ns */
+    r->period_ns = (uint32_t)(((uint64_t)sp * 1000000000ULL) / ((uint64_t)n * IC_TICK_HZ));
+    /* duty = Σalto / Σp  → Q15 */
+    uint32_t d   = (uint32_t)(((uint64_t)sh << 15) / sp);
+    r->duty_q15  = (int16_t)(d > 32767UL ? 32767UL : d);
+    r->running   = 1;
+}
+
+static inline uint8_t ic_stale(uint32_t last_edge, uint32_t now)
+{
+    return (uint8_t)(now - last_edge > IC_TIMEOUT_TICKS);
+}
+
+static inline void ic_stop(ic_result_t *r)
+{
+    r->freq_q16  = 0;
+    r->period_ns = 0;
+    r->duty_q15  = 0;
+    r->running   = 0;
+}
+
+#endif  /* IC_MEAS_H */
@@ -0,0 +1,282 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  supervisor de fallas determinista para un puente trifásico
+ *
+ *  Tres caminos de protección, del más rápido al más lento:
+ *
+ *  1) FLTA (RE8, activo en bajo): FLTACON lleva PWM1…3 a su estado
+ *     inactivo por hardware, sin pasar por software. Modo latch: la
+ *     salida sigue bloqueada mientras FLTAIF no se limpie, y la ISR
+ *     no lo limpia.
+ *  2) Sobrecorriente por software: el ADC muestrea ia/ib/ic en el pico
+ *     de la portadora (special event) y _ADCInterrupt compara contra
+ *     SUP_OC_LIMIT antes de cualquier otro cálculo. Al disparar se
+ *     escribe OVDCON = 0 (OSYNC = 0 → efecto inmediato). PTMR al
+ *     disparar da la latencia muestreo→apagado en TCY; el peor caso
+ *     se guarda en g_oc_latency_max y debe quedar bajo
+ *     SUP_OC_BUDGET_TCY (medio periodo). Una sobrecorriente se ve,
+ *     como mucho, en la siguiente muestra: respuesta total ≤ un
+ *     periodo PWM + g_oc_latency_max.
+ *  3) Watchdog con ventana por software: cada tarea registrada marca
+ *     su bit en g_sup_checkins. Sólo sup_service() ejecuta ClrWdt(),
+ *     y sólo si TODAS marcaron y pasaron al menos SUP_WIN_MIN_MS desde
+ *     el último kick. Si se cumple SUP_WIN_MAX_MS sin todas las marcas
+ *     se apaga el puente y se deja de alimentar el WDT: el dsPIC30F
+ *     no tiene WDT con ventana, así que la ventana la pone el
+ *     supervisor y el WDT de hardware (~128 ms) es el respaldo.
+ *
+ *  Tras un reinicio por WDT (RCON.WDTO) el puente arranca bloqueado
+ *  y el LED (RD0) parpadea rápido.
+ *
+ *  La comparación, el apagado y la ventana están en supervisor.h;
+ *  host/sup_sim.c los corre contra un modelo del PWM, el ADC y el WDT
+ *  y verifica estas cotas.
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config FWPSB   = WDTPSB_8      // 2 ms · 8 · 8 ≈ 128 ms nominal
+#pragma config FWPSA   = WDTPSA_8
+#pragma config WDT     = WDT_ON        // WDT siempre activo
+#pragma config PWMPIN  = RST_PWMPIN    // PWM en alta impedancia tras reset
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_ON
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "../0020_dspic30f_pwm/pwm_dutyset.h"
+
+/* PWM centrado, complementario */
+#define PWM_FREQ_HZ     20000UL
+#define PTPER_VAL       ((FCY / (2UL * PWM_FREQ_HZ)) - 1)  // 736
+#define PWM_DT_NS       1000                               // 30 TCY
+#define PWM_DT_PERIOD_TCY  (2UL * (PTPER_VAL + 1))
+#include "../0020_dspic30f_pwm/pwm_deadtime.h"
+
+#include "supervisor.h"
+
+#define LED_TRIS        TRISDbits.TRISD0
+#define LED_LAT         LATDbits.LATD0
+
+/* ——————————————————— TIPOS ——————————————————— */
+typedef struct {
+    void     (*run)(void);
+    uint16_t period_ms;
+    uint16_t last_ms;
+} sup_task_t;
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static volatile int16_t  g_ia, g_ib, g_ic;
+static volatile int16_t  g_duty_cmd = 0;           // Q15, −1…1 (pot AN3)
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timer1_init_1ms(void);
+static void pwm_init_bridge(void);
+static void fault_init_flta(void);
+static void adc_init_currents(void);
+static void task_monitor(void);
+static void task_heartbeat(void);
+
+static sup_task_t g_tasks[] = {
+    { task_monitor,    10U, 0 },
+    { task_heartbeat,  25U, 0 },
+};
+#define N_SCHED_TASKS   (sizeof g_tasks / sizeof g_tasks[0])
+
+/* ——————————————————— TIMER1: tick de 1 ms ——————————————— */
+static void timer1_init_1ms(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = (uint16_t)(FCY / 1000UL - 1UL);
+    IFS0bits.T1IF = 0;
+    IPC0bits.T1IP = 4;
+    IEC0bits.T1IE = 1;
+    T1CONbits.TON = 1;
+}
+
+void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
+{
+    IFS0bits.T1IF = 0;
+    g_ms++;
+}
+
+/* ——————————————————— PWM: puente trifásico ——————————————— */
+static void pwm_init_bridge(void)
+{
+    PTCONbits.PTEN   = 0;
+    PTCONbits.PTCKPS = 0;
+    PTCONbits.PTMOD  = 0b10;       // up/down continuo
+    PTPER = PTPER_VAL;
+
+    PWMCON1 = 0;
+    pwm_complementary_init(0x7U);  // tres pares complementarios + DTCON1
+
+    OVDCON = 0x0000;               // todo forzado a inactivo hasta el final
+    PDC1 = PDC2 = PDC3 = PTPER_VAL + 1;
+
+    SEVTCMP = PTPER_VAL;           // ADC en el pico, contando hacia arriba
+    PWMCON2 = 0;
+    PWMCON2bits.SEVOPS = 0;
+    PWMCON2bits.OSYNC  = 0;        // OVDCON actúa de inmediato
+
+    PTCONbits.PTEN = 1;
+}
+
+/* ——————————————————— FLTA: apagado por hardware ——————————— */
+static void fault_init_flta(void)
+{
+    TRISEbits.TRISE8 = 1;          // FLTA/INT0 como entrada
+
+    FLTACON = 0;
+    FLTACONbits.FAEN1 = 1;         // el pin FLTA controla PWM1…3
+    FLTACONbits.FAEN2 = 1;
+    FLTACONbits.FAEN3 = 1;
+    FLTACONbits.FLTAM = 0;         // latch hasta limpiar FLTAIF
+    /* FAOVxH/L = 0 → H y L inactivos durante la falla */
+
+    IFS2bits.FLTAIF = 0;
+    IPC10bits.FLTAIP = 7;
+    IEC2bits.FLTAIE = 1;
+}
+
+void __attribute__((interrupt, auto_psv)) _FLTAInterrupt(void)
+{
+    /* El hardware ya apagó las salidas; FLTAIF queda en 1 para que
+       el latch no se libere al soltar el pin. */
+    IEC2bits.FLTAIE = 0;
+    sup_trip(FAULT_FLTA);
+}
+
+/* ——————————————————— ADC: corrientes en el pico ———————————— */
+static void adc_init_currents(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFG &= ~0x000F;             // AN0…AN3 analógicos
+
+    ADCON1 = 0;
+    ADCON1bits.FORM   = 0b11;      // fraccional con signo → Q15
+    ADCON1bits.SSRC   = 0b011;     // special event del PWM
+    ADCON1bits.SIMSAM = 1;
+    ADCON1bits.ASAM   = 1;
+
+    ADCON2 = 0;
+    ADCON2bits.CHPS = 0b10;        // CH0…CH3
+    ADCON2bits.SMPI = 3;
+
+    ADCON3bits.ADCS = 9;           // TAD = (ADCS+1)/2 · TCY ≈ 170 ns
+    ADCON3bits.SAMC = 2;
+
+    ADCHS = 0;
+    ADCHSbits.CH123SA = 0;         // CH1 = AN0 (ia), CH2 = AN1 (ib), CH3 = AN2 (ic)
+    ADCHSbits.CH0SA   = 3;         // CH0 = AN3 (pot)
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 6;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+}
+
+/* ——————————————————— ADC INTERRUPT: protección + control ————————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    IFS0bits.ADIF = 0;
+
+    int16_t ia = (int16_t)ADCBUF1;
+    int16_t ib = (int16_t)ADCBUF2;
+    int16_t ic = (int16_t)ADCBUF3;
+
+    /* 1) Protección primero: nada más se ejecuta antes */
+    uint8_t oc = sup_oc_check(ia, ib, ic);
+    if (oc != FAULT_NONE) {
+        sup_trip(oc);
+        sup_oc_latency(PTMR);
+        return;
+    }
+
+    /* 2) Control: mismo duty en las tres fases desde el pot */
+    g_ia = ia; g_ib = ib; g_ic = ic;
+    g_duty_cmd = (int16_t)ADCBUF0;
+    uint16_t pdc = (uint16_t)((PTPER_VAL + 1) +
+                   (((int32_t)g_duty_cmd * (PTPER_VAL + 1)) >> 15));
+    pwm_duty_commit_all(pdc);       // las tres fases en el mismo valle
+
+    sup_checkin(TASK_CTRL);
+}
+
+/* ——————————————————— TAREAS ——————————————————— */
+static void task_monitor(void)
+{
+    /* Coherencia de corrientes: ia + ib + ic ≈ 0 */
+    int32_t sum = (int32_t)g_ia + g_ib + g_ic;
+    if (sum > SUP_OC_LIMIT || sum < -SUP_OC_LIMIT)
+        sup_trip(FAULT_SENSOR);
+
+    sup_checkin(TASK_MONITOR);
+}
+
+static void task_heartbeat(void)
+{
+    /* LED cada 250 ms en marcha normal, cada 50 ms con falla */
+    static uint16_t div = 0;
+    uint16_t n = (g_fault_code == FAULT_NONE) ? 10U : 2U;
+    if (++div >= n) {
+        div = 0;
+        LED_LAT ^= 1;
+    }
+    sup_checkin(TASK_HEARTBEAT);
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    LED_TRIS = 0;
+    LED_LAT  = 0;
+
+    uint8_t wdt_reset = RCONbits.WDTO;
+    RCONbits.WDTO = 0;
+
+    timer1_init_1ms();
+    pwm_init_bridge();
+    fault_init_flta();
+    adc_init_currents();
+
+    if (wdt_reset) {
+        sup_trip(FAULT_WDT_RESET);      // el puente no se libera
+    } else {
+        OVDCON = 0x3F00;                // PWM toma los seis pines
+    }
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        uint16_t now = g_ms;
+        for (uint16_t k = 0; k < N_SCHED_TASKS; k++) {
+            if ((uint16_t)(now - g_tasks[k].last_ms) >= g_tasks[k].period_ms) {
+                g_tasks[k].last_ms = now;
+                g_tasks[k].run();
+            }
+        }
+        sup_service();
+    }
+    return 0;
+}
@@ -0,0 +1,466 @@
+/*************************************************************
+ *  sup_sim – latencia de falla de supervisor.h (10_fault_supervisor.c)
+ *  como prueba de regresión en PC
+ *
+ *  cc -O2 -Wall -I.. -o sup_sim sup_sim.c -lm
+ *
+ *  dsPIC30F4011 a FCY = 29.48 MHz, PWM centrado a 20 kHz
+ *  (PTPER = 736, periodo 1474 TCY) como en 10. Dos escalas:
+ *    – TCY: el special event dispara el ADC en el pico subiendo;
+ *      SIMSAM muestrea ia/ib/ic a la vez y convierte los 4 canales
+ *      (12 TAD c/u, TAD = 5 TCY) antes de ADIF. La ISR (IPL6)
+ *      arranca tras la latencia de interrupción y, a veces, tras una
+ *      sección crítica del lazo (IPL7); C_* son estimados del código
+ *      con XC16 -O1. El ADC entrega Q15 fraccional de 10 bits.
+ *      sup_oc_check(), sup_trip() y sup_oc_latency() corren tal cual;
+ *      PTMR se calcula del contador up/down en el TCY de la lectura
+ *    – ms: Timer1, el planificador del lazo con sus tareas (copia de
+ *      10) y sup_service() tal cual; el WDT vence a los 128 ms ±25 %
+ *      del último ClrWdt() (LPRC, tolerancia supuesta). Tras un
+ *      reinicio las salidas quedan en alta impedancia y el arranque
+ *      de 10 bloquea el puente con FAULT_WDT_RESET
+ *  Casos (PASS/FAIL; el código de salida es el número de fallas):
+ *    1 sobrecorriente – 20000 fallas al azar (fase, signo, instante,
+ *                       escalón o rampa): código correcto, respuesta
+ *                       ≤ un periodo PWM + g_oc_latency_max (lo que
+ *                       promete 10), g_oc_latency_max ≤ medio periodo
+ *                       y sin pérdidas de presupuesto, la latencia
+ *                       por PTMR cubre el apagado real; sin disparos
+ *                       con |i| ≤ 0.79 y ruido
+ *    2 FLTA           – apagado en el TCY siguiente, código FLTA y el
+ *                       puente no vuelve al soltar el pin
+ *    3 ventana WDT    – marcha normal 10 s sin disparos ni reinicios,
+ *                       kicks dentro de [SUP_WIN_MIN_MS, MAX]; una
+ *                       tarea o la ISR del ADC que dejan de marcar
+ *                       apagan el puente ≤ SUP_WIN_MAX_MS + 1 ms
+ *                       después del último kick; ISR o lazo colgados
+ *                       los apaga el reinicio del WDT; después de
+ *                       una falla el WDT se sigue alimentando y un
+ *                       reinicio arranca bloqueado
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define FCY             (7370000UL * 16UL / 4UL)    // ≈ 29.48 MHz
+#define PWM_FREQ_HZ     20000UL
+#define PTPER_VAL       ((FCY / (2UL * PWM_FREQ_HZ)) - 1)  // 736
+#define PWM_PERIOD_TCY  (2UL * (PTPER_VAL + 1))
+
+static void sim_outputs_off(void);
+static void sim_wdt_clear(void);
+
+#define SUP_HOST
+#define SUP_OUTPUTS_OFF()       sim_outputs_off()
+#define SUP_WDT_CLEAR()         sim_wdt_clear()
+#define SUP_ATOMIC_BEGIN(s)     ((s) = 0)
+#define SUP_ATOMIC_END(s)       ((void)(s))
+#include "supervisor.h"
+
+/* Costos estimados en TCY (-O1) */
+#define C_CONV          (4U * 12U * 5U)     // CH0…CH3, 12 TAD de 5 TCY
+#define C_IRQ           5U                  // latencia fija de interrupción
+#define C_ATOMIC_MAX    6U                  // sección crítica del lazo a IPL7
+#define C_PRO           14U                 // prólogo auto_psv
+#define C_READ          5U                  // ADIF = 0 y tres ADCBUF
+#define C_CMP           5U                  // comparación de una fase
+#define C_TRIP          4U                  // llamada + escritura de OVDCON
+#define C_AFTER         10U                 // código, cuenta, retorno, lectura de PTMR
+#define C_FLTA_ISR      (C_IRQ + C_PRO + 6U)
+
+#define N_OC            20000U
+#define N_QUIET         20000U
+
+#define WDT_NOM_MS      128U
+#define WDT_TOL         0.25
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static uint32_t g_rng = 88172645UL;
+static uint32_t rnd32(void) { g_rng ^= g_rng << 13; g_rng ^= g_rng >> 17; g_rng ^= g_rng << 5; return g_rng; }
+static double   rndu(void)  { return (rnd32() >> 8) * (1.0 / 16777216.0); }
+
+/* ——— salidas y WDT ——— */
+static uint8_t  g_out_on;
+static uint64_t g_now, g_t_off;             // TCY (caso 1/2) o ms (caso 3)
+static uint32_t g_wdt_cnt;
+
+static void sim_outputs_off(void)
+{
+    if (g_out_on) g_t_off = g_now;
+    g_out_on = 0;
+}
+
+static void sim_wdt_clear(void) { g_wdt_cnt = 0; }
+
+static void sup_reset_state(void)
+{
+    g_ms = 0;
+    g_sup_checkins = 0;
+    g_sup_last_kick = 0;
+    g_sup_starved = 0;
+    g_sup_kicks = 0;
+    g_fault_code = FAULT_NONE;
+    g_fault_count = 0;
+    g_oc_latency = g_oc_latency_max = g_oc_budget_miss = 0;
+    g_out_on = 1;
+    g_wdt_cnt = 0;
+}
+
+/* PTMR en el TCY t: up/down, PTMR<15> = 1 bajando */
+static uint16_t ptmr_at(uint64_t t)
+{
+    const uint32_t p = (uint32_t)(t % PWM_PERIOD_TCY);
+    if (p <= PTPER_VAL) return (uint16_t)p;
+    return (uint16_t)(0x8000U | (PWM_PERIOD_TCY - 1U - p));
+}
+
+/* ADC fraccional con signo de 10 bits: i en pu → Q15 */
+static int16_t adc_q15(double i)
+{
+    long a = lround(i * 512.0 + 512.0);
+    if (a < 0) a = 0;
+    if (a > 1023) a = 1023;
+    return (int16_t)((a - 512) * 64);
+}
+
+/* ——— caso 1: sobrecorriente ——— */
+typedef struct {
+    int      phase;                 // 0…2
+    double   base[3];
+    double   sign, slope;           // slope en pu por TCY; 0 = escalón
+    double   step;                  // valor tras el escalón, pu
+    uint64_t t0;
+} oc_fault_t;
+
+static double phase_i(const oc_fault_t *f, int ph, uint64_t t)
+{
+    double i = f->base[ph];
+    if (ph != f->phase || t < f->t0) return i;
+    if (f->slope == 0.0) return f->sign * f->step;
+    return i + f->sign * f->slope * (double)(t - f->t0);
+}
+
+/* Primer TCY con |i| > 0.8 */
+static uint64_t crossing(const oc_fault_t *f)
+{
+    if (f->slope == 0.0) return f->t0;
+    const double need = 0.8 - f->sign * f->base[f->phase];
+    return f->t0 + (uint64_t)ceil(need / f->slope);
+}
+
+/* ISR del ADC desde ADIF; devuelve el código de falla */
+static uint8_t adc_isr(uint64_t t_adif, uint64_t t_trig, const int16_t q[3], int64_t *lat_err)
+{
+    uint64_t t = t_adif + C_IRQ;
+    if (rnd32() % 4U == 0) t += rnd32() % (C_ATOMIC_MAX + 1U);   // el lazo estaba en IPL7
+    t += C_PRO + C_READ;
+
+    uint8_t oc = sup_oc_check(q[0], q[1], q[2]);
+    if (oc == FAULT_NONE) return oc;
+    t += C_CMP * (uint64_t)(oc - FAULT_OC_A + 1);
+    g_now = t + C_TRIP;
+    sup_trip(oc);
+    sup_oc_latency(ptmr_at(g_now + C_AFTER));
+    *lat_err = (int64_t)g_oc_latency - (int64_t)(g_t_off - t_trig);
+    return oc;
+}
+
+static void case_oc(void)
+{
+    uint32_t wrong_code = 0, late = 0, missed = 0, lat_under = 0;
+    uint64_t resp_max = 0;
+    double   resp_sum = 0;
+    uint16_t lat_max = 0;
+    uint32_t miss_total = 0;
+
+    for (uint32_t n = 0; n < N_OC; n++) {
+        sup_reset_state();
+        oc_fault_t f;
+        f.phase = (int)(rnd32() % 3U);
+        for (int p = 0; p < 3; p++) f.base[p] = (rndu() - 0.5);
+        f.sign  = (rnd32() & 1U) ? 1.0 : -1.0;
+        f.slope = (rnd32() % 3U == 0) ? 0.0
+                : (0.3 + 0.3 * rndu()) / ((0.05 + 3.0 * rndu()) * PWM_PERIOD_TCY);
+        f.step  = 0.85 + 0.35 * rndu();
+        f.t0    = 10U * PWM_PERIOD_TCY + rnd32() % (2U * PWM_PERIOD_TCY);
+        const uint64_t t_x = crossing(&f);
+
+        uint8_t code = FAULT_NONE;
+        for (uint64_t k = 0; k < 100U && code == FAULT_NONE; k++) {
+            const uint64_t t_trig = k * PWM_PERIOD_TCY + PTPER_VAL;
+            int16_t q[3];
+            for (int p = 0; p < 3; p++) q[p] = adc_q15(phase_i(&f, p, t_trig));
+            int64_t err = 0;
+            code = adc_isr(t_trig + C_CONV + 1U, t_trig, q, &err);
+            if (code != FAULT_NONE && err < -2) lat_under++;
+            if (t_trig > t_x + 4U * PWM_PERIOD_TCY) break;
+        }
+        if (code == FAULT_NONE) { missed++; continue; }
+        if (code != FAULT_OC_A + f.phase) wrong_code++;
+        const uint64_t resp = (g_t_off > t_x) ? g_t_off - t_x : 0;
+        resp_sum += (double)resp;
+        if (resp > resp_max) resp_max = resp;
+        if (g_oc_latency > lat_max) lat_max = g_oc_latency;
+        if (resp > PWM_PERIOD_TCY + g_oc_latency_max) late++;
+        miss_total += g_oc_budget_miss;
+    }
+
+    printf("      respuesta cruce→apagado: media %.2f us, máx %.2f us (%lu TCY); "
+           "g_oc_latency máx %u TCY (%.2f us)\n",
+           resp_sum / (N_OC - missed) * 1e6 / FCY, resp_max * 1e6 / FCY,
+           (unsigned long)resp_max, lat_max, lat_max * 1e6 / FCY);
+    check("toda falla se detecta con el código de su fase", missed == 0 && wrong_code == 0);
+    check("respuesta <= periodo PWM + g_oc_latency_max", late == 0);
+    check("g_oc_latency_max <= SUP_OC_BUDGET_TCY (medio periodo), sin pérdidas",
+          lat_max <= SUP_OC_BUDGET_TCY && miss_total == 0);
+    check("la latencia por PTMR cubre el apagado real (-2 TCY)", lat_under == 0);
+
+    /* Sin falla: |i| ≤ 0.79 con ruido de ±1 LSB */
+    uint32_t false_trips = 0;
+    sup_reset_state();
+    for (uint32_t n = 0; n < N_QUIET; n++) {
+        int16_t q[3];
+        for (int p = 0; p < 3; p++) {
+            const double i = 0.79 * sin(2.0 * M_PI * (n / 400.0 + p / 3.0)) + (rndu() - 0.5) * 2.0 / 512.0;
+            q[p] = adc_q15(i);
+        }
+        int64_t err;
+        if (adc_isr((uint64_t)n * PWM_PERIOD_TCY, 0, q, &err) != FAULT_NONE) false_trips++;
+    }
+    check("sin disparos con |i| <= 0.79 y ruido", false_trips == 0 && g_out_on);
+}
+
+/* ——— caso 2: FLTA ——— */
+static void case_flta(void)
+{
+    uint32_t bad = 0, reenabled = 0;
+    uint64_t code_max = 0;
+    for (uint32_t n = 0; n < 1000U; n++) {
+        sup_reset_state();
+        uint8_t fltaif = 0;
+        const uint64_t t_pin = 1000U + rnd32() % PWM_PERIOD_TCY;
+        const uint64_t t_rel = t_pin + 1U + rnd32() % (4U * PWM_PERIOD_TCY);
+
+        /* El hardware lleva PWM1…3 a inactivo en el TCY siguiente */
+        g_now = t_pin + 1U;
+        fltaif = 1;
+        sim_outputs_off();
+        const uint64_t t_hw = g_t_off;
+
+        /* _FLTAInterrupt (IPL7): FLTAIE = 0, sup_trip; FLTAIF queda en 1 */
+        g_now = t_pin + C_FLTA_ISR;
+        sup_trip(FAULT_FLTA);
+        if (g_now - t_pin > code_max) code_max = g_now - t_pin;
+        if (g_fault_code != FAULT_FLTA || t_hw - t_pin > 1U) bad++;
+
+        /* Latch: el pin se suelta, FLTAIF sigue en 1; la ISR del ADC
+           sigue corriendo con corrientes normales */
+        for (uint64_t k = 0; k < 100U; k++) {
+            int16_t q[3] = { adc_q15(0.3), adc_q15(-0.2), adc_q15(-0.1) };
+            int64_t err;
+            adc_isr(t_rel + k * PWM_PERIOD_TCY, 0, q, &err);
+            if (g_out_on || !fltaif) reenabled++;
+        }
+    }
+    printf("      pin→salidas inactivas 1 TCY (hardware), pin→g_fault_code %lu TCY\n",
+           (unsigned long)code_max);
+    check("apagado en el TCY siguiente y código FLTA", bad == 0);
+    check("el puente no vuelve al soltar el pin", reenabled == 0);
+}
+
+/* ——— caso 3: ventana del WDT, a 1 ms ——— */
+enum { RUN_OK, STOP_HEARTBEAT, STOP_ADC, HANG_ADC, HANG_MAIN, OC_TRIP };
+
+typedef struct {
+    uint16_t period_ms;
+    uint16_t last_ms;
+    uint16_t task;
+} sched_t;
+
+typedef struct {
+    uint32_t trips, resets;
+    uint8_t  first_code;
+    uint32_t kick_min, kick_max;    // intervalo entre kicks, ms
+    uint64_t t_off, t_last_kick;
+    uint64_t kick_at_off;           // último kick antes del apagado
+    uint8_t  locked_after_reset;    // el puente no volvió tras el reinicio
+    uint8_t  resets_after_first;    // reinicios después del primero
+} wdt_res_t;
+
+static void run_wdt(int scen, uint32_t ms_total, uint64_t t_stop, uint32_t wdt_ms, wdt_res_t *r)
+{
+    sched_t tasks[] = { { 10U, 0, TASK_MONITOR }, { 25U, 0, TASK_HEARTBEAT } };
+    memset(r, 0, sizeof *r);
+    r->kick_min = 0xFFFFFFFFUL;
+    r->locked_after_reset = 1;
+    sup_reset_state();
+    uint16_t kicks_prev = 0;
+    uint64_t t_kick = 0;
+    int booted_wdt = 0;
+
+    for (g_now = 1; g_now <= ms_total; g_now++) {
+        const int stopped = g_now >= t_stop;
+        const int isr_hung = stopped && scen == HANG_ADC;
+        const int main_hung = stopped && (scen == HANG_MAIN || isr_hung);
+
+        if (!isr_hung) g_ms++;                                  // T1 (IPL4) bajo la ISR colgada
+        if (!(stopped && (scen == STOP_ADC || scen == HANG_ADC)))
+            sup_checkin(TASK_CTRL);                             // _ADCInterrupt, 20 por ms
+        if (scen == OC_TRIP && g_now == t_stop) sup_trip(FAULT_OC_A);
+
+        if (!main_hung) {
+            const uint16_t now = g_ms;
+            for (uint32_t k = 0; k < 2U; k++) {
+                if ((uint16_t)(now - tasks[k].last_ms) >= tasks[k].period_ms) {
+                    tasks[k].last_ms = now;
+                    if (!(stopped && scen == STOP_HEARTBEAT && tasks[k].task == TASK_HEARTBEAT))
+                        sup_checkin(tasks[k].task);
+                }
+            }
+            sup_service();
+        }
+
+        if (g_sup_kicks != kicks_prev) {
+            kicks_prev = g_sup_kicks;
+            if (t_kick) {
+                const uint32_t d = (uint32_t)(g_now - t_kick);
+                if (d < r->kick_min) r->kick_min = d;
+                if (d > r->kick_max) r->kick_max = d;
+            }
+            t_kick = g_now;
+            r->t_last_kick = g_now;
+        }
+        if (!g_out_on && !r->t_off) {
+            r->t_off = g_now;
+            r->first_code = g_fault_code;
+            r->kick_at_off = r->t_last_kick;
+        }
+
+        /* WDT: reinicio, salidas en alta impedancia, arranque de 10 */
+        if (++g_wdt_cnt >= wdt_ms) {
+            if (booted_wdt) r->resets_after_first++;
+            r->resets++;
+            g_out_on = 0;
+            if (!r->t_off) {
+                r->t_off = g_now;
+                r->first_code = FAULT_WDT_RESET;
+                r->kick_at_off = r->t_last_kick;
+            }
+            sup_reset_state();
+            g_out_on = 0;
+            sup_trip(FAULT_WDT_RESET);                          // RCON.WDTO = 1
+            tasks[0].last_ms = tasks[1].last_ms = 0;
+            booted_wdt = 1;
+            t_stop = (uint64_t)-1;                              // el reinicio libera el cuelgue
+            kicks_prev = 0;
+            t_kick = 0;
+        }
+        if (booted_wdt && g_out_on) r->locked_after_reset = 0;
+    }
+    r->trips = g_fault_count;
+}
+
+static void case_wdt(void)
+{
+    const uint32_t wdt_min = (uint32_t)(WDT_NOM_MS * (1.0 - WDT_TOL));
+    const uint32_t wdt_max = (uint32_t)(WDT_NOM_MS * (1.0 + WDT_TOL));
+    wdt_res_t r;
+
+    printf("    marcha normal, 10 s, WDT de %lu y %lu ms\n", (unsigned long)wdt_min, (unsigned long)wdt_max);
+    run_wdt(RUN_OK, 10000U, (uint64_t)-1, wdt_min, &r);
+    printf("      kicks %u, intervalo %lu…%lu ms, disparos %lu, reinicios %lu\n",
+           g_sup_kicks, (unsigned long)r.kick_min, (unsigned long)r.kick_max,
+           (unsigned long)r.trips, (unsigned long)r.resets);
+    check("sin disparos ni reinicios, kicks dentro de la ventana",
+          r.trips == 0 && r.resets == 0 && g_out_on &&
+          r.kick_min >= SUP_WIN_MIN_MS && r.kick_max <= SUP_WIN_MAX_MS);
+
+    static const struct { int scen; const char *name; } sc[] = {
+        { STOP_HEARTBEAT, "heartbeat deja de marcar" },
+        { STOP_ADC,       "la ISR del ADC deja de correr" },
+        { HANG_ADC,       "ISR del ADC colgada (IPL6)" },
+        { HANG_MAIN,      "lazo colgado en una tarea" },
+        { OC_TRIP,        "sobrecorriente" },
+    };
+    for (uint32_t s = 0; s < sizeof sc / sizeof sc[0]; s++) {
+        uint64_t after_kick_max = 0, from_stop_max = 0;
+        uint32_t bad = 0;
+        for (uint32_t n = 0; n < 200U; n++) {
+            const uint32_t wdt = wdt_min + rnd32() % (wdt_max - wdt_min + 1U);
+            const uint64_t t_stop = 200U + rnd32() % 1000U;
+            run_wdt(sc[s].scen, 3000U, t_stop, wdt, &r);
+            const uint64_t from_stop = r.t_off - t_stop;
+            if (from_stop > from_stop_max) from_stop_max = from_stop;
+
+            switch (sc[s].scen) {
+                case STOP_HEARTBEAT:
+                case STOP_ADC:
+                    /* Apagado por la ventana; después el WDT ya no se alimenta */
+                    if (r.t_off - r.kick_at_off > after_kick_max) after_kick_max = r.t_off - r.kick_at_off;
+                    if (r.first_code != FAULT_DEADLINE || r.t_off - r.kick_at_off > SUP_WIN_MAX_MS + 1U ||
+                        r.resets != 1 || !r.locked_after_reset || r.resets_after_first)
+                        bad++;
+                    break;
+                case HANG_ADC:
+                case HANG_MAIN:
+                    /* Sólo el WDT: reinicio a ≤ wdt del último kick */
+                    if (r.first_code != FAULT_WDT_RESET || from_stop > wdt_max ||
+                        r.resets != 1 || !r.locked_after_reset || r.resets_after_first)
+                        bad++;
+                    break;
+                default:
+                    /* El WDT se sigue alimentando: sin reinicio, puente bloqueado */
+                    if (r.first_code != FAULT_OC_A || from_stop != 0 || r.resets != 0 || g_out_on)
+                        bad++;
+                    break;
+            }
+        }
+        printf("    %s: parada→apagado máx %lu ms", sc[s].name, (unsigned long)from_stop_max);
+        if (after_kick_max) printf(", último kick→apagado máx %lu ms", (unsigned long)after_kick_max);
+        printf("\n");
+        char what[112];
+        switch (sc[s].scen) {
+            case STOP_HEARTBEAT:
+            case STOP_ADC:
+                snprintf(what, sizeof what, "%s: FAULT_DEADLINE <= %u ms tras el último kick, un reinicio, bloqueado",
+                         sc[s].name, SUP_WIN_MAX_MS + 1U);
+                break;
+            case HANG_ADC:
+            case HANG_MAIN:
+                snprintf(what, sizeof what, "%s: reinicio del WDT <= %lu ms, arranca bloqueado",
+                         sc[s].name, (unsigned long)wdt_max);
+                break;
+            default:
+                snprintf(what, sizeof what, "%s: el WDT se sigue alimentando, sin reinicio", sc[s].name);
+                break;
+        }
+        check(what, bad == 0);
+    }
+}
+
+int main(void)
+{
+    printf("sup_sim: FCY %.2f MHz, PWM %lu TCY (%.1f us), ADC %u TCY hasta ADIF\n",
+           FCY / 1e6, (unsigned long)PWM_PERIOD_TCY, PWM_PERIOD_TCY * 1e6 / FCY, C_CONV);
+
+    printf("\n1 sobrecorriente, %u fallas\n", N_OC);
+    case_oc();
+
+    printf("\n2 FLTA\n");
+    case_flta();
+
+    printf("\n3 ventana del WDT\n");
+    case_wdt();
+
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,145 @@
+/*************************************************************
+ *  Supervisor de fallas – header-only
+ *  (firmware y PC: 10_fault_supervisor.c, host/sup_sim.c)
+ *
+ *  – sup_oc_check(): comparación de ia/ib/ic contra SUP_OC_LIMIT,
+ *    lo primero que hace la ISR del ADC.
+ *  – sup_oc_latency(): latencia disparo del ADC → apagado a partir
+ *    de PTMR (PWM centrado, disparo en el pico subiendo).
+ *  – sup_trip(), sup_checkin(), sup_service(): apagado, marcas de
+ *    las tareas y la ventana del watchdog por software.
+ *  Ventanas y peores casos: ver el encabezado de 10_fault_supervisor.c.
+ *
+ *  Antes de incluir, definir PTPER_VAL. En el dsPIC el apagado, el
+ *  ClrWdt() y las secciones críticas van a los registros; en el PC
+ *  (host/sup_sim.c) las pone el que incluye, con SUP_HOST definido:
+ *      SUP_OUTPUTS_OFF()  SUP_WDT_CLEAR()
+ *      SUP_ATOMIC_BEGIN(s)  SUP_ATOMIC_END(s)
+ *************************************************************/
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+
+#ifndef PTPER_VAL
+#error "definir PTPER_VAL antes de incluir supervisor.h"
+#endif
+
+/* Sobrecorriente (Q15, 1.0 = fondo de escala del sensor) */
+#define SUP_OC_LIMIT    26214                      // 0.8
+#define SUP_OC_BUDGET_TCY  (PTPER_VAL)             // medio periodo
+
+/* Ventana del watchdog, en ms de Timer1. Toda tarea supervisada debe
+   correr al menos una vez dentro de SUP_WIN_MAX_MS. */
+#define SUP_WIN_MIN_MS  5U
+#define SUP_WIN_MAX_MS  50U
+
+/* Tareas supervisadas */
+#define TASK_CTRL       0                          // _ADCInterrupt
+#define TASK_MONITOR    1                          // 10 ms
+#define TASK_HEARTBEAT  2                          // 25 ms
+#define TASK_COUNT      3
+#define TASK_ALL_MASK   ((1U << TASK_COUNT) - 1U)
+
+/* Códigos de falla (el primero queda en g_fault_code) */
+#define FAULT_NONE      0
+#define FAULT_FLTA      1
+#define FAULT_OC_A      2
+#define FAULT_OC_B      3
+#define FAULT_OC_C      4
+#define FAULT_DEADLINE  5                          // ventana WDT vencida
+#define FAULT_WDT_RESET 6                          // arranque tras WDTO
+#define FAULT_SENSOR    7                          // ia + ib + ic ≠ 0
+
+#if defined(__dsPIC30F__) || defined(__XC16__)
+#include <xc.h>
+#include <libpic30.h>
+#define SUP_OUTPUTS_OFF()   (OVDCON = 0x0000)      // POVD = 0, POUT = 0 → todo inactivo
+#define SUP_WDT_CLEAR()     ClrWdt()
+/* Secciones críticas; guardan la IPL porque también se usan en ISR */
+#define SUP_ATOMIC_BEGIN(s) do { (s) = SRbits.IPL; SRbits.IPL = 7; } while (0)
+#define SUP_ATOMIC_END(s)   do { SRbits.IPL = (s); } while (0)
+#elif !defined(SUP_HOST)
+#error "supervisor.h: fuera del dsPIC definir SUP_HOST y SUP_OUTPUTS_OFF/WDT_CLEAR/ATOMIC_*"
+#endif
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static volatile uint16_t g_ms = 0;
+static volatile uint16_t g_sup_checkins = 0;
+static uint16_t          g_sup_last_kick = 0;
+static uint8_t           g_sup_starved = 0;        // ya no se alimenta el WDT
+static volatile uint16_t g_sup_kicks = 0;
+
+static volatile uint8_t  g_fault_code  = FAULT_NONE;
+static volatile uint16_t g_fault_count = 0;
+static volatile uint16_t g_oc_latency      = 0;    // TCY, último disparo
+static volatile uint16_t g_oc_latency_max  = 0;
+static volatile uint16_t g_oc_budget_miss  = 0;
+
+/* ——————————————————— SOBRECORRIENTE ——————————————————— */
+static inline uint8_t sup_oc_check(int16_t ia, int16_t ib, int16_t ic)
+{
+    if      (ia > SUP_OC_LIMIT || ia < -SUP_OC_LIMIT) return FAULT_OC_A;
+    else if (ib > SUP_OC_LIMIT || ib < -SUP_OC_LIMIT) return FAULT_OC_B;
+    else if (ic > SUP_OC_LIMIT || ic < -SUP_OC_LIMIT) return FAULT_OC_C;
+    return FAULT_NONE;
+}
+
+/* Latencia desde el disparo (PTMR = PTPER subiendo).
+   PTMR<15> = 1: bajando → PTPER − cnt; si no, ya pasó el valle. */
+static inline void sup_oc_latency(uint16_t ptmr)
+{
+    uint16_t cnt = ptmr & 0x7FFF;
+    uint16_t lat = (ptmr & 0x8000) ? (uint16_t)(PTPER_VAL - cnt)
+                                   : (uint16_t)(PTPER_VAL + cnt);
+    g_oc_latency = lat;
+    if (lat > g_oc_latency_max)  g_oc_latency_max = lat;
+    if (lat > SUP_OC_BUDGET_TCY) g_oc_budget_miss++;
+}
+
+/* ——————————————————— SUPERVISOR ——————————————————— */
+/* Puede llamarse desde cualquier prioridad: una escritura de OVDCON */
+static inline void sup_trip(uint8_t code)
+{
+    SUP_OUTPUTS_OFF();
+    if (g_fault_code == FAULT_NONE) g_fault_code = code;
+    g_fault_count++;
+}
+
+static inline void sup_checkin(uint16_t task)
+{
+    uint16_t ipl;
+    SUP_ATOMIC_BEGIN(ipl);
+    g_sup_checkins |= (1U << task);
+    SUP_ATOMIC_END(ipl);
+}
+
+/* Único lugar donde se alimenta el WDT */
+static inline void sup_service(void)
+{
+    if (g_sup_starved) return;     // se espera el reinicio por WDT
+
+    uint16_t now = g_ms;
+    uint16_t elapsed = now - g_sup_last_kick;
+
+    /* Tras una falla TASK_CTRL deja de marcar: el puente ya está
+       bloqueado, se sigue alimentando el WDT con el resto. */
+    uint16_t need = (g_fault_code == FAULT_NONE) ? TASK_ALL_MASK
+                                                 : (TASK_ALL_MASK & ~(1U << TASK_CTRL));
+
+    if ((g_sup_checkins & need) == need) {
+        if (elapsed < SUP_WIN_MIN_MS) return;      // antes de la ventana
+        SUP_WDT_CLEAR();
+        g_sup_last_kick = now;
+        uint16_t ipl;
+        SUP_ATOMIC_BEGIN(ipl);
+        g_sup_checkins = 0;
+        SUP_ATOMIC_END(ipl);
+        g_sup_kicks++;
+    } else if (elapsed > SUP_WIN_MAX_MS) {
+        sup_trip(FAULT_DEADLINE);
+        g_sup_starved = 1;
+    }
+}
+
+#endif  /* SUPERVISOR_H */
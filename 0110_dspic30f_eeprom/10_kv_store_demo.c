@@ -0,0 +1,188 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  configuración persistente con kv_store.h
+ *
+ *  – Al arrancar, kv_load() reconstruye la caché (TMR1 mide cuánto
+ *    tarda, g_kv_load_tcy) y los parámetros salen de la EEPROM con
+ *    un valor por defecto si la clave no existe: ganancias, offset
+ *    del ADC y baud rate dejan de ser constantes de compilación.
+ *  – El PWM arranca justo después de la carga; las escrituras
+ *    (contador de arranques y cambios por UART) van en el lazo.
+ *  – UART2 (RF4/RF5) acepta un comando binario para cambiar una
+ *    clave en campo:
+ *        0xC5  clave  len  dato[len]  suma
+ *    suma = clave + len + Σdato (8 bits). Respuesta 0x06 (ok) o
+ *    0x15 (error). El nuevo baud se aplica en el próximo arranque.
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_ON       // evita escribir EEPROM con Vdd bajo
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "kv_store.h"
+
+/* Claves (0…KV_MAX_KEYS−1); el formato de cada valor es fijo */
+#define KEY_KP_Q15      0              // int16
+#define KEY_KI_Q15      1              // int16
+#define KEY_ADC_OFS     2              // int16, cuentas
+#define KEY_BAUD        3              // uint32, baudios
+#define KEY_BOOTS       4              // uint32, arranques
+
+/* Valores por defecto (los de los ejemplos anteriores) */
+#define DEF_KP_Q15      16384          // 0.5
+#define DEF_KI_Q15      819            // 0.025
+#define DEF_ADC_OFS     0
+#define DEF_BAUD        115200UL
+
+#define PWM_FREQ_HZ     20000UL
+#define PTPER_COUNTS    ((FCY / PWM_FREQ_HZ) - 1)
+
+/* Comando UART */
+#define CMD_SYNC        0xC5
+#define CMD_ACK         0x06
+#define CMD_NAK         0x15
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static int16_t  g_kp_q15, g_ki_q15, g_adc_ofs;
+static uint32_t g_baud;
+static uint32_t g_boots;
+static uint16_t g_kv_load_tcy;         // duración de kv_load()
+static uint8_t  g_kv_nkeys;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timer1_init_stamp(void);
+static void pwm1_init(void);
+static void uart2_init(uint32_t baud);
+static void uart2_put(uint8_t c);
+static void cmd_poll(void);
+
+/* ——————————————————— TIMER1: sello de ciclos ——————————— */
+static void timer1_init_stamp(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0;
+    T1CONbits.TON   = 1;
+}
+
+/* ——————————————————— PWM1L a 50 % ——————————————————— */
+static void pwm1_init(void)
+{
+    PTCONbits.PTEN   = 0;
+    PTCONbits.PTCKPS = 0;
+    PTCONbits.PTMOD  = 0;          // libre
+    PTPER = PTPER_COUNTS;
+
+    PWMCON1 = 0;
+    PWMCON1bits.PMOD1 = 1;
+    PWMCON1bits.PEN1L = 1;         // RE0
+    DTCON1 = 0;
+
+    PDC1 = PTPER_COUNTS + 1;       // 50 %
+    OVDCONbits.POVD1L = 1;
+    PTCONbits.PTEN = 1;
+}
+
+/* ——————————————————— UART2 ——————————————————— */
+static void uart2_init(uint32_t baud)
+{
+    /* BRG redondeado; fuera de rango → por defecto */
+    if (baud < 1200UL || baud > FCY / 16UL) baud = DEF_BAUD;
+
+    U2MODE = 0;
+    U2MODEbits.PDSEL = 0b00;
+    U2MODEbits.STSEL = 0;
+    U2BRG = (uint16_t)(((FCY + 8UL * baud) / (16UL * baud)) - 1UL);
+    U2STA = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+}
+
+static void uart2_put(uint8_t c)
+{
+    while (U2STAbits.UTXBF);
+    U2TXREG = c;
+}
+
+/* FSM del comando de escritura; sin interrupciones, por sondeo */
+static void cmd_poll(void)
+{
+    static uint8_t st = 0, key, len, n, sum;
+    static uint8_t buf[KV_MAX_LEN];
+
+    if (U2STAbits.OERR) { U2STAbits.OERR = 0; st = 0; }
+
+    while (U2STAbits.URXDA) {
+        uint8_t c = (uint8_t)U2RXREG;
+        switch (st) {
+        case 0:
+            if (c == CMD_SYNC) st = 1;
+            break;
+        case 1:
+            key = c; sum = c; st = 2;
+            break;
+        case 2:
+            len = c; sum += c; n = 0;
+            if (len > KV_MAX_LEN) { st = 0; uart2_put(CMD_NAK); }
+            else                  { st = len ? 3 : 4; }
+            break;
+        case 3:
+            buf[n++] = c; sum += c;
+            if (n >= len) st = 4;
+            break;
+        default:
+            st = 0;
+            uart2_put((c == sum && kv_set(key, buf, len) == 0) ? CMD_ACK : CMD_NAK);
+            break;
+        }
+    }
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    timer1_init_stamp();
+
+    uint16_t t0 = TMR1;
+    g_kv_nkeys = kv_load();
+    g_kv_load_tcy = TMR1 - t0;
+
+    g_kp_q15  = kv_get_i16(KEY_KP_Q15,  DEF_KP_Q15);
+    g_ki_q15  = kv_get_i16(KEY_KI_Q15,  DEF_KI_Q15);
+    g_adc_ofs = kv_get_i16(KEY_ADC_OFS, DEF_ADC_OFS);
+    g_baud    = kv_get_u32(KEY_BAUD,    DEF_BAUD);
+
+    pwm1_init();                       // sin esperar a ninguna escritura
+    uart2_init(g_baud);
+
+    /* Primera escritura ya con el PWM corriendo */
+    g_boots = kv_get_u32(KEY_BOOTS, 0) + 1UL;
+    kv_set_u32(KEY_BOOTS, g_boots);
+
+    for (;;)
+    {
+        cmd_poll();
+    }
+    return 0;
+}
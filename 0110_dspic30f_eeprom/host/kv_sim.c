@@ -0,0 +1,429 @@
+/*************************************************************
+ *  kv_sim – kv_store.h sobre una EEPROM emulada, con cortes de energía
+ *
+ *  cc -O2 -Wall -I.. -o kv_sim kv_sim.c
+ *
+ *  La EEPROM son 512 palabras en RAM detrás de kv_ee_read/erase/
+ *  write (KV_EE_HOST). Cada borrado o escritura de palabra es una
+ *  operación numerada; el corte se inyecta en la operación n de un
+ *  kv_set() de tres maneras:
+ *      antes     – la palabra no cambió
+ *      a medias  – borrado: algunos bits ya en 1; escritura: algunos
+ *                  bits ya en 0 (bits al azar)
+ *      después   – la operación terminó y no hubo ninguna más
+ *  y se sale de kv_set() con longjmp, como un reset. Después se
+ *  "arranca": kv_load() y se compara con un modelo de referencia.
+ *
+ *    1 un corte    – 300 kv_set() al azar (claves, largos y datos),
+ *                    corte en cada una de sus 16 operaciones × 3
+ *                    maneras: la clave vale la versión vieja o la
+ *                    nueva (la nueva sólo si la marca quedó
+ *                    entera), las demás no cambian, a lo más una
+ *                    ranura cortada, y el kv_set() siguiente funciona
+ *    2 dos cortes  – además otro corte en cada operación del
+ *                    kv_set() que reintenta, sobre la ranura cortada
+ *    3 arranque    – palabras leídas y bytes de CRC por kv_load(),
+ *                    tiempo en el PC y estimado en el dsPIC, con la
+ *                    EEPROM vacía, llena y recién cortada
+ *    4 arranques   – el contador de 10_kv_store_demo.c con un corte
+ *                    en una operación al azar de cada arranque: nunca
+ *                    retrocede ni salta, y la ganancia guardada sigue
+ *  Cada caso imprime sus cifras y PASS/FAIL; el código de salida es
+ *  el número de fallas.
+ *************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+
+#define KV_EE_HOST
+#define KV_SLOT_WORDS_H 8U
+
+/* ——————————————————— EEPROM EMULADA ——————————————————— */
+static uint16_t g_ee[512];
+static uint32_t g_ops;              // borrados + escrituras desde el arranque
+static uint32_t g_reads;            // palabras leídas
+static uint32_t g_cut_at;           // 0 → sin corte; n → en la operación n
+static int      g_cut_mode;         // 0 antes, 1 a medias, 2 después
+static jmp_buf  g_reset;
+
+static uint32_t g_rnd = 0x1234567U;
+static uint32_t rnd32(void)
+{
+    g_rnd ^= g_rnd << 13;
+    g_rnd ^= g_rnd >> 17;
+    g_rnd ^= g_rnd << 5;
+    return g_rnd;
+}
+
+static void kv_ee_read(uint8_t slot, uint16_t w[KV_SLOT_WORDS_H])
+{
+    memcpy(w, &g_ee[slot * KV_SLOT_WORDS_H], KV_SLOT_WORDS_H * 2U);
+    g_reads += KV_SLOT_WORDS_H;
+}
+
+/* Una operación de palabra: nuevo valor 'v', o el corte */
+static void ee_op(uint16_t *cell, uint16_t v, int erase)
+{
+    if (++g_ops != g_cut_at) {
+        *cell = v;
+        return;
+    }
+    if (g_cut_mode == 1) {
+        uint16_t m = (uint16_t)rnd32();
+        *cell = erase ? (uint16_t)(*cell | m)               // bits que ya subieron
+                      : (uint16_t)(*cell & ~(~v & m));      // bits que ya bajaron
+    } else if (g_cut_mode == 2) {
+        *cell = v;
+    }
+    longjmp(g_reset, 1);
+}
+
+static void kv_ee_erase(uint8_t slot, uint8_t i)
+{
+    ee_op(&g_ee[slot * KV_SLOT_WORDS_H + i], 0xFFFFU, 1);
+}
+
+static void kv_ee_write(uint8_t slot, uint8_t i, uint16_t v)
+{
+    /* el dsPIC sólo baja bits: sobre una palabra sin borrar queda el AND */
+    uint16_t *c = &g_ee[slot * KV_SLOT_WORDS_H + i];
+    ee_op(c, (uint16_t)(*c & v), 0);
+}
+
+#include "kv_store.h"
+
+#if KV_SLOT_WORDS != KV_SLOT_WORDS_H || KV_EE_WORDS != 512U
+#error "kv_sim.c: geometría distinta de kv_store.h"
+#endif
+
+/* Costo estimado de kv_load() en el dsPIC: lectura por tabla y CRC
+   por nibbles (dos búsquedas en tabla por byte) */
+#define TCY_PER_WORD    6U
+#define TCY_PER_CRC_B   36U
+#define FCY_MHZ         29.48
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+/* ——————————————————— MODELO DE REFERENCIA ——————————————————— */
+typedef struct {
+    int8_t  len;                    // −1 → no existe
+    uint8_t d[KV_MAX_LEN];
+} ref_t;
+
+static ref_t g_ref[KV_MAX_KEYS];
+
+static void rnd_value(ref_t *v)
+{
+    v->len = (int8_t)(1 + rnd32() % KV_MAX_LEN);
+    memset(v->d, 0, sizeof v->d);
+    for (int i = 0; i < v->len; i++) v->d[i] = (uint8_t)rnd32();
+}
+
+static int same(uint8_t key, const ref_t *r)
+{
+    uint8_t buf[KV_MAX_LEN];
+    int8_t  n = kv_get(key, buf, sizeof buf);
+    if (r->len < 0) return n == -1;
+    return n == r->len && memcmp(buf, r->d, (size_t)n) == 0;
+}
+
+/* Arranque: kv_load() y todas las claves contra la referencia, menos
+   'skip' (la que se estaba escribiendo) */
+static int boot_matches(int skip)
+{
+    g_ops = 0;
+    g_cut_at = 0;
+    kv_load();
+    for (int k = 0; k < (int)KV_MAX_KEYS; k++)
+        if (k != skip && !same((uint8_t)k, &g_ref[k])) return 0;
+    return 1;
+}
+
+/* kv_set() con corte en la operación 'at' (0 → sin corte).
+   Devuelve 1 si llegó al corte. */
+static int set_cut(uint8_t key, const ref_t *v, uint32_t at, int mode)
+{
+    g_ops = 0;
+    g_cut_at = at;
+    g_cut_mode = mode;
+    if (setjmp(g_reset)) return 1;
+    int8_t r = kv_set(key, v->d, (uint8_t)v->len);
+    g_cut_at = 0;
+    return r == 0 ? 0 : -1;
+}
+
+/* ¿Quedó en la EEPROM un registro válido con la secuencia nueva?
+   Sólo puede pasar con el corte en la marca, la última operación */
+static int commit_landed(uint32_t at, uint32_t seq_new)
+{
+    if (at != 2U * KV_SLOT_WORDS) return 0;
+    for (uint8_t s = 0; s < KV_SLOTS; s++) {
+        uint16_t w[KV_SLOT_WORDS];
+        if (kv_read_slot(s, w) && ((uint32_t)w[1] | ((uint32_t)w[2] << 16)) == seq_new)
+            return 1;
+    }
+    return 0;
+}
+
+/* ——————————————————— 1 y 2: CORTES ——————————————————— */
+typedef struct {
+    unsigned trials, old_ok, new_ok, bad_value, bad_other, torn_max, after_bad;
+} cut_stats_t;
+
+/* Un corte en (at, mode) del kv_set(key, v), arranque y verificación.
+   depth 2: otro corte en cada operación del kv_set() que reintenta. */
+static void one_cut(cut_stats_t *st, uint8_t key, const ref_t *v, uint32_t at,
+                    int mode, int depth)
+{
+    uint16_t ee0[512];
+    ref_t    old = g_ref[key];
+    memcpy(ee0, g_ee, sizeof ee0);
+
+    kv_load();                                  // estado previo en RAM
+    uint32_t seq0 = g_kv_st.seq;
+    if (set_cut(key, v, at, mode) != 1) {       // kv_set() terminó antes del corte
+        memcpy(g_ee, ee0, sizeof ee0);
+        return;
+    }
+    st->trials++;
+
+    int landed = commit_landed(at, seq0 + 1U);
+
+    if (!boot_matches(key)) st->bad_other++;
+    if (same(key, v) && landed)        st->new_ok++;
+    else if (same(key, &old) && !landed) st->old_ok++;
+    else                               st->bad_value++;
+    unsigned torn = (unsigned)g_kv_st.torn;
+    if (torn > st->torn_max) st->torn_max = torn;
+
+    if (depth > 1) {
+        uint16_t ee1[512];
+        memcpy(ee1, g_ee, sizeof ee1);
+        ref_t cur = landed ? *v : old;
+        ref_t v2;
+        do rnd_value(&v2); while (v2.len == cur.len && !memcmp(v2.d, cur.d, KV_MAX_LEN));
+        for (uint32_t at2 = 1; at2 <= 2U * KV_SLOT_WORDS; at2++) {
+            for (int m2 = 0; m2 < 3; m2++) {
+                memcpy(g_ee, ee1, sizeof ee1);
+                g_ref[key] = cur;
+                one_cut(st, key, &v2, at2, m2, 1);
+            }
+        }
+        memcpy(g_ee, ee1, sizeof ee1);
+    }
+
+    /* el siguiente kv_set() de la misma clave, sin corte */
+    boot_matches(-1);
+    g_ref[key] = landed ? *v : old;
+    ref_t v3;
+    do rnd_value(&v3); while (v3.len == g_ref[key].len && !memcmp(v3.d, g_ref[key].d, KV_MAX_LEN));
+    if (set_cut(key, &v3, 0, 0) != 0) st->after_bad++;
+    else {
+        g_ref[key] = v3;
+        if (!boot_matches(-1)) st->after_bad++;
+    }
+
+    memcpy(g_ee, ee0, sizeof ee0);
+    g_ref[key] = old;
+}
+
+static void run_cuts(int nsets, int depth, cut_stats_t *st)
+{
+    memset(st, 0, sizeof *st);
+    for (int s = 0; s < nsets; s++) {
+        uint8_t key = (uint8_t)(rnd32() % KV_MAX_KEYS);
+        ref_t   v;
+        do rnd_value(&v); while (v.len == g_ref[key].len && !memcmp(v.d, g_ref[key].d, KV_MAX_LEN));
+
+        for (uint32_t at = 1; at <= 2U * KV_SLOT_WORDS; at++)
+            for (int mode = 0; mode < 3; mode++)
+                one_cut(st, key, &v, at, mode, depth);
+
+        /* y ahora sin corte, para avanzar */
+        kv_load();
+        if (set_cut(key, &v, 0, 0) == 0) g_ref[key] = v;
+        else st->after_bad++;
+    }
+}
+
+static void fill(void)
+{
+    memset(g_ee, 0xFF, sizeof g_ee);
+    for (int k = 0; k < (int)KV_MAX_KEYS; k++) g_ref[k].len = -1;
+    kv_load();
+    /* todas las claves y tres vueltas del anillo: hay versiones viejas */
+    for (int n = 0; n < 3 * (int)KV_SLOTS; n++) {
+        uint8_t key = (uint8_t)(n < (int)KV_MAX_KEYS ? (uint32_t)n : rnd32() % KV_MAX_KEYS);
+        ref_t   v;
+        rnd_value(&v);
+        if (set_cut(key, &v, 0, 0) == 0) g_ref[key] = v;
+    }
+}
+
+static void report_cuts(const cut_stats_t *st)
+{
+    printf("    %u cortes: %u dejaron la versión vieja, %u la nueva, %u otra cosa\n",
+           st->trials, st->old_ok, st->new_ok, st->bad_value);
+    printf("    claves ajenas alteradas en %u, ranuras cortadas por arranque ≤ %u, "
+           "kv_set() posterior fallido %u\n", st->bad_other, st->torn_max, st->after_bad);
+    check("la clave vale la versión vieja o (marca entera) la nueva", st->bad_value == 0);
+    check("las demás claves no cambian", st->bad_other == 0);
+    check("a lo más una ranura cortada tras cada arranque", st->torn_max <= 1);
+    check("el kv_set() siguiente escribe y se relee bien", st->after_bad == 0);
+}
+
+static void case_single(void)
+{
+    cut_stats_t st;
+    printf("\n1 un corte en cada operación de 300 kv_set()\n");
+    fill();
+    run_cuts(300, 1, &st);
+    report_cuts(&st);
+}
+
+static void case_double(void)
+{
+    cut_stats_t st;
+    printf("\n2 dos cortes: también en cada operación del reintento (20 kv_set())\n");
+    fill();
+    run_cuts(20, 2, &st);
+    report_cuts(&st);
+}
+
+/* ——————————————————— 3: ARRANQUE ——————————————————— */
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/* Bytes de CRC que calcula kv_load(): ranuras que pasan los filtros
+   previos de kv_read_slot() */
+static unsigned crc_bytes(void)
+{
+    unsigned n = 0;
+    for (unsigned s = 0; s < KV_SLOTS; s++) {
+        const uint16_t *w = &g_ee[s * KV_SLOT_WORDS];
+        if (w[7] == KV_COMMIT && (w[0] & 0xF000U) == KV_HDR_MAGIC &&
+            (w[0] & 0x00FFU) < KV_MAX_KEYS && ((w[0] >> 8) & 0x0FU) <= KV_MAX_LEN)
+            n += 12U;
+    }
+    return n;
+}
+
+static double boot_once(const char *what, unsigned *words_out, double *tcy_out)
+{
+    enum { REP = 20000 };
+    g_reads = 0;
+    kv_load();
+    unsigned words = g_reads;
+    unsigned crc   = crc_bytes();
+
+    double t0 = now_ns();
+    for (int r = 0; r < REP; r++) kv_load();
+    double ns = (now_ns() - t0) / REP;
+
+    double tcy = (double)words * TCY_PER_WORD + (double)crc * TCY_PER_CRC_B;
+    printf("    %4u palabras, %4u bytes de CRC, PC %6.0f ns, dsPIC ≈ %5.0f TCY (%.2f ms)  %s\n",
+           words, crc, ns, tcy, tcy / (FCY_MHZ * 1000.0), what);
+    *words_out = words;
+    *tcy_out   = tcy;
+    return tcy;
+}
+
+static void case_boot(void)
+{
+    unsigned w_empty, w_full, w_cut;
+    double   t_empty, t_full, t_cut;
+    printf("\n3 arranque: costo de kv_load() (%u TCY por palabra y %u por byte de CRC, estimados)\n",
+           TCY_PER_WORD, TCY_PER_CRC_B);
+
+    memset(g_ee, 0xFF, sizeof g_ee);
+    boot_once("vacía", &w_empty, &t_empty);
+
+    fill();
+    /* anillo completo de registros válidos: el peor caso */
+    for (int n = 0; n < (int)KV_SLOTS; n++) {
+        ref_t v;
+        uint8_t key = (uint8_t)(rnd32() % KV_MAX_KEYS);
+        rnd_value(&v);
+        kv_load();
+        if (set_cut(key, &v, 0, 0) == 0) g_ref[key] = v;
+    }
+    boot_once("llena", &w_full, &t_full);
+
+    ref_t v;
+    rnd_value(&v);
+    kv_load();
+    set_cut(0, &v, 2U * KV_SLOT_WORDS, 1);       // marca a medias
+    boot_once("recién cortada", &w_cut, &t_cut);
+
+    check("una sola pasada: 512 palabras leídas en cada arranque",
+          w_empty == KV_EE_WORDS && w_full == KV_EE_WORDS && w_cut == KV_EE_WORDS);
+    check("el corte no alarga el arranque", t_cut <= t_full);
+    check("peor caso ≤ 1.2 ms a 29.48 MIPS", t_full <= 1.2e-3 * FCY_MHZ * 1e6);
+}
+
+/* ——————————————————— 4: CONTADOR DE ARRANQUES ——————————————————— */
+#define KEY_KP_Q15      0
+#define KEY_BOOTS       4
+
+/* kv_set_u32() con el corte ya programado; 1 si se cortó */
+static int boots_write(uint32_t n)
+{
+    if (setjmp(g_reset)) return 1;
+    kv_set_u32(KEY_BOOTS, n);
+    return 0;
+}
+
+static void case_boots(void)
+{
+    enum { BOOTS = 20000 };
+    unsigned back = 0, jump = 0, kp_bad = 0, cuts = 0;
+
+    memset(g_ee, 0xFF, sizeof g_ee);
+    kv_load();
+    kv_set_i16(KEY_KP_Q15, 16384);
+
+    uint32_t prev = 0;
+    for (int b = 0; b < BOOTS; b++) {
+        g_ops = 0;
+        g_cut_at = 0;
+        kv_load();
+        uint32_t n = kv_get_u32(KEY_BOOTS, 0);
+        if (n < prev)     back++;
+        if (n > prev + 1) jump++;
+        if (kv_get_i16(KEY_KP_Q15, 0) != 16384) kp_bad++;
+        prev = n;
+
+        /* la mitad de los arranques se corta en alguna de las 16 operaciones */
+        g_cut_at   = (rnd32() & 1U) ? 1U + rnd32() % (2U * KV_SLOT_WORDS) : 0U;
+        g_cut_mode = (int)(rnd32() % 3U);
+        cuts += (unsigned)boots_write(n + 1UL);
+    }
+    printf("\n4 %d arranques, %u con corte durante kv_set_u32()\n", BOOTS, cuts);
+    printf("    contador final %u, retrocesos %u, saltos %u, ganancia alterada %u\n",
+           (unsigned)prev, back, jump, kp_bad);
+    check("el contador nunca retrocede ni salta", back == 0 && jump == 0);
+    check("las claves que no se escriben no cambian", kp_bad == 0);
+    check("cuenta los arranques que terminaron de escribir", prev >= BOOTS - cuts - 1U);
+}
+
+int main(void)
+{
+    case_single();
+    case_double();
+    case_boot();
+    case_boots();
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
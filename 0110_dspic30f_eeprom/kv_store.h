@@ -0,0 +1,256 @@
+/*************************************************************
+ *  dsPIC30F4011  – Almacén clave/valor en la EEPROM de datos
+ *  Toolchain     – XC-DSC 3.21 (libpic30: _erase_eedata, ...)
+ *
+ *  Los 1 KB de EEPROM (512 palabras) se dividen en KV_SLOTS
+ *  ranuras de 8 palabras. Cada escritura es un registro nuevo en
+ *  una ranura libre; la versión vigente de una clave es la de
+ *  mayor número de secuencia con CRC válido.
+ *
+ *   palabra  0   0xA000 | len<<8 | clave
+ *            1-2 secuencia de 32 bits (LSW primero)
+ *            3-5 valor, hasta KV_MAX_LEN bytes
+ *            6   CRC-16/CCITT de las palabras 0…5
+ *            7   KV_COMMIT, se escribe al final
+ *
+ *  – Nivelado de desgaste: el puntero de escritura recorre las 64
+ *    ranuras en círculo y salta las que contienen la versión vigente
+ *    de alguna clave; el resto se reescribe por turno.
+ *  – Actualización atómica: sólo se borra y escribe una ranura que
+ *    no es vigente, y la marca KV_COMMIT va al final. Un corte de
+ *    energía deja a lo más una ranura incompleta, que kv_load()
+ *    descarta por marca o CRC; la versión anterior sigue valiendo.
+ *  – kv_load() lee las 64 ranuras una sola vez (CRC por nibbles,
+ *    ≈ 1 ms a 29.48 MIPS) y deja los valores en RAM; kv_get() no
+ *    toca la EEPROM.
+ *  – kv_set() bloquea ≈ 16 × 2 ms (8 borrados + 8 escrituras de
+ *    palabra). Llamarla sólo desde el lazo principal; las
+ *    interrupciones siguen atendiéndose durante la escritura.
+ *  – La EEPROM se toca sólo con kv_ee_read/erase/write. En el PC
+ *    (host/kv_sim.c) las pone el que incluye, con KV_EE_HOST
+ *    definido: así se prueban cortes en cada palabra escrita.
+ *************************************************************/
+#ifndef KV_STORE_H
+#define KV_STORE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define KV_EE_WORDS     512U
+#define KV_SLOT_WORDS   8U
+#define KV_SLOTS        (KV_EE_WORDS / KV_SLOT_WORDS)      // 64
+#define KV_MAX_KEYS     16U
+#define KV_MAX_LEN      6U
+#define KV_HDR_MAGIC    0xA000U
+#define KV_COMMIT       0x5AA5U
+#define KV_NO_SLOT      0xFFU
+
+#if (KV_MAX_KEYS > KV_SLOTS / 2)
+#error "Demasiadas claves para las ranuras disponibles"
+#endif
+
+/* ——————————————————— TIPOS ——————————————————— */
+typedef struct {
+    uint8_t  slot;                 // KV_NO_SLOT → clave inexistente
+    uint8_t  len;
+    uint8_t  data[KV_MAX_LEN];
+    uint32_t seq;
+} kv_entry_t;
+
+typedef struct {
+    uint32_t seq;                  // última secuencia usada
+    uint8_t  head;                 // siguiente ranura candidata
+    uint16_t writes;               // registros escritos desde el arranque
+    uint16_t torn;                 // ranuras inválidas vistas en kv_load()
+    uint16_t verify_err;           // escrituras que no se leyeron iguales
+} kv_state_t;
+
+/* ——————————————————— MEMORIA ——————————————————— */
+static kv_entry_t g_kv[KV_MAX_KEYS];
+static kv_state_t g_kv_st;
+
+#if defined(__dsPIC30F__) || defined(__XC16__)
+#include <xc.h>
+#include <libpic30.h>
+
+static int16_t __attribute__((space(eedata), aligned(_EE_ROW)))
+    g_kv_ee[KV_EE_WORDS] = { [0 ... KV_EE_WORDS - 1] = -1 };
+
+static inline _prog_addressT kv_slot_addr(uint8_t slot)
+{
+    _prog_addressT a;
+    _init_prog_address(a, g_kv_ee);
+    return a + (uint32_t)slot * (KV_SLOT_WORDS * 2U);
+}
+
+static inline void kv_ee_read(uint8_t slot, uint16_t w[KV_SLOT_WORDS])
+{
+    _memcpy_p2d16(w, kv_slot_addr(slot), KV_SLOT_WORDS * 2U);
+}
+
+static inline void kv_ee_erase(uint8_t slot, uint8_t i)
+{
+    _erase_eedata(kv_slot_addr(slot) + 2U * i, _EE_WORD);
+    _wait_eedata();
+}
+
+static inline void kv_ee_write(uint8_t slot, uint8_t i, uint16_t v)
+{
+    _write_eedata_word(kv_slot_addr(slot) + 2U * i, (int)v);
+    _wait_eedata();
+}
+#elif !defined(KV_EE_HOST)
+#error "kv_store.h: fuera del dsPIC definir KV_EE_HOST y kv_ee_read/erase/write"
+#endif
+
+/* ——————————————————— AUXILIARES ——————————————————— */
+static const uint16_t kv_crc_nib[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static inline uint16_t kv_crc16(const uint16_t *w, uint8_t nwords)
+{
+    uint16_t crc = 0xFFFF;
+    const uint8_t *p = (const uint8_t *)w;
+
+    for (uint8_t i = 0; i < 2U * nwords; i++) {
+        crc = (crc << 4) ^ kv_crc_nib[(crc >> 12) ^ (p[i] >> 4)];
+        crc = (crc << 4) ^ kv_crc_nib[(crc >> 12) ^ (p[i] & 0x0F)];
+    }
+    return crc;
+}
+
+/* Lee una ranura; devuelve 1 si contiene un registro válido */
+static inline uint8_t kv_read_slot(uint8_t slot, uint16_t w[KV_SLOT_WORDS])
+{
+    kv_ee_read(slot, w);
+
+    if (w[7] != KV_COMMIT)                         return 0;
+    if ((w[0] & 0xF000U) != KV_HDR_MAGIC)          return 0;
+    if ((w[0] & 0x00FFU) >= KV_MAX_KEYS)           return 0;
+    if (((w[0] >> 8) & 0x0FU) > KV_MAX_LEN)        return 0;
+    return kv_crc16(w, 6) == w[6];
+}
+
+static inline uint8_t kv_slot_is_live(uint8_t slot)
+{
+    for (uint8_t k = 0; k < KV_MAX_KEYS; k++)
+        if (g_kv[k].slot == slot) return 1;
+    return 0;
+}
+
+/* ——————————————————— API ——————————————————— */
+/* Reconstruye la caché en RAM. Devuelve el número de claves válidas. */
+static inline uint8_t kv_load(void)
+{
+    uint16_t w[KV_SLOT_WORDS];
+    uint8_t  newest = KV_SLOTS - 1U;
+    uint8_t  nkeys  = 0;
+
+    memset(&g_kv_st, 0, sizeof g_kv_st);
+    for (uint8_t k = 0; k < KV_MAX_KEYS; k++) g_kv[k].slot = KV_NO_SLOT;
+
+    for (uint8_t s = 0; s < KV_SLOTS; s++) {
+        if (!kv_read_slot(s, w)) {
+            /* Ranura borrada (todo 0xFFFF) o registro cortado */
+            for (uint8_t i = 0; i < KV_SLOT_WORDS; i++)
+                if (w[i] != 0xFFFFU) { g_kv_st.torn++; break; }
+            continue;
+        }
+
+        uint8_t  key = (uint8_t)(w[0] & 0xFFU);
+        uint32_t seq = (uint32_t)w[1] | ((uint32_t)w[2] << 16);
+        kv_entry_t *e = &g_kv[key];
+
+        if (e->slot == KV_NO_SLOT) nkeys++;
+        if (e->slot == KV_NO_SLOT || seq > e->seq) {
+            e->slot = s;
+            e->seq  = seq;
+            e->len  = (uint8_t)((w[0] >> 8) & 0x0FU);
+            memcpy(e->data, &w[3], KV_MAX_LEN);
+        }
+        if (seq >= g_kv_st.seq) {
+            g_kv_st.seq = seq;
+            newest = s;
+        }
+    }
+
+    g_kv_st.head = (uint8_t)((newest + 1U) % KV_SLOTS);
+    return nkeys;
+}
+
+/* Copia hasta 'len' bytes del valor. Devuelve la longitud guardada
+   o −1 si la clave no existe. */
+static inline int8_t kv_get(uint8_t key, void *buf, uint8_t len)
+{
+    if (key >= KV_MAX_KEYS || g_kv[key].slot == KV_NO_SLOT) return -1;
+    if (len > g_kv[key].len) len = g_kv[key].len;
+    memcpy(buf, g_kv[key].data, len);
+    return (int8_t)g_kv[key].len;
+}
+
+/* Guarda un valor. 0 = escrito o sin cambios, −1 = error. */
+static inline int8_t kv_set(uint8_t key, const void *buf, uint8_t len)
+{
+    if (key >= KV_MAX_KEYS || len > KV_MAX_LEN) return -1;
+
+    kv_entry_t *e = &g_kv[key];
+    if (e->slot != KV_NO_SLOT && e->len == len && memcmp(e->data, buf, len) == 0)
+        return 0;                                  // no gastar un ciclo
+
+    /* Siguiente ranura que no guarda una versión vigente */
+    uint8_t s = g_kv_st.head;
+    while (kv_slot_is_live(s)) s = (uint8_t)((s + 1U) % KV_SLOTS);
+
+    uint16_t w[KV_SLOT_WORDS];
+    uint32_t seq = g_kv_st.seq + 1U;
+    w[0] = KV_HDR_MAGIC | ((uint16_t)len << 8) | key;
+    w[1] = (uint16_t)seq;
+    w[2] = (uint16_t)(seq >> 16);
+    w[3] = w[4] = w[5] = 0xFFFFU;
+    memcpy(&w[3], buf, len);
+    w[6] = kv_crc16(w, 6);
+    w[7] = KV_COMMIT;
+
+    /* Borrar primero la marca: la ranura deja de parecer válida */
+    for (int8_t i = KV_SLOT_WORDS - 1; i >= 0; i--)
+        kv_ee_erase(s, (uint8_t)i);
+    /* Datos, CRC y por último la marca */
+    for (uint8_t i = 0; i < KV_SLOT_WORDS; i++)
+        kv_ee_write(s, i, w[i]);
+
+    g_kv_st.seq  = seq;
+    g_kv_st.head = (uint8_t)((s + 1U) % KV_SLOTS);
+
+    uint16_t r[KV_SLOT_WORDS];
+    if (!kv_read_slot(s, r) || memcmp(r, w, sizeof w) != 0) {
+        g_kv_st.verify_err++;                      // la versión previa sigue vigente
+        return -1;
+    }
+
+    e->slot = s;
+    e->seq  = seq;
+    e->len  = len;
+    memcpy(e->data, &w[3], KV_MAX_LEN);
+    g_kv_st.writes++;
+    return 0;
+}
+
+/* Atajos para los tipos más usados */
+static inline uint32_t kv_get_u32(uint8_t key, uint32_t def)
+{
+    uint32_t v;
+    return (kv_get(key, &v, sizeof v) == (int8_t)sizeof v) ? v : def;
+}
+
+static inline int16_t kv_get_i16(uint8_t key, int16_t def)
+{
+    int16_t v;
+    return (kv_get(key, &v, sizeof v) == (int8_t)sizeof v) ? v : def;
+}
+
+static inline int8_t kv_set_u32(uint8_t key, uint32_t v) { return kv_set(key, &v, sizeof v); }
+static inline int8_t kv_set_i16(uint8_t key, int16_t v)  { return kv_set(key, &v, sizeof v); }
+
+#endif /* KV_STORE_H */
@@ -0,0 +1,199 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Bootloader residente por UART2 (RF4 = U2RX, RF5 = U2TX)
+ *
+ *  Mapa de memoria de programa (direcciones de programa):
+ *     0x0000 … 0x77BF   aplicación (incluye vectores 0x0000…0x00FF)
+ *     0x77C0 … 0x77FF   fila BL_APPVEC: GOTO original de la app
+ *     0x7800 … 0x7FFE   este bootloader (1024 instrucciones)
+ *  El proyecto del bootloader se enlaza con la región "program" del
+ *  .gld empezando en BL_START. No usa interrupciones: la tabla de
+ *  vectores pertenece a la aplicación.
+ *
+ *  Protocolo (todo binario, LSB primero):
+ *    host → BL   0xC1                       saludo (dentro de BL_WAIT_MS)
+ *    BL → host   'B' 'L' BL_VERSION BL_ROW_INSTR
+ *    host → BL   0xB5 a0 a1 a2 d[96] crcL crcH
+ *                  a = dirección de fila (múltiplo de 0x40)
+ *                  d = 32 instrucciones × 3 bytes (low, mid, upper)
+ *                  crc = CRC-16/CCITT de a0…d95
+ *    BL → host   0x06 ok | 0x15 CRC/lectura | 0x1A dirección protegida
+ *                | 0x1B verificación de flash
+ *    host → BL   0xE5 crcL crcH             fin: CRC de todas las filas
+ *    BL → host   0x06 y salta a la app | 0x15
+ *
+ *  – El CRC del bloque se comprueba en RAM antes de tocar la flash;
+ *    cada fila se borra, se escribe y se relee contra el búfer.
+ *  – Una fila reenviada porque se perdió su ACK (misma dirección que
+ *    la última aceptada) reemplaza su aporte al CRC de imagen: no se
+ *    cuenta dos veces. La sesión está en bl_session.h.
+ *  – El dsPIC30F detiene la CPU mientras borra/escribe la flash de
+ *    programa (≈ 2 ms + 2 ms por fila), así que la recepción no puede
+ *    solaparse con la programación: el host envía la siguiente fila
+ *    en cuanto recibe el ACK y omite las filas en blanco.
+ *  – La fila 0 de la app se escribe con GOTO al bootloader; el GOTO
+ *    original se guarda en RAM y se escribe en BL_APPVEC sólo después
+ *    del CRC final. Un envío interrumpido deja BL_APPVEC borrada y el
+ *    equipo se queda en el bootloader. La única ventana de riesgo es
+ *    el borrado/escritura de la fila 0 (≈ 4 ms): un corte justo ahí
+ *    deja sin vector de reset y hay que volver al PICkit.
+ *  – Sin saludo en BL_WAIT_MS, si BL_APPVEC es válida salta a la app.
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN    // el puente sigue apagado
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_ON       // no programar con Vdd bajo
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+
+/* UART: BRG = 3 → 460800 exactos con el FRC de 7.37 MHz (ajustar
+   OSCTUN si el FRC se aleja más de ~2 %). 921600 (BRG = 1) funciona
+   con cables cortos y adaptadores que lo soporten. */
+#define BL_BAUD         460800UL
+#define BL_BRG          (((FCY + 8UL * BL_BAUD) / (16UL * BL_BAUD)) - 1UL)
+
+#define NVM_ERASE_ROW   0x4041
+#define NVM_WRITE_ROW   0x4001
+
+/* Timer1 1:256 → 8.68 µs por tick */
+#define T1_TICKS_MS     ((uint16_t)(FCY / 256UL / 1000UL))
+
+#if (BL_BRG > 0xFFFF)
+#error "BL_BAUD demasiado bajo para U2BRG"
+#endif
+
+extern void __reset(void);                 // entrada del propio bootloader
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void     bl_uart_init(void);
+static void     bl_putc(uint8_t c);
+static int16_t  bl_getc(uint16_t tmo_ms);
+static void     bl_flash_row(uint32_t addr, const uint32_t *ins);
+static uint32_t bl_read_ins(uint32_t addr);
+static void     bl_jump_app(void);
+static uint8_t  bl_app_valid(void);
+
+/* Sesión de carga (protocolo, CRC de imagen): la misma en host/bl_sim.c */
+#define BL_ENTRY_ADDR   ((uint16_t)__reset)
+#include "bl_session.h"
+
+/* ——————————————————— UART2 por sondeo ——————————————————— */
+static void bl_uart_init(void)
+{
+    U2MODE = 0;
+    U2MODEbits.PDSEL = 0b00;
+    U2MODEbits.STSEL = 0;
+    U2BRG = (uint16_t)BL_BRG;
+    U2STA = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TCKPS = 0b11;        // 1:256
+    T1CONbits.TON   = 1;
+}
+
+static void bl_putc(uint8_t c)
+{
+    while (U2STAbits.UTXBF);
+    U2TXREG = c;
+}
+
+/* Byte recibido o −1 si vence el plazo */
+static int16_t bl_getc(uint16_t tmo_ms)
+{
+    uint16_t t0 = TMR1;
+    uint32_t lim = (uint32_t)tmo_ms * T1_TICKS_MS;
+    uint32_t acc = 0;
+
+    for (;;) {
+        if (U2STAbits.OERR) U2STAbits.OERR = 0;
+        if (U2STAbits.URXDA) return (int16_t)(U2RXREG & 0xFF);
+
+        uint16_t t = TMR1;
+        acc += (uint16_t)(t - t0);
+        t0 = t;
+        if (acc >= lim) return -1;
+    }
+}
+
+/* ——————————————————— FLASH DE PROGRAMA ——————————————————— */
+static uint32_t bl_read_ins(uint32_t addr)
+{
+    TBLPAG = (uint16_t)(addr >> 16);
+    uint16_t off = (uint16_t)addr;
+    return (uint32_t)__builtin_tblrdl(off) |
+           ((uint32_t)(__builtin_tblrdh(off) & 0xFF) << 16);
+}
+
+/* Borra y escribe una fila; la CPU queda detenida en cada WR */
+static void bl_flash_row(uint32_t addr, const uint32_t *ins)
+{
+    NVMADRU = (uint16_t)(addr >> 16);
+    NVMADR  = (uint16_t)addr;
+    NVMCON  = NVM_ERASE_ROW;
+    __builtin_write_NVM();
+    while (NVMCONbits.WR);
+
+    TBLPAG = (uint16_t)(addr >> 16);
+    uint16_t off = (uint16_t)addr;
+    for (uint8_t i = 0; i < BL_ROW_INSTR; i++, off += 2) {
+        __builtin_tblwtl(off, (uint16_t)ins[i]);
+        __builtin_tblwth(off, (uint8_t)(ins[i] >> 16));
+    }
+
+    NVMADRU = (uint16_t)(addr >> 16);
+    NVMADR  = (uint16_t)addr;
+    NVMCON  = NVM_WRITE_ROW;
+    __builtin_write_NVM();
+    while (NVMCONbits.WR);
+}
+
+/* ——————————————————— APLICACIÓN ——————————————————— */
+static uint8_t bl_app_valid(void)
+{
+    return bl_read_ins(BL_APPVEC) != 0xFFFFFFUL;
+}
+
+static void bl_jump_app(void)
+{
+    while (!U2STAbits.TRMT);                   // que salga el último ACK
+    U2MODEbits.UARTEN = 0;
+    T1CON = 0;
+    TBLPAG = 0;
+    ((void (*)(void))(uint16_t)BL_APPVEC)();   // GOTO original de la app
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    bl_uart_init();
+
+    if (bl_getc(BL_WAIT_MS) == BL_HELLO || !bl_app_valid())
+        bl_session();                  // no regresa
+
+    bl_jump_app();
+    for (;;);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*************************************************************
+ *  Sesión de carga del bootloader – header-only
+ *  (firmware y PC: 10_uart2_bootloader.c, host/bl_sim.c)
+ *
+ *  Protocolo, mapa de memoria y ventanas de riesgo: ver el
+ *  encabezado de 10_uart2_bootloader.c.
+ *
+ *  Antes de incluir, declarar el hardware que usa la sesión:
+ *      int16_t  bl_getc(uint16_t tmo_ms);      // −1 si vence el plazo
+ *      void     bl_putc(uint8_t c);
+ *      void     bl_flash_row(uint32_t addr, const uint32_t *ins);
+ *      uint32_t bl_read_ins(uint32_t addr);
+ *      void     bl_jump_app(void);             // no regresa
+ *  y definir BL_ENTRY_ADDR (dirección del propio bootloader, la del
+ *  GOTO que se escribe en la fila 0).
+ *
+ *  CRC de imagen: el host suma cada fila una vez, en el orden en que
+ *  la envía. Si se pierde el ACK de una fila el host la reenvía; la
+ *  misma dirección que la última fila aceptada reemplaza su aporte
+ *  (se vuelve al CRC de antes de esa fila) en vez de sumarlo dos
+ *  veces, así el CRC final coincide aunque haya reintentos.
+ *************************************************************/
+#ifndef BL_SESSION_H
+#define BL_SESSION_H
+
+#include <stdint.h>
+
+#ifndef BL_ENTRY_ADDR
+#error "definir BL_ENTRY_ADDR y el hardware de la sesión antes de incluir bl_session.h"
+#endif
+
+#define BL_VERSION      1
+#define BL_START        0x7800UL
+#define BL_APPVEC       0x77C0UL
+#define BL_ROW_INSTR    32U
+#define BL_ROW_ADDR     (2U * BL_ROW_INSTR)        // 0x40
+#define BL_ROW_BYTES    (3U * BL_ROW_INSTR)        // 96 en la trama
+#define BL_WAIT_MS      300U
+#define BL_BYTE_TMO_MS  50U
+#define BL_NO_ROW       0xFFFFFFFFUL
+
+#define BL_HELLO        0xC1
+#define BL_BLOCK        0xB5
+#define BL_DONE         0xE5
+#define BL_ACK          0x06
+#define BL_NAK          0x15
+#define BL_PROT         0x1A
+#define BL_VERIFY_ERR   0x1B
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static uint32_t g_row[BL_ROW_INSTR];       // instrucciones de 24 bits
+static uint32_t g_app_goto[2];             // GOTO original de la app
+static uint8_t  g_have_goto = 0;
+static uint16_t g_image_crc = 0xFFFF;      // CRC de filas aceptadas
+static uint16_t g_crc_prev  = 0xFFFF;      // CRC antes de la última fila aceptada
+static uint32_t g_last_row  = BL_NO_ROW;   // dirección de esa fila
+
+/* ——————————————————— AUXILIARES ——————————————————— */
+static inline uint16_t bl_crc16(uint16_t crc, uint8_t b)
+{
+    crc ^= (uint16_t)b << 8;
+    for (uint8_t i = 0; i < 8; i++)
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    return crc;
+}
+
+static inline uint8_t bl_row_is_protected(uint32_t addr)
+{
+    return (addr & (BL_ROW_ADDR - 1U)) != 0 || addr >= BL_APPVEC;
+}
+
+static inline uint8_t bl_verify_row(uint32_t addr, const uint32_t *ins)
+{
+    for (uint8_t i = 0; i < BL_ROW_INSTR; i++, addr += 2)
+        if (bl_read_ins(addr) != (ins[i] & 0xFFFFFFUL)) return 0;
+    return 1;
+}
+
+static inline void bl_banner(void)
+{
+    bl_putc('B'); bl_putc('L'); bl_putc(BL_VERSION); bl_putc(BL_ROW_INSTR);
+}
+
+/* ——————————————————— SESIÓN DE CARGA ——————————————————— */
+static inline void bl_session(void)
+{
+    bl_banner();
+
+    /* BL_APPVEC se borra primero: hasta el CRC final no hay app */
+    for (uint8_t i = 0; i < BL_ROW_INSTR; i++) g_row[i] = 0xFFFFFFUL;
+    bl_flash_row(BL_APPVEC, g_row);
+    g_have_goto = 0;
+    g_image_crc = 0xFFFF;
+    g_crc_prev  = 0xFFFF;
+    g_last_row  = BL_NO_ROW;
+
+    for (;;) {
+        int16_t c = bl_getc(0xFFFF);
+        if (c == BL_HELLO) {
+            bl_banner();
+            continue;
+        }
+
+        if (c == BL_DONE) {
+            int16_t lo = bl_getc(BL_BYTE_TMO_MS);
+            int16_t hi = bl_getc(BL_BYTE_TMO_MS);
+            if (lo < 0 || hi < 0 || !g_have_goto ||
+                (uint16_t)(lo | (hi << 8)) != g_image_crc) {
+                bl_putc(BL_NAK);
+                continue;
+            }
+            for (uint8_t i = 0; i < BL_ROW_INSTR; i++) g_row[i] = 0xFFFFFFUL;
+            g_row[0] = g_app_goto[0];
+            g_row[1] = g_app_goto[1];
+            bl_flash_row(BL_APPVEC, g_row);
+            if (!bl_verify_row(BL_APPVEC, g_row)) { bl_putc(BL_VERIFY_ERR); continue; }
+            bl_putc(BL_ACK);
+            bl_jump_app();
+        }
+
+        if (c != BL_BLOCK) continue;
+
+        /* Trama de fila */
+        uint16_t crc = 0xFFFF;
+        uint32_t addr = 0;
+        uint8_t  ok = 1;
+        for (uint8_t i = 0; i < 3 && ok; i++) {
+            int16_t b = bl_getc(BL_BYTE_TMO_MS);
+            if (b < 0) { ok = 0; break; }
+            addr |= (uint32_t)b << (8 * i);
+            crc = bl_crc16(crc, (uint8_t)b);
+        }
+        for (uint8_t i = 0; i < BL_ROW_INSTR && ok; i++) {
+            uint32_t ins = 0;
+            for (uint8_t k = 0; k < 3; k++) {
+                int16_t b = bl_getc(BL_BYTE_TMO_MS);
+                if (b < 0) { ok = 0; break; }
+                ins |= (uint32_t)b << (8 * k);
+                crc = bl_crc16(crc, (uint8_t)b);
+            }
+            g_row[i] = ins;
+        }
+        if (ok) {
+            int16_t lo = bl_getc(BL_BYTE_TMO_MS);
+            int16_t hi = bl_getc(BL_BYTE_TMO_MS);
+            ok = (lo >= 0 && hi >= 0 && (uint16_t)(lo | (hi << 8)) == crc);
+        }
+        if (!ok)                        { bl_putc(BL_NAK);  continue; }
+        if (bl_row_is_protected(addr))  { bl_putc(BL_PROT); continue; }
+
+        /* Fila 0: guardar el GOTO de la app y apuntar al bootloader */
+        if (addr == 0) {
+            uint16_t bl = (uint16_t)(BL_ENTRY_ADDR);
+            g_app_goto[0] = g_row[0];
+            g_app_goto[1] = g_row[1];
+            g_have_goto   = 1;
+            g_row[0] = 0x040000UL | (bl & 0xFFFEU);        // GOTO bl
+            g_row[1] = 0x000000UL;
+        }
+
+        bl_flash_row(addr, g_row);
+        if (!bl_verify_row(addr, g_row)) { bl_putc(BL_VERIFY_ERR); continue; }
+
+        /* Reintento de la última fila aceptada (ACK perdido): reemplaza
+           su aporte al CRC en lugar de sumarlo otra vez */
+        if (addr == g_last_row) g_image_crc = g_crc_prev;
+        g_crc_prev = g_image_crc;
+        g_last_row = addr;
+
+        /* CRC de imagen sobre lo que el host envió (fila 0 sin parche) */
+        if (addr == 0) { g_row[0] = g_app_goto[0]; g_row[1] = g_app_goto[1]; }
+        for (uint8_t i = 0; i < 3; i++)
+            g_image_crc = bl_crc16(g_image_crc, (uint8_t)(addr >> (8 * i)));
+        for (uint8_t i = 0; i < BL_ROW_INSTR; i++)
+            for (uint8_t k = 0; k < 3; k++)
+                g_image_crc = bl_crc16(g_image_crc, (uint8_t)(g_row[i] >> (8 * k)));
+
+        bl_putc(BL_ACK);
+    }
+}
+
+#endif  /* BL_SESSION_H */
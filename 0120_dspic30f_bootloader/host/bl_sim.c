@@ -0,0 +1,445 @@
+/*************************************************************
+ *  bl_sim – bootloader y cargador de punta a punta, simulados en PC
+ *
+ *  cc -O2 -Wall -I.. -o bl_sim bl_sim.c
+ *
+ *  El lado dsPIC es bl_session.h, el mismo de 10_uart2_bootloader.c,
+ *  sobre una flash de programa emulada (borrado y escritura por fila,
+ *  2 ms cada uno, con la CPU detenida) y una UART a 460800 baudios.
+ *  El lado PC repite bl_upload.c: sólo filas no vacías, hasta 3
+ *  intentos por fila con 500 ms de espera del ACK, CRC de imagen con
+ *  cada fila aceptada y DONE al final. El tiempo es simulado: bytes
+ *  a 10 bits, flash y HOST_TURN_S de latencia del adaptador USB por
+ *  cada respuesta.
+ *
+ *  Fallas por intento de fila, inyectadas al armar la trama:
+ *      byte alterado, byte perdido, ACK perdido (la fila quedó
+ *      escrita pero el PC reintenta), verificación de flash fallida.
+ *
+ *    1 limpia      – imagen de ~20 KB con huecos: DONE con ACK, flash
+ *                    igual a la imagen (fila 0 con GOTO al bootloader,
+ *                    BL_APPVEC con el GOTO original), tasa efectiva
+ *    2 ACK perdido – en el primer intento de cada fila: la sesión
+ *                    termina bien; sin el reemplazo del CRC (como
+ *                    antes) el DONE recibe NAK
+ *    3 al azar     – 300 sesiones con fallas de todo tipo: o termina
+ *                    con la imagen exacta, o falla con BL_APPVEC en
+ *                    blanco (el equipo se queda en el bootloader)
+ *    4 CRC malo    – el PC omite una fila pero la cuenta: NAK y sin app
+ *  Cada caso imprime sus cifras y PASS/FAIL; el código de salida es
+ *  el número de fallas.
+ *************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <setjmp.h>
+
+static int16_t  bl_getc(uint16_t tmo_ms);
+static void     bl_putc(uint8_t c);
+static void     bl_flash_row(uint32_t addr, const uint32_t *ins);
+static uint32_t bl_read_ins(uint32_t addr);
+static void     bl_jump_app(void);
+
+#define BL_ENTRY_ADDR   BL_START
+#include "bl_session.h"
+
+#define PROG_WORDS      0x8000UL
+#define N_INSTR         (PROG_WORDS / 2UL)
+#define BAUD            460800.0
+#define BYTE_S          (10.0 / BAUD)
+#define FLASH_OP_S      2e-3            // borrado o escritura de fila
+#define HOST_TURN_S     1e-3            // latencia del adaptador USB
+#define HOST_TMO_S      0.5             // espera del ACK en bl_upload.c
+#define HOST_TRIES      3
+#define FRAME_MAX       (1 + 3 + BL_ROW_BYTES + 2 + 1)
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static uint32_t g_rnd = 0x2545F491U;
+static uint32_t rnd32(void)
+{
+    g_rnd ^= g_rnd << 13;
+    g_rnd ^= g_rnd >> 17;
+    g_rnd ^= g_rnd << 5;
+    return g_rnd;
+}
+
+static int chance(double p) { return (rnd32() >> 8) < p * 16777216.0; }
+
+/* ——————————————————— DSPIC: FLASH Y UART ——————————————————— */
+static uint32_t g_flash[N_INSTR];
+static double   g_t;                    // tiempo simulado, s
+static int      g_flash_fault;          // próxima escritura de fila con un bit pegado
+static int      g_lose_ack;             // el próximo ACK no llega al PC
+static int      g_legacy;               // 1 → CRC sin reemplazo (antes del arreglo)
+static jmp_buf  g_exit;                 // salida de bl_session(): 1 = app, 2 = PC abandonó
+
+static uint32_t bl_read_ins(uint32_t addr)
+{
+    return g_flash[(addr / 2U) % N_INSTR];
+}
+
+static void bl_flash_row(uint32_t addr, const uint32_t *ins)
+{
+    uint32_t *r = &g_flash[(addr / 2U) % N_INSTR];
+    for (unsigned i = 0; i < BL_ROW_INSTR; i++) r[i] = 0xFFFFFFUL;
+    for (unsigned i = 0; i < BL_ROW_INSTR; i++) r[i] &= ins[i] & 0xFFFFFFUL;
+    if (g_flash_fault) {
+        r[rnd32() % BL_ROW_INSTR] &= ~(1UL << (rnd32() % 24));
+        g_flash_fault = 0;
+    }
+    g_t += 2 * FLASH_OP_S;
+}
+
+static void bl_jump_app(void)
+{
+    longjmp(g_exit, 1);
+}
+
+/* ——————————————————— PC: bl_upload.c ——————————————————— */
+enum { PC_WAIT_ROW, PC_WAIT_DONE, PC_GAVE_UP };
+
+typedef struct {
+    /* imagen y configuración */
+    uint32_t img[N_INSTR];
+    double   p_corrupt, p_drop, p_lose_ack, p_flash;
+    int      first_try_lose_ack;        // perder el ACK del 1.er intento de cada fila
+    uint32_t skip_row;                  // fila que no se envía pero se cuenta (0 = ninguna)
+
+    /* estado */
+    int      state;
+    uint32_t row;                       // fila en curso
+    int      tries;
+    uint16_t img_crc;
+    uint8_t  frame[FRAME_MAX];
+    unsigned frame_len;
+
+    /* cola PC → dsPIC y respuesta dsPIC → PC */
+    uint8_t  q[FRAME_MAX];
+    unsigned q_len, q_pos;
+    int      resp;                      // −1: nada
+
+    /* resultados */
+    unsigned rows, retries, bytes;
+    int      done_reply;
+} pc_t;
+
+static pc_t g_pc;
+
+static int row_blank(const pc_t *pc, uint32_t addr)
+{
+    for (unsigned i = 0; i < BL_ROW_INSTR; i++)
+        if (pc->img[addr / 2U + i] != 0xFFFFFFUL) return 0;
+    return 1;
+}
+
+static uint16_t crc16(uint16_t crc, uint8_t b) { return bl_crc16(crc, b); }
+
+/* Siguiente fila no vacía desde 'a' (BL_APPVEC si no hay más) */
+static uint32_t next_row(const pc_t *pc, uint32_t a)
+{
+    while (a < BL_APPVEC && row_blank(pc, a)) a += BL_ROW_ADDR;
+    return a;
+}
+
+static void build_frame(pc_t *pc)
+{
+    unsigned k = 0;
+    uint16_t crc = 0xFFFF;
+    uint32_t first = pc->row / 2U;
+    pc->frame[k++] = BL_BLOCK;
+    for (int i = 0; i < 3; i++) { pc->frame[k] = (uint8_t)(pc->row >> (8 * i)); crc = crc16(crc, pc->frame[k++]); }
+    for (unsigned i = 0; i < BL_ROW_INSTR; i++)
+        for (int b = 0; b < 3; b++) { pc->frame[k] = (uint8_t)(pc->img[first + i] >> (8 * b)); crc = crc16(crc, pc->frame[k++]); }
+    pc->frame[k++] = (uint8_t)crc;
+    pc->frame[k++] = (uint8_t)(crc >> 8);
+    pc->frame_len = k;
+}
+
+/* Pone una trama en la línea, con las fallas de este intento */
+static void send_bytes(pc_t *pc, const uint8_t *b, unsigned n, int row_frame)
+{
+    memcpy(pc->q, b, n);
+    pc->q_len = n;
+    pc->q_pos = 0;
+    pc->resp  = -1;
+    pc->bytes += n;
+    if (!row_frame) return;
+
+    if (chance(pc->p_corrupt))
+        pc->q[rnd32() % n] ^= (uint8_t)(1U << (rnd32() % 8));
+    if (chance(pc->p_drop)) {
+        unsigned at = rnd32() % n;
+        memmove(&pc->q[at], &pc->q[at + 1], n - at - 1);
+        pc->q_len--;
+    }
+    g_lose_ack    = (pc->first_try_lose_ack && pc->tries == 0) || chance(pc->p_lose_ack);
+    g_flash_fault = chance(pc->p_flash);
+}
+
+static void send_row(pc_t *pc)
+{
+    build_frame(pc);
+    send_bytes(pc, pc->frame, pc->frame_len, 1);
+}
+
+static void send_done(pc_t *pc)
+{
+    uint8_t d[3] = { BL_DONE, (uint8_t)pc->img_crc, (uint8_t)(pc->img_crc >> 8) };
+    pc->state = PC_WAIT_DONE;
+    send_bytes(pc, d, 3, 0);
+}
+
+static void next_or_done(pc_t *pc)
+{
+    pc->row = next_row(pc, pc->row + BL_ROW_ADDR);
+    pc->tries = 0;
+    if (pc->skip_row && pc->row == pc->skip_row) {
+        /* fila "enviada" sólo en el CRC del PC */
+        build_frame(pc);
+        for (unsigned i = 1; i < pc->frame_len - 2; i++) pc->img_crc = crc16(pc->img_crc, pc->frame[i]);
+        pc->row = next_row(pc, pc->row + BL_ROW_ADDR);
+    }
+    if (pc->row >= BL_APPVEC) send_done(pc);
+    else                      send_row(pc);
+}
+
+/* Respuesta a la trama en curso (−1: venció la espera) */
+static void pc_reply(pc_t *pc, int r)
+{
+    g_t += HOST_TURN_S;
+    if (pc->state == PC_WAIT_DONE) {
+        pc->done_reply = r;
+        pc->state = PC_GAVE_UP;         // con ACK la sesión ya saltó a la app
+        return;
+    }
+    if (r == BL_ACK) {
+        for (unsigned i = 1; i < pc->frame_len - 2; i++) pc->img_crc = crc16(pc->img_crc, pc->frame[i]);
+        pc->rows++;
+        next_or_done(pc);
+        return;
+    }
+    if (++pc->tries >= HOST_TRIES) { pc->state = PC_GAVE_UP; return; }
+    pc->retries++;
+    send_row(pc);
+}
+
+static void bl_putc(uint8_t c)
+{
+    g_t += BYTE_S;
+    if (c == BL_ACK && g_lose_ack) {
+        g_lose_ack = 0;
+        if (g_legacy) g_last_row = BL_NO_ROW;   // el bootloader de antes no reconocía el reintento
+        return;
+    }
+    if (g_pc.q_pos >= g_pc.q_len && g_pc.resp < 0) g_pc.resp = c;
+}
+
+static int16_t bl_getc(uint16_t tmo_ms)
+{
+    pc_t *pc = &g_pc;
+    for (;;) {
+        if (pc->q_pos < pc->q_len) {
+            g_t += BYTE_S;
+            return pc->q[pc->q_pos++];
+        }
+        if (pc->state == PC_GAVE_UP) longjmp(g_exit, 2);
+        if (pc->resp >= 0) {                    // el PC leyó la respuesta
+            int r = pc->resp;
+            pc->resp = -1;
+            pc_reply(pc, r);
+            continue;
+        }
+        if (tmo_ms == 0xFFFF) {                 // el dsPIC espera una trama y el PC una respuesta
+            g_t += HOST_TMO_S;
+            pc_reply(pc, -1);
+            continue;
+        }
+        g_t += tmo_ms * 1e-3;                   // trama corta: vence el plazo por byte
+        return -1;
+    }
+}
+
+/* ——————————————————— SESIÓN COMPLETA ——————————————————— */
+typedef struct {
+    int    app_ok;          // DONE con ACK
+    int    appvec_blank;    // BL_APPVEC vacía al terminar
+    int    image_ok;        // flash igual a la imagen (con los parches)
+    double secs;
+} sess_t;
+
+static int flash_matches(const pc_t *pc)
+{
+    for (uint32_t a = 0; a < BL_APPVEC; a += BL_ROW_ADDR) {
+        if (row_blank(pc, a)) continue;         // el PC no las envía: queda lo viejo
+        for (unsigned i = 0; i < BL_ROW_INSTR; i++) {
+            uint32_t want = pc->img[a / 2U + i];
+            if (a == 0 && i == 0) want = 0x040000UL | (BL_START & 0xFFFEU);
+            if (a == 0 && i == 1) want = 0;
+            if (g_flash[a / 2U + i] != want) return 0;
+        }
+    }
+    return g_flash[BL_APPVEC / 2U] == pc->img[0] && g_flash[BL_APPVEC / 2U + 1] == pc->img[1];
+}
+
+static sess_t session(void)
+{
+    sess_t s;
+    pc_t  *pc = &g_pc;
+    memset(&s, 0, sizeof s);
+    g_t = 0;
+    pc->state = PC_WAIT_ROW;
+    pc->row = next_row(pc, 0);
+    pc->tries = 0;
+    pc->img_crc = 0xFFFF;
+    pc->rows = pc->retries = pc->bytes = 0;
+    pc->done_reply = -1;
+    pc->q_len = pc->q_pos = 0;
+    pc->resp = -1;
+    g_lose_ack = g_flash_fault = 0;
+
+    int how = setjmp(g_exit);
+    if (!how) {
+        send_row(pc);
+        bl_session();
+    }
+    s.app_ok       = (how == 1);
+    s.appvec_blank = bl_read_ins(BL_APPVEC) == 0xFFFFFFUL;
+    s.image_ok     = s.app_ok && flash_matches(pc);
+    s.secs         = g_t;
+    return s;
+}
+
+/* Imagen de ~20 KB: GOTO en la fila 0, código con huecos y datos */
+static void make_image(pc_t *pc)
+{
+    for (unsigned long i = 0; i < N_INSTR; i++) pc->img[i] = 0xFFFFFFUL;
+    for (uint32_t a = 0; a < 0x3600UL; a += BL_ROW_ADDR) {
+        if (a != 0 && rnd32() % 8 == 0) continue;         // huecos
+        for (unsigned i = 0; i < BL_ROW_INSTR; i++)
+            pc->img[a / 2U + i] = rnd32() & 0xFFFFFFUL;
+    }
+    for (uint32_t a = 0x6000UL; a < 0x6400UL; a += 2) pc->img[a / 2U] = rnd32() & 0xFFFFFFUL;
+    pc->img[0] = 0x040200UL;                            // GOTO 0x0200
+    pc->img[1] = 0x000000UL;
+}
+
+static void stale_flash(void)
+{
+    for (unsigned long i = 0; i < N_INSTR; i++) g_flash[i] = rnd32() & 0xFFFFFFUL;
+}
+
+static void faults(pc_t *pc, double corrupt, double drop, double lose, double flash, int first)
+{
+    pc->p_corrupt = corrupt;
+    pc->p_drop    = drop;
+    pc->p_lose_ack = lose;
+    pc->p_flash   = flash;
+    pc->first_try_lose_ack = first;
+    pc->skip_row  = 0;
+}
+
+/* ——————————————————— CASOS ——————————————————— */
+static void case_clean(void)
+{
+    pc_t *pc = &g_pc;
+    make_image(pc);
+    faults(pc, 0, 0, 0, 0, 0);
+    stale_flash();
+    sess_t s = session();
+
+    double row_s = (1 + 3 + BL_ROW_BYTES + 2) * BYTE_S + 2 * FLASH_OP_S + BYTE_S + HOST_TURN_S;
+    printf("\n1 limpia: %u filas, %u bytes en %.3f s (%.0f B/s); modelo por fila %.2f ms\n",
+           pc->rows, pc->bytes, s.secs, pc->bytes / s.secs, row_s * 1e3);
+    check("DONE con ACK y salto a la app", s.app_ok);
+    check("flash igual a la imagen, GOTO en fila 0 y BL_APPVEC", s.image_ok);
+    check("ningún reintento", pc->retries == 0);
+}
+
+static void case_lost_ack(void)
+{
+    pc_t *pc = &g_pc;
+    faults(pc, 0, 0, 0, 0, 1);
+    stale_flash();
+    g_legacy = 0;
+    sess_t s = session();
+    unsigned retries = pc->retries;
+    double   secs = s.secs;
+
+    stale_flash();
+    g_legacy = 1;
+    sess_t o = session();
+    g_legacy = 0;
+
+    printf("\n2 ACK perdido en el 1.er intento de cada fila: %u reintentos, %.2f s\n",
+           retries, secs);
+    printf("    sin reemplazo del CRC: respuesta al DONE 0x%02X, BL_APPVEC %s\n",
+           pc->done_reply & 0xFF, o.appvec_blank ? "en blanco" : "escrita");
+    check("cada fila reintentada una vez", retries == pc->rows);
+    check("DONE con ACK y flash igual a la imagen", s.app_ok && s.image_ok);
+    check("el CRC de antes (sumando dos veces) daba NAK", !o.app_ok && o.appvec_blank &&
+          pc->done_reply == BL_NAK);
+}
+
+static void case_random(void)
+{
+    enum { SESSIONS = 300 };
+    pc_t *pc = &g_pc;
+    unsigned ok = 0, failed_clean = 0, bad = 0, retries = 0;
+    double   secs = 0;
+
+    for (int n = 0; n < SESSIONS; n++) {
+        make_image(pc);
+        faults(pc, 0.01, 0.01, 0.01, 0.005, 0);
+        stale_flash();
+        sess_t s = session();
+        retries += pc->retries;
+        if (s.app_ok) {
+            secs += s.secs;
+            if (s.image_ok) ok++;
+            else            bad++;
+        } else if (s.appvec_blank) {
+            failed_clean++;
+        } else {
+            bad++;
+        }
+    }
+    printf("\n3 %d sesiones, fallas del 1 %% (verificación 0.5 %%) por intento de fila\n", SESSIONS);
+    printf("    %u completas (%.2f s de media), %u abandonadas sin app, %u mal, %u reintentos\n",
+           ok, ok ? secs / ok : 0, failed_clean, bad, retries);
+    check("nunca una app aceptada con la flash distinta", bad == 0);
+    check("las sesiones abandonadas dejan BL_APPVEC en blanco", ok + failed_clean == SESSIONS);
+    check("con 3 intentos casi todas terminan (≥ 95 %)", ok >= SESSIONS * 95 / 100);
+}
+
+static void case_bad_crc(void)
+{
+    pc_t *pc = &g_pc;
+    make_image(pc);
+    faults(pc, 0, 0, 0, 0, 0);
+    pc->skip_row = next_row(pc, 10 * BL_ROW_ADDR);
+    stale_flash();
+    sess_t s = session();
+    pc->skip_row = 0;
+
+    printf("\n4 fila 0x%04lX omitida pero contada: respuesta al DONE 0x%02X\n",
+           (unsigned long)next_row(pc, 10 * BL_ROW_ADDR), pc->done_reply & 0xFF);
+    check("DONE con NAK", pc->done_reply == BL_NAK);
+    check("sin app: BL_APPVEC en blanco", !s.app_ok && s.appvec_blank);
+}
+
+int main(void)
+{
+    case_clean();
+    case_lost_ack();
+    case_random();
+    case_bad_crc();
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,258 @@
+/*************************************************************
+ *  bl_upload – cargador del lado PC para 10_uart2_bootloader.c
+ *  POSIX (Linux / macOS):  cc -O2 -o bl_upload bl_upload.c
+ *
+ *  Uso:  bl_upload <puerto> <app.hex> [baud]
+ *        p.ej.  bl_upload /dev/ttyUSB0 dist/app.hex 460800
+ *
+ *  – Lee el .hex de XC-DSC: cada instrucción ocupa 4 bytes en el
+ *    archivo (low, mid, upper, fantasma) en la dirección 2·PC.
+ *    Se ignora todo lo que no es memoria de programa (EEPROM,
+ *    bits de configuración).
+ *  – Envía 0xC1 cada 50 ms hasta ver "BL" (resetear la placa).
+ *  – Manda sólo las filas no vacías, espera el ACK de cada una y
+ *    reintenta hasta 3 veces; al final manda el CRC de la imagen.
+ *  – Imprime el tiempo total y la tasa efectiva.
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/select.h>
+
+#define PROG_WORDS      0x8000UL                   // 0x0000 … 0x7FFE
+#define N_INSTR         (PROG_WORDS / 2UL)
+#define ROW_INSTR       32U
+#define ROW_ADDR        (2U * ROW_INSTR)
+#define BL_APPVEC       0x77C0UL
+
+#define BL_HELLO        0xC1
+#define BL_BLOCK        0xB5
+#define BL_DONE         0xE5
+#define BL_ACK          0x06
+
+static uint32_t g_img[N_INSTR];
+
+/* ——————————————————— HEX ——————————————————— */
+static int hex_byte(const char *s)
+{
+    unsigned v;
+    return (sscanf(s, "%2x", &v) == 1) ? (int)v : -1;
+}
+
+static int load_hex(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); return -1; }
+
+    for (unsigned long i = 0; i < N_INSTR; i++) g_img[i] = 0xFFFFFFUL;
+
+    char line[600];
+    uint32_t base = 0;
+    unsigned long ignored = 0;
+
+    while (fgets(line, sizeof line, f)) {
+        if (line[0] != ':') continue;
+        int n    = hex_byte(line + 1);
+        int ahi  = hex_byte(line + 3);
+        int alo  = hex_byte(line + 5);
+        int type = hex_byte(line + 7);
+        if (n < 0 || ahi < 0 || alo < 0 || type < 0) goto bad;
+
+        uint8_t sum = (uint8_t)(n + ahi + alo + type);
+        uint8_t d[256];
+        for (int i = 0; i <= n; i++) {
+            int b = hex_byte(line + 9 + 2 * i);
+            if (b < 0) goto bad;
+            if (i < n) d[i] = (uint8_t)b;
+            sum += (uint8_t)b;
+        }
+        if (sum != 0) goto bad;
+
+        if (type == 0x04) { base = ((uint32_t)d[0] << 24) | ((uint32_t)d[1] << 16); continue; }
+        if (type == 0x01) break;
+        if (type != 0x00) continue;
+
+        for (int i = 0; i < n; i++) {
+            uint32_t ba = base + (uint32_t)((ahi << 8) | alo) + (uint32_t)i;
+            uint32_t idx = ba >> 2;                // 4 bytes por instrucción
+            unsigned pos = ba & 3U;
+            if (idx >= N_INSTR) { ignored++; continue; }
+            if (pos == 3) continue;                // byte fantasma
+            g_img[idx] &= ~(0xFFUL << (8 * pos));
+            g_img[idx] |= (uint32_t)d[i] << (8 * pos);
+        }
+    }
+    fclose(f);
+    if (ignored) fprintf(stderr, "aviso: %lu bytes fuera de la flash de programa ignorados\n", ignored);
+    return 0;
+
+bad:
+    fclose(f);
+    fprintf(stderr, "%s: línea HEX inválida\n", path);
+    return -1;
+}
+
+/* ——————————————————— PUERTO SERIE ——————————————————— */
+static speed_t baud_const(long b)
+{
+    switch (b) {
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+#ifdef B460800
+    case 460800: return B460800;
+#endif
+#ifdef B921600
+    case 921600: return B921600;
+#endif
+    default:     return 0;
+    }
+}
+
+static int open_port(const char *dev, long baud)
+{
+    speed_t sp = baud_const(baud);
+    if (!sp) { fprintf(stderr, "baud no soportado: %ld\n", baud); return -1; }
+
+    int fd = open(dev, O_RDWR | O_NOCTTY);
+    if (fd < 0) { perror(dev); return -1; }
+
+    struct termios t;
+    tcgetattr(fd, &t);
+    cfmakeraw(&t);
+    cfsetispeed(&t, sp);
+    cfsetospeed(&t, sp);
+    t.c_cflag |= CLOCAL | CREAD;
+    t.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+    t.c_cc[VMIN]  = 0;
+    t.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &t);
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+/* Byte recibido o −1 tras tmo_ms */
+static int rx_byte(int fd, int tmo_ms)
+{
+    fd_set s;
+    struct timeval tv = { tmo_ms / 1000, (tmo_ms % 1000) * 1000 };
+    FD_ZERO(&s);
+    FD_SET(fd, &s);
+    if (select(fd + 1, &s, NULL, NULL, &tv) <= 0) return -1;
+    uint8_t c;
+    return (read(fd, &c, 1) == 1) ? c : -1;
+}
+
+static uint16_t crc16(uint16_t crc, uint8_t b)
+{
+    crc ^= (uint16_t)b << 8;
+    for (int i = 0; i < 8; i++)
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    return crc;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ——————————————————— PROTOCOLO ——————————————————— */
+static int wait_banner(int fd)
+{
+    uint8_t h = BL_HELLO;
+    for (int tries = 0; tries < 600; tries++) {        // ~30 s
+        if (write(fd, &h, 1) != 1) return -1;
+        if (rx_byte(fd, 50) == 'B' && rx_byte(fd, 50) == 'L') {
+            int ver = rx_byte(fd, 50), row = rx_byte(fd, 50);
+            printf("bootloader v%d, fila de %d instrucciones\n", ver, row);
+            if (row != ROW_INSTR) { fprintf(stderr, "tamaño de fila inesperado\n"); return -1; }
+            usleep(20000);                               // banner de sesión
+            tcflush(fd, TCIFLUSH);
+            return 0;
+        }
+    }
+    fprintf(stderr, "sin respuesta del bootloader\n");
+    return -1;
+}
+
+static int row_blank(uint32_t first)
+{
+    for (unsigned i = 0; i < ROW_INSTR; i++)
+        if (g_img[first + i] != 0xFFFFFFUL) return 0;
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "uso: %s <puerto> <app.hex> [baud]\n", argv[0]);
+        return 2;
+    }
+    long baud = (argc > 3) ? atol(argv[3]) : 460800L;
+
+    if (load_hex(argv[2]) < 0) return 1;
+
+    for (uint32_t a = BL_APPVEC; a < PROG_WORDS; a += ROW_ADDR)
+        if (!row_blank(a / 2U)) {
+            fprintf(stderr, "la imagen usa 0x%04lX, reservado al bootloader\n", (unsigned long)a);
+            return 1;
+        }
+    if (row_blank(0)) { fprintf(stderr, "la imagen no tiene vector de reset\n"); return 1; }
+
+    int fd = open_port(argv[1], baud);
+    if (fd < 0) return 1;
+    if (wait_banner(fd) < 0) return 1;
+
+    double t0 = now_s();
+    uint16_t img_crc = 0xFFFF;
+    unsigned rows = 0;
+    unsigned long bytes = 0;
+
+    for (uint32_t a = 0; a < BL_APPVEC; a += ROW_ADDR) {
+        uint32_t first = a / 2U;
+        if (row_blank(first)) continue;
+
+        uint8_t fr[1 + 3 + 3 * ROW_INSTR + 2];
+        unsigned k = 0;
+        uint16_t crc = 0xFFFF;
+        fr[k++] = BL_BLOCK;
+        for (int i = 0; i < 3; i++) { fr[k] = (uint8_t)(a >> (8 * i)); crc = crc16(crc, fr[k++]); }
+        for (unsigned i = 0; i < ROW_INSTR; i++)
+            for (int b = 0; b < 3; b++) { fr[k] = (uint8_t)(g_img[first + i] >> (8 * b)); crc = crc16(crc, fr[k++]); }
+        fr[k++] = (uint8_t)crc;
+        fr[k++] = (uint8_t)(crc >> 8);
+
+        int r = -1;
+        for (int tries = 0; tries < 3 && r != BL_ACK; tries++) {
+            if (write(fd, fr, k) != (ssize_t)k) { perror("write"); return 1; }
+            r = rx_byte(fd, 500);
+            if (r != BL_ACK) fprintf(stderr, "fila 0x%04lX: respuesta 0x%02X, reintento\n",
+                                     (unsigned long)a, r & 0xFF);
+        }
+        if (r != BL_ACK) { fprintf(stderr, "fila 0x%04lX rechazada\n", (unsigned long)a); return 1; }
+
+        for (unsigned i = 1; i < k - 2; i++) img_crc = crc16(img_crc, fr[i]);
+        rows++;
+        bytes += k;
+        printf("\r%u filas", rows);
+        fflush(stdout);
+    }
+
+    uint8_t done[3] = { BL_DONE, (uint8_t)img_crc, (uint8_t)(img_crc >> 8) };
+    if (write(fd, done, 3) != 3) { perror("write"); return 1; }
+    int r = rx_byte(fd, 500);
+    double dt = now_s() - t0;
+
+    if (r != BL_ACK) { fprintf(stderr, "\nverificación final falló (0x%02X)\n", r & 0xFF); return 1; }
+    printf("\n%u filas, %lu bytes en %.2f s (%.0f B/s), aplicación en marcha\n",
+           rows, bytes, dt, bytes / dt);
+    close(fd);
+    return 0;
+}
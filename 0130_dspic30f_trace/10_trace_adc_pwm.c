@@ -0,0 +1,240 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  ADC → PWM con comandos por UART2, instrumentado con trazas
+ *
+ *  – El PWM libre a 20 kHz dispara el ADC (AN0) cada 4 periodos
+ *    (SEVOPS = 1:4); _ADCInterrupt fija PDC1 = AN0 + g_offset.
+ *  – UART2 (115200): '+' / '-' mueven el offset objetivo 16 cuentas,
+ *    '0' lo vuelve a cero; cada byte se contesta con 'k' o '?'.
+ *  – Timer1 a 100 Hz lleva g_offset hacia el objetivo (4 cuentas por
+ *    tick), así que también hay estado que depende del tiempo.
+ *  – Cada entrada (ADC, byte RX, tick) y cada salida (PDC1, byte TX)
+ *    se graba con trace_rec.h; la marca de tiempo es Timer2/3 en modo
+ *    32 bits a TCY. La traza sale por UART1 (RF3 = U1TX) a 460800.
+ *  – host/trace_replay.c compila ESTE archivo sin cambios en el PC y
+ *    reproduce la traza llamando a las mismas ISR.
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+
+/* Marca de tiempo: Timer2/3 de 32 bits. Leer TMR2 copia TMR3 en TMR3HLD. */
+static inline uint32_t trc_now32(void)
+{
+    uint16_t lo = TMR2;
+    uint16_t hi = TMR3HLD;
+    return ((uint32_t)hi << 16) | lo;
+}
+#define TRACE_NOW()     trc_now32()
+#include "trace_rec.h"
+
+#define PWM_FREQ_HZ     20000UL
+#define PTPER_COUNTS    ((FCY / PWM_FREQ_HZ) - 1)  // 1473
+#define PDC_MAX         (2U * (PTPER_COUNTS + 1U))
+#define ADC_POSTSCALE   4U
+
+#define UART2_BAUD      115200UL
+#define UART1_BAUD      460800UL
+#define BRG(b)          ((uint16_t)(((FCY + 8UL * (b)) / (16UL * (b))) - 1UL))
+
+#define OFFSET_STEP     16
+#define OFFSET_SLEW     4
+#define OFFSET_LIMIT    512
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static volatile int16_t  g_offset = 0;
+static volatile int16_t  g_offset_target = 0;
+static volatile uint16_t g_pdc1 = 0xFFFF;      // último valor escrito
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timebase_init(void);
+static void timer1_init_100hz(void);
+static void pwm_adc_init(void);
+static void uart_init(void);
+static void uart2_reply(uint8_t c);
+
+/* ——————————————————— TIMER2/3: 32 bits a TCY ——————————— */
+static void timebase_init(void)
+{
+    T2CON = 0;
+    T3CON = 0;
+    T2CONbits.T32 = 1;
+    TMR3 = 0;
+    TMR2 = 0;
+    PR3  = 0xFFFF;
+    PR2  = 0xFFFF;
+    T2CONbits.TON = 1;
+}
+
+static void timer1_init_100hz(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = (uint16_t)(FCY / 8UL / 100UL - 1UL);
+    T1CONbits.TCKPS = 0b01;        // 1:8
+    IFS0bits.T1IF = 0;
+    IPC0bits.T1IP = 3;
+    IEC0bits.T1IE = 1;
+    T1CONbits.TON = 1;
+}
+
+/* ——————————————————— PWM1L + ADC AN0 ——————————————————— */
+static void pwm_adc_init(void)
+{
+    PTCONbits.PTEN   = 0;
+    PTCONbits.PTCKPS = 0;
+    PTCONbits.PTMOD  = 0;          // libre
+    PTPER = PTPER_COUNTS;
+
+    PWMCON1 = 0;
+    PWMCON1bits.PMOD1 = 1;
+    PWMCON1bits.PEN1L = 1;         // RE0
+    DTCON1 = 0;
+    PDC1 = 0;
+    OVDCONbits.POVD1L = 1;
+
+    SEVTCMP = 0;
+    PWMCON2 = 0;
+    PWMCON2bits.SEVOPS = ADC_POSTSCALE - 1;
+
+    ADPCFG = 0xFFFF;
+    ADPCFGbits.PCFG0 = 0;
+    ADCON1 = 0;
+    ADCON1bits.SSRC = 0b011;       // special event del PWM
+    ADCON1bits.ASAM = 1;
+    ADCON2 = 0;                    // CH0, IRQ por muestra
+    ADCON3bits.ADCS = 9;           // TAD ≈ 170 ns
+    ADCHS = 0;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 5;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    PTCONbits.PTEN  = 1;
+}
+
+/* ——————————————————— UART1 (traza) y UART2 (comandos) ——————— */
+static void uart_init(void)
+{
+    U1MODE = 0;
+    U1BRG  = BRG(UART1_BAUD);
+    U1STA  = 0;
+    U1MODEbits.UARTEN = 1;
+    U1STAbits.UTXEN   = 1;
+
+    U2MODE = 0;
+    U2BRG  = BRG(UART2_BAUD);
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+
+    IFS1bits.U2RXIF = 0;
+    IPC6bits.U2RXIP = 4;
+    IEC1bits.U2RXIE = 1;
+}
+
+static void uart2_reply(uint8_t c)
+{
+    U2TXREG = c;                   // 1 byte por comando: la FIFO alcanza
+    TRACE_TX(2, c);
+}
+
+/* ——————————————————— INTERRUPCIONES ——————————————————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    IFS0bits.ADIF = 0;
+
+    uint16_t v = ADCBUF0;
+    TRACE_ADC(0, v);
+
+    int32_t duty = (int32_t)(((uint32_t)v * PDC_MAX) >> 10) + g_offset;
+    if (duty < 0)       duty = 0;
+    if (duty > (int32_t)PDC_MAX) duty = PDC_MAX;
+
+    if ((uint16_t)duty != g_pdc1) {
+        g_pdc1 = (uint16_t)duty;
+        PDC1 = g_pdc1;
+        TRACE_PDC(1, g_pdc1);
+    }
+}
+
+void __attribute__((interrupt, auto_psv)) _U2RXInterrupt(void)
+{
+    IFS1bits.U2RXIF = 0;
+
+    while (U2STAbits.URXDA) {
+        uint8_t b = (uint8_t)U2RXREG;
+        TRACE_RX(2, b);
+
+        int16_t t = g_offset_target;
+        if      (b == '+') t += OFFSET_STEP;
+        else if (b == '-') t -= OFFSET_STEP;
+        else if (b == '0') t = 0;
+        else { uart2_reply('?'); continue; }
+
+        if (t >  OFFSET_LIMIT) t =  OFFSET_LIMIT;
+        if (t < -OFFSET_LIMIT) t = -OFFSET_LIMIT;
+        g_offset_target = t;
+        uart2_reply('k');
+    }
+    if (U2STAbits.OERR) U2STAbits.OERR = 0;
+}
+
+void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
+{
+    IFS0bits.T1IF = 0;
+    TRACE_TMR(1);
+
+    int16_t d = g_offset_target - g_offset;
+    if      (d >  OFFSET_SLEW) d =  OFFSET_SLEW;
+    else if (d < -OFFSET_SLEW) d = -OFFSET_SLEW;
+    g_offset += d;
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    timebase_init();
+    trace_init(FCY);
+    uart_init();
+    timer1_init_100hz();
+    pwm_adc_init();
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        /* Vaciar la traza hacia UART1 sin bloquear */
+        while (!U1STAbits.UTXBF) {
+            int16_t b = trace_getbyte();
+            if (b < 0) break;
+            U1TXREG = (uint8_t)b;
+        }
+    }
+    return 0;
+}
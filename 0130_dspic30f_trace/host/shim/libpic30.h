@@ -0,0 +1,6 @@
+/* libpic30.h de PC para trace_replay.c – NO usar en el equipo */
+#ifndef HOST_LIBPIC30_H
+#define HOST_LIBPIC30_H
+#define __delay_ms(x)   ((void)0)
+#define __delay_us(x)   ((void)0)
+#endif
@@ -0,0 +1,46 @@
+/*************************************************************
+ *  xc.h de PC para trace_replay.c – NO usar en el equipo
+ *
+ *  Sólo declara los registros y bits que toca 10_trace_adc_pwm.c,
+ *  como variables normales. Los bits de control no tienen efecto;
+ *  los que la ISR lee (URXDA, OERR) y U2RXREG los maneja el
+ *  reproductor.
+ *************************************************************/
+#ifndef HOST_XC_H
+#define HOST_XC_H
+
+#include <stdint.h>
+
+#define __attribute__(x)
+#define __builtin_disable_interrupts()  ((void)0)
+#define __builtin_enable_interrupts()   ((void)0)
+
+typedef struct {
+    uint16_t ADON, ASAM, SSRC, ADCS, PCFG0;
+    uint16_t ADIE, T1IE, U2RXIE, ADIF, T1IF, U2RXIF, T1IP, ADIP, U2RXIP;
+    uint16_t POVD1L, PTCKPS, PTEN, PTMOD, PEN1L, PMOD1, SEVOPS;
+    uint16_t IPL, TCKPS, TON, T32;
+    uint16_t UARTEN, UTXBF, UTXEN, OERR, URXDA;
+} host_bits_t;
+
+/* Cada registro y su estructura de bits; casi ninguno se usa en ambas formas */
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#define HOST_REG(n)     static uint16_t n; static host_bits_t n##bits
+
+HOST_REG(ADCON1);  HOST_REG(ADCON2);  HOST_REG(ADCON3);  HOST_REG(ADCHS);
+HOST_REG(ADPCFG);  HOST_REG(ADCBUF0);
+HOST_REG(IEC0);    HOST_REG(IEC1);    HOST_REG(IFS0);    HOST_REG(IFS1);
+HOST_REG(IPC0);    HOST_REG(IPC2);    HOST_REG(IPC6);    HOST_REG(SR);
+HOST_REG(PTCON);   HOST_REG(PTPER);   HOST_REG(PWMCON1); HOST_REG(PWMCON2);
+HOST_REG(DTCON1);  HOST_REG(OVDCON);  HOST_REG(SEVTCMP); HOST_REG(PDC1);
+HOST_REG(T1CON);   HOST_REG(T2CON);   HOST_REG(T3CON);
+HOST_REG(TMR1);    HOST_REG(TMR2);    HOST_REG(TMR3);    HOST_REG(TMR3HLD);
+HOST_REG(PR1);     HOST_REG(PR2);     HOST_REG(PR3);
+HOST_REG(U1MODE);  HOST_REG(U1STA);   HOST_REG(U1BRG);   HOST_REG(U1TXREG);
+HOST_REG(U2MODE);  HOST_REG(U2STA);   HOST_REG(U2BRG);   HOST_REG(U2TXREG);
+
+/* Leer U2RXREG saca un byte de la FIFO simulada */
+static uint16_t host_u2rx_pop(void);
+#define U2RXREG         host_u2rx_pop()
+
+#endif /* HOST_XC_H */
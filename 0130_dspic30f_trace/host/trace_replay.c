@@ -0,0 +1,234 @@
+/*************************************************************
+ *  trace_replay – reproduce una traza de 10_trace_adc_pwm.c en PC
+ *
+ *  cc -O2 -Ishim -I.. -Wno-unknown-pragmas -o trace_replay trace_replay.c -lm
+ *
+ *  Uso:
+ *    trace_replay <traza.bin> [-n N]   reproduce y compara N veces
+ *    trace_replay --synth <salida.bin> [segundos]
+ *                                      genera una traza sintética
+ *
+ *  – Incluye el firmware tal cual; shim/xc.h convierte los registros
+ *    en variables. Cada evento de entrada carga el registro que leería
+ *    la ISR (ADCBUF0, U2RXREG, TMR2/TMR3HLD) y llama a la misma ISR.
+ *  – El firmware vuelve a grabar su traza con trace_rec.h; las
+ *    salidas regeneradas (PDC, TX) se comparan en orden con las
+ *    grabadas en el equipo, sin mirar los tiempos.
+ *  – Al final imprime eventos/s de la reproducción completa
+ *    (decodificar + ISR + volver a codificar + comparar).
+ *************************************************************/
+#define main fw_main
+#include "10_trace_adc_pwm.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/* ——————————————————— FIFO RX simulada ——————————————————— */
+static uint8_t  g_rx_fifo[4];
+static unsigned g_rx_n = 0;
+
+static uint16_t host_u2rx_pop(void)
+{
+    uint8_t b = g_rx_fifo[0];
+    if (g_rx_n) {
+        memmove(g_rx_fifo, g_rx_fifo + 1, --g_rx_n);
+    }
+    U2STAbits.URXDA = (g_rx_n != 0);
+    return b;
+}
+
+/* ——————————————————— Flujo regenerado ——————————————————— */
+static uint8_t *g_out;
+static size_t   g_out_len, g_out_cap;
+
+static void drain(void)
+{
+    int16_t b;
+    while ((b = trace_getbyte()) >= 0) {
+        if (g_out_len == g_out_cap) {
+            g_out_cap = g_out_cap ? 2 * g_out_cap : 65536;
+            g_out = realloc(g_out, g_out_cap);
+            if (!g_out) { perror("realloc"); exit(1); }
+        }
+        g_out[g_out_len++] = (uint8_t)b;
+    }
+}
+
+/* Estado inicial del firmware, el mismo que tras el reset */
+static void fw_reset(void)
+{
+    g_offset = 0;
+    g_offset_target = 0;
+    g_pdc1 = 0xFFFF;
+    g_rx_n = 0;
+    U2STAbits.URXDA = 0;
+    TMR2 = TMR3HLD = 0;
+    g_out_len = 0;
+    trace_init(FCY);
+    drain();
+}
+
+static void set_time(uint32_t t)
+{
+    TMR2    = (uint16_t)t;
+    TMR3HLD = (uint16_t)(t >> 16);
+}
+
+/* Entrega un evento de entrada a su ISR */
+static void feed(const trc_event_t *e)
+{
+    set_time(e->t);
+    switch (e->type) {
+    case TRC_ADC:
+        ADCBUF0 = (uint16_t)e->value;
+        IFS0bits.ADIF = 1;
+        _ADCInterrupt();
+        break;
+    case TRC_RX:
+        if (g_rx_n < sizeof g_rx_fifo) g_rx_fifo[g_rx_n++] = (uint8_t)e->value;
+        U2STAbits.URXDA = 1;
+        IFS1bits.U2RXIF = 1;
+        _U2RXInterrupt();
+        break;
+    case TRC_TMR:
+        IFS0bits.T1IF = 1;
+        _T1Interrupt();
+        break;
+    default:
+        break;
+    }
+    drain();
+}
+
+static int is_output(uint8_t type) { return type == TRC_PDC || type == TRC_TX; }
+
+/* ——————————————————— REPRODUCCIÓN ——————————————————— */
+typedef struct { unsigned long events, outputs, mismatches, lost; } replay_stats_t;
+
+static int replay(const uint8_t *buf, size_t len, replay_stats_t *st, int verbose)
+{
+    trc_reader_t rin, rout;
+    trc_event_t  e, o;
+
+    memset(st, 0, sizeof *st);
+    if (!trc_reader_init(&rin, buf, (uint32_t)len)) {
+        fprintf(stderr, "cabecera de traza inválida\n");
+        return -1;
+    }
+
+    fw_reset();
+    while (trc_next(&rin, &e)) {
+        st->events++;
+        if (e.type == TRC_LOST) st->lost += (unsigned long)e.value;
+        else if (!is_output(e.type)) feed(&e);
+    }
+
+    /* Comparar salidas en orden */
+    trc_reader_init(&rin, buf, (uint32_t)len);
+    trc_reader_init(&rout, g_out, (uint32_t)g_out_len);
+    for (;;) {
+        int a, b;
+        while ((a = trc_next(&rin,  &e)) && !is_output(e.type)) ;
+        while ((b = trc_next(&rout, &o)) && !is_output(o.type)) ;
+        if (!a && !b) break;
+        if (a) st->outputs++;
+        if (!a || !b || e.type != o.type || e.arg != o.arg || e.value != o.value) {
+            if (verbose && st->mismatches < 10) {
+                if (a && b)
+                    fprintf(stderr, "salida #%lu (t=%lu): grabada %u/%u=%ld, reproducida %u/%u=%ld\n",
+                            st->outputs, (unsigned long)e.t, e.type, e.arg, (long)e.value,
+                            o.type, o.arg, (long)o.value);
+                else
+                    fprintf(stderr, "salida #%lu: %s\n", st->outputs,
+                            a ? "falta en la reproducción" : "sobra en la reproducción");
+            }
+            st->mismatches++;
+            if (!a || !b) break;
+        }
+    }
+    return 0;
+}
+
+/* ——————————————————— TRAZA SINTÉTICA ——————————————————— */
+static int synth(const char *path, double seconds)
+{
+    const uint32_t t_adc = (uint32_t)(FCY / (PWM_FREQ_HZ / ADC_POSTSCALE));
+    const uint32_t t_tmr = (uint32_t)(FCY / 100UL);
+    const uint32_t t_rx  = (uint32_t)(FCY / 20UL);
+    const char     cmds[] = "++++-0x+--";
+    uint32_t t = 0, n_adc = 0, n_tmr = 0, n_rx = 0;
+    uint32_t end = (uint32_t)(seconds * FCY);
+
+    fw_reset();
+    srand(1);
+    while (t < end) {
+        uint32_t next_adc = (n_adc + 1) * t_adc;
+        uint32_t next_tmr = (n_tmr + 1) * t_tmr;
+        uint32_t next_rx  = (n_rx  + 1) * t_rx;
+        trc_event_t e = { 0 };
+
+        if (next_adc <= next_tmr && next_adc <= next_rx) {
+            t = next_adc; n_adc++;
+            double s = 512.0 + 300.0 * sin(2.0 * M_PI * 3.0 * t / FCY);
+            e.type = TRC_ADC;
+            e.value = (int32_t)s + (rand() % 5) - 2;
+        } else if (next_tmr <= next_rx) {
+            t = next_tmr; n_tmr++;
+            e.type = TRC_TMR; e.arg = 1;
+        } else {
+            t = next_rx; n_rx++;
+            e.type = TRC_RX; e.arg = 2;
+            e.value = (uint8_t)cmds[n_rx % (sizeof cmds - 1)];
+        }
+        e.t = t;
+        feed(&e);
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f) { perror(path); return 1; }
+    fwrite(g_out, 1, g_out_len, f);
+    fclose(f);
+    printf("%s: %zu bytes, %u ADC, %u ticks, %u bytes RX (%.2f bytes/muestra ADC)\n",
+           path, g_out_len, n_adc, n_tmr, n_rx, (double)g_out_len / n_adc);
+    return 0;
+}
+
+/* ——————————————————— MAIN ——————————————————— */
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "--synth") == 0)
+        return synth(argv[2], argc > 3 ? atof(argv[3]) : 10.0);
+
+    if (argc < 2) {
+        fprintf(stderr, "uso: %s <traza.bin> [-n N] | --synth <salida.bin> [s]\n", argv[0]);
+        return 2;
+    }
+    int reps = (argc > 3 && strcmp(argv[2], "-n") == 0) ? atoi(argv[3]) : 1;
+    if (reps < 1) reps = 1;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) { perror(argv[1]); return 1; }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc((size_t)len);
+    if (!buf || fread(buf, 1, (size_t)len, f) != (size_t)len) { perror("read"); return 1; }
+    fclose(f);
+
+    replay_stats_t st;
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (int i = 0; i < reps; i++)
+        if (replay(buf, (size_t)len, &st, i == 0) < 0) return 1;
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    double dt = (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) * 1e-9;
+
+    printf("%lu eventos, %lu salidas, %lu diferencias", st.events, st.outputs, st.mismatches);
+    if (st.lost) printf(", %lu eventos perdidos en el equipo (comparación no exacta)", st.lost);
+    printf("\n%.0f eventos/s (%d repeticiones, %.3f s)\n", st.events * (double)reps / dt, reps, dt);
+    return st.mismatches ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+/*************************************************************
+ *  Formato binario de trazas de periféricos (firmware y PC)
+ *
+ *  Cabecera:  'T' 'R' TRC_VERSION  tick_hz (u32, LSB primero)
+ *  Evento:    etiqueta  dt  [dato]
+ *     etiqueta = tipo<<4 | arg      (arg = canal, UART, timer…)
+ *     dt       = varint: ticks desde el evento anterior
+ *     dato     = según tipo:
+ *        TRC_ADC, TRC_PDC  varint(zigzag(valor − último[tipo][arg]))
+ *        TRC_RX,  TRC_TX   1 byte tal cual
+ *        TRC_TMR           nada
+ *        TRC_LOST          varint: eventos descartados antes de éste
+ *
+ *  El predictor de cada (tipo, arg) arranca en 0 y sólo avanza con
+ *  eventos que llegan al flujo, así que emisor y lector siguen en
+ *  fase aunque se pierdan eventos. Una muestra de ADC casi constante
+ *  ocupa 3 bytes (etiqueta, dt corto, delta pequeño).
+ *************************************************************/
+#ifndef TRACE_FMT_H
+#define TRACE_FMT_H
+
+#include <stdint.h>
+
+#define TRC_VERSION     1
+#define TRC_HDR_LEN     7
+#define TRC_MAX_EVENT   11             // etiqueta + 5 + 5
+
+#define TRC_ADC         1
+#define TRC_RX          2
+#define TRC_TMR         3
+#define TRC_PDC         4
+#define TRC_TX          5
+#define TRC_LOST        15
+
+#define TRC_NARGS       16
+
+/* ——————————————————— VARINT / ZIGZAG ——————————————————— */
+static inline uint32_t trc_zigzag(int32_t v)
+{   return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);   }
+
+static inline int32_t trc_unzigzag(uint32_t u)
+{   return (int32_t)(u >> 1) ^ -(int32_t)(u & 1U);   }
+
+/* Escribe v en p; devuelve bytes usados (1…5) */
+static inline uint8_t trc_put_varint(uint8_t *p, uint32_t v)
+{
+    uint8_t n = 0;
+    while (v >= 0x80U) {
+        p[n++] = (uint8_t)(v | 0x80U);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/* ——————————————————— LECTOR ——————————————————— */
+typedef struct {
+    uint8_t  type, arg;
+    uint32_t t;                        // tiempo absoluto en ticks
+    int32_t  value;                    // valor absoluto / byte / cuenta
+} trc_event_t;
+
+typedef struct {
+    const uint8_t *p, *end;
+    uint32_t t;
+    int32_t  last[TRC_NARGS * 2];      // predictores ADC y PDC
+    uint32_t tick_hz;
+} trc_reader_t;
+
+static inline int trc_get_varint(trc_reader_t *r, uint32_t *v)
+{
+    uint32_t x = 0;
+    for (uint8_t s = 0; s < 35; s += 7) {
+        if (r->p >= r->end) return 0;
+        uint8_t b = *r->p++;
+        x |= (uint32_t)(b & 0x7FU) << s;
+        if (!(b & 0x80U)) { *v = x; return 1; }
+    }
+    return 0;
+}
+
+/* 1 = cabecera válida */
+static inline int trc_reader_init(trc_reader_t *r, const uint8_t *buf, uint32_t len)
+{
+    r->p = buf;
+    r->end = buf + len;
+    r->t = 0;
+    for (uint8_t i = 0; i < TRC_NARGS * 2; i++) r->last[i] = 0;
+    if (len < TRC_HDR_LEN || buf[0] != 'T' || buf[1] != 'R' || buf[2] != TRC_VERSION)
+        return 0;
+    r->tick_hz = (uint32_t)buf[3] | ((uint32_t)buf[4] << 8) |
+                 ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 24);
+    r->p += TRC_HDR_LEN;
+    return 1;
+}
+
+/* 1 = evento leído, 0 = fin o flujo truncado */
+static inline int trc_next(trc_reader_t *r, trc_event_t *e)
+{
+    uint32_t dt, u;
+    if (r->p >= r->end) return 0;
+
+    uint8_t tag = *r->p++;
+    e->type = tag >> 4;
+    e->arg  = tag & 0x0FU;
+    if (!trc_get_varint(r, &dt)) return 0;
+    r->t += dt;
+    e->t = r->t;
+
+    switch (e->type) {
+    case TRC_ADC:
+    case TRC_PDC: {
+        int32_t *last = &r->last[(e->type == TRC_PDC ? TRC_NARGS : 0) + e->arg];
+        if (!trc_get_varint(r, &u)) return 0;
+        *last += trc_unzigzag(u);
+        e->value = *last;
+        break;
+    }
+    case TRC_RX:
+    case TRC_TX:
+        if (r->p >= r->end) return 0;
+        e->value = *r->p++;
+        break;
+    case TRC_LOST:
+        if (!trc_get_varint(r, &u)) return 0;
+        e->value = (int32_t)u;
+        break;
+    default:
+        e->value = 0;
+        break;
+    }
+    return 1;
+}
+
+#endif /* TRACE_FMT_H */
@@ -0,0 +1,142 @@
+/*************************************************************
+ *  Grabador de trazas (trace_fmt.h) – header-only
+ *
+ *  Antes de incluirlo, el programa define:
+ *     TRACE_NOW()     tiempo actual en ticks (uint32_t)
+ *     TRACE_ENABLE    0 → todas las macros desaparecen
+ *
+ *  TRACE_ADC/RX/TMR/PDC/TX pueden llamarse desde cualquier ISR: la
+ *  codificación (≈ 60…100 TCY) se hace con IPL 7 y escribe en un anillo
+ *  de TRACE_RING_LEN bytes. El lazo principal lo vacía con
+ *  trace_getbyte(), normalmente hacia una UART. Si el anillo no tiene
+ *  espacio el evento se descarta entero y el siguiente que entre va
+ *  precedido de un TRC_LOST con la cuenta.
+ *
+ *  El mismo archivo compila en PC (ver host/trace_replay.c): allí la
+ *  traza regenerada se compara con la grabada en el equipo.
+ *************************************************************/
+#ifndef TRACE_REC_H
+#define TRACE_REC_H
+
+#include <xc.h>
+#include <stdint.h>
+#include "trace_fmt.h"
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE    1
+#endif
+#ifndef TRACE_RING_LEN
+#define TRACE_RING_LEN  512U           // potencia de 2
+#endif
+
+#if TRACE_ENABLE
+
+#ifndef TRACE_NOW
+#error "Definir TRACE_NOW() antes de incluir trace_rec.h"
+#endif
+#if (TRACE_RING_LEN & (TRACE_RING_LEN - 1U)) != 0
+#error "TRACE_RING_LEN debe ser potencia de 2"
+#endif
+
+#define TRC_LOCK(s)     do { (s) = SRbits.IPL; SRbits.IPL = 7; } while (0)
+#define TRC_UNLOCK(s)   do { SRbits.IPL = (s); } while (0)
+
+static uint8_t           g_trc_ring[TRACE_RING_LEN];
+static volatile uint16_t g_trc_head = 0, g_trc_tail = 0;
+static uint32_t          g_trc_tlast = 0;
+static int32_t           g_trc_last[TRC_NARGS * 2];
+static uint16_t          g_trc_lost = 0;        // pendientes de reportar
+static uint32_t          g_trc_lost_total = 0;
+
+static inline void trc_emit(uint8_t type, uint8_t arg, int32_t v)
+{
+    uint8_t  e[2 * TRC_MAX_EVENT];
+    uint8_t  n = 0;
+    uint16_t ipl;
+
+    TRC_LOCK(ipl);
+    uint32_t now = TRACE_NOW();
+    uint32_t dt  = now - g_trc_tlast;
+
+    if (g_trc_lost) {
+        e[n++] = TRC_LOST << 4;
+        n += trc_put_varint(&e[n], dt);
+        n += trc_put_varint(&e[n], g_trc_lost);
+        dt = 0;
+    }
+
+    e[n++] = (uint8_t)((type << 4) | (arg & 0x0FU));
+    n += trc_put_varint(&e[n], dt);
+
+    int32_t *last = 0;
+    if (type == TRC_ADC || type == TRC_PDC) {
+        last = &g_trc_last[(type == TRC_PDC ? TRC_NARGS : 0) + (arg & 0x0FU)];
+        n += trc_put_varint(&e[n], trc_zigzag(v - *last));
+    } else if (type == TRC_RX || type == TRC_TX) {
+        e[n++] = (uint8_t)v;
+    }
+
+    if ((uint16_t)(TRACE_RING_LEN - (uint16_t)(g_trc_head - g_trc_tail)) < n) {
+        g_trc_lost++;                  // predictores y tiempo sin tocar
+        g_trc_lost_total++;
+        TRC_UNLOCK(ipl);
+        return;
+    }
+
+    for (uint8_t i = 0; i < n; i++)
+        g_trc_ring[(g_trc_head + i) & (TRACE_RING_LEN - 1U)] = e[i];
+    g_trc_head += n;
+    g_trc_tlast = now;
+    g_trc_lost  = 0;
+    if (last) *last = v;
+    TRC_UNLOCK(ipl);
+}
+
+/* Cabecera; llamar una vez, antes del primer evento */
+static inline void trace_init(uint32_t tick_hz)
+{
+    uint16_t ipl;
+    TRC_LOCK(ipl);
+    g_trc_head = g_trc_tail = 0;
+    g_trc_lost = 0;
+    for (uint8_t i = 0; i < TRC_NARGS * 2; i++) g_trc_last[i] = 0;
+
+    const uint8_t h[TRC_HDR_LEN] = {
+        'T', 'R', TRC_VERSION,
+        (uint8_t)tick_hz, (uint8_t)(tick_hz >> 8),
+        (uint8_t)(tick_hz >> 16), (uint8_t)(tick_hz >> 24)
+    };
+    for (uint8_t i = 0; i < TRC_HDR_LEN; i++) g_trc_ring[i] = h[i];
+    g_trc_head  = TRC_HDR_LEN;
+    g_trc_tlast = TRACE_NOW();
+    TRC_UNLOCK(ipl);
+}
+
+/* Siguiente byte del flujo o −1; sólo desde el lazo principal */
+static inline int16_t trace_getbyte(void)
+{
+    if (g_trc_tail == g_trc_head) return -1;
+    uint8_t b = g_trc_ring[g_trc_tail & (TRACE_RING_LEN - 1U)];
+    g_trc_tail++;
+    return b;
+}
+
+#define TRACE_ADC(ch, v)   trc_emit(TRC_ADC, (ch), (int32_t)(v))
+#define TRACE_RX(u, b)     trc_emit(TRC_RX,  (u),  (b))
+#define TRACE_TMR(id)      trc_emit(TRC_TMR, (id), 0)
+#define TRACE_PDC(g, v)    trc_emit(TRC_PDC, (g),  (int32_t)(v))
+#define TRACE_TX(u, b)     trc_emit(TRC_TX,  (u),  (b))
+
+#else   /* !TRACE_ENABLE */
+
+#define trace_init(hz)     ((void)0)
+#define trace_getbyte()    (-1)
+#define TRACE_ADC(ch, v)   ((void)0)
+#define TRACE_RX(u, b)     ((void)0)
+#define TRACE_TMR(id)      ((void)0)
+#define TRACE_PDC(g, v)    ((void)0)
+#define TRACE_TX(u, b)     ((void)0)
+
+#endif  /* TRACE_ENABLE */
+
+#endif  /* TRACE_REC_H */
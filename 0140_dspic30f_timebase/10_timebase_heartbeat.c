@@ -0,0 +1,164 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  base de tiempo de 64 bits (timebase.h) y plazos sin timer
+ *
+ *  – Timer2/3 cuenta TCY libre; arranca 1 ms antes de la vuelta de
+ *    32 bits y, con las interrupciones todavía deshabilitadas, la
+ *    prueba: lee tb_now64() hasta cruzarla (bandera pendiente, ISR
+ *    sin correr) y exige que la parte alta suba y nada retroceda.
+ *  – LED en RD0 a 1 Hz con plazos tb_due32() sobre tb_now32(): sin
+ *    timer propio ni deriva (el plazo siguiente se suma al anterior,
+ *    no a la hora de atención).
+ *  – Timer1 a 10 kHz con IPL 6 (sobre la ISR de la base, IPL 2) lee
+ *    tb_now64() y comprueba que nunca retrocede; el lazo principal
+ *    hace lo mismo sin pausa, a veces con las IRQ deshabilitadas.
+ *    Las vueltas siguientes llegan cada 145.7 s.
+ *  – Medidas (ver con el depurador):
+ *      g_backsteps_isr / g_backsteps_main  lecturas que retrocedieron
+ *                                          (deben quedar en 0)
+ *      g_wrap_ok                           prueba de arranque superada
+ *      g_rd32_tcy / g_rd64_tcy             costo de cada lectura
+ *      g_late_max                          peor atraso del LED, TCY
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "timebase.h"
+
+#define LED_TRIS        TRISDbits.TRISD0
+#define LED_LAT         LATDbits.LATD0
+
+#define LED_HALF_TCY    TB_MS(500)                 // 1 Hz
+#define T1_HZ           10000UL
+#define PR1_COUNTS      ((FCY / T1_HZ) - 1)
+#define WRAP_LEAD_TCY   TB_MS(1)                   // arranque antes de la vuelta
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static uint64_t          g_isr_last = 0;
+static volatile uint16_t g_backsteps_isr = 0;
+static uint16_t          g_backsteps_main = 0;
+static uint8_t           g_wrap_ok = 0;
+static uint16_t          g_rd32_tcy = 0, g_rd64_tcy = 0;
+static uint32_t          g_late_max = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timer1_init(void);
+static void wrap_test(void);
+static void read_cost(void);
+
+/* ——————————————————— TIMER1: 10 kHz, IPL 6 ——————————————— */
+static void timer1_init(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = PR1_COUNTS;
+    IFS0bits.T1IF = 0;
+    IPC0bits.T1IP = 6;
+    IEC0bits.T1IE = 1;
+    T1CONbits.TON = 1;
+}
+
+void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
+{
+    IFS0bits.T1IF = 0;
+    uint64_t t = tb_now64();
+    if (t < g_isr_last) g_backsteps_isr++;
+    g_isr_last = t;
+}
+
+/* ——————————————————— PRUEBA DE VUELTA ——————————————————— */
+/* Con IRQ deshabilitadas: la ISR de la base no corre, sólo la
+   bandera pendiente puede sostener la parte alta. */
+static void wrap_test(void)
+{
+    uint64_t t0 = tb_now64(), prev = t0, t;
+    uint8_t  ok = 1;
+    do {
+        t = tb_now64();
+        if (t < prev) ok = 0;
+        prev = t;
+    } while ((t >> 32) == (t0 >> 32) && t - t0 < 2UL * WRAP_LEAD_TCY);
+    g_wrap_ok = ok && (t >> 32) == (t0 >> 32) + 1;
+}
+
+/* ——————————————————— COSTO DE LECTURA ——————————————————— */
+/* Diferencia contra un par de lecturas vacío; IRQ deshabilitadas */
+static void read_cost(void)
+{
+    volatile uint64_t sink;
+    uint32_t a, b, base;
+
+    a = tb_now32(); b = tb_now32();
+    base = b - a;
+    a = tb_now32(); sink = tb_now32(); b = tb_now32();
+    g_rd32_tcy = (uint16_t)(b - a - base);
+    a = tb_now32(); sink = tb_now64(); b = tb_now32();
+    g_rd64_tcy = (uint16_t)(b - a - base);
+    (void)sink;
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    __builtin_disable_interrupts();
+
+    LED_TRIS = 0;
+    LED_LAT  = 0;
+
+    tb_init_at(0x100000000ULL - WRAP_LEAD_TCY);
+    read_cost();
+    wrap_test();
+    timer1_init();
+
+    __builtin_enable_interrupts();
+
+    uint32_t led_t  = tb_now32() + LED_HALF_TCY;
+    uint64_t last   = tb_now64();
+    uint16_t pass   = 0;
+
+    for (;;)
+    {
+        uint32_t now = tb_now32();
+        if (tb_due32(now, led_t)) {
+            uint32_t late = now - led_t;
+            if (late > g_late_max) g_late_max = late;
+            led_t += LED_HALF_TCY;
+            LED_LAT ^= 1;
+        }
+
+        /* una de cada 16 lecturas con las IRQ deshabilitadas */
+        uint64_t t;
+        if ((++pass & 15U) == 0) {
+            __builtin_disable_interrupts();
+            t = tb_now64();
+            __builtin_enable_interrupts();
+        } else {
+            t = tb_now64();
+        }
+        if (t < last) g_backsteps_main++;
+        last = t;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*************************************************************
+ *  Base de tiempo monotónica de 64 bits a TCY – header-only
+ *
+ *  Timer2/3 en modo 32 bits (o Timer4/5 si se define TB_T45 antes de
+ *  incluirlo), libre hasta 0xFFFFFFFF, cuenta TCY: a 29.48 MHz da la
+ *  vuelta cada 145.7 s. La interrupción de periodo del par suma 1 a la
+ *  parte alta g_tb_hi; juntas dan 64 bits (≈ 19 800 años).
+ *
+ *  Lecturas, sin bloqueo y válidas desde cualquier contexto (lazo
+ *  principal, ISR de cualquier prioridad, con IRQ deshabilitadas):
+ *    tb_now32()   ≈ 6 TCY   32 bits bajos: sellos y plazos < 72 s
+ *    tb_now64()   ≈ 20 TCY  tiempo absoluto desde tb_init()
+ *
+ *  – El contador se lee msw, lsw, msw y se repite si el msw cambió. No
+ *    se usa TMRxHLD: una ISR que leyera el timer entre la lectura de
+ *    TMR2 y la de TMR3HLD de otro contexto pisaría el registro.
+ *  – tb_now64() lee g_tb_hi antes y después y repite si la ISR corrió
+ *    en medio. Si el contador ya dio la vuelta pero su ISR todavía no
+ *    corrió (lectura desde una ISR de mayor prioridad o con IRQ
+ *    deshabilitadas) la bandera está puesta: si además la parte baja
+ *    está en la mitad inferior, la lectura es posterior a la vuelta y
+ *    se suma 1. La ISR actualiza g_tb_hi y baja la bandera con IPL 7,
+ *    así ninguna lectura ve una cosa sin la otra.
+ *
+ *  Plazos con 32 bits: tb_due32(now, t) es verdadero cuando now ya
+ *  alcanzó t, aunque el contador haya dado la vuelta (|now − t| < 2^31).
+ *
+ *  El par queda ocupado: con TB_T45, Timer3 sigue libre para disparar
+ *  el ADC (SSRC = 010), como en los ejemplos de 0060_uart.
+ *
+ *  Requiere FCY. Define la ISR del par (_T3Interrupt o _T5Interrupt).
+ *************************************************************/
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#ifndef FCY
+#error "Definir FCY antes de incluir timebase.h"
+#endif
+
+#ifndef TB_IPL
+#define TB_IPL          2               // prioridad de la ISR de vuelta
+#endif
+
+#define TB_HZ           FCY
+/* TCY en t µs / ms (constantes) */
+#define TB_US(t)        ((uint32_t)(((uint64_t)(t) * FCY + 500000ULL) / 1000000ULL))
+#define TB_MS(t)        ((uint32_t)(((uint64_t)(t) * FCY + 500ULL) / 1000ULL))
+
+#ifdef TB_T45
+#define TB_LSW          TMR4
+#define TB_MSW          TMR5
+#define TB_PR_LSW       PR4
+#define TB_PR_MSW       PR5
+#define TB_CON_LSW      T4CON
+#define TB_CON_MSW      T5CON
+#define TB_CONbits      T4CONbits
+#define TB_IF           IFS1bits.T5IF
+#define TB_IE           IEC1bits.T5IE
+#define TB_IP           IPC5bits.T5IP
+#define TB_ISR          _T5Interrupt
+#else
+#define TB_LSW          TMR2
+#define TB_MSW          TMR3
+#define TB_PR_LSW       PR2
+#define TB_PR_MSW       PR3
+#define TB_CON_LSW      T2CON
+#define TB_CON_MSW      T3CON
+#define TB_CONbits      T2CONbits
+#define TB_IF           IFS0bits.T3IF
+#define TB_IE           IEC0bits.T3IE
+#define TB_IP           IPC1bits.T3IP
+#define TB_ISR          _T3Interrupt
+#endif
+
+static volatile uint32_t g_tb_hi = 0;   // vueltas del contador de 32 bits
+
+/* Arranca el contador en t0 (0 normalmente; cerca de 2^32 para
+   probar la vuelta). Llamar con las interrupciones deshabilitadas. */
+static inline void tb_init_at(uint64_t t0)
+{
+    TB_IE = 0;
+    TB_CON_LSW = 0;
+    TB_CON_MSW = 0;
+    TB_CONbits.T32   = 1;
+    TB_CONbits.TCKPS = 0;               // 1:1 → un tick por TCY
+    TB_MSW    = (uint16_t)(t0 >> 16);   // msw primero
+    TB_LSW    = (uint16_t)t0;
+    TB_PR_MSW = 0xFFFF;
+    TB_PR_LSW = 0xFFFF;
+    g_tb_hi   = (uint32_t)(t0 >> 32);
+
+    TB_IF = 0;
+    TB_IP = TB_IPL;
+    TB_IE = 1;
+    TB_CONbits.TON = 1;
+}
+
+static inline void tb_init(void)        { tb_init_at(0); }
+
+static inline uint32_t tb_now32(void)
+{
+    uint16_t hi, lo;
+    do {
+        hi = TB_MSW;
+        lo = TB_LSW;
+    } while (hi != TB_MSW);
+    return ((uint32_t)hi << 16) | lo;
+}
+
+static inline uint64_t tb_now64(void)
+{
+    uint32_t hi, lo;
+    uint8_t  pend;
+    do {
+        hi   = g_tb_hi;
+        lo   = tb_now32();
+        pend = TB_IF;
+    } while (hi != g_tb_hi);
+    if (pend && !(lo & 0x80000000UL)) hi++;
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* now alcanzó t (aritmética módulo 2^32) */
+static inline int tb_due32(uint32_t now, uint32_t t)
+{   return (int32_t)(now - t) >= 0;   }
+
+/* Vuelta del contador de 32 bits */
+void __attribute__((interrupt, auto_psv)) TB_ISR(void)
+{
+    uint16_t ipl = SRbits.IPL;
+    SRbits.IPL = 7;
+    g_tb_hi++;
+    TB_IF = 0;
+    SRbits.IPL = ipl;
+}
+
+#endif  /* TIMEBASE_H */
@@ -0,0 +1,206 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21  (enlazar con -Wl,--stack=320)
+ *  Demo:  búferes declarados en la arena estática (ram_arena.h)
+ *
+ *  – Toda la RAM grande del ejemplo está en ram_layout.h, una lista
+ *    por módulo con alineación y espacio X/Y; si no cabe junto con la
+ *    reserva de pila, no compila. host/ram_budget.c imprime la tabla.
+ *  – adc:  Timer3 dispara el ADC a ADC_FS_HZ sobre AN0; la ISR llena
+ *          RAM(adc, blk) en dos mitades ping-pong (memoria Y).
+ *  – filt: el lazo principal pasa cada mitad por una media móvil de
+ *          FILT_TAPS muestras con historia circular en RAM(filt, hist)
+ *          (memoria X, alineada a su tamaño: lista para XMODSRT) y
+ *          diezma ×OUT_DECIM en RAM(filt, out).
+ *  – uart: cada bloque diezmado sale comprimido con adc_pack.h por
+ *          UART2 desde el anillo RAM(uart, tx).
+ *  – Medidas (ver con el depurador):
+ *      RAM_USED_X / _Y / _ANY, RAM_FREE   presupuesto (constantes)
+ *      g_blk_overruns, g_tx_drops         mitades / marcos perdidos
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "ram_layout.h"
+#include "../0060_uart/adc_pack.h"
+
+/* Muestreo: sólo AN0 */
+#define ADC_FS_HZ       8000UL
+#define PR3_COUNTS      ((FCY / ADC_FS_HZ) - 1)
+#define ADCS_TAD_COUNTS 9                          // TAD ≈ 170 ns
+
+/* UART2 */
+#define UART_BAUD       115200UL
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+
+#if ADC_BLK / OUT_DECIM != ADC_PACK_N
+#error "ADC_BLK / OUT_DECIM debe ser ADC_PACK_N"
+#endif
+#if (FILT_TAPS & (FILT_TAPS - 1)) != 0 || (TX_RING_LEN & (TX_RING_LEN - 1)) != 0
+#error "FILT_TAPS y TX_RING_LEN deben ser potencias de 2"
+#endif
+#if TX_RING_LEN < ADC_PACK_FRAME_MAX
+#error "TX_RING_LEN debe caber un marco"
+#endif
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static uint16_t          g_fill = 0;              // muestras en la mitad en curso
+static uint8_t           g_half = 0;              // mitad que llena la ISR
+static volatile uint8_t  g_ready = 0;             // 1 + mitad lista; 0 = ninguna
+static volatile uint16_t g_blk_overruns = 0;
+
+static uint16_t          g_hist_i = 0;
+static uint32_t          g_hist_sum = 0;
+static uint8_t           g_seq = 0;
+
+static uint16_t          g_tx_head = 0, g_tx_tail = 0;
+static uint16_t          g_tx_drops = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void adc_init_an0(void);
+static void uart2_init(void);
+static void filt_block(const uint16_t *x);
+static void tx_frame(const uint8_t *f, uint8_t len);
+static void tx_pump(void);
+
+/* ——————————————————— ADC: Timer3 sobre AN0 ———————————————— */
+static void adc_init_an0(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFGbits.PCFG0 = 0;
+
+    ADCON1 = 0;
+    ADCON1bits.FORM = 0;       // entero 0…1023
+    ADCON1bits.SSRC = 0b010;   // Timer3
+    ADCON1bits.ASAM = 1;
+
+    ADCON2 = 0;                // una interrupción por muestra
+    ADCON3bits.ADCS = ADCS_TAD_COUNTS;
+    ADCHS = 0;                 // CH0+ = AN0
+
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = PR3_COUNTS;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 5;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    T3CONbits.TON   = 1;
+}
+
+/* ——————————————————— UART2: 8N1, sólo TX ———————————————— */
+static void uart2_init(void)
+{
+    U2MODE = 0;
+    U2BRG  = (uint16_t)U2BRG_VAL;
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+}
+
+/* ——————————————————— ADC INTERRUPT ——————————————————— */
+/* Si el lazo no liberó la otra mitad, se sigue en la misma */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    IFS0bits.ADIF = 0;
+
+    RAM(adc, blk)[g_half * ADC_BLK + g_fill] = ADCBUF0;
+    if (++g_fill >= ADC_BLK) {
+        g_fill = 0;
+        if (g_ready == 0) {
+            g_ready = 1 + g_half;
+            g_half ^= 1;
+        } else {
+            g_blk_overruns++;
+        }
+    }
+}
+
+/* ——————————————————— FILT: media móvil + diezmado ——————————— */
+static void filt_block(const uint16_t *x)
+{
+    uint16_t *hist = RAM(filt, hist);
+    uint16_t *out  = RAM(filt, out);
+
+    for (uint16_t i = 0; i < ADC_BLK; i++) {
+        g_hist_sum += x[i];
+        g_hist_sum -= hist[g_hist_i];
+        hist[g_hist_i] = x[i];
+        g_hist_i = (g_hist_i + 1) & (FILT_TAPS - 1);
+
+        if ((i % OUT_DECIM) == OUT_DECIM - 1)
+            out[i / OUT_DECIM] = (uint16_t)(g_hist_sum / FILT_TAPS);
+    }
+}
+
+/* ——————————————————— UART2: marcos completos o nada ——————————— */
+static void tx_frame(const uint8_t *f, uint8_t len)
+{
+    uint8_t *ring = RAM(uart, tx);
+
+    if ((uint16_t)(TX_RING_LEN - (g_tx_head - g_tx_tail)) < len) {
+        g_tx_drops++;
+        return;
+    }
+    for (uint8_t i = 0; i < len; i++)
+        ring[(g_tx_head++) & (TX_RING_LEN - 1)] = f[i];
+}
+
+static void tx_pump(void)
+{
+    const uint8_t *ring = RAM(uart, tx);
+
+    while (g_tx_tail != g_tx_head && !U2STAbits.UTXBF)
+        U2TXREG = ring[(g_tx_tail++) & (TX_RING_LEN - 1)];
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    uint8_t frame[ADC_PACK_FRAME_MAX];
+
+    __builtin_disable_interrupts();
+
+    for (uint16_t i = 0; i < FILT_TAPS; i++)
+        RAM(filt, hist)[i] = 0;
+    uart2_init();
+    adc_init_an0();
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        uint8_t r = g_ready;
+        if (r) {
+            filt_block(&RAM(adc, blk)[(r - 1) * ADC_BLK]);
+            g_ready = 0;               // la mitad vuelve a la ISR
+
+            tx_frame(frame, adc_pack_block(frame, RAM(filt, out), 0, g_seq++));
+        }
+        tx_pump();
+    }
+    return 0;
+}
@@ -0,0 +1,290 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  marca de agua de la pila con ISR anidadas (stack_watch.h)
+ *
+ *  – Cuatro ISR con las prioridades de los ejemplos, todas con
+ *    STK_ISR_ENTER/EXIT:
+ *      T2   IPL 3  250 Hz  mediana de las últimas 9 muestras (arreglo
+ *                          local: la ISR de marco más grande)
+ *      T1   IPL 4  1 kHz   media de las muestras desde el tick anterior
+ *      U2RX IPL 5          'r' reinicia la marca, '?' pide el informe
+ *      ADC  IPL 6  8 kHz   AN0 disparado por Timer3
+ *  – stk_init() pinta la pila al arrancar; el lazo principal llama a
+ *    stk_poll() sin pausa y envía por UART2 una línea cuando la marca
+ *    sube, una vez por segundo o con '?':
+ *      pila 212/512 B (41%) por T2>T1>U2RX>ADC entrada 148
+ *  – Sin STK_WATCH los ganchos desaparecen del código (la marca sigue,
+ *    siempre atribuida al lazo).
+ *  – Medidas (ver con el depurador):
+ *      g_stk.isr_sp[], g_stk.isr_mask[]   entrada más profunda por ISR
+ *      g_hook_tcy                          costo de ENTER + EXIT
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#define STK_WATCH                                  // quitar: sin ganchos
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "stack_watch.h"
+
+/* ids en orden de prioridad creciente: el informe sale de afuera hacia adentro */
+enum { ID_T2, ID_T1, ID_U2RX, ID_ADC };
+static const char *const k_isr_names[] = { "T2", "T1", "U2RX", "ADC" };
+
+#define ADC_FS_HZ       8000UL
+#define PR3_COUNTS      ((FCY / ADC_FS_HZ) - 1)
+#define ADCS_TAD_COUNTS 9
+#define PR1_COUNTS      ((FCY / 1000UL) - 1)       // 1 kHz
+#define PR2_COUNTS      ((FCY / 8UL / 250UL) - 1)  // 250 Hz con 1:8
+
+#define UART_BAUD       115200UL
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+#define TX_RING_LEN     128U                       // potencia de 2
+
+#define HIST_LEN        16U                        // potencia de 2
+#define MED_N           9U
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static volatile uint16_t g_hist[HIST_LEN];
+static volatile uint16_t g_hist_i = 0;
+static volatile uint32_t g_acc = 0;
+static volatile uint16_t g_acc_n = 0;
+static volatile uint16_t g_mean = 0, g_median = 0;
+static volatile uint16_t g_ticks = 0;              // T2, 250 Hz
+static volatile uint8_t  g_cmd_report = 0, g_cmd_reset = 0;
+
+static uint8_t           g_tx_ring[TX_RING_LEN];
+static uint16_t          g_tx_head = 0, g_tx_tail = 0;
+static uint16_t          g_hook_tcy = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timers_init(void);
+static void adc_init_an0(void);
+static void uart2_init(void);
+static void hook_cost(void);
+static void tx_line(const char *s, uint8_t len);
+static void tx_pump(void);
+
+/* ——————————————————— TIMERS: T1 1 kHz, T2 250 Hz ——————————— */
+static void timers_init(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = PR1_COUNTS;
+    IFS0bits.T1IF = 0;
+    IPC0bits.T1IP = 4;
+    IEC0bits.T1IE = 1;
+    T1CONbits.TON = 1;
+
+    T2CON = 0;
+    TMR2  = 0;
+    PR2   = PR2_COUNTS;
+    T2CONbits.TCKPS = 1;       // 1:8
+    IFS0bits.T2IF = 0;
+    IPC1bits.T2IP = 3;
+    IEC0bits.T2IE = 1;
+    T2CONbits.TON = 1;
+}
+
+/* ——————————————————— ADC: Timer3 sobre AN0 ———————————————— */
+static void adc_init_an0(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFGbits.PCFG0 = 0;
+
+    ADCON1 = 0;
+    ADCON1bits.FORM = 0;       // entero 0…1023
+    ADCON1bits.SSRC = 0b010;   // Timer3
+    ADCON1bits.ASAM = 1;
+
+    ADCON2 = 0;
+    ADCON3bits.ADCS = ADCS_TAD_COUNTS;
+    ADCHS = 0;
+
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = PR3_COUNTS;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 6;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    T3CONbits.TON   = 1;
+}
+
+/* ——————————————————— UART2: 8N1, TX y RX ———————————————— */
+static void uart2_init(void)
+{
+    U2MODE = 0;
+    U2BRG  = (uint16_t)U2BRG_VAL;
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+
+    IFS1bits.U2RXIF = 0;
+    IPC6bits.U2RXIP = 5;
+    IEC1bits.U2RXIE = 1;
+}
+
+/* ——————————————————— ISR ——————————————————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    STK_ISR_ENTER(ID_ADC);
+    IFS0bits.ADIF = 0;
+
+    uint16_t x = ADCBUF0;
+    g_hist[g_hist_i] = x;
+    g_hist_i = (g_hist_i + 1) & (HIST_LEN - 1);
+    g_acc += x;
+    g_acc_n++;
+    STK_ISR_EXIT();
+}
+
+void __attribute__((interrupt, auto_psv)) _U2RXInterrupt(void)
+{
+    STK_ISR_ENTER(ID_U2RX);
+    IFS1bits.U2RXIF = 0;
+
+    while (U2STAbits.URXDA) {
+        uint8_t c = (uint8_t)U2RXREG;
+        if (c == 'r')      g_cmd_reset = 1;
+        else if (c == '?') g_cmd_report = 1;
+    }
+    if (U2STAbits.OERR) U2STAbits.OERR = 0;
+    STK_ISR_EXIT();
+}
+
+void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
+{
+    STK_ISR_ENTER(ID_T1);
+    IFS0bits.T1IF = 0;
+
+    uint32_t acc;
+    uint16_t n;
+    __builtin_disable_interrupts();
+    acc = g_acc;  g_acc = 0;
+    n   = g_acc_n; g_acc_n = 0;
+    __builtin_enable_interrupts();
+    if (n) g_mean = (uint16_t)(acc / n);
+    STK_ISR_EXIT();
+}
+
+/* Mediana por inserción sobre una copia local: MED_N palabras de pila */
+void __attribute__((interrupt, auto_psv)) _T2Interrupt(void)
+{
+    STK_ISR_ENTER(ID_T2);
+    IFS0bits.T2IF = 0;
+
+    uint16_t w[MED_N];
+    uint16_t j0 = g_hist_i;
+    for (uint8_t i = 0; i < MED_N; i++) {
+        uint16_t v = g_hist[(j0 - 1 - i) & (HIST_LEN - 1)];
+        uint8_t  k = i;
+        while (k && w[k - 1] > v) { w[k] = w[k - 1]; k--; }
+        w[k] = v;
+    }
+    g_median = w[MED_N / 2];
+    g_ticks++;
+    STK_ISR_EXIT();
+}
+
+/* ——————————————————— COSTO DE LOS GANCHOS ——————————————— */
+/* Después de stk_init(), con IRQ deshabilitadas; TMR1 libre a TCY
+   antes de timers_init() */
+static void hook_cost(void)
+{
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = 0xFFFF;
+    T1CONbits.TON = 1;
+
+    uint16_t t0 = TMR1;
+    {
+        STK_ISR_ENTER(STK_IDS - 1);
+        STK_ISR_EXIT();
+    }
+    uint16_t t1 = TMR1;
+    uint16_t t2 = TMR1;
+    g_hook_tcy = (uint16_t)((t1 - t0) - (t2 - t1));
+    /* la medición no cuenta como ISR: ni su entrada ni su reclamación */
+    g_stk.isr_sp[STK_IDS - 1] = g_stk.isr_mask[STK_IDS - 1] = 0;
+    g_stk.claimed = 0;
+    T1CON = 0;
+}
+
+/* ——————————————————— UART2: líneas completas o nada ——————————— */
+static void tx_line(const char *s, uint8_t len)
+{
+    if ((uint16_t)(TX_RING_LEN - (g_tx_head - g_tx_tail)) < len) return;
+    for (uint8_t i = 0; i < len; i++)
+        g_tx_ring[(g_tx_head++) & (TX_RING_LEN - 1)] = (uint8_t)s[i];
+}
+
+static void tx_pump(void)
+{
+    while (g_tx_tail != g_tx_head && !U2STAbits.UTXBF)
+        U2TXREG = g_tx_ring[(g_tx_tail++) & (TX_RING_LEN - 1)];
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    char     line[64];
+    uint16_t last_tick = 0;
+
+    __builtin_disable_interrupts();
+
+    stk_init();
+    hook_cost();
+    uart2_init();
+    adc_init_an0();
+    timers_init();
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        uint8_t send = stk_poll();
+
+        if (g_cmd_reset) {
+            g_cmd_reset = 0;
+            __builtin_disable_interrupts();
+            stk_init();
+            __builtin_enable_interrupts();
+            send = 1;
+        }
+        if (g_cmd_report) {
+            g_cmd_report = 0;
+            send = 1;
+        }
+        if ((uint16_t)(g_ticks - last_tick) >= 250U) {
+            last_tick += 250U;
+            send = 1;
+        }
+        if (send)
+            tx_line(line, stk_format(line, k_isr_names));
+        tx_pump();
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*************************************************************
+ *  ram_budget – tabla de RAM por búfer y por módulo en PC
+ *
+ *  cc -O2 -Wall -I.. -o ram_budget ram_budget.c
+ *  cc -O2 -Wall -I<carpeta con ram_layout.h> -I.. ...  otra aplicación
+ *
+ *  – Compila el mismo ram_layout.h que el firmware con RAM_HOST: los
+ *    _Static_assert de ram_arena.h detienen también esta compilación
+ *    si el mapa no cabe.
+ *  – Imprime cada búfer (espacio, bytes, alineación, huella), los
+ *    totales por módulo y por espacio contra X, Y, la reserva de pila
+ *    y la de otras globales, y lo que queda libre.
+ *  – Código de salida 1 si lo libre es menos de RAM_MARGIN_PCT % de
+ *    la RAM (por defecto 5): margen para el crecimiento siguiente.
+ *************************************************************/
+#define RAM_HOST
+#include "ram_layout.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef RAM_MARGIN_PCT
+#define RAM_MARGIN_PCT  5U
+#endif
+
+#define MAX_MODS        32
+
+static const char *const k_sp[] = { "X", "Y", "-" };
+
+typedef struct {
+    const char *mod;
+    unsigned    foot[3];
+} mod_sum_t;
+
+int main(void)
+{
+    mod_sum_t mods[MAX_MODS];
+    unsigned  nmods = 0;
+
+    printf("módulo     búfer      esp   bytes  alin  huella\n");
+    for (unsigned i = 0; i < RAM_TABLE_LEN; i++) {
+        const ram_entry_t *e = &g_ram_table[i];
+        printf("%-10s %-10s %3s %7u %5u %7u\n", e->mod, e->name, k_sp[e->sp],
+               e->bytes, e->align, e->foot);
+
+        unsigned m = 0;
+        while (m < nmods && strcmp(mods[m].mod, e->mod) != 0) m++;
+        if (m == nmods) {
+            if (nmods == MAX_MODS) continue;
+            memset(&mods[m], 0, sizeof mods[m]);
+            mods[m].mod = e->mod;
+            nmods++;
+        }
+        mods[m].foot[e->sp] += e->foot;
+    }
+
+    printf("\nmódulo           X       Y       -   total   %%RAM\n");
+    for (unsigned m = 0; m < nmods; m++) {
+        unsigned t = mods[m].foot[0] + mods[m].foot[1] + mods[m].foot[2];
+        printf("%-10s %7u %7u %7u %7u %5.1f%%\n", mods[m].mod,
+               mods[m].foot[0], mods[m].foot[1], mods[m].foot[2], t,
+               100.0 * t / RAM_DEVICE_BYTES);
+    }
+
+    printf("\nmemoria X        %5u / %u\n", (unsigned)RAM_USED_X, RAM_X_BYTES);
+    printf("memoria Y        %5u / %u\n", (unsigned)RAM_USED_Y, RAM_Y_BYTES);
+    printf("sin ubicación    %5u\n", (unsigned)RAM_USED_ANY);
+    printf("otras globales   %5u (reserva)\n", RAM_OTHER_RESERVE);
+    printf("pila             %5u (reserva)\n", RAM_STACK_RESERVE);
+    printf("libre            %5d / %u (%.1f%%)\n", (int)RAM_FREE, RAM_DEVICE_BYTES,
+           100.0 * (int)RAM_FREE / RAM_DEVICE_BYTES);
+
+    if ((unsigned)RAM_FREE * 100U < RAM_MARGIN_PCT * RAM_DEVICE_BYTES) {
+        printf("AVISO: menos de %u%% libre\n", RAM_MARGIN_PCT);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,282 @@
+/*************************************************************
+ *  stack_bench – pintado, recorrido y atribución de stack_watch.h en PC
+ *
+ *  cc -O2 -Wall -I.. -o stack_bench stack_bench.c
+ *
+ *  La pila es un arreglo con palabras de guarda a los dos lados; W15
+ *  es una variable (STK_SP()). Cada caso imprime sus cifras y
+ *  PASS/FAIL; el código de salida es el número de fallas.
+ *
+ *    1 pintar     – sólo [paint, lim) queda en STK_PAINT; la base y
+ *                   las guardas no se tocan
+ *    2 recorrer   – profundidades al azar con datos al azar: la marca
+ *                   es la palabra escrita más alta; con las k palabras
+ *                   de arriba iguales a STK_PAINT queda k abajo (el
+ *                   caso documentado); marca monótona entre recorridos
+ *    3 anidar     – ISR de prioridad 3…6 (T2, T1, U2RX, ADC) que se
+ *                   anidan al azar sobre el lazo, con marcos de tamaño
+ *                   al azar, con más pila de la de afuera después de
+ *                   que vuelven las anidadas: máscara consistente tras
+ *                   cada salida, marca exacta, entrada más profunda por
+ *                   ISR exacta; la combinación atribuida es siempre la
+ *                   causante salvo cuando el lazo deja pila escrita sin
+ *                   recorrer antes de la ISR siguiente (se informa el
+ *                   porcentaje)
+ *    4 informe    – stk_format() de un estado conocido
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define STK_HOST
+static uint16_t g_sim_sp;
+#define STK_SP()        g_sim_sp
+#define STK_WATCH
+#include "stack_watch.h"
+
+#define WORDS           320U            // 640 B como RAM_STACK_RESERVE
+#define GUARD           16U
+#define GUARD_VAL       0x1234U
+#define SP0             0x0A00U         // W15 numérico de la base
+#define NISR            4U
+
+static uint16_t g_mem[GUARD + WORDS + GUARD];
+static uint16_t *const g_base = &g_mem[GUARD];
+static uint16_t *const g_lim  = &g_mem[GUARD + WORDS];
+
+static const char *const k_names[STK_IDS] = { "T2", "T1", "U2RX", "ADC" };
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static uint16_t rnd16(void)              { return (uint16_t)(rand() ^ (rand() << 8)); }
+static unsigned rndn(unsigned n)         { return (unsigned)rand() % n; }
+
+/* dato de pila al azar distinto de la pintura */
+static uint16_t data16(void)
+{
+    uint16_t v;
+    do v = rnd16(); while (v == STK_PAINT);
+    return v;
+}
+
+static void reset_mem(unsigned paint_from)
+{
+    for (unsigned i = 0; i < GUARD + WORDS + GUARD; i++) g_mem[i] = GUARD_VAL;
+    stk_init_range(g_base, g_base + paint_from, g_lim, SP0);
+}
+
+static int guards_ok(void)
+{
+    for (unsigned i = 0; i < GUARD; i++)
+        if (g_mem[i] != GUARD_VAL || g_mem[GUARD + WORDS + i] != GUARD_VAL) return 0;
+    return 1;
+}
+
+/* ——————————————————— 1: pintar ——————————————————— */
+static void case_paint(void)
+{
+    printf("1 pintar\n");
+    int ok = 1;
+    for (unsigned from = 0; from < WORDS; from += 7) {
+        reset_mem(from);
+        for (unsigned i = 0; i < WORDS; i++)
+            if ((g_base[i] == STK_PAINT) != (i >= from)) ok = 0;
+        if (!guards_ok() || stk_scan_range(g_stk.paint, g_lim) != g_stk.paint) ok = 0;
+    }
+    check("sólo [paint, lim) pintado, guardas intactas", ok);
+    check("recorrido de pila recién pintada = inicio", ok);
+}
+
+/* ——————————————————— 2: recorrer ——————————————————— */
+static void case_scan(void)
+{
+    printf("2 recorrer\n");
+    int exact = 1, topk = 1, mono = 1;
+
+    for (unsigned t = 0; t < 20000; t++) {
+        unsigned from = 4 + rndn(16), d = from + rndn(WORDS - from + 1);
+        reset_mem(from);
+        for (unsigned i = from; i < d; i++) g_base[i] = data16();
+        if (stk_scan_range(g_stk.paint, g_lim) != g_base + d) exact = 0;
+
+        /* las k palabras más altas escritas con el valor de la pintura */
+        unsigned k = 1 + rndn(4);
+        if (d >= from + k) {
+            for (unsigned i = d - k; i < d; i++) g_base[i] = STK_PAINT;
+            if (stk_scan_range(g_stk.paint, g_lim) != g_base + d - k) topk = 0;
+        }
+    }
+    check("marca = palabra escrita más alta + 1 (20000 casos)", exact);
+    check("k palabras altas = pintura: marca k abajo", topk);
+
+    reset_mem(8);
+    unsigned peak = 8;
+    for (unsigned t = 0; t < 2000; t++) {
+        unsigned d = 8 + rndn(WORDS - 8 + 1);
+        for (unsigned i = 8; i < d; i++) g_base[i] = data16();
+        if (d > peak) peak = d;
+        uint16_t *before = g_stk.hw;
+        stk_poll();
+        if (g_stk.hw < before || g_stk.hw != g_base + peak) mono = 0;
+    }
+    check("stk_poll(): marca monótona = máximo histórico", mono);
+}
+
+/* ——————————————————— 3: anidar ——————————————————— */
+typedef struct {
+    unsigned    id, start;              // palabras
+    unsigned    pre, post;              // usado al entrar / antes de salir
+    stk_frame_t f;                      // retorno de stk_isr_enter()
+} sim_isr_t;
+
+typedef struct {
+    unsigned polls_up, attr_ok;
+    int      mask_ok, hw_ok, isr_ok;
+} sim_res_t;
+
+/* chain: una sola cadena de anidamiento por ventana (todo vuelve al
+   lazo y se recorre antes de la siguiente); loop: el lazo también usa
+   pila más o menos profunda entre recorridos */
+static sim_res_t simulate(int chain, int loop, unsigned steps)
+{
+    sim_isr_t act[NISR];
+    unsigned  nact = 0, main_depth = 12, peak = main_depth;
+    uint16_t  exp_sp[NISR] = { 0 }, exp_mask[NISR] = { 0 };
+    uint16_t  win_cause = 0;            // máscara que escribió la palabra más alta de la ventana
+    unsigned  win_peak = 0;
+    sim_res_t r = { 0, 0, 1, 1, 1 };
+
+    reset_mem(main_depth);
+    for (unsigned i = 0; i < main_depth; i++) g_base[i] = data16();
+
+    for (unsigned s = 0; s < steps; s++) {
+        unsigned top  = nact ? act[nact - 1].id + 1 : 0;
+        unsigned sp_w = nact ? act[nact - 1].start + act[nact - 1].pre : main_depth;
+        unsigned ev   = rndn(8);
+
+        if (ev < 4 && top < NISR) {
+            /* entra una ISR de mayor prioridad que la activa */
+            sim_isr_t *a = &act[nact];
+            a->id    = top + rndn(NISR - top);
+            a->start = sp_w;
+            a->pre   = 4 + rndn(12 + 8 * a->id);
+            a->post  = rndn(24);
+            if (a->start + a->pre + a->post > WORDS) continue;
+            unsigned prolog = 2 + rndn(a->pre - 1);        // W15 al pasar el gancho
+            g_sim_sp = (uint16_t)(SP0 + 2U * (a->start + prolog));
+            a->f = stk_isr_enter((uint8_t)a->id);
+            nact++;
+            for (unsigned i = a->start; i < a->start + a->pre; i++) g_base[i] = data16();
+
+            uint16_t m = 0;
+            for (unsigned i = 0; i < nact; i++) m |= (uint16_t)(1U << act[i].id);
+            if (g_stk.mask != m) r.mask_ok = 0;
+            if (g_sim_sp > exp_sp[a->id]) { exp_sp[a->id] = g_sim_sp; exp_mask[a->id] = m; }
+            if (a->start + a->pre > win_peak) { win_peak = a->start + a->pre; win_cause = m; }
+        } else if (ev < 7 && nact) {
+            /* sale la activa; en modo cadena salen todas */
+            do {
+                sim_isr_t *a = &act[nact - 1];
+                /* más pila después de que volvieron las anidadas */
+                unsigned top_w = a->start + a->pre + a->post;
+                for (unsigned i = a->start + a->pre; i < top_w; i++) g_base[i] = data16();
+                if (top_w > win_peak) { win_peak = top_w; win_cause = g_stk.mask; }
+                nact--;
+                stk_isr_exit(a->f);                 // STK_ISR_EXIT()
+                uint16_t m = 0;
+                for (unsigned i = 0; i < nact; i++) m |= (uint16_t)(1U << act[i].id);
+                if (g_stk.mask != m) r.mask_ok = 0;
+            } while (chain && nact);
+        } else if (!nact && loop) {
+            /* el lazo llama algo más o menos profundo */
+            unsigned d = 12 + rndn(WORDS / 2);
+            for (unsigned i = 12; i < d; i++) g_base[i] = data16();
+            if (d > win_peak) { win_peak = d; win_cause = 0; }
+        }
+        /* recorrido: sólo desde el lazo; en modo cadena cada vez */
+        if (nact != 0 || (!chain && rndn(4) != 0)) continue;
+        {
+            if (win_peak > peak) peak = win_peak;
+            int up = stk_poll();
+            if (up) {
+                r.polls_up++;
+                if (g_stk.hw_mask == win_cause) r.attr_ok++;
+            }
+            if (g_stk.hw != g_base + peak) r.hw_ok = 0;
+            win_peak = 0;
+            win_cause = 0;
+        }
+    }
+    while (nact) stk_isr_exit(act[--nact].f);
+    if (g_stk.mask != 0) r.mask_ok = 0;
+    for (unsigned i = 0; i < NISR; i++)
+        if (g_stk.isr_sp[i] != exp_sp[i] || g_stk.isr_mask[i] != exp_mask[i]) r.isr_ok = 0;
+    return r;
+}
+
+static void case_nest(void)
+{
+    printf("3 anidar\n");
+    static const struct { int chain, loop; const char *name; } k_mode[] = {
+        { 1, 1, "cadena + lazo" }, { 0, 0, "anidado al azar" }, { 0, 1, "al azar + lazo" },
+    };
+    for (unsigned k = 0; k < 3; k++) {
+        sim_res_t t = { 0, 0, 1, 1, 1 };
+        for (unsigned run = 0; run < 2000; run++) {
+            sim_res_t r = simulate(k_mode[k].chain, k_mode[k].loop, 400);
+            t.polls_up += r.polls_up;
+            t.attr_ok  += r.attr_ok;
+            t.mask_ok  &= r.mask_ok;
+            t.hw_ok    &= r.hw_ok;
+            t.isr_ok   &= r.isr_ok;
+        }
+        printf("    %s: 2000 corridas, %u subidas de la marca, %.1f %% atribuidas a la causante\n",
+               k_mode[k].name, t.polls_up, t.polls_up ? 100.0 * t.attr_ok / t.polls_up : 0.0);
+        check("máscara tras cada salida y al final", t.mask_ok);
+        check("marca = palabra más alta escrita", t.hw_ok);
+        check("entrada más profunda por ISR y su máscara", t.isr_ok);
+        /* con pila del lazo sin recorrer, la ISR siguiente se la lleva */
+        if (!(k_mode[k].loop && !k_mode[k].chain))
+            check("combinación atribuida = causante, siempre",
+                  t.polls_up > 1000 && t.attr_ok == t.polls_up);
+    }
+}
+
+/* ——————————————————— 4: informe ——————————————————— */
+static void case_format(void)
+{
+    printf("4 informe\n");
+    char buf[80];
+    reset_mem(8);
+    g_stk.hw       = g_base + 159;
+    g_stk.hw_mask  = (1U << 0) | (1U << 1) | (1U << 3);
+    g_stk.hw_entry = SP0 + 212;
+    uint8_t n = stk_format(buf, k_names);
+    buf[n] = 0;
+    printf("    %s", buf);
+    check("texto con marca, porcentaje y combinación",
+          strcmp(buf, "pila 318/640 B (49%) por T2>T1>ADC entrada 212\r\n") == 0);
+
+    g_stk.hw_mask = 0;
+    n = stk_format(buf, k_names);
+    buf[n] = 0;
+    check("máscara 0 = lazo principal", strcmp(buf, "pila 318/640 B (49%) por lazo\r\n") == 0);
+}
+
+int main(void)
+{
+    srand(1);
+    case_paint();
+    case_scan();
+    case_nest();
+    case_format();
+    printf("%d falla(s)\n", g_fail);
+    return g_fail;
+}
@@ -0,0 +1,138 @@
+/*************************************************************
+ *  Arena estática de RAM con presupuesto en compilación – header-only
+ *
+ *  El dsPIC30F4011 tiene 2 KB: X 0x0800…0x0BFF y Y 0x0C00…0x0FFF.
+ *  Cada módulo declara sus búferes en una lista X-macro y la
+ *  aplicación junta las listas en RAM_LAYOUT(X) antes de incluir este
+ *  archivo:
+ *
+ *    #define ADC_RAM(X)  X(adc, blk, uint16_t, 256, 2, RAM_Y)
+ *    #define RAM_LAYOUT(X)  ADC_RAM(X) FILT_RAM(X) ...
+ *
+ *    X(módulo, nombre, tipo, cantidad, alineación en bytes, espacio)
+ *    espacio: RAM_X (space(xmemory)), RAM_Y (space(ymemory)) o
+ *             RAM_ANY (donde lo ponga el enlazador)
+ *
+ *  – Cada entrada es un arreglo estático ram_<módulo>_<nombre>
+ *    (RAM(módulo, nombre)): el enlazador lo ubica, no hay puntero de
+ *    arena ni costo en tiempo de ejecución.
+ *  – La huella de cada búfer es su tamaño par más el peor relleno de
+ *    alineación (alin − 2). RAM_USED_X / _Y / _ANY y RAM_USED son
+ *    constantes; la compilación falla si X o Y no alcanzan, o si lo
+ *    usado + RAM_OTHER_RESERVE + RAM_STACK_RESERVE pasa de los 2 KB.
+ *  – RAM_OTHER_RESERVE cubre las globales que no están en la arena
+ *    (contadores, estado de los .h) y el runtime de C. Enlazar con
+ *    -Wl,--stack=RAM_STACK_RESERVE para que el enlazador verifique
+ *    lo mismo sobre el mapa real.
+ *  – Un búfer para direccionamiento modular (XMODSRT/YMODSRT) pide
+ *    alineación a la potencia de 2 ≥ su tamaño.
+ *  – host/ram_budget.c compila la misma lista en el PC (RAM_HOST: sólo
+ *    constantes y tabla, sin los arreglos) e imprime la tabla por
+ *    búfer y por módulo.
+ *
+ *  Los tokens RAM_X, RAM_Y y RAM_ANY no deben definirse como macros.
+ *************************************************************/
+#ifndef RAM_ARENA_H
+#define RAM_ARENA_H
+
+#ifndef RAM_HOST
+#include <xc.h>
+#endif
+#include <stdint.h>
+
+#ifndef RAM_LAYOUT
+#error "Definir RAM_LAYOUT(X) antes de incluir ram_arena.h"
+#endif
+
+/* ——————————————————— LÍMITES ——————————————————— */
+#ifndef RAM_X_BYTES
+#define RAM_X_BYTES         1024U
+#endif
+#ifndef RAM_Y_BYTES
+#define RAM_Y_BYTES         1024U
+#endif
+#define RAM_DEVICE_BYTES    (RAM_X_BYTES + RAM_Y_BYTES)
+
+#ifndef RAM_STACK_RESERVE
+#define RAM_STACK_RESERVE   256U        // pila: lazo + ISR anidadas
+#endif
+#ifndef RAM_OTHER_RESERVE
+#define RAM_OTHER_RESERVE   128U        // globales fuera de la arena
+#endif
+
+/* ——————————————————— ESPACIOS ——————————————————— */
+#ifdef RAM_HOST
+#define RAM_ATTR_RAM_X
+#define RAM_ATTR_RAM_Y
+#else
+#define RAM_ATTR_RAM_X      __attribute__((space(xmemory)))
+#define RAM_ATTR_RAM_Y      __attribute__((space(ymemory)))
+#endif
+#define RAM_ATTR_RAM_ANY
+
+#define RAM_IN_X_RAM_X      1
+#define RAM_IN_X_RAM_Y      0
+#define RAM_IN_X_RAM_ANY    0
+#define RAM_IN_Y_RAM_X      0
+#define RAM_IN_Y_RAM_Y      1
+#define RAM_IN_Y_RAM_ANY    0
+#define RAM_IN_A_RAM_X      0
+#define RAM_IN_A_RAM_Y      0
+#define RAM_IN_A_RAM_ANY    1
+
+#define RAM_SP_RAM_X        0U
+#define RAM_SP_RAM_Y        1U
+#define RAM_SP_RAM_ANY      2U
+
+/* bytes ocupados en el peor caso: tamaño par + relleno de alineación */
+#define RAM_BYTES(type, n)      ((uint16_t)(sizeof(type) * (n)))
+#define RAM_FOOT(type, n, al)   (((RAM_BYTES(type, n) + 1U) & ~1U) + ((al) > 2U ? (al) - 2U : 0U))
+
+#define RAM(mod, name)          ram_##mod##_##name
+
+/* ——————————————————— DECLARACIONES ——————————————————— */
+#define RAM_DECL(mod, name, type, n, al, sp) \
+    static type RAM(mod, name)[n] __attribute__((aligned(al))) RAM_ATTR_##sp;
+#define RAM_CHECK(mod, name, type, n, al, sp) \
+    _Static_assert((al) >= 2U && ((al) & ((al) - 1U)) == 0U, \
+                   "ram_arena: " #mod "." #name ": alin debe ser potencia de 2 >= 2");
+
+RAM_LAYOUT(RAM_CHECK)
+#ifndef RAM_HOST
+RAM_LAYOUT(RAM_DECL)
+#endif
+
+/* ——————————————————— PRESUPUESTO ——————————————————— */
+#define RAM_SUM_X(mod, name, type, n, al, sp)   + RAM_IN_X_##sp * RAM_FOOT(type, n, al)
+#define RAM_SUM_Y(mod, name, type, n, al, sp)   + RAM_IN_Y_##sp * RAM_FOOT(type, n, al)
+#define RAM_SUM_A(mod, name, type, n, al, sp)   + RAM_IN_A_##sp * RAM_FOOT(type, n, al)
+
+enum {
+    RAM_USED_X   = 0 RAM_LAYOUT(RAM_SUM_X),
+    RAM_USED_Y   = 0 RAM_LAYOUT(RAM_SUM_Y),
+    RAM_USED_ANY = 0 RAM_LAYOUT(RAM_SUM_A),
+    RAM_USED     = RAM_USED_X + RAM_USED_Y + RAM_USED_ANY,
+    RAM_FREE     = (int32_t)RAM_DEVICE_BYTES - (int32_t)RAM_USED
+                 - (int32_t)RAM_OTHER_RESERVE - (int32_t)RAM_STACK_RESERVE
+};
+
+_Static_assert(RAM_USED_X <= RAM_X_BYTES, "ram_arena: RAM_X excede la memoria X");
+_Static_assert(RAM_USED_Y <= RAM_Y_BYTES, "ram_arena: RAM_Y excede la memoria Y");
+_Static_assert(RAM_FREE >= 0, "ram_arena: arena + RAM_OTHER_RESERVE + RAM_STACK_RESERVE excede la RAM");
+
+/* ——————————————————— TABLA (PC o depuración) ——————————————————— */
+#if defined(RAM_HOST) || defined(RAM_TABLE)
+typedef struct {
+    const char *mod, *name;
+    uint8_t     sp;                     // RAM_SP_*
+    uint16_t    bytes, align, foot;
+} ram_entry_t;
+
+#define RAM_ROW(mod, name, type, n, al, sp) \
+    { #mod, #name, RAM_SP_##sp, RAM_BYTES(type, n), (al), RAM_FOOT(type, n, al) },
+
+static const ram_entry_t g_ram_table[] = { RAM_LAYOUT(RAM_ROW) };
+#define RAM_TABLE_LEN   (sizeof g_ram_table / sizeof g_ram_table[0])
+#endif
+
+#endif  /* RAM_ARENA_H */
@@ -0,0 +1,36 @@
+/*************************************************************
+ *  Mapa de RAM de 10_ram_arena_demo.c – una lista por módulo
+ *
+ *  Lo incluyen el firmware y host/ram_budget.c (con RAM_HOST); sólo
+ *  tipos de <stdint.h>, así los tamaños son iguales en los dos.
+ *
+ *  Prueba del presupuesto: ADC_BLK = 512 pide 2 KB de Y y la
+ *  compilación se detiene en el _Static_assert de la memoria Y.
+ *************************************************************/
+#ifndef RAM_LAYOUT_H
+#define RAM_LAYOUT_H
+
+#include <stdint.h>
+
+#define ADC_BLK         128U            // muestras por bloque (ping-pong ×2)
+#define FILT_TAPS       16U             // media móvil, potencia de 2
+#define OUT_DECIM       (ADC_BLK / 32U) // 32 muestras por marco adc_pack
+#define TX_RING_LEN     256U            // potencia de 2
+
+#define RAM_STACK_RESERVE   320U
+#define RAM_OTHER_RESERVE   96U
+
+/* X(módulo, nombre, tipo, cantidad, alineación, espacio) */
+#define ADC_RAM(X) \
+    X(adc,  blk,  uint16_t, 2U * ADC_BLK, 2,                   RAM_Y)
+#define FILT_RAM(X) \
+    X(filt, hist, uint16_t, FILT_TAPS,    2U * FILT_TAPS,      RAM_X) \
+    X(filt, out,  uint16_t, ADC_BLK / OUT_DECIM, 2,            RAM_ANY)
+#define UART_RAM(X) \
+    X(uart, tx,   uint8_t,  TX_RING_LEN,  2,                   RAM_ANY)
+
+#define RAM_LAYOUT(X)   ADC_RAM(X) FILT_RAM(X) UART_RAM(X)
+
+#include "ram_arena.h"
+
+#endif  /* RAM_LAYOUT_H */
@@ -0,0 +1,251 @@
+/*************************************************************
+ *  Marca de agua de la pila con atribución a ISR anidadas – header-only
+ *
+ *  – stk_init() pinta con STK_PAINT la pila libre, desde unas
+ *    palabras sobre W15 hasta SPLIM (la pila del dsPIC crece hacia
+ *    arriba desde __SP_init). Llamarla al principio de main() con
+ *    las interrupciones deshabilitadas.
+ *  – stk_poll(), desde el lazo principal, recorre la zona pintada de
+ *    arriba hacia abajo hasta la primera palabra escrita: la marca
+ *    nunca queda por debajo de lo usado, salvo que justo las palabras
+ *    más altas se hayan escrito con STK_PAINT.
+ *  – Ganchos: cada ISR abre con STK_ISR_ENTER(id) y cierra con
+ *    STK_ISR_EXIT(). La entrada mantiene la máscara de ISR activas
+ *    (id 0…15) y la entrada más profunda (W15 y máscara) de cada id.
+ *    La salida compara una sola palabra, la sonda justo sobre la
+ *    marca: si ya no está pintada, esta ISR (o una anidada sin
+ *    ganchos) pasó la marca; la reclama con la máscara activa y su W15
+ *    de entrada y sube la sonda por lo recién escrito (cada palabra se
+ *    recorre una vez en toda la vida). La primera en salir es la más
+ *    interna, así que la combinación queda exacta aunque la ISR de
+ *    afuera siga usando pila después.
+ *  – stk_poll() toma la última reclamación; si la marca subió sin
+ *    reclamación la causa es el lazo principal (máscara 0). Lo que el
+ *    lazo deja escrito por encima de la sonda se atribuye a la ISR que
+ *    salga antes del siguiente stk_poll(): llamarlo seguido.
+ *  – Costo: unas pocas cargas y comparaciones por gancho, sin bucles
+ *    salvo al reclamar (medido en g_hook_tcy de 20_stack_watch_demo.c).
+ *  – Sin STK_WATCH definido los ganchos desaparecen; pintar y recorrer
+ *    siguen disponibles.
+ *  – stk_format() arma una línea de texto para la UART sin printf
+ *    (que por sí sola usa cientos de bytes de pila).
+ *
+ *  STK_HOST: sin registros; el banco de PC define STK_SP() y usa
+ *  stk_init_range() sobre un arreglo.
+ *************************************************************/
+#ifndef STACK_WATCH_H
+#define STACK_WATCH_H
+
+#ifndef STK_HOST
+#include <xc.h>
+#endif
+#include <stdint.h>
+
+#define STK_PAINT       0x5AA5U
+#define STK_IDS         16U
+#define STK_GAP_WORDS   8U              // sin pintar sobre W15 en stk_init()
+
+#ifndef STK_HOST
+#define STK_SP()        WREG15
+#define STK_LOCK(s)     do { (s) = SRbits.IPL; SRbits.IPL = 7; } while (0)
+#define STK_UNLOCK(s)   do { SRbits.IPL = (s); } while (0)
+extern uint16_t _SP_init;               // __SP_init del enlazador
+#else
+#define STK_LOCK(s)     do { (void)(s); } while (0)
+#define STK_UNLOCK(s)   do { (void)(s); } while (0)
+#endif
+
+/* ——————————————————— ESTADO ——————————————————— */
+typedef struct {
+    uint16_t *base, *lim;               // pila: [base, lim)
+    uint16_t *paint;                    // inicio de la zona pintada
+    uint16_t *hw;                       // palabra siguiente a la más alta escrita
+    uint16_t *probe;                    // sonda de las salidas, ≥ hw
+    uint16_t  sp0;                      // W15 de base (valor numérico)
+    uint16_t  hw_mask;                  // combinación atribuida a la marca
+    uint16_t  hw_entry;                 // su W15 de entrada
+    uint16_t  mask;                     // ISR activas ahora
+    uint8_t   claimed;                  // reclamación desde el último stk_poll()
+    uint16_t  claim_mask, claim_sp;
+    uint16_t  isr_sp[STK_IDS];          // entrada más profunda por ISR
+    uint16_t  isr_mask[STK_IDS];        // y su combinación
+} stk_state_t;
+
+static stk_state_t g_stk;
+
+/* ——————————————————— PINTAR / RECORRER ——————————————————— */
+static inline void stk_paint_range(uint16_t *lo, uint16_t *hi)
+{
+    while (lo < hi) *lo++ = STK_PAINT;
+}
+
+/* Palabra siguiente a la más alta distinta de STK_PAINT en [lo, hi);
+   lo si está todo pintado */
+static inline uint16_t *stk_scan_range(uint16_t *lo, uint16_t *hi)
+{
+    while (hi > lo && hi[-1] == STK_PAINT) hi--;
+    return hi;
+}
+
+static inline void stk_init_range(uint16_t *base, uint16_t *paint, uint16_t *lim, uint16_t sp0)
+{
+    stk_paint_range(paint, lim);
+    g_stk.base  = base;
+    g_stk.lim   = lim;
+    g_stk.paint = paint;
+    g_stk.hw    = paint;
+    g_stk.probe = paint < lim ? paint : lim - 1;
+    g_stk.sp0   = sp0;
+    g_stk.hw_mask = g_stk.hw_entry = 0;
+    g_stk.mask    = 0;
+    g_stk.claimed = 0;
+    g_stk.claim_mask = g_stk.claim_sp = 0;
+    for (uint8_t i = 0; i < STK_IDS; i++) g_stk.isr_sp[i] = g_stk.isr_mask[i] = 0;
+}
+
+#ifndef STK_HOST
+/* Con las interrupciones deshabilitadas */
+static inline void stk_init(void)
+{
+    uint16_t *base = &_SP_init;
+    uint16_t *sp   = (uint16_t *)WREG15 + STK_GAP_WORDS;
+    stk_init_range(base, sp, (uint16_t *)SPLIM + 1, (uint16_t)base);
+}
+#endif
+
+/* Recorre y, si la marca subió, la atribuye a la última reclamación
+   (o al lazo). Devuelve 1 si subió. */
+static inline uint8_t stk_poll(void)
+{
+    uint16_t *hw = stk_scan_range(g_stk.hw, g_stk.lim);
+    uint16_t  s, cmask = 0, csp = 0;
+    uint8_t   claimed;
+
+    STK_LOCK(s);
+    claimed = g_stk.claimed;
+    if (claimed) {
+        cmask = g_stk.claim_mask;
+        csp   = g_stk.claim_sp;
+        g_stk.claimed = 0;
+    }
+    if (hw > g_stk.probe)
+        g_stk.probe = hw < g_stk.lim ? hw : g_stk.lim - 1;
+    STK_UNLOCK(s);
+
+    if (hw > g_stk.hw) {
+        g_stk.hw       = hw;
+        g_stk.hw_mask  = cmask;
+        g_stk.hw_entry = csp;
+        return 1;
+    }
+    return 0;
+}
+
+static inline uint16_t stk_used_bytes(void)  { return (uint16_t)(2U * (g_stk.hw - g_stk.base)); }
+static inline uint16_t stk_total_bytes(void) { return (uint16_t)(2U * (g_stk.lim - g_stk.base)); }
+
+/* ——————————————————— GANCHOS DE ISR ——————————————————— */
+typedef struct {
+    uint16_t prev;                      // máscara al entrar
+    uint16_t sp;                        // W15 al entrar
+} stk_frame_t;
+
+/* Una ISR anidada restaura la máscara antes de volver y isr_sp[id]
+   sólo lo escribe la ISR id (no se anida a sí misma): sin bloqueo. */
+static inline stk_frame_t stk_isr_enter(uint8_t id)
+{
+    stk_frame_t f;
+    f.sp   = STK_SP();
+    f.prev = g_stk.mask;
+    uint16_t m = f.prev | (1U << id);
+
+    g_stk.mask = m;
+    if (f.sp > g_stk.isr_sp[id]) { g_stk.isr_sp[id] = f.sp; g_stk.isr_mask[id] = m; }
+    return f;
+}
+
+/* Camino raro: la sonda está escrita. Con IPL 7 para no cruzarse con
+   otra salida ni con stk_poll(). */
+static inline void stk_isr_claim(uint16_t sp)
+{
+    uint16_t s;
+    STK_LOCK(s);
+    uint16_t *p = g_stk.probe, *top = g_stk.lim - 1;
+    if (*p != STK_PAINT) {
+        while (p < top && *p != STK_PAINT) p++;
+        g_stk.probe      = p;
+        g_stk.claimed    = 1;
+        g_stk.claim_mask = g_stk.mask;
+        g_stk.claim_sp   = sp;
+    }
+    STK_UNLOCK(s);
+}
+
+static inline void stk_isr_exit(stk_frame_t f)
+{
+    if (*g_stk.probe != STK_PAINT) stk_isr_claim(f.sp);
+    g_stk.mask = f.prev;
+}
+
+#ifdef STK_WATCH
+#define STK_ISR_ENTER(id)   stk_frame_t stk_f_ = stk_isr_enter(id)
+#define STK_ISR_EXIT()      stk_isr_exit(stk_f_)
+#else
+#define STK_ISR_ENTER(id)   do { } while (0)
+#define STK_ISR_EXIT()      do { } while (0)
+#endif
+
+/* ——————————————————— INFORME ——————————————————— */
+static inline char *stk_put_u(char *p, uint16_t v)
+{
+    char d[5];
+    uint8_t n = 0;
+    do { d[n++] = (char)('0' + v % 10U); v /= 10U; } while (v);
+    while (n) *p++ = d[--n];
+    return p;
+}
+
+static inline char *stk_put_mask(char *p, uint16_t m, const char *const *names)
+{
+    uint8_t first = 1;
+    if (!m) {
+        const char *s = "lazo";
+        while (*s) *p++ = *s++;
+        return p;
+    }
+    for (uint8_t i = 0; i < STK_IDS; i++) {
+        if (!(m & (1U << i))) continue;
+        if (!first) *p++ = '>';
+        first = 0;
+        const char *s = names[i];
+        while (*s) *p++ = *s++;
+    }
+    return p;
+}
+
+/* "pila 318/640 B (49%) por T2>T1>ADC entrada 212\r\n"; names[id] en
+   orden de prioridad creciente. buf ≥ 32 + nombres de la máscara. */
+static inline uint8_t stk_format(char *buf, const char *const *names)
+{
+    char    *p = buf;
+    uint16_t used = stk_used_bytes(), total = stk_total_bytes();
+    const char *s;
+
+    for (s = "pila "; *s; ) *p++ = *s++;
+    p = stk_put_u(p, used);
+    *p++ = '/';
+    p = stk_put_u(p, total);
+    for (s = " B ("; *s; ) *p++ = *s++;
+    p = stk_put_u(p, (uint16_t)((uint32_t)used * 100U / total));
+    for (s = "%) por "; *s; ) *p++ = *s++;
+    p = stk_put_mask(p, g_stk.hw_mask, names);
+    if (g_stk.hw_mask) {
+        for (s = " entrada "; *s; ) *p++ = *s++;
+        p = stk_put_u(p, (uint16_t)(g_stk.hw_entry - g_stk.sp0));
+    }
+    *p++ = '\r';
+    *p++ = '\n';
+    return (uint8_t)(p - buf);
+}
+
+#endif  /* STACK_WATCH_H */
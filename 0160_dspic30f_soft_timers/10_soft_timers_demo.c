@@ -0,0 +1,309 @@
+/*************************************************************
+ *  dsPIC30F4011  – FRC 7.37 MHz ×16 PLL  (FCY ≈ 29.48 MHz)
+ *  Toolchain     – XC-DSC 3.21
+ *  Demo:  temporizadores por software sobre Timer1 (timer_wheel.h)
+ *
+ *  – Timer1 es el único tick (1 kHz, IPL 4); todo lo periódico o con
+ *    plazo es un tw_timer_t:
+ *      latido   periódico 500 ms   LED en RD1
+ *      informe  periódico 1 s      línea por UART2 desde el lazo
+ *      enlace   una vez 2 s        se rearma con cada byte recibido;
+ *                                  al vencer enciende RD0 (sin enlace)
+ *      carga    LOAD_N periódicos  '+' los arma con periodos 3…97 ms,
+ *                                  '-' los detiene
+ *  – Timer3 queda para el ADC (AN0 a 8 kHz, IPL 6) y Timer2 corre
+ *    libre a TCY: mide cuánto dura cada tick con sus callbacks.
+ *  – Informe:  "tick 38/212 TCY venc 41 carga 32 adc 512\r\n"
+ *    (tick medio/máximo del último segundo, vencimientos en ese
+ *    segundo, temporizadores de carga armados y media de AN0).
+ *************************************************************/
+
+/*****************  CONFIGURATION BITS – FRC + PLL16  *****************/
+#pragma config FPR     = FRC_PLL16     // Primary Osc = FRC ×16 PLL
+#pragma config FOS     = PRI
+#pragma config FCKSMEN = CSW_FSCM_OFF
+#pragma config PWMPIN  = RST_PWMPIN
+#pragma config LPOL    = PWMxL_ACT_HI
+#pragma config HPOL    = PWMxH_ACT_HI
+#pragma config WDT     = WDT_OFF
+#pragma config FPWRT   = PWRT_64
+#pragma config BODENV  = BORV42
+#pragma config BOREN   = PBOR_OFF
+#pragma config MCLRE   = MCLR_EN
+#pragma config GWRP    = GWRP_OFF
+#pragma config GCP     = CODE_PROT_OFF
+#pragma config ICS     = ICS_PGD
+
+/* ——————————————————— CONSTANTES DE DISEÑO —————————————————— */
+#define _CRYSTAL_WORK   (7370000UL*16)
+#define FCY             (_CRYSTAL_WORK/4)          // ≈ 29.48 MHz
+
+#define TW_STATS                                   // cuenta vencimientos
+#include <xc.h>
+#include <stdint.h>
+#include <libpic30.h>
+#include "timer_wheel.h"
+
+#define PR1_COUNTS      ((FCY / 1000UL) - 1)       // tick de 1 ms
+#define ADC_FS_HZ       8000UL
+#define PR3_COUNTS      ((FCY / ADC_FS_HZ) - 1)
+#define ADCS_TAD_COUNTS 9
+
+#define UART_BAUD       115200UL
+#define U2BRG_VAL       (((FCY + 8UL * UART_BAUD) / (16UL * UART_BAUD)) - 1UL)
+#define TX_RING_LEN     128U                       // potencia de 2
+
+#define BEAT_MS         500U
+#define REPORT_MS       1000U
+#define LINK_MS         2000U
+#define LOAD_N          32U
+
+#define BEAT_TRIS       TRISDbits.TRISD1
+#define BEAT_LAT        LATDbits.LATD1
+#define LINK_TRIS       TRISDbits.TRISD0
+#define LINK_LAT        LATDbits.LATD0
+
+/* ——————————————————— VARIABLES GLOBALES ————————————————— */
+static tw_timer_t        g_beat, g_report, g_link;
+static tw_timer_t        g_load[LOAD_N];
+static volatile uint16_t g_load_hits[LOAD_N];
+
+static volatile uint32_t g_acc = 0;
+static volatile uint16_t g_acc_n = 0;
+static volatile uint16_t g_tick_max = 0;           // TCY, desde el último informe
+static volatile uint32_t g_tick_sum = 0;
+static volatile uint16_t g_tick_n = 0;
+static volatile uint8_t  g_report_due = 0;
+static volatile uint8_t  g_cmd = 0;                // '+' / '-' pendiente
+
+static uint8_t           g_tx_ring[TX_RING_LEN];
+static uint16_t          g_tx_head = 0, g_tx_tail = 0;
+
+/* ——————————————————— PROTOTIPOS ——————————————————— */
+static void timers_init(void);
+static void adc_init_an0(void);
+static void uart2_init(void);
+static void load_arm(uint8_t on);
+static uint8_t report_format(char *buf);
+static void tx_line(const char *s, uint8_t len);
+static void tx_pump(void);
+
+/* ——————————————————— CALLBACKS (en la ISR de Timer1) ——————————— */
+static void on_beat(void *arg)   { (void)arg; BEAT_LAT ^= 1; }
+static void on_report(void *arg) { (void)arg; g_report_due = 1; }
+static void on_link(void *arg)   { (void)arg; LINK_LAT = 1; }
+
+static void on_load(void *arg)
+{
+    g_load_hits[(uintptr_t)arg]++;
+}
+
+/* ——————————————————— TIMERS: T1 tick, T2 libre a TCY ——————————— */
+static void timers_init(void)
+{
+    T2CON = 0;
+    TMR2  = 0;
+    PR2   = 0xFFFF;
+    T2CONbits.TON = 1;
+
+    T1CON = 0;
+    TMR1  = 0;
+    PR1   = PR1_COUNTS;
+    IFS0bits.T1IF = 0;
+    IPC0bits.T1IP = TW_IPL;
+    IEC0bits.T1IE = 1;
+    T1CONbits.TON = 1;
+}
+
+/* ——————————————————— ADC: Timer3 sobre AN0 ———————————————— */
+static void adc_init_an0(void)
+{
+    ADPCFG = 0xFFFF;
+    ADPCFGbits.PCFG0 = 0;
+
+    ADCON1 = 0;
+    ADCON1bits.FORM = 0;       // entero 0…1023
+    ADCON1bits.SSRC = 0b010;   // Timer3
+    ADCON1bits.ASAM = 1;
+
+    ADCON2 = 0;
+    ADCON3bits.ADCS = ADCS_TAD_COUNTS;
+    ADCHS = 0;
+
+    T3CON = 0;
+    TMR3  = 0;
+    PR3   = PR3_COUNTS;
+
+    IFS0bits.ADIF = 0;
+    IPC2bits.ADIP = 6;
+    IEC0bits.ADIE = 1;
+
+    ADCON1bits.ADON = 1;
+    T3CONbits.TON   = 1;
+}
+
+/* ——————————————————— UART2: 8N1, TX y RX ———————————————— */
+static void uart2_init(void)
+{
+    U2MODE = 0;
+    U2BRG  = (uint16_t)U2BRG_VAL;
+    U2STA  = 0;
+    U2MODEbits.UARTEN = 1;
+    U2STAbits.UTXEN   = 1;
+
+    IFS1bits.U2RXIF = 0;
+    IPC6bits.U2RXIP = 3;       // ≤ TW_IPL: puede llamar a tw_start()
+    IEC1bits.U2RXIE = 1;
+}
+
+/* ——————————————————— ISR ——————————————————— */
+void __attribute__((interrupt, auto_psv)) _ADCInterrupt(void)
+{
+    IFS0bits.ADIF = 0;
+    g_acc += ADCBUF0;
+    g_acc_n++;
+}
+
+/* Cada byte rearma el plazo del enlace: stop + start, O(1) */
+void __attribute__((interrupt, auto_psv)) _U2RXInterrupt(void)
+{
+    IFS1bits.U2RXIF = 0;
+
+    while (U2STAbits.URXDA) {
+        uint8_t c = (uint8_t)U2RXREG;
+        if (c == '+' || c == '-') g_cmd = c;
+    }
+    if (U2STAbits.OERR) U2STAbits.OERR = 0;
+    tw_start(&g_link, LINK_MS, 0, on_link, NULL);
+    LINK_LAT = 0;
+}
+
+void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
+{
+    uint16_t t0 = TMR2;
+    IFS0bits.T1IF = 0;
+
+    tw_tick();
+
+    uint16_t dt = (uint16_t)(TMR2 - t0);
+    if (dt > g_tick_max) g_tick_max = dt;
+    g_tick_sum += dt;
+    g_tick_n++;
+}
+
+/* ——————————————————— CARGA ——————————————————— */
+/* Periodos primos: los vencimientos casi nunca caen todos juntos */
+static const uint8_t k_load_ms[LOAD_N] = {
+     3,  5,  7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59,
+    61, 67, 71, 73, 79, 83, 89, 97,  3,  5,  7, 11, 13, 17, 19, 23 };
+
+static void load_arm(uint8_t on)
+{
+    for (uint16_t i = 0; i < LOAD_N; i++) {
+        if (on) tw_start(&g_load[i], k_load_ms[i], k_load_ms[i], on_load, (void *)(uintptr_t)i);
+        else    tw_stop(&g_load[i]);
+    }
+}
+
+/* ——————————————————— INFORME ——————————————————— */
+static char *put_u(char *p, uint16_t v)
+{
+    char d[5];
+    uint8_t n = 0;
+    do { d[n++] = (char)('0' + v % 10U); v /= 10U; } while (v);
+    while (n) *p++ = d[--n];
+    return p;
+}
+
+static char *put_s(char *p, const char *s)
+{
+    while (*s) *p++ = *s++;
+    return p;
+}
+
+/* Toma y reinicia las cuentas del último segundo */
+static uint8_t report_format(char *buf)
+{
+    static uint32_t last_expired = 0;
+    uint32_t sum, acc, expired;
+    uint16_t n, max, acc_n, armed = 0;
+    uint16_t s;
+    char    *p = buf;
+
+    TW_LOCK(s);
+    sum = g_tick_sum;  g_tick_sum = 0;
+    n   = g_tick_n;    g_tick_n   = 0;
+    max = g_tick_max;  g_tick_max = 0;
+    expired = g_tw.expired;
+    TW_UNLOCK(s);
+    __builtin_disable_interrupts();
+    acc   = g_acc;    g_acc   = 0;
+    acc_n = g_acc_n;  g_acc_n = 0;
+    __builtin_enable_interrupts();
+    for (uint8_t i = 0; i < LOAD_N; i++) armed += tw_active(&g_load[i]);
+
+    p = put_s(p, "tick ");
+    p = put_u(p, n ? (uint16_t)(sum / n) : 0);
+    *p++ = '/';
+    p = put_u(p, max);
+    p = put_s(p, " TCY venc ");
+    p = put_u(p, (uint16_t)(expired - last_expired));
+    p = put_s(p, " carga ");
+    p = put_u(p, armed);
+    p = put_s(p, " adc ");
+    p = put_u(p, acc_n ? (uint16_t)(acc / acc_n) : 0);
+    *p++ = '\r';
+    *p++ = '\n';
+    last_expired = expired;
+    return (uint8_t)(p - buf);
+}
+
+/* ——————————————————— UART2: líneas completas o nada ——————————— */
+static void tx_line(const char *s, uint8_t len)
+{
+    if ((uint16_t)(TX_RING_LEN - (g_tx_head - g_tx_tail)) < len) return;
+    for (uint8_t i = 0; i < len; i++)
+        g_tx_ring[(g_tx_head++) & (TX_RING_LEN - 1)] = (uint8_t)s[i];
+}
+
+static void tx_pump(void)
+{
+    while (g_tx_tail != g_tx_head && !U2STAbits.UTXBF)
+        U2TXREG = g_tx_ring[(g_tx_tail++) & (TX_RING_LEN - 1)];
+}
+
+/* ——————————————————— PROGRAMA PRINCIPAL ——————————————— */
+int main(void)
+{
+    char line[64];
+
+    __builtin_disable_interrupts();
+
+    BEAT_TRIS = 0;  BEAT_LAT = 0;
+    LINK_TRIS = 0;  LINK_LAT = 1;              // sin enlace hasta el primer byte
+
+    tw_init();
+    tw_start(&g_beat,   BEAT_MS,   BEAT_MS,   on_beat,   NULL);
+    tw_start(&g_report, REPORT_MS, REPORT_MS, on_report, NULL);
+
+    uart2_init();
+    adc_init_an0();
+    timers_init();
+
+    __builtin_enable_interrupts();
+
+    for (;;)
+    {
+        uint8_t c = g_cmd;
+        if (c) {
+            g_cmd = 0;
+            load_arm(c == '+');
+        }
+        if (g_report_due) {
+            g_report_due = 0;
+            tx_line(line, report_format(line));
+        }
+        tx_pump();
+    }
+    return 0;
+}
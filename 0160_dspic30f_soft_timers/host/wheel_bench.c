@@ -0,0 +1,278 @@
+/*************************************************************
+ *  wheel_bench – exactitud y costo de timer_wheel.h en PC
+ *
+ *  cc -O2 -Wall -I.. -o wheel_bench wheel_bench.c
+ *
+ *  Un modelo de referencia lleva el vencimiento de cada temporizador
+ *  en ticks de 64 bits. Cada caso imprime sus cifras y PASS/FAIL; el
+ *  código de salida es el número de fallas.
+ *
+ *    1 exactitud  – 4096 temporizadores de una vez y periódicos con
+ *                   plazos de 1…65535 ticks durante varias vueltas del
+ *                   tick de 16 bits; entre ticks y desde los callbacks
+ *                   se arrancan, rearman y detienen al azar (también
+ *                   los que faltan recorrer en el mismo tick): cada uno
+ *                   vence exactamente en su tick, ninguno se pierde y
+ *                   ninguno detenido vence
+ *    2 O(1)       – tw_stop() + tw_start() al azar con 16…16384
+ *                   temporizadores armados: ns por par
+ *    3 por tick   – a) todos periódicos, una vuelta completa: nodos
+ *                      repartidos por vencimiento ≤ TW_LEVELS − 1 y ns
+ *                      por (tick + nodo tocado), sin importar cuántos hay
+ *                   b) todos esperando más allá de la ventana: cero
+ *                      nodos tocados y ns por tick parejos; al lado, una
+ *                      lista que descuenta cada temporizador en cada
+ *                      tick (lo que hace un servicio ingenuo)
+ *  Las cifras en ns son orientativas y no deciden PASS/FAIL salvo
+ *  por un margen amplio (4×) entre el menor y el mayor.
+ *************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#define TW_HOST
+#define TW_STATS
+#include "timer_wheel.h"
+
+#define NX              4096U           // caso 1
+#define TICKS_X         300000UL
+#define N_MAX           16384U
+#define REPS_OPS        1000000UL
+
+static int g_fail;
+
+static void check(const char *what, int ok)
+{
+    printf("    %s  %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) g_fail++;
+}
+
+static uint32_t g_rng = 12345U;
+static uint32_t rnd32(void)              { g_rng ^= g_rng << 13; g_rng ^= g_rng >> 17; g_rng ^= g_rng << 5; return g_rng; }
+static unsigned rndn(unsigned n)         { return (unsigned)(rnd32() % n); }
+static uint16_t rnd_delay(void)
+{
+    /* la mitad cortos (niveles 0–1), el resto en todo el rango */
+    return (uint16_t)(rndn(2) ? 1U + rndn(255U) : 1U + rndn(65535U));
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* ——————————————————— REFERENCIA ——————————————————— */
+static tw_timer_t g_t[N_MAX];
+static uint64_t   g_due[N_MAX];
+static uint8_t    g_armed[N_MAX];
+static uint16_t   g_per[N_MAX];
+static uint64_t   g_tick;               // ticks de 64 bits
+static unsigned   g_n;
+static unsigned long g_fired, g_wrong, g_stopped_fired;
+static int        g_chaos;              // callbacks que tocan otros
+
+static void ref_start(unsigned i, uint16_t delay, uint16_t period);
+
+static void on_fire(void *arg)
+{
+    unsigned i = (unsigned)(uintptr_t)arg;
+
+    g_fired++;
+    if (!g_armed[i])            g_stopped_fired++;
+    else if (g_due[i] != g_tick) g_wrong++;
+    if (g_per[i]) g_due[i] += g_per[i];
+    else          g_armed[i] = 0;
+
+    if (!g_chaos) return;
+    switch (rndn(8)) {
+    case 0: {                               // detener otro (quizá del mismo tick)
+        unsigned j = rndn(g_n);
+        tw_stop(&g_t[j]);
+        g_armed[j] = 0;
+        break;
+    }
+    case 1:                                 // rearmarse con otro plazo
+        ref_start(i, rnd_delay(), rndn(2) ? rnd_delay() : 0);
+        break;
+    case 2:                                 // detenerse
+        tw_stop(&g_t[i]);
+        g_armed[i] = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+static void ref_start(unsigned i, uint16_t delay, uint16_t period)
+{
+    tw_start(&g_t[i], delay, period, on_fire, (void *)(uintptr_t)i);
+    g_due[i]   = g_tick + (delay ? delay : 1U);
+    g_per[i]   = period;
+    g_armed[i] = 1;
+}
+
+static void ref_reset(unsigned n)
+{
+    tw_init();
+    for (unsigned i = 0; i < N_MAX; i++) { g_t[i].pprev = NULL; g_armed[i] = 0; }
+    g_tick = 0;
+    g_n = n;
+    g_fired = g_wrong = g_stopped_fired = 0;
+    g_tw.expired = g_tw.cascaded = 0;
+}
+
+static void ref_tick(void)
+{
+    g_tick++;
+    tw_tick();
+}
+
+/* Armados con vencimiento pasado: perdidos */
+static unsigned long ref_lost(void)
+{
+    unsigned long lost = 0;
+    for (unsigned i = 0; i < g_n; i++)
+        if (g_armed[i] && (g_due[i] <= g_tick || !tw_active(&g_t[i]))) lost++;
+    return lost;
+}
+
+/* ——————————————————— 1 EXACTITUD ——————————————————— */
+static void case_exact(void)
+{
+    unsigned long lost = 0, active_ok = 1;
+
+    printf("1 exactitud: %u temporizadores, %lu ticks\n", NX, TICKS_X);
+    ref_reset(NX);
+    g_chaos = 1;
+    for (unsigned i = 0; i < NX; i++)
+        ref_start(i, rnd_delay(), rndn(2) ? rnd_delay() : 0);
+
+    for (unsigned long k = 0; k < TICKS_X; k++) {
+        for (unsigned r = rndn(4); r; r--) {
+            unsigned i = rndn(NX);
+            if (rndn(3)) ref_start(i, rnd_delay(), rndn(2) ? rnd_delay() : 0);
+            else { tw_stop(&g_t[i]); g_armed[i] = 0; }
+        }
+        ref_tick();
+        if (k % 997U == 0) lost += ref_lost();
+    }
+    lost += ref_lost();
+    for (unsigned i = 0; i < NX; i++)
+        if (g_armed[i] != tw_active(&g_t[i])) active_ok = 0;
+
+    printf("    vencidos %lu, repartidos %lu (%.2f por vencimiento)\n",
+           g_fired, (unsigned long)g_tw.cascaded, (double)g_tw.cascaded / g_fired);
+    check("cada vencimiento en su tick", g_fired > 0 && g_wrong == 0);
+    check("ningún detenido vence", g_stopped_fired == 0);
+    check("ninguno se pierde", lost == 0);
+    check("tw_active() igual a la referencia", active_ok);
+    g_chaos = 0;
+}
+
+/* ——————————————————— 2 INSERTAR / CANCELAR ——————————————— */
+static const unsigned k_sizes[] = { 16, 256, 4096, N_MAX };
+#define NSIZES (sizeof k_sizes / sizeof k_sizes[0])
+
+static void case_ops(void)
+{
+    double ns[NSIZES], lo = 1e30, hi = 0;
+
+    printf("2 O(1): tw_stop() + tw_start() con n armados\n");
+    for (unsigned s = 0; s < NSIZES; s++) {
+        unsigned n = k_sizes[s];
+        ref_reset(n);
+        for (unsigned i = 0; i < n; i++) ref_start(i, rnd_delay(), rnd_delay());
+
+        double best = 1e30;
+        for (int rep = 0; rep < 5; rep++) {
+            double t0 = now_ns();
+            for (unsigned long k = 0; k < REPS_OPS; k++) {
+                tw_timer_t *t = &g_t[rndn(n)];
+                tw_stop(t);                 // sigue habiendo n armados
+                tw_start(t, rnd_delay(), rnd_delay(), on_fire, NULL);
+            }
+            double dt = (now_ns() - t0) / REPS_OPS;
+            if (dt < best) best = dt;
+        }
+        ns[s] = best;
+        if (best < lo) lo = best;
+        if (best > hi) hi = best;
+        printf("    n = %5u   %6.1f ns por par\n", n, ns[s]);
+    }
+    check("ns por par parejos (mayor ≤ 4× menor)", hi <= 4.0 * lo);
+}
+
+/* ——————————————————— 3 COSTO POR TICK ——————————————————— */
+static uint16_t g_naive_left[N_MAX];
+
+static void case_tick(void)
+{
+    double lo_e = 1e30, hi_e = 0, lo_i = 1e30, hi_i = 0;
+    int    casc_ok = 1, idle_ok = 1;
+
+    printf("3 por tick: a) todos periódicos, una vuelta de 65536 ticks\n");
+    printf("            b) todos esperando, ventana de 8191 ticks\n");
+    printf("        n   repart/venc  ns/(tick+nodo) ns/tick b) nodos b) lista ns/tick\n");
+    for (unsigned s = 0; s < NSIZES; s++) {
+        unsigned n = k_sizes[s];
+
+        /* a) */
+        ref_reset(n);
+        for (unsigned i = 0; i < n; i++) ref_start(i, rnd_delay(), rnd_delay());
+        g_tw.expired = g_tw.cascaded = 0;
+        double t0 = now_ns();
+        for (unsigned long k = 0; k < 65536UL; k++) ref_tick();
+        double ns_e = (now_ns() - t0) / (65536.0 + g_tw.expired + g_tw.cascaded);
+        double cpe  = (double)g_tw.cascaded / (double)g_tw.expired;
+        if (cpe > TW_LEVELS - 1U || g_wrong) casc_ok = 0;
+        if (ns_e < lo_e) lo_e = ns_e;
+        if (ns_e > hi_e) hi_e = ns_e;
+
+        /* b) vencen en [8192, 65535]: ningún bloque suyo empieza antes */
+        double best = 1e30;
+        uint32_t touched = 0;
+        for (int rep = 0; rep < 5; rep++) {
+            ref_reset(n);
+            for (unsigned i = 0; i < n; i++)
+                ref_start(i, (uint16_t)(8192U + rndn(65536U - 8192U)), 0);
+            t0 = now_ns();
+            for (unsigned long k = 0; k < 8191UL; k++) ref_tick();
+            double dt = (now_ns() - t0) / 8191.0;
+            if (dt < best) best = dt;
+            touched += g_tw.expired + g_tw.cascaded;
+        }
+        if (touched) idle_ok = 0;
+        if (best < lo_i) lo_i = best;
+        if (best > hi_i) hi_i = best;
+
+        /* lista ingenua: descontar cada uno en cada tick */
+        for (unsigned i = 0; i < n; i++) g_naive_left[i] = (uint16_t)(8192U + rndn(65536U - 8192U));
+        volatile unsigned fired = 0;
+        t0 = now_ns();
+        for (unsigned long k = 0; k < 8191UL; k++)
+            for (unsigned i = 0; i < n; i++)
+                if (--g_naive_left[i] == 0) fired++;
+        double ns_l = (now_ns() - t0) / 8191.0;
+
+        printf("    %5u   %8.2f    %10.1f    %9.1f %8lu %12.1f\n",
+               n, cpe, ns_e, best, (unsigned long)touched, ns_l);
+    }
+    check("a) repartidos por vencimiento ≤ TW_LEVELS − 1, todos a tiempo", casc_ok);
+    check("a) ns por tick y nodo parejos (mayor ≤ 4× menor)", hi_e <= 4.0 * lo_e);
+    check("b) ningún nodo tocado mientras esperan", idle_ok);
+    check("b) ns por tick parejos (mayor ≤ 4× menor)", hi_i <= 4.0 * lo_i);
+}
+
+int main(void)
+{
+    printf("timer_wheel: %u niveles × %u casilleros, %u bytes de casilleros en dsPIC\n\n",
+           TW_LEVELS, TW_SLOTS, 2U * TW_LEVELS * TW_SLOTS);
+    case_exact();
+    case_ops();
+    case_tick();
+    printf("\n%s (%d fallas)\n", g_fail ? "FAIL" : "PASS", g_fail);
+    return g_fail;
+}
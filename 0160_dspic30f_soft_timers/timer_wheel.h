@@ -0,0 +1,181 @@
+/*************************************************************
+ *  Temporizadores por software sobre un solo tick – header-only
+ *
+ *  Rueda jerárquica: TW_LEVELS niveles de TW_SLOTS casilleros que
+ *  cubren el tick de 16 bits completo (4 × 16 = 65536 ticks):
+ *    nivel 0   un casillero por tick; vence lo que está en el de ahora
+ *    nivel k   un casillero cada 16^k ticks; al empezar ese bloque su
+ *              lista se reparte en los niveles de abajo
+ *  Cada temporizador es un nodo de lista doble dentro de la estructura
+ *  del usuario (sin memoria dinámica, 12 bytes):
+ *    tw_start()   O(1)   una vez (period = 0) o periódico, 1…65535 ticks
+ *    tw_stop()    O(1)   también desde un callback, sobre cualquiera
+ *    tw_tick()    O(1) + lo que vence + lo que se reparte; un
+ *                 temporizador baja a lo más TW_LEVELS − 1 veces por
+ *                 vuelta, así que el costo por tick no depende de
+ *                 cuántos esperan, sólo de cuántos vencen.
+ *  – Los periódicos se rearman a expires + period antes del callback:
+ *    sin deriva, y el callback puede detenerlos o rearmarlos.
+ *  – tw_tick() va en la ISR del tick; los callbacks corren ahí, con su
+ *    prioridad. tw_start()/tw_stop() desde el lazo o desde ISR de
+ *    prioridad ≤ TW_IPL (suben la IPL a TW_IPL un instante).
+ *  – RAM: 2 · TW_LEVELS · TW_SLOTS = 128 bytes de casilleros + 12 por
+ *    temporizador.
+ *
+ *  TW_HOST: sin registros, para el banco de PC. TW_STATS cuenta los
+ *  nodos vencidos y repartidos.
+ *************************************************************/
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#ifndef TW_HOST
+#include <xc.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TW_IPL
+#define TW_IPL          4               // prioridad de la ISR del tick
+#endif
+#define TW_BITS         4U
+#define TW_SLOTS        (1U << TW_BITS)
+#define TW_LEVELS       4U              // TW_BITS · TW_LEVELS = 16
+
+#ifndef TW_HOST
+#define TW_LOCK(s)      do { (s) = SRbits.IPL; if ((s) < TW_IPL) SRbits.IPL = TW_IPL; } while (0)
+#define TW_UNLOCK(s)    do { SRbits.IPL = (s); } while (0)
+#else
+#define TW_LOCK(s)      do { (s) = 0; } while (0)
+#define TW_UNLOCK(s)    do { (void)(s); } while (0)
+#endif
+
+#ifdef TW_STATS
+#define TW_COUNT(f)     (g_tw.f++)
+#else
+#define TW_COUNT(f)     do { } while (0)
+#endif
+
+/* ——————————————————— TIPOS ——————————————————— */
+typedef void (*tw_fn_t)(void *arg);
+
+typedef struct tw_timer {
+    struct tw_timer  *next;
+    struct tw_timer **pprev;            // NULL = detenido
+    uint16_t          expires;          // tick absoluto
+    uint16_t          period;           // 0 = una vez
+    tw_fn_t           fn;
+    void             *arg;
+} tw_timer_t;
+
+typedef struct {
+    tw_timer_t *slot[TW_LEVELS][TW_SLOTS];
+    uint16_t    now;                    // último tick procesado
+#ifdef TW_STATS
+    uint32_t    expired, cascaded;      // nodos vencidos / repartidos
+#endif
+} tw_wheel_t;
+
+static tw_wheel_t g_tw;
+
+/* ——————————————————— LISTAS ——————————————————— */
+static inline void tw_link(tw_timer_t **head, tw_timer_t *t)
+{
+    t->next = *head;
+    if (t->next) t->next->pprev = &t->next;
+    *head    = t;
+    t->pprev = head;
+}
+
+static inline void tw_unlink(tw_timer_t *t)
+{
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    t->pprev = NULL;
+}
+
+/* Nivel por lo que falta (16^k ≤ d < 16^(k+1)), casillero por el tick
+   de vencimiento: se visita justo al empezar su bloque */
+static inline void tw_place(tw_timer_t *t)
+{
+    uint16_t d = (uint16_t)(t->expires - g_tw.now);
+    uint8_t  k = 0;
+
+    while (k < TW_LEVELS - 1U && (d >> (TW_BITS * (k + 1U))) != 0) k++;
+    tw_link(&g_tw.slot[k][(t->expires >> (TW_BITS * k)) & (TW_SLOTS - 1U)], t);
+}
+
+/* Saca la lista del casillero a una cabeza local: un callback puede
+   detener cualquiera de los que faltan recorrer */
+static inline void tw_take(tw_timer_t **slot, tw_timer_t **local)
+{
+    *local = *slot;
+    *slot  = NULL;
+    if (*local) (*local)->pprev = local;
+}
+
+/* ——————————————————— API ——————————————————— */
+static inline void tw_init(void)
+{
+    for (uint8_t k = 0; k < TW_LEVELS; k++)
+        for (uint8_t i = 0; i < TW_SLOTS; i++)
+            g_tw.slot[k][i] = NULL;
+    g_tw.now = 0;
+}
+
+static inline uint8_t  tw_active(const tw_timer_t *t)  { return t->pprev != NULL; }
+static inline uint16_t tw_now(void)                    { return g_tw.now; }
+
+static inline void tw_stop(tw_timer_t *t)
+{
+    uint16_t s;
+    TW_LOCK(s);
+    if (t->pprev) tw_unlink(t);
+    TW_UNLOCK(s);
+}
+
+/* Vence dentro de delay ticks (0 cuenta como 1); rearranca si ya corría */
+static inline void tw_start(tw_timer_t *t, uint16_t delay, uint16_t period, tw_fn_t fn, void *arg)
+{
+    uint16_t s;
+    if (delay == 0) delay = 1;
+    TW_LOCK(s);
+    if (t->pprev) tw_unlink(t);
+    t->fn      = fn;
+    t->arg     = arg;
+    t->period  = period;
+    t->expires = (uint16_t)(g_tw.now + delay);
+    tw_place(t);
+    TW_UNLOCK(s);
+}
+
+/* Un tick: repartir de arriba hacia abajo los niveles cuyo bloque
+   empieza ahora, luego vencer el casillero del nivel 0 */
+static inline void tw_tick(void)
+{
+    tw_timer_t *list, *t;
+    uint16_t    now = ++g_tw.now;
+    uint8_t     k = 0;
+
+    while (k < TW_LEVELS - 1U && (now & ((1U << (TW_BITS * (k + 1U))) - 1U)) == 0) k++;
+    for (; k > 0; k--) {
+        tw_take(&g_tw.slot[k][(now >> (TW_BITS * k)) & (TW_SLOTS - 1U)], &list);
+        while ((t = list) != NULL) {
+            tw_unlink(t);
+            tw_place(t);
+            TW_COUNT(cascaded);
+        }
+    }
+
+    tw_take(&g_tw.slot[0][now & (TW_SLOTS - 1U)], &list);
+    while ((t = list) != NULL) {
+        tw_unlink(t);
+        if (t->period) {
+            t->expires += t->period;
+            tw_place(t);
+        }
+        TW_COUNT(expired);
+        t->fn(t->arg);
+    }
+}
+
+#endif  /* TIMER_WHEEL_H */